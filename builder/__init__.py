@@ -33,6 +33,7 @@ from .constants import (
 from .downloader import install_mingw
 from .packaging import get_packager
 from .sdl_installer import get_installer
+from .unicode import generate_unicode_tables
 from .utils import (
     BuildError,
     ConvertType,
@@ -238,7 +239,12 @@ class KithareBuilder:
             print(f"Using {compilerpool.maxpoolsize} subprocess(es)")
 
         print()  # newline
-        for file in self.basepath.glob("src/**/*.c*"):
+        # Unicode tables are generated into the build directory, not the source tree
+        generated = self.builddir / "unicode_tables.c"
+        if generate_unicode_tables(generated):
+            print(f"Generated Unicode tables at '{generated}'\n")
+
+        for file in (*self.basepath.glob("src/**/*.c*"), generated):
             if file.suffix not in {".c", ".cpp"}:
                 # not a C or CPP file
                 continue
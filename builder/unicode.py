@@ -0,0 +1,143 @@
+"""
+This file is a part of the Kithare programming language source code.
+The source code for Kithare programming language is distributed under the MIT
+license.
+Copyright (C) 2022 Kithare Organization
+
+builder/unicode.py
+Generates the Unicode XID_Start/XID_Continue lookup tables used by the lexer,
+and the printable one used to escape characters
+"""
+
+import unicodedata
+from pathlib import Path
+
+# Code points are split into blocks of 256, 2 bits each in the XID tables (XID_Start,
+# XID_Continue) and 1 bit each in the printable one
+BLOCK_SHIFT = 8
+BLOCK_SIZE = 1 << BLOCK_SHIFT
+MAX_CODEPOINT = 0x110000
+
+XID_START_BIT = 1
+XID_CONTINUE_BIT = 2
+
+HEADER = """/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ *
+ * Generated by builder/unicode.py from Unicode {version}, do not edit.
+ */
+
+#include <kithare/core/unicode.h>
+
+
+"""
+
+
+def _classify(codepoint: int):
+    """
+    Returns the XID bits of a code point. str.isidentifier follows the
+    XID_Start/XID_Continue properties (PEP 3131), besides accepting '_' as a
+    start character, which the lexer handles on its own
+    """
+    char = chr(codepoint)
+    if 0xD800 <= codepoint <= 0xDFFF:
+        # Lone surrogates are never identifiers
+        return 0
+
+    bits = 0
+    if char != "_" and char.isidentifier():
+        bits |= XID_START_BIT
+    if ("a" + char).isidentifier():
+        bits |= XID_CONTINUE_BIT
+
+    return bits
+
+
+def _is_printable(codepoint: int):
+    """
+    Returns whether a code point is printed as itself when escaping. That is
+    the one of str.isprintable, which leaves out the controls, the format
+    characters, the surrogates, the private use and unassigned code points, and
+    the separators besides the ASCII space
+    """
+    return int(chr(codepoint).isprintable())
+
+
+def _build_tables(classify, width: int):
+    """
+    Builds the two stage tables: the first stage maps the upper bits of a code
+    point to a deduplicated block of width-bit entries in the second stage
+    """
+    per_byte = 8 // width
+    stage1: list[int] = []
+    blocks: dict[bytes, int] = {}
+
+    for high in range(MAX_CODEPOINT >> BLOCK_SHIFT):
+        packed = bytearray(BLOCK_SIZE // per_byte)
+        for low in range(BLOCK_SIZE):
+            bits = classify((high << BLOCK_SHIFT) | low)
+            packed[low // per_byte] |= bits << ((low % per_byte) * width)
+
+        stage1.append(blocks.setdefault(bytes(packed), len(blocks)))
+
+    if len(blocks) > 256:
+        raise ValueError("Unicode tables do not fit in 8-bit block indices")
+
+    return stage1, list(blocks)
+
+
+def _format_bytes(values, indent: str):
+    """
+    Formats a sequence of bytes as rows of a C array initializer
+    """
+    rows = []
+    for i in range(0, len(values), 16):
+        rows.append(indent + ", ".join(f"0x{x:02X}" for x in values[i : i + 16]) + ",")
+
+    return "\n".join(rows)
+
+
+def _format_tables(name: str, stage1, blocks):
+    """
+    Formats both stages of a table as C definitions, named after name
+    """
+    source = f"const uint8_t {name}_stage1[{len(stage1)}] = {{\n"
+    source += _format_bytes(stage1, "    ") + "\n};\n\n"
+
+    source += f"const uint8_t {name}_stage2[{len(blocks)}][{len(blocks[0])}] = {{\n"
+    for block in blocks:
+        source += "    {\n" + _format_bytes(block, "        ") + "\n    },\n"
+    source += "};\n"
+
+    return source
+
+
+def generate_unicode_tables(outfile: Path):
+    """
+    Writes the generated C source of the tables into outfile. The file is only
+    rewritten when its contents change, so that it doesn't trigger rebuilds.
+    Returns True if the file was (re)written
+    """
+    source = HEADER.format(version=unicodedata.unidata_version)
+    source += _format_tables("kh_xid", *_build_tables(_classify, 2))
+    source += "\n"
+    source += _format_tables("kh_printable", *_build_tables(_is_printable, 1))
+
+    try:
+        if outfile.read_text() == source:
+            return False
+    except FileNotFoundError:
+        pass
+
+    outfile.parent.mkdir(parents=True, exist_ok=True)
+    outfile.write_text(source)
+    return True
+
+
+if __name__ == "__main__":
+    import sys
+
+    generate_unicode_tables(Path(sys.argv[1]))
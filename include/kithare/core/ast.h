@@ -13,14 +13,42 @@ extern "C" {
 #include <stdbool.h>
 #include <stdint.h>
 
+#include <kithare/lib/arena.h>
 #include <kithare/lib/array.h>
 #include <kithare/lib/buffer.h>
 #include <kithare/lib/string.h>
+#include <kithare/lib/writer.h>
 
 
 typedef struct khAstStatement khAstStatement;
 typedef struct khAstExpression khAstExpression;
 
+// Each node type has a `_move` function alongside `_copy`, which takes the contents out instead of
+// deeply copying them. What's left behind is empty, and deleting it does nothing
+
+// Spans of the nodes are offsets in characters into the source string, like the ones of the tokens, and
+// each node has the file it was parsed in alongside, see `kh_setFile`. Nodes which don't come from any
+// one place in it, such as the placeholders of what failed to parse or the elements of
+// `khAstPackedValues`, have this as both ends instead
+#define khAst_NO_SPAN UINT32_MAX
+
+
+// Source string of a tree, which its raw literals and skipped blocks are offsets into rather than
+// pointers, so that moving the tree over to another copy of the string only swaps this. It's counted by
+// the nodes which hold it, and freed by the last one to let go of it, or along with the arena it's on.
+// Nodes on an arena never let go of theirs, so they should only be moved over to a source on the same
+// arena. The string itself belongs to the caller, and has to outlive it
+typedef struct {
+    char32_t* string;
+    uint32_t file;
+    uint32_t references;
+    khArena* opt_arena;
+} khAstSource;
+
+khAstSource* khAstSource_new(char32_t* string, uint32_t file, khArena* opt_arena);
+khAstSource* khAstSource_retain(khAstSource* source);
+void khAstSource_release(khAstSource* source);
+
 
 typedef enum {
     khAstStatementType_INVALID,
@@ -59,8 +87,10 @@ typedef struct {
 } khAstVariable;
 
 khAstVariable khAstVariable_copy(khAstVariable* variable);
+khAstVariable khAstVariable_move(khAstVariable* variable);
 void khAstVariable_delete(khAstVariable* variable);
-khstring khAstVariable_string(khAstVariable* variable, char32_t* origin);
+void khAstVariable_write(khAstVariable* variable, khWriter* writer);
+khstring khAstVariable_string(khAstVariable* variable);
 
 
 typedef enum {
@@ -100,22 +130,56 @@ typedef enum {
 khstring khAstExpressionType_string(khAstExpressionType type);
 
 
+// Span of a string or a buffer literal without any escapes, between its quotes. Its payload only gets
+// decoded from there once it's asked for by `khAstExpression_decode`, so the source has to outlive the
+// tree. The source is NULL when the literal isn't raw, or not anymore
+typedef struct {
+    khAstSource* source;
+    uint32_t begin;
+    uint32_t end;
+} khAstRawLiteral;
+
+
+// Elements of a tuple or an array which are all literals of the same type, stored back to back as their
+// values rather than as an expression each. The parser packs big data tables this way, where the list
+// keeps its single span and its elements have none
+typedef struct {
+    khAstExpressionType type; // INVALID when the elements are stored as expressions instead
+    kharray(uint8_t) data;
+} khAstPackedValues;
+
+// Bytes taken by each packed element of the type, 0 if it can't be packed
+size_t khAstPackedValues_width(khAstExpressionType type);
+size_t khAstPackedValues_size(khAstPackedValues* packed);
+// Expands an element into its literal expression, without a span
+khAstExpression khAstPackedValues_get(khAstPackedValues* packed, size_t index);
+
+
 typedef struct {
     kharray(khAstExpression) values;
+    khAstPackedValues packed;
 } khAstTuple;
 
 khAstTuple khAstTuple_copy(khAstTuple* tuple);
+khAstTuple khAstTuple_move(khAstTuple* tuple);
 void khAstTuple_delete(khAstTuple* tuple);
-khstring khAstTuple_string(khAstTuple* tuple, char32_t* origin);
+void khAstTuple_write(khAstTuple* tuple, khWriter* writer);
+khstring khAstTuple_string(khAstTuple* tuple);
+// Expands the packed elements into `values` on first access
+kharray(khAstExpression) * khAstTuple_values(khAstTuple* tuple);
 
 
 typedef struct {
     kharray(khAstExpression) values;
+    khAstPackedValues packed;
 } khAstArray;
 
 khAstArray khAstArray_copy(khAstArray* array);
+khAstArray khAstArray_move(khAstArray* array);
 void khAstArray_delete(khAstArray* array);
-khstring khAstArray_string(khAstArray* array, char32_t* origin);
+void khAstArray_write(khAstArray* array, khWriter* writer);
+khstring khAstArray_string(khAstArray* array);
+kharray(khAstExpression) * khAstArray_values(khAstArray* array);
 
 
 typedef struct {
@@ -124,8 +188,10 @@ typedef struct {
 } khAstDict;
 
 khAstDict khAstDict_copy(khAstDict* dict);
+khAstDict khAstDict_move(khAstDict* dict);
 void khAstDict_delete(khAstDict* dict);
-khstring khAstDict_string(khAstDict* dict, char32_t* origin);
+void khAstDict_write(khAstDict* dict, khWriter* writer);
+khstring khAstDict_string(khAstDict* dict);
 
 
 typedef struct {
@@ -136,22 +202,41 @@ typedef struct {
 } khAstSignature;
 
 khAstSignature khAstSignature_copy(khAstSignature* signature);
+khAstSignature khAstSignature_move(khAstSignature* signature);
 
 void khAstSignature_delete(khAstSignature* signature);
-khstring khAstSignature_string(khAstSignature* signature, char32_t* origin);
+void khAstSignature_write(khAstSignature* signature, khWriter* writer);
+khstring khAstSignature_string(khAstSignature* signature);
+// Moves it out of line, for a SIGNATURE expression to hold
+khAstSignature* khAstSignature_box(khAstSignature signature, khArena* opt_arena);
+
+
+// Source range of a block which got skipped by `kh_parseDeclarations`, left empty until it's parsed on
+// first access
+typedef struct {
+    khAstSource* source; // Source the offsets are in, NULL if there's nothing left to parse
+    uint32_t begin;      // Its opening curly bracket
+    uint32_t end;        // Right after its closing curly bracket
+    khArena* opt_arena;
+} khAstLazyBlock;
 
 
 typedef struct {
     kharray(khAstVariable) arguments;
-    khAstVariable* opt_variadic_argument;
+    khAstVariable* opt_variadic_argument; // Held in an array of one, so that it can be shared
     bool is_return_type_ref;
     khAstExpression* opt_return_type;
     kharray(khAstStatement) block;
+    khAstLazyBlock lazy_block;
 } khAstLambda;
 
 khAstLambda khAstLambda_copy(khAstLambda* lambda);
+khAstLambda khAstLambda_move(khAstLambda* lambda);
 void khAstLambda_delete(khAstLambda* lambda);
-khstring khAstLambda_string(khAstLambda* lambda, char32_t* origin);
+void khAstLambda_write(khAstLambda* lambda, khWriter* writer);
+khstring khAstLambda_string(khAstLambda* lambda);
+// Moves it out of line, for a LAMBDA expression to hold
+khAstLambda* khAstLambda_box(khAstLambda lambda, khArena* opt_arena);
 
 
 typedef enum {
@@ -171,8 +256,10 @@ typedef struct {
 } khAstUnaryExpression;
 
 khAstUnaryExpression khAstUnaryExpression_copy(khAstUnaryExpression* unary_exp);
+khAstUnaryExpression khAstUnaryExpression_move(khAstUnaryExpression* unary_exp);
 void khAstUnaryExpression_delete(khAstUnaryExpression* unary_exp);
-khstring khAstUnaryExpression_string(khAstUnaryExpression* unary_exp, char32_t* origin);
+void khAstUnaryExpression_write(khAstUnaryExpression* unary_exp, khWriter* writer);
+khstring khAstUnaryExpression_string(khAstUnaryExpression* unary_exp);
 
 
 typedef enum {
@@ -222,8 +309,10 @@ typedef struct {
 } khAstBinaryExpression;
 
 khAstBinaryExpression khAstBinaryExpression_copy(khAstBinaryExpression* binary_exp);
+khAstBinaryExpression khAstBinaryExpression_move(khAstBinaryExpression* binary_exp);
 void khAstBinaryExpression_delete(khAstBinaryExpression* binary_exp);
-khstring khAstBinaryExpression_string(khAstBinaryExpression* binary_exp, char32_t* origin);
+void khAstBinaryExpression_write(khAstBinaryExpression* binary_exp, khWriter* writer);
+khstring khAstBinaryExpression_string(khAstBinaryExpression* binary_exp);
 
 
 typedef struct {
@@ -233,8 +322,10 @@ typedef struct {
 } khAstTernaryExpression;
 
 khAstTernaryExpression khAstTernaryExpression_copy(khAstTernaryExpression* ternary_exp);
+khAstTernaryExpression khAstTernaryExpression_move(khAstTernaryExpression* ternary_exp);
 void khAstTernaryExpression_delete(khAstTernaryExpression* ternary_exp);
-khstring khAstTernaryExpression_string(khAstTernaryExpression* ternary_exp, char32_t* origin);
+void khAstTernaryExpression_write(khAstTernaryExpression* ternary_exp, khWriter* writer);
+khstring khAstTernaryExpression_string(khAstTernaryExpression* ternary_exp);
 
 
 typedef enum {
@@ -255,8 +346,10 @@ typedef struct {
 } khAstComparisonExpression;
 
 khAstComparisonExpression khAstComparisonExpression_copy(khAstComparisonExpression* comparison_exp);
+khAstComparisonExpression khAstComparisonExpression_move(khAstComparisonExpression* comparison_exp);
 void khAstComparisonExpression_delete(khAstComparisonExpression* comparison_exp);
-khstring khAstComparisonExpression_string(khAstComparisonExpression* comparison_exp, char32_t* origin);
+void khAstComparisonExpression_write(khAstComparisonExpression* comparison_exp, khWriter* writer);
+khstring khAstComparisonExpression_string(khAstComparisonExpression* comparison_exp);
 
 
 typedef struct {
@@ -265,8 +358,10 @@ typedef struct {
 } khAstCallExpression;
 
 khAstCallExpression khAstCallExpression_copy(khAstCallExpression* call_exp);
+khAstCallExpression khAstCallExpression_move(khAstCallExpression* call_exp);
 void khAstCallExpression_delete(khAstCallExpression* call_exp);
-khstring khAstCallExpression_string(khAstCallExpression* call_exp, char32_t* origin);
+void khAstCallExpression_write(khAstCallExpression* call_exp, khWriter* writer);
+khstring khAstCallExpression_string(khAstCallExpression* call_exp);
 
 
 typedef struct {
@@ -275,8 +370,10 @@ typedef struct {
 } khAstIndexExpression;
 
 khAstIndexExpression khAstIndexExpression_copy(khAstIndexExpression* index_exp);
+khAstIndexExpression khAstIndexExpression_move(khAstIndexExpression* index_exp);
 void khAstIndexExpression_delete(khAstIndexExpression* index_exp);
-khstring khAstIndexExpression_string(khAstIndexExpression* index_exp, char32_t* origin);
+void khAstIndexExpression_write(khAstIndexExpression* index_exp, khWriter* writer);
+khstring khAstIndexExpression_string(khAstIndexExpression* index_exp);
 
 
 typedef struct {
@@ -285,8 +382,10 @@ typedef struct {
 } khAstScopeExpression;
 
 khAstScopeExpression khAstScopeExpression_copy(khAstScopeExpression* scope_exp);
+khAstScopeExpression khAstScopeExpression_move(khAstScopeExpression* scope_exp);
 void khAstScopeExpression_delete(khAstScopeExpression* scope_exp);
-khstring khAstScopeExpression_string(khAstScopeExpression* scope_exp, char32_t* origin);
+void khAstScopeExpression_write(khAstScopeExpression* scope_exp, khWriter* writer);
+khstring khAstScopeExpression_string(khAstScopeExpression* scope_exp);
 
 
 typedef struct {
@@ -295,20 +394,33 @@ typedef struct {
 } khAstTemplatizeExpression;
 
 khAstTemplatizeExpression khAstTemplatizeExpression_copy(khAstTemplatizeExpression* templatize_exp);
+khAstTemplatizeExpression khAstTemplatizeExpression_move(khAstTemplatizeExpression* templatize_exp);
 void khAstTemplatizeExpression_delete(khAstTemplatizeExpression* templatize_exp);
-khstring khAstTemplatizeExpression_string(khAstTemplatizeExpression* templatize_exp, char32_t* origin);
+void khAstTemplatizeExpression_write(khAstTemplatizeExpression* templatize_exp, khWriter* writer);
+khstring khAstTemplatizeExpression_string(khAstTemplatizeExpression* templatize_exp);
 
 
+// Every node is as big as the largest kind it can be, so the payloads are kept to 24 bytes at most:
+// three pointers, as much as a binary expression takes. The rare kinds which would need more hold
+// theirs out of line, being deleted and copied along with the node
 struct khAstExpression {
-    char32_t* begin;
-    char32_t* end;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t file;
 
     khAstExpressionType type;
+    uint64_t hash; // Structural hash, or 0 if it's not computed yet; see `khAstExpression_hash`
     union {
         khstring identifier;
         char32_t char_v;
-        khstring string;
-        khbuffer buffer;
+        struct {
+            union {
+                khstring string;
+                khbuffer buffer;
+                khArena* opt_raw_arena; // Where the payload gets allocated, while it's still raw
+            };
+            khAstRawLiteral raw;
+        };
         uint8_t byte;
         int64_t integer;
         uint64_t uinteger;
@@ -321,8 +433,8 @@ struct khAstExpression {
         khAstArray array;
         khAstDict dict;
 
-        khAstSignature signature;
-        khAstLambda lambda;
+        khAstSignature* signature;
+        khAstLambda* lambda;
 
         khAstUnaryExpression unary;
         khAstBinaryExpression binary;
@@ -337,19 +449,73 @@ struct khAstExpression {
 };
 
 khAstExpression khAstExpression_copy(khAstExpression* expression);
+// Copies only the node itself, with its children and everything else it holds being shared with the
+// original by their reference counts. Neither of them can change what's shared in place afterwards,
+// see `khAstExpression_own` and `kharray_unshare`
+khAstExpression khAstExpression_share(khAstExpression* expression);
+khAstExpression khAstExpression_move(khAstExpression* expression);
 void khAstExpression_delete(khAstExpression* expression);
-khstring khAstExpression_string(khAstExpression* expression, char32_t* origin);
+// Writes the node as JSON, going through its children on a stack of its own rather than the call stack
+void khAstExpression_write(khAstExpression* expression, khWriter* writer);
+khstring khAstExpression_string(khAstExpression* expression);
+// Moves the node and all of its children over to another source, with everything in it `shift`
+// characters further along. Spans are shifted and the nodes take the file of the source, while raw
+// literals and skipped blocks swap the source they hold for it
+void khAstExpression_relocate(khAstExpression* expression, khAstSource* source, int64_t shift);
+// Decodes the payload of a STRING or a BUFFER expression if it's still raw, only on the first call
+void khAstExpression_decode(khAstExpression* expression);
+// Bytes taken by the node itself, along with what it holds out of line. Its children, strings and
+// arrays are left out, so that summing it up over a tree tells how much the layout of the nodes takes
+size_t khAstExpression_footprint(khAstExpression* expression);
+
+// Expressions which a parent points to are boxed along with a reference count, so that the nodes made
+// by `khAstExpression_share` can point to the same ones. Boxes on an arena count their references too,
+// but are only freed along with it
+khAstExpression* khAstExpression_box(khAstExpression expression, khArena* opt_arena);
+// Takes the expression out of a box which isn't shared, freeing the box
+khAstExpression khAstExpression_unbox(khAstExpression* boxed);
+khAstExpression* khAstExpression_retain(khAstExpression* boxed);
+// The boxed expression gets deleted by whatever lets go of it last
+void khAstExpression_release(khAstExpression* boxed);
+// Copy-on-write: a shared box gets replaced with one of its own, holding a shared copy of the node. It
+// gives the expression which can then be changed
+khAstExpression* khAstExpression_own(khAstExpression** boxed);
+
+// Hash of the node's type and payload folded with the hashes of its children, leaving out the spans.
+// The parser sets it on every node as it goes, and it's only computed here for the nodes which don't
+// have it yet, so it's O(1) on a parsed tree. A node that gets changed afterwards has to have it set
+// back to 0. Raw literals hash the same as decoded ones, and so do packed values and expressions.
+// Lambdas go through the statements of their bodies, while a body which is yet to be parsed only
+// matches one over the same source; parsing it changes the node
+uint64_t khAstExpression_hash(khAstExpression* expression);
+// Structural equality, which only goes through both trees when their hashes match
+bool khAstExpression_equal(khAstExpression* a, khAstExpression* b);
+
+
+// Hash-consing table, which hands out a single node for each set of structurally equal ones. It
+// doesn't own the nodes, which have to outlive it
+typedef struct {
+    kharray(khAstExpression*) slots; // Open addressing by the hashes of the nodes, NULL when empty
+    size_t count;
+} khAstInterner;
+
+khAstInterner khAstInterner_new(void);
+void khAstInterner_delete(khAstInterner* interner);
+// Gives the node equal to the expression which came first, which is the expression itself if it's new
+khAstExpression* khAstInterner_intern(khAstInterner* interner, khAstExpression* expression);
 
 
 typedef struct {
     kharray(khstring) path;
     bool relative;
-    khstring* opt_alias;
+    khstring* opt_alias; // Held in an array of one, so that it can be shared
 } khAstImport;
 
 khAstImport khAstImport_copy(khAstImport* import_v);
+khAstImport khAstImport_move(khAstImport* import_v);
 void khAstImport_delete(khAstImport* import_v);
-khstring khAstImport_string(khAstImport* import_v, char32_t* origin);
+void khAstImport_write(khAstImport* import_v, khWriter* writer);
+khstring khAstImport_string(khAstImport* import_v);
 
 
 typedef struct {
@@ -358,8 +524,10 @@ typedef struct {
 } khAstInclude;
 
 khAstInclude khAstInclude_copy(khAstInclude* include);
+khAstInclude khAstInclude_move(khAstInclude* include);
 void khAstInclude_delete(khAstInclude* include);
-khstring khAstInclude_string(khAstInclude* include, char32_t* origin);
+void khAstInclude_write(khAstInclude* include, khWriter* writer);
+khstring khAstInclude_string(khAstInclude* include);
 
 
 typedef struct {
@@ -368,15 +536,18 @@ typedef struct {
     kharray(khstring) identifiers;
     kharray(khstring) template_arguments;
     kharray(khAstVariable) arguments;
-    khAstVariable* opt_variadic_argument;
+    khAstVariable* opt_variadic_argument; // Held in an array of one, so that it can be shared
     bool is_return_type_ref;
     khAstExpression* opt_return_type;
     kharray(khAstStatement) block;
+    khAstLazyBlock lazy_block;
 } khAstFunction;
 
 khAstFunction khAstFunction_copy(khAstFunction* function);
+khAstFunction khAstFunction_move(khAstFunction* function);
 void khAstFunction_delete(khAstFunction* function);
-khstring khAstFunction_string(khAstFunction* function, char32_t* origin);
+void khAstFunction_write(khAstFunction* function, khWriter* writer);
+khstring khAstFunction_string(khAstFunction* function);
 
 
 typedef struct {
@@ -388,8 +559,10 @@ typedef struct {
 } khAstClass;
 
 khAstClass khAstClass_copy(khAstClass* class_v);
+khAstClass khAstClass_move(khAstClass* class_v);
 void khAstClass_delete(khAstClass* class_v);
-khstring khAstClass_string(khAstClass* class_v, char32_t* origin);
+void khAstClass_write(khAstClass* class_v, khWriter* writer);
+khstring khAstClass_string(khAstClass* class_v);
 
 
 typedef struct {
@@ -400,8 +573,10 @@ typedef struct {
 } khAstStruct;
 
 khAstStruct khAstStruct_copy(khAstStruct* struct_v);
+khAstStruct khAstStruct_move(khAstStruct* struct_v);
 void khAstStruct_delete(khAstStruct* struct_v);
-khstring khAstStruct_string(khAstStruct* struct_v, char32_t* origin);
+void khAstStruct_write(khAstStruct* struct_v, khWriter* writer);
+khstring khAstStruct_string(khAstStruct* struct_v);
 
 
 typedef struct {
@@ -410,8 +585,10 @@ typedef struct {
 } khAstEnum;
 
 khAstEnum khAstEnum_copy(khAstEnum* enum_v);
+khAstEnum khAstEnum_move(khAstEnum* enum_v);
 void khAstEnum_delete(khAstEnum* enum_v);
-khstring khAstEnum_string(khAstEnum* enum_v, char32_t* origin);
+void khAstEnum_write(khAstEnum* enum_v, khWriter* writer);
+khstring khAstEnum_string(khAstEnum* enum_v);
 
 
 typedef struct {
@@ -421,8 +598,10 @@ typedef struct {
 } khAstAlias;
 
 khAstAlias khAstAlias_copy(khAstAlias* alias);
+khAstAlias khAstAlias_move(khAstAlias* alias);
 void khAstAlias_delete(khAstAlias* alias);
-khstring khAstAlias_string(khAstAlias* alias, char32_t* origin);
+void khAstAlias_write(khAstAlias* alias, khWriter* writer);
+khstring khAstAlias_string(khAstAlias* alias);
 
 
 typedef struct {
@@ -432,8 +611,10 @@ typedef struct {
 } khAstIfBranch;
 
 khAstIfBranch khAstIfBranch_copy(khAstIfBranch* if_branch);
+khAstIfBranch khAstIfBranch_move(khAstIfBranch* if_branch);
 void khAstIfBranch_delete(khAstIfBranch* if_branch);
-khstring khAstIfBranch_string(khAstIfBranch* if_branch, char32_t* origin);
+void khAstIfBranch_write(khAstIfBranch* if_branch, khWriter* writer);
+khstring khAstIfBranch_string(khAstIfBranch* if_branch);
 
 
 typedef struct {
@@ -442,8 +623,10 @@ typedef struct {
 } khAstWhileLoop;
 
 khAstWhileLoop khAstWhileLoop_copy(khAstWhileLoop* while_loop);
+khAstWhileLoop khAstWhileLoop_move(khAstWhileLoop* while_loop);
 void khAstWhileLoop_delete(khAstWhileLoop* while_loop);
-khstring khAstWhileLoop_string(khAstWhileLoop* while_loop, char32_t* origin);
+void khAstWhileLoop_write(khAstWhileLoop* while_loop, khWriter* writer);
+khstring khAstWhileLoop_string(khAstWhileLoop* while_loop);
 
 
 typedef struct {
@@ -452,8 +635,10 @@ typedef struct {
 } khAstDoWhileLoop;
 
 khAstDoWhileLoop khAstDoWhileLoop_copy(khAstDoWhileLoop* do_while_loop);
+khAstDoWhileLoop khAstDoWhileLoop_move(khAstDoWhileLoop* do_while_loop);
 void khAstDoWhileLoop_delete(khAstDoWhileLoop* do_while_loop);
-khstring khAstDoWhileLoop_string(khAstDoWhileLoop* do_while_loop, char32_t* origin);
+void khAstDoWhileLoop_write(khAstDoWhileLoop* do_while_loop, khWriter* writer);
+khstring khAstDoWhileLoop_string(khAstDoWhileLoop* do_while_loop);
 
 
 typedef struct {
@@ -463,8 +648,10 @@ typedef struct {
 } khAstForLoop;
 
 khAstForLoop khAstForLoop_copy(khAstForLoop* for_loop);
+khAstForLoop khAstForLoop_move(khAstForLoop* for_loop);
 void khAstForLoop_delete(khAstForLoop* for_loop);
-khstring khAstForLoop_string(khAstForLoop* for_loop, char32_t* origin);
+void khAstForLoop_write(khAstForLoop* for_loop, khWriter* writer);
+khstring khAstForLoop_string(khAstForLoop* for_loop);
 
 
 typedef struct {
@@ -472,13 +659,16 @@ typedef struct {
 } khAstReturn;
 
 khAstReturn khAstReturn_copy(khAstReturn* return_v);
+khAstReturn khAstReturn_move(khAstReturn* return_v);
 void khAstReturn_delete(khAstReturn* return_v);
-khstring khAstReturn_string(khAstReturn* return_v, char32_t* origin);
+void khAstReturn_write(khAstReturn* return_v, khWriter* writer);
+khstring khAstReturn_string(khAstReturn* return_v);
 
 
 struct khAstStatement {
-    char32_t* begin;
-    char32_t* end;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t file;
 
     khAstStatementType type;
     union {
@@ -502,8 +692,14 @@ struct khAstStatement {
 };
 
 khAstStatement khAstStatement_copy(khAstStatement* ast);
+// Same as `khAstExpression_share`. A whole tree is copied in O(1) with `kharray_share`, and a statement
+// in it is changed by first unsharing the arrays down to it with `khAstStatement_share` as the copier
+khAstStatement khAstStatement_share(khAstStatement* ast);
+khAstStatement khAstStatement_move(khAstStatement* ast);
 void khAstStatement_delete(khAstStatement* ast);
-khstring khAstStatement_string(khAstStatement* ast, char32_t* origin);
+void khAstStatement_write(khAstStatement* statement, khWriter* writer);
+khstring khAstStatement_string(khAstStatement* ast);
+void khAstStatement_relocate(khAstStatement* ast, khAstSource* source, int64_t shift);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,41 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include <kithare/core/ast.h>
+#include <kithare/core/lines.h>
+#include <kithare/core/token.h>
+#include <kithare/lib/array.h>
+#include <kithare/lib/string.h>
+
+
+// Lexing and parsing results kept in a directory across runs, so that an unchanged string doesn't have
+// to go through either again. Each entry is named after a hash of the string, seeded by the compiler
+// version and the formats of the entry, and holds the encoded result along with the errors raised while
+// getting it. A hit raises those errors again, without lexing or parsing anything.
+//
+// Entries are written to a temporary file which then gets moved in place, so processes can share the
+// directory. A missing directory gets made, and any entry which can't be read or written is treated
+// like a miss; the cache never makes these fail.
+
+// Same as `kh_lexicate`
+kharray(khToken) kh_lexicateCached(khstring* string, khstring* cache_directory);
+// Same as `kh_parseParallel` without an arena, which it uses for a miss. A hit has nothing lexed, so
+// the lines are recorded by going through the string instead
+kharray(khAstStatement) kh_parseCached(khstring* string, khstring* cache_directory, size_t workers,
+                                       khLineIndex* opt_lines);
+
+
+#ifdef __cplusplus
+}
+#endif
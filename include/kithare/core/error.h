@@ -11,23 +11,42 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <kithare/lib/array.h>
 #include <kithare/lib/string.h>
 
 
+// Most errors kept until they're flushed. Once another one is raised past them, the last one kept gets
+// replaced by a note that there were more. Malformed input then can't flood the stack, nor make each
+// raise slower than the last
+#define kh_MAX_ERRORS 1000
+
+
 typedef enum { khErrorType_LEXER, khErrorType_PARSER, khErrorType_UNSPECIFIED } khErrorType;
 
 
+// Where an error is is the file it was raised in, along with its offset in characters within the source
+// string of that file
 typedef struct {
     khErrorType type;
     khstring message;
-    void* data;
+    uint32_t file;
+    uint32_t offset;
 } khError;
 
 static inline khError khError_copy(khError* error) {
-    return (khError){
-        .type = error->type, .message = khstring_copy(&error->message), .data = error->data};
+    return (khError){.type = error->type,
+                     .message = khstring_copy(&error->message),
+                     .file = error->file,
+                     .offset = error->offset};
+}
+
+static inline khError khError_move(khError* error) {
+    return (khError){.type = error->type,
+                     .message = khstring_move(&error->message),
+                     .file = error->file,
+                     .offset = error->offset};
 }
 
 static inline void khError_delete(khError* error) {
@@ -35,6 +54,12 @@ static inline void khError_delete(khError* error) {
 }
 
 
+// Errors, tokens and AST nodes are made within the file the thread is currently on, as set here, which
+// is up to the caller as the lexer and the parser only ever see strings. It's 0 until set otherwise.
+// Raising an error, even one merged from another thread, sets its file to that
+void kh_setFile(uint32_t file);
+uint32_t kh_getFile(void);
+
 void kh_raiseError(khError error);
 size_t kh_hasErrors(void);
 kharray(khError) * kh_getErrors(void);
@@ -0,0 +1,147 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kithare/core/ast.h>
+#include <kithare/lib/array.h>
+#include <kithare/lib/buffer.h>
+#include <kithare/lib/string.h>
+
+
+// Marks an absent node or span offset
+#define khFlat_NONE UINT32_MAX
+
+// Bumped whenever the layout of the tree or its encoding changes, so that older encodings get rejected
+#define kh_FLAT_FORMAT_VERSION 1
+
+// Deepest nesting of nodes that a decoded tree can have, as unflattening it goes through the call
+// stack. Trees within the parser's `kh_PARSE_MAX_DEPTH` stay well within it
+#ifndef kh_FLAT_MAX_DEPTH
+#define kh_FLAT_MAX_DEPTH 1024
+#endif
+
+
+typedef enum {
+    khFlatNodeKind_STATEMENT,
+    khFlatNodeKind_EXPRESSION,
+    khFlatNodeKind_VARIABLE // Arguments of functions and lambdas, laid out like variable statements
+} khFlatNodeKind;
+
+typedef enum {
+    khFlatFlag_STATIC = 1 << 0,
+    khFlatFlag_WILD = 1 << 1,
+    khFlatFlag_REF = 1 << 2,
+    khFlatFlag_INCASE = 1 << 3,
+    khFlatFlag_RELATIVE = 1 << 4,
+    khFlatFlag_RETURN_TYPE_REF = 1 << 5,
+    khFlatFlag_HAS_ALIAS = 1 << 6,
+    khFlatFlag_LAZY_BLOCK = 1 << 7,
+    khFlatFlag_PACKED = 1 << 8,
+    khFlatFlag_RAW = 1 << 9
+} khFlatFlag;
+
+
+typedef struct {
+    uint8_t kind;   // khFlatNodeKind
+    uint8_t type;   // khAstStatementType or khAstExpressionType, depending on the kind
+    uint16_t flags; // khFlatFlag bits, or the operator type of unary and binary expressions
+    uint32_t begin; // Offsets in the source, or khFlat_NONE
+    uint32_t end;
+    uint32_t extra; // Offset of the node's record in the extra pool, or an inline payload
+} khFlatNode;
+
+// Nodes are laid out in pre-order, children following their parents, and refer to each other by their
+// index. Everything a node has besides its header lives in the `extra` pool:
+//
+// - A node index is a single slot, khFlat_NONE if it's optional and absent.
+// - A string is two slots, an offset into `strings` and its length. Buffers do the same into `bytes`.
+// - A list is a single slot, the offset of a `[count, items...]` run somewhere else in the pool.
+//
+// Inline payloads, in the node's `extra` itself: the character of CHAR, the byte of BYTE, the bits of
+// FLOAT and IFLOAT, the operand of UNARY, and the expression of an EXPRESSION statement. The rest point
+// to a fixed size record, whose fields are in the same order as the AST structs':
+//
+//   IDENTIFIER, STRING: string         BUFFER: buffer
+//   INTEGER, UINTEGER, DOUBLE, IDOUBLE: low and high 32 bits
+//   TUPLE, ARRAY: list of nodes        DICT: list of keys, list of values
+//   SIGNATURE: list of refs, list of argument types, return type
+//   LAMBDA: list of arguments, variadic argument, return type, list of statements
+//   BINARY: left, right                TERNARY: condition, value, otherwise
+//   COMPARISON: list of operations, list of operands
+//   CALL, INDEX, TEMPLATIZE: node, list of nodes
+//   SCOPE: node, list of strings
+//
+//   VARIABLE: list of strings, type, initializer
+//   IMPORT: list of strings, alias     INCLUDE: list of strings
+//   FUNCTION: list of strings, list of strings, list of arguments, variadic argument, return type,
+//             list of statements
+//   CLASS: name, list of strings, base type, list of statements
+//   STRUCT: name, list of strings, list of statements
+//   ENUM: name, list of strings        ALIAS: name, expression
+//   IF_BRANCH: list of conditions, list of blocks (each a list of statements), list of statements
+//   WHILE_LOOP, DO_WHILE_LOOP: condition, list of statements
+//   FOR_LOOP: list of strings, iteratee, list of statements
+//   RETURN: list of nodes
+//
+// The block of a LAMBDA or FUNCTION with LAZY_BLOCK set, one which wasn't parsed yet, is instead a
+// record of the begin and end offsets of its source. The elements of a TUPLE or ARRAY with PACKED set
+// are a record of their expression type, then their values as a buffer. A STRING or BUFFER with RAW set
+// is the begin and end offsets of its payload in the source instead.
+//
+// Since it holds no pointers, the whole tree can be copied, cached or mapped as is.
+typedef struct {
+    kharray(khFlatNode) nodes;
+    kharray(uint32_t) extra;
+    khstring strings;
+    khbuffer bytes;
+    uint32_t statements; // List of the top-level statements
+} khFlatAst;
+
+// Raw literals and skipped blocks are stored as the offsets they are, into the source the AST was
+// parsed from
+khFlatAst khFlatAst_new(kharray(khAstStatement) * statements);
+void khFlatAst_delete(khFlatAst* ast);
+
+// Converts it back into the AST structs, with their raw literals and skipped blocks holding `origin` as
+// their source. The nodes are made in the file the thread is on, see `kh_setFile`
+kharray(khAstStatement) khFlatAst_unflatten(khFlatAst* ast, char32_t* origin);
+
+// The binary form of the tree, to be stored or cached across runs. It starts with the `khfa` magic and
+// the format version, then the sizes of the four arrays and the list of the top-level statements, all
+// as LEB128 varints. Each node is then its kind (with two bits telling whether its begin and end are
+// present), type, flags, begin as a zigzag delta from the previous begin, end as a zigzag delta from
+// that, and extra. The extra pool and the characters of `strings` follow as varints, and
+// `bytes` as they are. Spans are still offsets, so the source is still needed to unflatten it.
+khbuffer khFlatAst_encode(khFlatAst* ast);
+// Sets `success` to false if the data is truncated, malformed or of another format version, or if the
+// tree in it fails `khFlatAst_check`. The AST has to be deleted either way
+khFlatAst khFlatAst_decode(uint8_t* data, size_t size, size_t origin_size, bool* success);
+// Whether the tree could have been written by `khFlatAst_encode` and can be unflattened: false for a
+// node, list, string or record out of bounds, a node of the wrong kind or referred to twice, a node
+// nested deeper than `kh_FLAT_MAX_DEPTH`, or a span, raw literal or skipped block which doesn't fit
+// within the `origin_size` characters of the source. A tree is worth storing only if it passes
+bool khFlatAst_check(khFlatAst* ast, size_t origin_size);
+
+static inline size_t khFlatAst_listSize(khFlatAst* ast, uint32_t list) {
+    return ast->extra[list];
+}
+
+static inline uint32_t* khFlatAst_listItems(khFlatAst* ast, uint32_t list) {
+    return ast->extra + list + 1;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -19,18 +19,31 @@ extern "C" {
 #include <kithare/lib/string.h>
 
 
-kharray(khToken) kh_lexicate(khstring* string);
-
-khToken kh_lexToken(char32_t** cursor);
-khToken kh_lexWord(char32_t** cursor);
-khToken kh_lexNumber(char32_t** cursor);
-khToken kh_lexSymbol(char32_t** cursor);
+// Longest source which gets lexed or parsed, as offsets into it are 32 bits with `UINT32_MAX` being
+// left for nodes without a span. A longer one raises an error at its beginning, and is taken as empty
+#define kh_MAX_SOURCE_SIZE (UINT32_MAX - 1)
 
-char32_t kh_lexChar(char32_t** cursor, bool with_quotes, bool is_byte);
-khstring kh_lexString(char32_t** cursor, bool is_buffer);
+// Whether the source is short enough, raising the error if it isn't
+bool kh_checkSourceSize(khstring* string);
 
-uint64_t kh_lexInt(char32_t** cursor, uint8_t base, size_t max_length, bool* had_overflowed);
-double kh_lexFloat(char32_t** cursor, uint8_t base);
+kharray(khToken) kh_lexicate(khstring* string);
+// Streams the tokens to a callback instead of collecting them, lending each one for the duration of
+// the call. Lexing stops early once the callback returns false
+void kh_lexicateEach(khstring* string, bool (*callback)(khToken* token, void* data), void* data);
+
+// Spans of the tokens, and of any errors raised, are offsets from `origin`, the beginning of the string
+// that `cursor` is in
+khToken kh_lexToken(char32_t** cursor, char32_t* origin);
+khToken kh_lexWord(char32_t** cursor, char32_t* origin);
+khToken kh_lexNumber(char32_t** cursor, char32_t* origin);
+khToken kh_lexSymbol(char32_t** cursor, char32_t* origin);
+
+char32_t kh_lexChar(char32_t** cursor, char32_t* origin, bool with_quotes, bool is_byte);
+khstring kh_lexString(char32_t** cursor, char32_t* origin, bool is_buffer);
+
+uint64_t kh_lexInt(char32_t** cursor, char32_t* origin, uint8_t base, size_t max_length,
+                   bool* had_overflowed);
+double kh_lexFloat(char32_t** cursor, char32_t* origin, uint8_t base);
 
 
 #ifdef __cplusplus
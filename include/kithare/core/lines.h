@@ -0,0 +1,57 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <kithare/core/token.h>
+#include <kithare/lib/array.h>
+#include <kithare/lib/string.h>
+
+
+typedef struct {
+    size_t line;        // Starts from 1
+    size_t column;      // Starts from 1, counted in characters
+    size_t byte_offset; // Offset in the UTF-8 encoding of the source
+} khSourcePosition;
+
+
+// Offsets of the beginning of each line in a source string, for mapping offsets into line and column
+// positions without rescanning the source
+typedef struct {
+    char32_t* origin;
+    kharray(size_t) line_offsets;
+
+    // UTF-8 offsets of the beginning of each line, only computed up to the lines that were looked up
+    kharray(size_t) line_byte_offsets;
+} khLineIndex;
+
+// Builds the index out of the whole string at once
+khLineIndex khLineIndex_new(khstring* string);
+// Starts an empty index, to be filled with khLineIndex_addToken as the string gets lexed
+khLineIndex khLineIndex_newEmpty(khstring* string);
+void khLineIndex_delete(khLineIndex* index);
+
+// Records the newlines within a token; tokens have to be added in the order they were lexed
+void khLineIndex_addToken(khLineIndex* index, khToken* token);
+// Records the newlines within a range of the string which doesn't get lexed, such as all of it when its
+// tree is loaded from a cache
+void khLineIndex_addRange(khLineIndex* index, uint32_t begin, uint32_t end);
+// Adds the lines of another index of the same string which begin past the last one of this index, so
+// that indexes of parts lexed in order, even overlapping ones, add up to the index of the whole
+void khLineIndex_merge(khLineIndex* index, khLineIndex* other);
+khSourcePosition khLineIndex_position(khLineIndex* index, uint32_t offset);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,13 +12,82 @@ extern "C" {
 
 #include <kithare/core/ast.h>
 #include <kithare/core/error.h>
+#include <kithare/core/lines.h>
+#include <kithare/lib/arena.h>
 #include <kithare/lib/array.h>
 
 
+// Below this many characters per chunk, splitting isn't worth the threads
+#define kh_PARSE_CHUNK_MIN_SIZE 65536
+
+// Deepest nesting of expressions and blocks that gets parsed, past which they're skipped with an error.
+// Chains of operators, calls and indexes count as nesting too, as each link is a node deeper. This
+// bounds how deep the tree gets, and so the call stack usage of parsing it and of going through it
+#ifndef kh_PARSE_MAX_DEPTH
+#define kh_PARSE_MAX_DEPTH 256
+#endif
+
+// Tuples and arrays of at least this many literals of one type get their elements packed, see
+// `khAstPackedValues`. Smaller ones aren't worth looking ahead for
+#define kh_PARSE_PACK_MIN_SIZE 16
+
+
+// String and buffer literals without escapes keep pointing into the string, see `khAstRawLiteral`
 kharray(khAstStatement) kh_parse(khstring* string);
+// Allocates the whole tree from the arena instead of the heap, which then gets freed all at once by
+// `khArena_delete`. Deleting the returned array or any of its nodes is a no-op
+kharray(khAstStatement) kh_parseIn(khstring* string, khArena* arena);
+// Same as `kh_parseIn`, except that the expressions which nodes point to get shared through the
+// interner wherever they're structurally equal, like repeated types such as `int` or `list!(float)`.
+// Sharing goes on across every string parsed with the same interner, and the arena is what lets the
+// nodes be shared without being deleted twice. A shared node keeps the spans of its first occurrence,
+// and can't be changed nor relocated by `kh_reparse`
+kharray(khAstStatement) kh_parseInterned(khstring* string, khArena* arena, khAstInterner* interner);
+
+// Skips the bodies of functions and lambdas by matching their curly brackets, for when only the
+// declarations are needed. Each body gets parsed on first access through `khAstFunction_body` or
+// `khAstLambda_body`, which is when its errors are raised. The string has to outlive the tree
+kharray(khAstStatement) kh_parseDeclarations(khstring* string, khArena* opt_arena);
+
+// Same as `kh_parseIn`, except that the tokens are lexed ahead on a separate thread, handed over
+// through a `khTokenPipe`, while the parser goes through them. Lexer errors are still raised as the
+// parser gets to their tokens, in source order along with its own. The lines get recorded into
+// `opt_lines` the same as by `kh_parseParallel`
+kharray(khAstStatement) kh_parsePipelined(khstring* string, khArena* opt_arena,
+                                          khLineIndex* opt_lines);
+
+// Splits the string into chunks at the beginnings of top-level statements, which get parsed by up to
+// `workers` threads. The result and the raised errors are the same as `kh_parseIn`'s. The lines of the
+// string get recorded into `opt_lines` as it's lexed, if given, which has to be made with
+// `khLineIndex_newEmpty`. That spares mapping the errors and the nodes to their lines a rescan of it
+kharray(khAstStatement) kh_parseParallel(khstring* string, khArena* opt_arena, size_t workers,
+                                         khLineIndex* opt_lines);
+
+// Replacement of `size` characters at `index` in a string with `new_size` other characters
+typedef struct {
+    size_t index;
+    size_t size;
+    size_t new_size;
+} khEdit;
+
+// Parses the string again after an edit, given the statements parsed from the string before it. Only
+// the top-level statements around the edit get parsed again, the rest are moved out of `statements`
+// with the spans of the ones after the edit shifted by the change in size. What's left in `statements`
+// still has to be deleted, and the arena has to be the one they were parsed in. Errors are raised only
+// for the statements that got parsed again
+kharray(khAstStatement) kh_reparse(khstring* string, khArena* opt_arena,
+                                   kharray(khAstStatement) * statements, khstring* old_string,
+                                   khEdit edit);
+
+// Parse the block first if it was skipped, allocating it from the same arena as the rest of the tree.
+// Not thread-safe, as it modifies the node
+kharray(khAstStatement) * khAstFunction_body(khAstFunction* function);
+kharray(khAstStatement) * khAstLambda_body(khAstLambda* lambda);
 
-khAstStatement kh_parseStatement(char32_t** cursor);
-khAstExpression kh_parseExpression(char32_t** cursor, bool ignore_newline, bool filter_type);
+// Same as the lexer's, spans are offsets from `origin`, the beginning of the string that `cursor` is in
+khAstStatement kh_parseStatement(char32_t** cursor, char32_t* origin);
+khAstExpression kh_parseExpression(char32_t** cursor, char32_t* origin, bool ignore_newline,
+                                   bool filter_type);
 
 
 #ifdef __cplusplus
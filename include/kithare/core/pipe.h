@@ -0,0 +1,67 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <kithare/core/error.h>
+#include <kithare/core/token.h>
+#include <kithare/lib/array.h>
+#include <kithare/lib/string.h>
+
+
+// Must be a power of two
+#define kh_TOKEN_PIPE_CAPACITY 4096
+
+
+typedef struct {
+    khToken token;
+    kharray(khError) errors; // Lexer errors raised while lexing the token, NULL if there were none
+} _khTokenPipeSlot;
+
+// Lexes a string on a separate thread, which hands over the tokens through a lock-free single-producer
+// single-consumer ring. The lexer errors are carried along with their tokens, then raised on the
+// consumer's thread as the tokens are taken, so they stay in source order. Without the thread, the
+// tokens are lexed on the consumer's thread as they're taken instead, which raises the errors the same
+typedef struct {
+    _khTokenPipeSlot* slots;
+    char32_t* origin;
+    char32_t* cursor; // Where the consumer lexes from, without the thread
+    uint32_t file;    // The file of the thread which made it, which the tokens are lexed in
+    bool is_threaded;
+    pthread_t thread;
+    khToken eof;      // Kept once the consumer took the EOF token
+    bool is_finished;
+
+    // Padded into separate cache lines, as they are written by different threads
+    atomic_size_t head; // Written by the lexer thread
+    char _head_padding[64 - sizeof(atomic_size_t)];
+    atomic_size_t tail; // Written by the consumer
+    char _tail_padding[64 - sizeof(atomic_size_t)];
+    atomic_bool is_stopped;
+} khTokenPipe;
+
+// Lexing only goes on a separate thread when asked to, and falls back to the consumer's own if the
+// thread can't be started
+khTokenPipe* khTokenPipe_new(khstring* string, bool is_threaded);
+void khTokenPipe_delete(khTokenPipe* pipe);
+
+// Takes the next token, blocking until the lexer thread produces it if there's one. Keeps returning EOF
+// tokens once the end of the string has been reached
+khToken khTokenPipe_next(khTokenPipe* pipe);
+
+
+#ifdef __cplusplus
+}
+#endif
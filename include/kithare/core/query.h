@@ -0,0 +1,111 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kithare/core/ast.h>
+#include <kithare/core/walker.h>
+#include <kithare/lib/array.h>
+#include <kithare/lib/string.h>
+
+
+// Nodes of a tree, gathered in a single walk through it, along with lists of them by their kind and by
+// their name. Building it is a full pass over the tree, after parsing: the parser builds nodes
+// bottom-up and moves them into arrays which may still grow, so neither their addresses nor their
+// depths are known while it makes them. Queries narrowed down by a kind or an exact name then only go
+// through their lists. The index points into the tree, which has to outlive it and stay unchanged,
+// apart from the elements of packed values which it keeps copies of
+typedef struct {
+    khAstNode node;
+    uint32_t depth;
+    uint32_t names_begin; // Range of its names in `name_ids`, empty if it has none
+    uint32_t names_end;
+} khAstIndexEntry;
+
+typedef struct {
+    khstring name;
+    uint64_t hash;
+    kharray(uint32_t) entries; // The nodes with this name, in the order they were walked through
+} khAstIndexName;
+
+typedef struct {
+    kharray(khAstIndexEntry) entries;
+    kharray(khAstExpression) elements; // Copies of the transient nodes, which their entries point to
+    kharray(uint32_t) statement_kinds[khAstStatementType_RETURN + 1];
+    kharray(uint32_t) expression_kinds[khAstExpressionType_TEMPLATIZE + 1];
+
+    kharray(uint32_t) name_ids;
+    kharray(khAstIndexName) names;
+    kharray(uint32_t) slots; // Open addressing into `names` by their hashes, UINT32_MAX when empty
+} khAstIndex;
+
+// Names of the nodes are what they declare or refer to: the names of variables, functions, classes,
+// structs, enums and aliases, the dotted paths of imports and includes, identifiers, and dotted scopes.
+// Calls, indexes and templatizations are named after what they're applied to
+khAstIndex khAstIndex_new(kharray(khAstStatement) * statements);
+void khAstIndex_delete(khAstIndex* index);
+// The first name of the entry, NULL if it has none
+khstring* khAstIndex_name(khAstIndex* index, uint32_t entry);
+// Entries of the nodes with the name, NULL if there are none
+kharray(uint32_t) * khAstIndex_named(khAstIndex* index, khstring* name);
+
+
+// Names match if any of the node's does, where `*` in the value matches any characters. Arguments are
+// counted for calls, indexes, templatizations, functions, lambdas and signatures, and operators are
+// those of unary and binary expressions, such as `add` or `not`
+typedef enum {
+    khAstQueryAttribute_NAME,
+    khAstQueryAttribute_ARGUMENTS,
+    khAstQueryAttribute_OPERATOR,
+    khAstQueryAttribute_DEPTH // Nesting depth from the top-level statements
+} khAstQueryAttribute;
+
+typedef struct {
+    khAstQueryAttribute attribute;
+    khAstComparisonExpressionType operation;
+    khstring name;    // NAME
+    uint64_t number;  // ARGUMENTS and DEPTH
+    int32_t unary;    // OPERATOR, the unary and binary types named so; -1 if there's no such operator
+    int32_t binary;
+} khAstQueryCondition;
+
+// Pattern over the nodes of a tree, written as the kind of the nodes followed by conditions on their
+// attributes, all of which have to hold:
+//
+//     call[name=print]
+//     import[name=std.*]
+//     function[arguments>3, depth=0]
+//     *[name="some name"]
+//
+// Kinds are named as they're written by `khAstStatementType_string` and `khAstExpressionType_string`,
+// or `*` for any. Conditions compare with `=`, `!=`, `<`, `>`, `<=` and `>=`, where names and operators
+// are only compared to be equal or not. A node without the attribute doesn't hold any condition on it
+typedef struct {
+    bool has_kind;
+    khAstNodeKind kind;
+    uint32_t type; // A khAstStatementType or a khAstExpressionType
+    kharray(khAstQueryCondition) conditions;
+} khAstQuery;
+
+// Errors in the pattern are raised at their offset in it, and have to be checked for
+khAstQuery khAstQuery_new(khstring* pattern);
+void khAstQuery_delete(khAstQuery* query);
+bool khAstQuery_matches(khAstQuery* query, khAstIndex* index, uint32_t entry);
+// Entries of the matching nodes, in the order they were walked through. An exact name in the conditions
+// narrows it down to the nodes with that name, and otherwise a kind to the nodes of that kind
+kharray(uint32_t) khAstIndex_query(khAstIndex* index, khAstQuery* query);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,11 +10,15 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include <kithare/core/error.h>
+#include <kithare/lib/arena.h>
 #include <kithare/lib/array.h>
 #include <kithare/lib/buffer.h>
 #include <kithare/lib/string.h>
+#include <kithare/lib/writer.h>
 
 
 typedef enum {
@@ -145,9 +149,13 @@ typedef enum {
 khstring khOperatorToken_string(khOperatorToken operator_v);
 
 
+// Spans are offsets into the source string in characters, rather than pointers into it, so that a token
+// keeps meaning the same wherever the string is loaded. Along with them is the file the token was lexed
+// in, being the one the thread was on, see `kh_setFile`
 typedef struct {
-    char32_t* begin;
-    char32_t* end;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t file;
 
     khTokenType type;
     union {
@@ -171,82 +179,144 @@ typedef struct {
 } khToken;
 
 khToken khToken_copy(khToken* token);
+// Leaves an invalid token with the same span behind
+khToken khToken_move(khToken* token);
 void khToken_delete(khToken* token);
+void khToken_write(khToken* token, khWriter* writer, char32_t* origin);
 khstring khToken_string(khToken* token, char32_t* origin);
 
-static inline khToken khToken_fromInvalid(char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_INVALID};
+// String and buffer literals without any escapes are left undecoded by the lexer, with a NULL payload,
+// as it's the very same as their source between the quotes. This gets the offsets of where that is
+void khToken_rawSpan(khToken* token, char32_t* origin, uint32_t* begin, uint32_t* end);
+// Decodes such a payload from that source
+khstring kh_decodeRawString(char32_t* begin, char32_t* end, khArena* opt_arena);
+khbuffer kh_decodeRawBuffer(char32_t* begin, char32_t* end, khArena* opt_arena);
+
+// Bumped whenever the encoding of tokens changes
+#define kh_TOKEN_FORMAT_VERSION 1
+
+// Binary form of a token stream, to be stored or cached across runs. It starts with the `khtk` magic,
+// the format version and the count of tokens as LEB128 varints. Each token then is its type, begin as
+// a zigzag delta from the previous token's end, length, and its payload: strings as their size then
+// their characters, buffers as their size then their bytes, and numbers as varints. Raw strings and
+// buffers are stored as a size of 0, and the others with their size plus one
+khbuffer kh_encodeTokens(kharray(khToken) * tokens);
+// Sets `success` to false if the data is truncated, malformed or of another format version, or if any
+// span doesn't fit within the `origin_size` characters of the string. The tokens have to be deleted
+// either way
+kharray(khToken) kh_decodeTokens(uint8_t* data, size_t size, size_t origin_size, bool* success);
+
+static inline khToken khToken_fromInvalid(uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin, .end = end, .file = kh_getFile(), .type = khTokenType_INVALID};
 }
 
-static inline khToken khToken_fromEof(char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_EOF};
+static inline khToken khToken_fromEof(uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin, .end = end, .file = kh_getFile(), .type = khTokenType_EOF};
 }
 
-static inline khToken khToken_fromNewline(char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_NEWLINE};
+static inline khToken khToken_fromNewline(uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin, .end = end, .file = kh_getFile(), .type = khTokenType_NEWLINE};
 }
 
-static inline khToken khToken_fromComment(char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_COMMENT};
+static inline khToken khToken_fromComment(uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin, .end = end, .file = kh_getFile(), .type = khTokenType_COMMENT};
 }
 
-static inline khToken khToken_fromIdentifier(khstring identifier, char32_t* begin, char32_t* end) {
-    return (khToken){
-        .begin = begin, .end = end, .type = khTokenType_IDENTIFIER, .identifier = identifier};
+static inline khToken khToken_fromIdentifier(khstring identifier, uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin,
+                     .end = end,
+                     .file = kh_getFile(),
+                     .type = khTokenType_IDENTIFIER,
+                     .identifier = identifier};
 }
 
-static inline khToken khToken_fromKeyword(khKeywordToken keyword, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_KEYWORD, .keyword = keyword};
+static inline khToken khToken_fromKeyword(khKeywordToken keyword, uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin,
+                     .end = end,
+                     .file = kh_getFile(),
+                     .type = khTokenType_KEYWORD,
+                     .keyword = keyword};
 }
 
-static inline khToken khToken_fromDelimiter(khDelimiterToken delimiter, char32_t* begin,
-                                            char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_DELIMITER, .delimiter = delimiter};
+static inline khToken khToken_fromDelimiter(khDelimiterToken delimiter, uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin,
+                     .end = end,
+                     .file = kh_getFile(),
+                     .type = khTokenType_DELIMITER,
+                     .delimiter = delimiter};
 }
 
-static inline khToken khToken_fromOperator(khOperatorToken operator_v, char32_t* begin, char32_t* end) {
-    return (khToken){
-        .begin = begin, .end = end, .type = khTokenType_OPERATOR, .operator_v = operator_v};
+static inline khToken khToken_fromOperator(khOperatorToken operator_v, uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin,
+                     .end = end,
+                     .file = kh_getFile(),
+                     .type = khTokenType_OPERATOR,
+                     .operator_v = operator_v};
 }
 
-static inline khToken khToken_fromChar(char32_t char_v, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_CHAR, .char_v = char_v};
+static inline khToken khToken_fromChar(char32_t char_v, uint32_t begin, uint32_t end) {
+    return (khToken){
+        .begin = begin, .end = end, .file = kh_getFile(), .type = khTokenType_CHAR, .char_v = char_v};
 }
 
-static inline khToken khToken_fromString(khstring string, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_STRING, .string = string};
+static inline khToken khToken_fromString(khstring string, uint32_t begin, uint32_t end) {
+    return (khToken){
+        .begin = begin, .end = end, .file = kh_getFile(), .type = khTokenType_STRING, .string = string};
 }
 
-static inline khToken khToken_fromBuffer(khbuffer buffer, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_BUFFER, .buffer = buffer};
+static inline khToken khToken_fromBuffer(khbuffer buffer, uint32_t begin, uint32_t end) {
+    return (khToken){
+        .begin = begin, .end = end, .file = kh_getFile(), .type = khTokenType_BUFFER, .buffer = buffer};
 }
 
-static inline khToken khToken_fromByte(uint8_t byte, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_BYTE, .byte = byte};
+static inline khToken khToken_fromByte(uint8_t byte, uint32_t begin, uint32_t end) {
+    return (khToken){
+        .begin = begin, .end = end, .file = kh_getFile(), .type = khTokenType_BYTE, .byte = byte};
 }
 
-static inline khToken khToken_fromInteger(int64_t integer, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_INTEGER, .integer = integer};
+static inline khToken khToken_fromInteger(int64_t integer, uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin,
+                     .end = end,
+                     .file = kh_getFile(),
+                     .type = khTokenType_INTEGER,
+                     .integer = integer};
 }
 
-static inline khToken khToken_fromUinteger(uint64_t uinteger, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_UINTEGER, .uinteger = uinteger};
+static inline khToken khToken_fromUinteger(uint64_t uinteger, uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin,
+                     .end = end,
+                     .file = kh_getFile(),
+                     .type = khTokenType_UINTEGER,
+                     .uinteger = uinteger};
 }
 
-static inline khToken khToken_fromFloat(float float_v, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_FLOAT, .float_v = float_v};
+static inline khToken khToken_fromFloat(float float_v, uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin,
+                     .end = end,
+                     .file = kh_getFile(),
+                     .type = khTokenType_FLOAT,
+                     .float_v = float_v};
 }
 
-static inline khToken khToken_fromDouble(double double_v, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_DOUBLE, .double_v = double_v};
+static inline khToken khToken_fromDouble(double double_v, uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin,
+                     .end = end,
+                     .file = kh_getFile(),
+                     .type = khTokenType_DOUBLE,
+                     .double_v = double_v};
 }
 
-static inline khToken khToken_fromIfloat(float ifloat, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_IFLOAT, .ifloat = ifloat};
+static inline khToken khToken_fromIfloat(float ifloat, uint32_t begin, uint32_t end) {
+    return (khToken){
+        .begin = begin, .end = end, .file = kh_getFile(), .type = khTokenType_IFLOAT, .ifloat = ifloat};
 }
 
-static inline khToken khToken_fromIdouble(double idouble, char32_t* begin, char32_t* end) {
-    return (khToken){.begin = begin, .end = end, .type = khTokenType_IDOUBLE, .idouble = idouble};
+static inline khToken khToken_fromIdouble(double idouble, uint32_t begin, uint32_t end) {
+    return (khToken){.begin = begin,
+                     .end = end,
+                     .file = kh_getFile(),
+                     .type = khTokenType_IDOUBLE,
+                     .idouble = idouble};
 }
 
 
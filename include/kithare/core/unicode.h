@@ -0,0 +1,75 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <kithare/lib/string.h>
+
+
+// Two-stage XID_Start/XID_Continue tables, generated at build time by builder/unicode.py. The first
+// stage maps `chr >> 8` to a block in the second stage, which stores 2 bits per code point
+extern const uint8_t kh_xid_stage1[0x110000 >> 8];
+extern const uint8_t kh_xid_stage2[][64];
+
+static inline uint8_t _kh_xidBits(char32_t chr) {
+    if (chr >= 0x110000) {
+        return 0;
+    }
+
+    return (kh_xid_stage2[kh_xid_stage1[chr >> 8]][(chr & 0xFF) >> 2] >> ((chr & 3) * 2)) & 3;
+}
+
+static inline bool kh_isXidStart(char32_t chr) {
+    // ASCII fast path, skipping the tables
+    if (chr < 0x80) {
+        return (chr >= U'a' && chr <= U'z') || (chr >= U'A' && chr <= U'Z');
+    }
+
+    return _kh_xidBits(chr) & 1;
+}
+
+static inline bool kh_isXidContinue(char32_t chr) {
+    if (chr < 0x80) {
+        return (chr >= U'a' && chr <= U'z') || (chr >= U'A' && chr <= U'Z') ||
+               (chr >= U'0' && chr <= U'9') || chr == U'_';
+    }
+
+    return _kh_xidBits(chr) & 2;
+}
+
+// Unicode White_Space property, which is short and stable enough to be listed here instead of in the
+// tables
+static inline bool kh_isSpace(char32_t chr) {
+    if (chr < 0x80) {
+        return chr == U' ' || (chr >= U'\t' && chr <= U'\r');
+    }
+
+    switch (chr) {
+        case 0x85:
+        case 0xA0:
+        case 0x1680:
+        case 0x2028:
+        case 0x2029:
+        case 0x202F:
+        case 0x205F:
+        case 0x3000:
+            return true;
+        default:
+            return chr >= 0x2000 && chr <= 0x200A;
+    }
+}
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,66 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <kithare/core/ast.h>
+#include <kithare/lib/array.h>
+
+
+typedef enum { khAstNodeKind_STATEMENT, khAstNodeKind_EXPRESSION } khAstNodeKind;
+
+typedef struct {
+    khAstNodeKind kind;
+    bool is_transient; // An element of packed values, built for the callback and gone once it returns
+    union {
+        khAstStatement* statement;
+        khAstExpression* expression;
+    };
+} khAstNode;
+
+typedef enum {
+    khAstWalkAction_CONTINUE,
+    khAstWalkAction_SKIP, // Leaves out the children of the node, but still calls its post callback
+    khAstWalkAction_STOP  // Ends the whole walk right away, without any more callbacks
+} khAstWalkAction;
+
+// Callbacks around each node, with its nesting depth from where the walk started. Either may be NULL
+typedef struct {
+    khAstWalkAction (*opt_pre)(khAstNode node, size_t depth, void* data);
+    void (*opt_post)(khAstNode node, size_t depth, void* data);
+    void* data;
+} khAstVisitor;
+
+
+// Walks through the nodes depth first in source order, calling the pre callback before the children of
+// each node and the post one after them. The nodes to go through are kept on a stack of their own
+// rather than on the call stack, so that however deep the tree is, it can't overflow. Children are
+// statements and expressions, including the types and initializers of arguments and the elements of
+// packed values, while the bodies which `kh_parseDeclarations` skipped aren't walked through. Packed
+// elements are handed over as transient nodes, which have to be copied to be kept
+//
+// Returns false if it got stopped
+bool khAst_walk(kharray(khAstStatement) * statements, khAstVisitor* visitor);
+bool khAstStatement_walk(khAstStatement* statement, khAstVisitor* visitor);
+bool khAstExpression_walk(khAstExpression* expression, khAstVisitor* visitor);
+
+// Hands out the top-level statements to up to `workers` threads, which each walk through the ones they
+// take with their own visitor, `visitors[i]` for the i-th one. Callbacks get called from those
+// threads at once, so they must only read the tree, keeping anything they gather in their own `data`.
+// Stopping one of them stops all of them
+bool khAst_walkParallel(kharray(khAstStatement) * statements, khAstVisitor* visitors, size_t workers);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,120 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+#define kh_ARENA_BLOCK_SIZE 65536
+#define kh_ARENA_ALIGNMENT 16
+
+
+typedef struct _khArenaBlock {
+    struct _khArenaBlock* previous;
+    size_t size;
+    size_t used;
+} _khArenaBlock;
+
+// Bump allocator, of which everything allocated from it gets freed all at once by `khArena_delete`.
+// Allocated memory is zero-filled. Not thread-safe
+typedef struct {
+    _khArenaBlock* block;
+} khArena;
+
+
+static inline size_t _khArena_align(size_t size) {
+    return (size + kh_ARENA_ALIGNMENT - 1) & ~(size_t)(kh_ARENA_ALIGNMENT - 1);
+}
+
+static inline uint8_t* _khArenaBlock_data(_khArenaBlock* block) {
+    return (uint8_t*)block + _khArena_align(sizeof(_khArenaBlock));
+}
+
+
+static inline khArena khArena_new(void) {
+    return (khArena){.block = NULL};
+}
+
+static inline void khArena_delete(khArena* arena) {
+    _khArenaBlock* block = arena->block;
+    while (block != NULL) {
+        _khArenaBlock* previous = block->previous;
+        free(block);
+        block = previous;
+    }
+
+    arena->block = NULL;
+}
+
+static inline void* khArena_allocate(khArena* arena, size_t size) {
+    size = _khArena_align(size);
+
+    // Starts a new block once the current one is full; big allocations get a block of their own
+    if (arena->block == NULL || arena->block->size - arena->block->used < size) {
+        size_t block_size = size > kh_ARENA_BLOCK_SIZE ? size : kh_ARENA_BLOCK_SIZE;
+        _khArenaBlock* block =
+            (_khArenaBlock*)calloc(_khArena_align(sizeof(_khArenaBlock)) + block_size, 1);
+
+        *block = (_khArenaBlock){.previous = arena->block, .size = block_size, .used = 0};
+        arena->block = block;
+    }
+
+    void* ptr = _khArenaBlock_data(arena->block) + arena->block->used;
+    arena->block->used += size;
+    return ptr;
+}
+
+// Hands all of the other arena's memory over to this one, leaving the other empty
+static inline void khArena_merge(khArena* arena, khArena* other) {
+    if (other->block == NULL) {
+        return;
+    }
+
+    _khArenaBlock* last = other->block;
+    while (last->previous != NULL) {
+        last = last->previous;
+    }
+
+    // Goes behind the current block, which stays the one being allocated from
+    if (arena->block == NULL) {
+        arena->block = other->block;
+    }
+    else {
+        last->previous = arena->block->previous;
+        arena->block->previous = other->block;
+    }
+
+    other->block = NULL;
+}
+
+// Grows the latest allocation in place, if it still has room in its block. Returns false if it can't,
+// where a new allocation has to be made instead
+static inline bool khArena_extend(khArena* arena, void* ptr, size_t size, size_t new_size) {
+    size = _khArena_align(size);
+    new_size = _khArena_align(new_size);
+
+    _khArenaBlock* block = arena->block;
+    if (block == NULL || (uint8_t*)ptr + size != _khArenaBlock_data(block) + block->used ||
+        block->used - size + new_size > block->size) {
+        return false;
+    }
+
+    block->used += new_size - size;
+    return true;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -10,16 +10,22 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
+
 
 typedef struct {
-    size_t type_size;
+    uint32_t type_size;
+    uint32_t references; // How many variables hold the array, see `kharray_share`
     void (*deleter)(void*);
     size_t size;
     size_t reserved;
+    khArena* arena; // NULL if it's allocated on the heap
 } _kharrayHeader;
 
 
@@ -27,43 +33,62 @@ typedef struct {
 #define kharray(TYPE) TYPE* // Type alias
 #define _kharray_header(ARRAY) (((_kharrayHeader*)(*ARRAY))[-1])
 #define _kharray_typeSize(ARRAY) (_kharray_header(ARRAY).type_size)
+#define _kharray_references(ARRAY) (_kharray_header(ARRAY).references)
 #define _kharray_deleter(ARRAY) (_kharray_header(ARRAY).deleter)
 #define kharray_size(ARRAY) (_kharray_header(ARRAY).size)
 #define kharray_reserved(ARRAY) (_kharray_header(ARRAY).reserved)
+#define kharray_arena(ARRAY) (_kharray_header(ARRAY).arena)
 
 // Verifies that the argument given is a pointer to a pointer (Known as a pointer to an array; e.g:
 // int**, char**), then casts it into a void**
 #define _kharray_verify(PTR)                                               \
     ({                                                                     \
         typeof(PTR) __kh_ptr = PTR;                                        \
-        typeof(**__kh_ptr) __kh_dptr __attribute__((unused)) = **__kh_ptr; \
+        typeof(**__kh_ptr)* __kh_dptr __attribute__((unused)) = *__kh_ptr; \
         (void**)__kh_ptr;                                                  \
     })
 
 
-#define kharray_new(TYPE, DELETER) (TYPE*)_kharray_new(sizeof(TYPE), (void (*)(void*))(DELETER))
-static inline void* _kharray_new(size_t type_size, void (*deleter)(void*)) {
+static inline void* _kharray_allocate(khArena* arena, size_t size) {
+    return arena != NULL ? khArena_allocate(arena, size) : calloc(size, 1);
+}
+
+#define kharray_new(TYPE, DELETER) kharray_newIn(TYPE, DELETER, NULL)
+// Arrays allocated from an arena are freed along with the arena. Deleting them doesn't do anything, so
+// their elements mustn't own anything outside of the arena either
+#define kharray_newIn(TYPE, DELETER, ARENA)                              \
+    (TYPE*)_kharray_new(sizeof(TYPE), (void (*)(void*))(DELETER), ARENA)
+static inline void* _kharray_new(size_t type_size, void (*deleter)(void*), khArena* arena) {
     // Don't forget to allocate an extra null-terminator space in case it's a string
-    void* array = calloc(sizeof(_kharrayHeader) + type_size, 1);
-    *(_kharrayHeader*)array =
-        (_kharrayHeader){.type_size = type_size, .size = 0, .reserved = 0, .deleter = deleter};
+    void* array = _kharray_allocate(arena, sizeof(_kharrayHeader) + type_size);
+    *(_kharrayHeader*)array = (_kharrayHeader){
+        .type_size = type_size,
+        .references = 1,
+        .size = 0,
+        .reserved = 0,
+        .deleter = deleter,
+        .arena = arena};
     return array + sizeof(_kharrayHeader);
 }
 
-#define kharray_copy(ARRAY, COPIER)                                                                \
+#define kharray_copy(ARRAY, COPIER) kharray_copyIn(ARRAY, COPIER, NULL)
+#define kharray_copyIn(ARRAY, COPIER, ARENA)                                                       \
     ({                                                                                             \
         typeof(ARRAY) __kh_array_ptr = ARRAY;                                                      \
         typeof(*__kh_array_ptr) __kh_array = *__kh_array_ptr;                                      \
+        khArena* __kh_arena = ARENA;                                                               \
                                                                                                    \
         /* The copied array */                                                                     \
-        typeof(__kh_array) __kh_copy =                                                             \
-            calloc(sizeof(_kharrayHeader) +                                                        \
-                       _kharray_typeSize(__kh_array_ptr) * (kharray_size(__kh_array_ptr) + 1),     \
-                   1);                                                                             \
+        typeof(__kh_array) __kh_copy = _kharray_allocate(                                          \
+            __kh_arena,                                                                            \
+            sizeof(_kharrayHeader) +                                                               \
+                _kharray_typeSize(__kh_array_ptr) * (kharray_size(__kh_array_ptr) + 1));           \
                                                                                                    \
         /* Placing the array header and fitting the reserve count, then offsetting the copy */     \
         *(_kharrayHeader*)__kh_copy = _kharray_header(__kh_array_ptr);                             \
+        ((_kharrayHeader*)__kh_copy)->references = 1;                                              \
         ((_kharrayHeader*)__kh_copy)->reserved = kharray_size(__kh_array_ptr);                     \
+        ((_kharrayHeader*)__kh_copy)->arena = __kh_arena;                                          \
         __kh_copy = (typeof(__kh_array))((_kharrayHeader*)__kh_copy + 1);                          \
                                                                                                    \
         /* Call the copy constructor of each element, unless it's NULL */                          \
@@ -84,6 +109,18 @@ static inline void* _kharray_new(size_t type_size, void (*deleter)(void*)) {
 #define kharray_delete(ARRAY) _kharray_delete(_kharray_verify(ARRAY))
 #define kharray_arrayDeleter(TYPE) ((void (*)(TYPE**))_kharray_delete)
 static inline void _kharray_delete(void** array) {
+    // Nothing left once it's been moved out
+    if (*array == NULL) {
+        return;
+    }
+
+    // Left to whatever else still shares it, or freed along with the arena instead
+    if (__atomic_sub_fetch(&_kharray_references(array), 1, __ATOMIC_ACQ_REL) > 0 ||
+        kharray_arena(array) != NULL) {
+        *array = NULL;
+        return;
+    }
+
     if (_kharray_deleter(array) != NULL) {
         // Increment by type size
         for (size_t i = 0; i < _kharray_typeSize(array) * kharray_size(array);
@@ -97,6 +134,44 @@ static inline void _kharray_delete(void** array) {
     *array = NULL;
 }
 
+// Takes the array out of the variable, leaving a NULL which deleting does nothing to
+#define kharray_move(ARRAY) _kharray_move(_kharray_verify(ARRAY))
+static inline void* _kharray_move(void** array) {
+    void* moved = *array;
+    *array = NULL;
+    return moved;
+}
+
+// Hands out the same array to another variable, which has to be deleted on its own as well. Its memory
+// and elements are only deleted along with the last one. A shared array mustn't be changed in place, so
+// whoever wants to change it first takes a copy of their own with `kharray_unshare`
+#define kharray_share(ARRAY) ((typeof(*(ARRAY)))_kharray_share(_kharray_verify(ARRAY)))
+static inline void* _kharray_share(void** array) {
+    if (*array != NULL) {
+        __atomic_add_fetch(&_kharray_references(array), 1, __ATOMIC_RELAXED);
+    }
+    return *array;
+}
+
+#define kharray_isShared(ARRAY) _kharray_isShared(_kharray_verify(ARRAY))
+static inline bool _kharray_isShared(void** array) {
+    return *array != NULL && __atomic_load_n(&_kharray_references(array), __ATOMIC_ACQUIRE) > 1;
+}
+
+// Copy-on-write: if the array is shared, it gets replaced with a copy made by COPIER, in the same place
+// it was allocated from. COPIER would usually share whatever the elements hold rather than copy it too
+#define kharray_unshare(ARRAY, COPIER)                                                   \
+    {                                                                                    \
+        typeof(ARRAY) __kh_shared_ptr = ARRAY;                                           \
+                                                                                         \
+        if (kharray_isShared(__kh_shared_ptr)) {                                         \
+            typeof(*__kh_shared_ptr) __kh_unshared =                                     \
+                kharray_copyIn(__kh_shared_ptr, COPIER, kharray_arena(__kh_shared_ptr)); \
+            kharray_delete(__kh_shared_ptr);                                             \
+            *__kh_shared_ptr = __kh_unshared;                                            \
+        }                                                                                \
+    }
+
 #define kharray_reserve(ARRAY, SIZE) _kharray_reserve(_kharray_verify(ARRAY), SIZE)
 static inline void _kharray_reserve(void** array, size_t size) {
     if (kharray_reserved(array) >= size) {
@@ -104,12 +179,24 @@ static inline void _kharray_reserve(void** array, size_t size) {
     }
 
     // Also, don't forget the null-terminator space
-    void* expanded_array = calloc(sizeof(_kharrayHeader) + _kharray_typeSize(array) * (size + 1), 1);
+    khArena* arena = kharray_arena(array);
+    size_t old_size = sizeof(_kharrayHeader) + _kharray_typeSize(array) * (kharray_reserved(array) + 1);
+    size_t new_size = sizeof(_kharrayHeader) + _kharray_typeSize(array) * (size + 1);
+
+    // The latest array allocated from an arena can just grow in place
+    if (arena != NULL && khArena_extend(arena, *array - sizeof(_kharrayHeader), old_size, new_size)) {
+        kharray_reserved(array) = size;
+        return;
+    }
+
+    void* expanded_array = _kharray_allocate(arena, new_size);
     *(_kharrayHeader*)expanded_array = _kharray_header(array);
     memcpy(expanded_array + sizeof(_kharrayHeader), *array,
            _kharray_typeSize(array) * kharray_size(array));
-    // Undo offset, free!
-    free(*array - sizeof(_kharrayHeader));
+    // Undo offset, free! Arrays on an arena simply leave their old memory there
+    if (arena == NULL) {
+        free(*array - sizeof(_kharrayHeader));
+    }
 
     ((_kharrayHeader*)expanded_array)->reserved = size;
     *array = expanded_array + sizeof(_kharrayHeader);
@@ -118,7 +205,8 @@ static inline void _kharray_reserve(void** array, size_t size) {
 #define kharray_fit(ARRAY) _kharray_fit(_kharray_verify(ARRAY));
 static inline void _kharray_fit(void** array) {
     // Pretty much the same implementation of `_kharray_reserve` but with this part different
-    if (kharray_reserved(array) == kharray_size(array)) {
+    // Memory on an arena can't be given back anyway
+    if (kharray_reserved(array) == kharray_size(array) || kharray_arena(array) != NULL) {
         return;
     }
 
@@ -138,7 +226,7 @@ static inline void _kharray_pop(void** array, size_t items) {
     // If it's trying to pop more items than the array actually has, cap it
     items = items > kharray_size(array) ? kharray_size(array) : items;
 
-    if (_kharray_deleter(array) != NULL) {
+    if (_kharray_deleter(array) != NULL && kharray_arena(array) == NULL) {
         for (size_t i = items; i > 0; i--) {
             _kharray_deleter(array)(*array + _kharray_typeSize(array) * (kharray_size(array) - i));
         }
@@ -209,7 +297,7 @@ static inline void _kharray_reverse(void** array) {
         kharray_memory(___kh_array_ptr, &___kh_item, 1, NULL);   \
     }
 
-#define kharray_concatenate(ARRAY, OTHER, COPIER) \
+#define kharray_concatenate(ARRAY, OTHER, COPIER)                \
     kharray_memory(ARRAY, *(OTHER), kharray_size(OTHER), COPIER)
 
 
@@ -29,6 +29,14 @@ static inline khbuffer khbuffer_copy(khbuffer* buffer) {
     return kharray_copy(buffer, NULL);
 }
 
+static inline khbuffer khbuffer_copyIn(khbuffer* buffer, khArena* arena) {
+    return kharray_copyIn(buffer, NULL, arena);
+}
+
+static inline khbuffer khbuffer_move(khbuffer* buffer) {
+    return kharray_move(buffer);
+}
+
 static inline void khbuffer_delete(khbuffer* buffer) {
     kharray_delete(buffer);
 }
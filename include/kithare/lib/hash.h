@@ -0,0 +1,59 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+// Final mix of MurmurHash3, which spreads every bit of the input over the whole output
+static inline uint64_t kh_mixHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCD;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Non-cryptographic 64-bit hash, going through the data a word at a time. Only meant to tell data
+// apart, not to resist collisions made on purpose. The result depends on the byte order of the machine
+static inline uint64_t kh_hash(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = seed ^ (size * 0x9E3779B97F4A7C15);
+
+    for (; size >= sizeof(uint64_t); bytes += sizeof(uint64_t), size -= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes, sizeof(uint64_t));
+        hash ^= word * 0x87C37B91114253D5;
+        hash = ((hash << 31) | (hash >> 33)) * 0x4CF5AD432745937F;
+    }
+
+    if (size > 0) {
+        uint64_t word = 0;
+        memcpy(&word, bytes, size);
+        hash ^= word * 0x87C37B91114253D5;
+        hash = ((hash << 31) | (hash >> 33)) * 0x4CF5AD432745937F;
+    }
+
+    return kh_mixHash(hash);
+}
+
+// Folds a value into a running hash, where the order of the values matters
+static inline uint64_t kh_combineHash(uint64_t hash, uint64_t value) {
+    return kh_mixHash(hash ^ (value + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2)));
+}
+
+
+#ifdef __cplusplus
+}
+#endif
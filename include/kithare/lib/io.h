@@ -17,6 +17,8 @@ extern "C" {
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/stat.h>
 #endif
 
 #include "array.h"
@@ -36,28 +38,47 @@ static inline void kh_putln(khstring* string, FILE* stream) {
     khbuffer_delete(&buffer);
 }
 
-static inline khbuffer kh_readFile(khstring* file_name, bool* success) {
-    khbuffer buffer = khbuffer_new("");
-
 #ifdef _WIN32
-    char16_t* char16_file_name = (char16_t*)calloc(khstring_size(file_name) + 1, sizeof(char16_t));
-    for (size_t i = 0; i < khstring_size(file_name); i++) {
-        char16_file_name[i] = (char16_t)(*file_name)[i];
+// Has to be freed
+static inline wchar_t* _kh_widePath(khstring* path) {
+    wchar_t* wide_path = (wchar_t*)calloc(khstring_size(path) + 1, sizeof(wchar_t));
+    for (size_t i = 0; i < khstring_size(path); i++) {
+        wide_path[i] = (wchar_t)(*path)[i];
     }
 
-    FILE* file = _wfopen(char16_file_name, L"rb");
-    free(char16_file_name);
+    return wide_path;
+}
+#endif
+
+static inline FILE* kh_openFile(khstring* file_name, bool write) {
+#ifdef _WIN32
+    wchar_t* wide_file_name = _kh_widePath(file_name);
+    FILE* file = _wfopen(wide_file_name, write ? L"wb" : L"rb");
+    free(wide_file_name);
 #else
     khbuffer utf8_file_name = kh_encodeUtf8(file_name);
-    FILE* file = fopen((char*)utf8_file_name, "rb");
+    FILE* file = fopen((char*)utf8_file_name, write ? "wb" : "rb");
     khbuffer_delete(&utf8_file_name);
 #endif
 
+    return file;
+}
+
+static inline khbuffer kh_readFile(khstring* file_name, bool* success) {
+    khbuffer buffer = khbuffer_new("");
+    FILE* file = kh_openFile(file_name, false);
+
     if (file != NULL) {
         fseek(file, 0, SEEK_END);
-        khbuffer_reserve(&buffer, ftell(file));
+        long size = ftell(file);
         rewind(file);
 
+        // Read in one go, with whatever may have come after the size was taken appended after
+        if (size > 0) {
+            khbuffer_reserve(&buffer, size);
+            kharray_size(&buffer) = fread(buffer, 1, size, file);
+        }
+
         int chr;
         while ((chr = fgetc(file)) != EOF) {
             khbuffer_append(&buffer, chr);
@@ -73,6 +94,65 @@ static inline khbuffer kh_readFile(khstring* file_name, bool* success) {
     return buffer;
 }
 
+// Replaces the file if it exists
+static inline bool kh_writeFile(khstring* file_name, khbuffer* content) {
+    FILE* file = kh_openFile(file_name, true);
+    if (file == NULL) {
+        return false;
+    }
+
+    bool written = fwrite(*content, 1, khbuffer_size(content), file) == khbuffer_size(content);
+    return fclose(file) == 0 && written;
+}
+
+// Atomically replaces the destination if it exists, as long as both are on the same file system
+static inline bool kh_moveFile(khstring* source, khstring* destination) {
+#ifdef _WIN32
+    wchar_t* wide_source = _kh_widePath(source);
+    wchar_t* wide_destination = _kh_widePath(destination);
+    bool moved = MoveFileExW(wide_source, wide_destination, MOVEFILE_REPLACE_EXISTING);
+    free(wide_source);
+    free(wide_destination);
+#else
+    khbuffer utf8_source = kh_encodeUtf8(source);
+    khbuffer utf8_destination = kh_encodeUtf8(destination);
+    bool moved = rename((char*)utf8_source, (char*)utf8_destination) == 0;
+    khbuffer_delete(&utf8_source);
+    khbuffer_delete(&utf8_destination);
+#endif
+
+    return moved;
+}
+
+static inline bool kh_removeFile(khstring* file_name) {
+#ifdef _WIN32
+    wchar_t* wide_file_name = _kh_widePath(file_name);
+    bool removed = _wremove(wide_file_name) == 0;
+    free(wide_file_name);
+#else
+    khbuffer utf8_file_name = kh_encodeUtf8(file_name);
+    bool removed = remove((char*)utf8_file_name) == 0;
+    khbuffer_delete(&utf8_file_name);
+#endif
+
+    return removed;
+}
+
+// Only makes the last directory of the path. Fails if it already exists
+static inline bool kh_makeDirectory(khstring* path) {
+#ifdef _WIN32
+    wchar_t* wide_path = _kh_widePath(path);
+    bool made = CreateDirectoryW(wide_path, NULL);
+    free(wide_path);
+#else
+    khbuffer utf8_path = kh_encodeUtf8(path);
+    bool made = mkdir((char*)utf8_path, 0777) == 0;
+    khbuffer_delete(&utf8_path);
+#endif
+
+    return made;
+}
+
 
 #ifdef __cplusplus
 }
@@ -14,7 +14,6 @@ extern "C" {
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
-#include <wctype.h>
 
 // Avaxar: Apple sucks
 #ifdef __APPLE__
@@ -31,20 +30,32 @@ typedef kharray(uint8_t) khbuffer;
 typedef kharray(char32_t) khstring;
 
 
-static inline khstring khstring_new(const char32_t* cstring) {
+static inline khstring khstring_newIn(const char32_t* cstring, khArena* arena) {
     size_t size = 0;
     for (; cstring[size] != U'\0'; size++) {}
 
-    khstring string = kharray_new(char32_t, NULL);
+    khstring string = kharray_newIn(char32_t, NULL, arena);
     kharray_memory(&string, (char32_t*)cstring, size, NULL);
 
     return string;
 }
 
+static inline khstring khstring_new(const char32_t* cstring) {
+    return khstring_newIn(cstring, NULL);
+}
+
 static inline khstring khstring_copy(khstring* string) {
     return kharray_copy(string, NULL);
 }
 
+static inline khstring khstring_copyIn(khstring* string, khArena* arena) {
+    return kharray_copyIn(string, NULL, arena);
+}
+
+static inline khstring khstring_move(khstring* string) {
+    return kharray_move(string);
+}
+
 static inline void khstring_delete(khstring* string) {
     kharray_delete(string);
 }
@@ -337,6 +348,25 @@ static inline khstring kh_decodeUtf8(khbuffer* buffer) {
     return string;
 }
 
+// Two-stage table of the printable code points, generated at build time by builder/unicode.py along
+// with the XID ones in kithare/core/unicode.h. The first stage maps `chr >> 8` to a block in the second
+// stage, which stores a bit per code point
+extern const uint8_t kh_printable_stage1[0x110000 >> 8];
+extern const uint8_t kh_printable_stage2[][32];
+
+// Whether the character is escaped as itself, the same everywhere rather than by the current locale.
+// Controls, format characters, separators other than the space, and unassigned code points aren't
+static inline bool kh_isPrintable(char32_t chr) {
+    if (chr < 0x80) {
+        return chr >= U' ' && chr < 0x7F;
+    }
+    if (chr >= 0x110000) {
+        return false;
+    }
+
+    return (kh_printable_stage2[kh_printable_stage1[chr >> 8]][(chr & 0xFF) >> 3] >> (chr & 7)) & 1;
+}
+
 static inline khstring kh_escapeChar(char32_t chr) {
     switch (chr) {
         // Regular single character escapes
@@ -366,7 +396,7 @@ static inline khstring kh_escapeChar(char32_t chr) {
         default: {
             khstring string = khstring_new(U"");
 
-            if (iswprint(chr)) {
+            if (kh_isPrintable(chr)) {
                 khstring_append(&string, chr);
                 return string;
             }
@@ -0,0 +1,108 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "array.h"
+#include "buffer.h"
+
+
+// Unsigned LEB128: seven bits per byte from the lowest, the highest bit set on all but the last byte
+static inline void kh_putVarint(khbuffer* buffer, uint64_t value) {
+    // Written straight into the reserved memory, with room for the longest varint
+    if (kharray_reserved(buffer) - khbuffer_size(buffer) < 10) {
+        size_t doubled = kharray_reserved(buffer) * 2;
+        kharray_reserve(buffer,
+                        doubled > khbuffer_size(buffer) + 10 ? doubled : khbuffer_size(buffer) + 10);
+    }
+
+    uint8_t* byte = *buffer + khbuffer_size(buffer);
+    while (value >= 0x80) {
+        *byte++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *byte++ = (uint8_t)value;
+
+    kharray_size(buffer) = byte - *buffer;
+}
+
+// Maps signed values to unsigned ones with the small magnitudes first: 0, -1, 1, -2, 2...
+static inline uint64_t kh_zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t kh_unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+
+// Reads varints off some data, turning invalid once anything is malformed or out of bounds and staying
+// so. Then it only needs to be checked once everything has been read
+typedef struct {
+    uint8_t* cursor;
+    uint8_t* end;
+    bool valid;
+} khVarintReader;
+
+static inline khVarintReader khVarintReader_new(uint8_t* data, size_t size) {
+    return (khVarintReader){.cursor = data, .end = data + size, .valid = true};
+}
+
+// Turns invalid if the value is above `max`
+static inline uint64_t khVarintReader_get(khVarintReader* reader, uint64_t max) {
+    // Most of them are a single byte
+    if (reader->cursor < reader->end && *reader->cursor < 0x80) {
+        uint64_t value = *reader->cursor++;
+        reader->valid &= value <= max;
+        return value;
+    }
+
+    uint64_t value = 0;
+    for (unsigned shift = 0; reader->cursor < reader->end && shift < 64; shift += 7) {
+        uint8_t byte = *reader->cursor++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) {
+            reader->valid &= value <= max;
+            return reader->valid ? value : 0;
+        }
+    }
+
+    reader->valid = false;
+    return 0;
+}
+
+// Count of the elements which follow. Every element takes at least a byte, which bounds the count
+// before anything gets allocated for it
+static inline size_t khVarintReader_count(khVarintReader* reader) {
+    size_t count = khVarintReader_get(reader, UINT32_MAX);
+    reader->valid &= count <= (size_t)(reader->end - reader->cursor);
+    return reader->valid ? count : 0;
+}
+
+// Takes `size` raw bytes, or NULL if there are less left
+static inline uint8_t* khVarintReader_bytes(khVarintReader* reader, size_t size) {
+    reader->valid &= size <= (size_t)(reader->end - reader->cursor);
+    if (!reader->valid) {
+        return NULL;
+    }
+
+    uint8_t* bytes = reader->cursor;
+    reader->cursor += size;
+    return bytes;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
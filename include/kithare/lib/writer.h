@@ -0,0 +1,263 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#pragma once
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "array.h"
+#include "buffer.h"
+#include "string.h"
+
+
+#define kh_WRITER_BUFFER_SIZE 65536
+
+
+// Text output, either appended to a string or encoded as UTF-8 into a stream. Streams are written
+// through a buffer of a fixed size, so that the memory used stays the same however much gets written
+typedef struct {
+    FILE* opt_stream; // NULL if it's written into `string` instead
+    khstring string;
+    uint8_t* buffer;
+    size_t size;
+} khWriter;
+
+
+// The string is left to the caller, rather than deleted along with the writer
+static inline khWriter khWriter_newString(void) {
+    return (khWriter){.opt_stream = NULL, .string = khstring_new(U""), .buffer = NULL, .size = 0};
+}
+
+static inline khWriter khWriter_newStream(FILE* stream) {
+    return (khWriter){.opt_stream = stream,
+                      .string = NULL,
+                      .buffer = (uint8_t*)malloc(kh_WRITER_BUFFER_SIZE),
+                      .size = 0};
+}
+
+static inline void khWriter_flush(khWriter* writer) {
+    if (writer->opt_stream != NULL && writer->size > 0) {
+        fwrite(writer->buffer, 1, writer->size, writer->opt_stream);
+        writer->size = 0;
+    }
+}
+
+// Flushes what's left in the buffer, if it writes into a stream
+static inline void khWriter_delete(khWriter* writer) {
+    khWriter_flush(writer);
+    free(writer->buffer);
+    writer->buffer = NULL;
+}
+
+static inline void khWriter_char(khWriter* writer, char32_t chr) {
+    if (writer->opt_stream == NULL) {
+        khstring_append(&writer->string, chr);
+        return;
+    }
+
+    if (writer->size + 4 > kh_WRITER_BUFFER_SIZE) {
+        khWriter_flush(writer);
+    }
+
+    // Same encoding as `kh_encodeUtf8`
+    uint8_t* buffer = writer->buffer + writer->size;
+    if (chr > 0xFFFF) {
+        buffer[0] = 0b11110000 | (uint8_t)(0b00000111 & (chr >> 18));
+        buffer[1] = 0b10000000 | (uint8_t)(0b00111111 & (chr >> 12));
+        buffer[2] = 0b10000000 | (uint8_t)(0b00111111 & (chr >> 6));
+        buffer[3] = 0b10000000 | (uint8_t)(0b00111111 & chr);
+        writer->size += 4;
+    }
+    else if (chr > 0x7FF) {
+        buffer[0] = 0b11100000 | (uint8_t)(0b00001111 & (chr >> 12));
+        buffer[1] = 0b10000000 | (uint8_t)(0b00111111 & (chr >> 6));
+        buffer[2] = 0b10000000 | (uint8_t)(0b00111111 & chr);
+        writer->size += 3;
+    }
+    else if (chr > 0x7F) {
+        buffer[0] = 0b11000000 | (uint8_t)(0b00011111 & (chr >> 6));
+        buffer[1] = 0b10000000 | (uint8_t)(0b00111111 & chr);
+        writer->size += 2;
+    }
+    else {
+        buffer[0] = chr;
+        writer->size++;
+    }
+}
+
+static inline void khWriter_cstring(khWriter* writer, const char32_t* cstring) {
+    for (; *cstring != U'\0'; cstring++) {
+        khWriter_char(writer, *cstring);
+    }
+}
+
+static inline void khWriter_string(khWriter* writer, khstring* string) {
+    for (char32_t* chr = *string; chr < *string + khstring_size(string); chr++) {
+        khWriter_char(writer, *chr);
+    }
+}
+
+// These write the same as their `kh_*ToString` counterparts, without allocating anything
+static inline void khWriter_uint(khWriter* writer, uint64_t uint_v, uint8_t base) {
+    char32_t digits[64];
+    size_t size = 0;
+
+    do {
+        uint8_t digit = uint_v % base;
+        digits[size++] = digit < 10 ? U'0' + digit : U'A' + digit - 10;
+        uint_v /= base;
+    } while (uint_v > 0);
+
+    while (size > 0) {
+        khWriter_char(writer, digits[--size]);
+    }
+}
+
+static inline void khWriter_int(khWriter* writer, int64_t int_v, uint8_t base) {
+    if (int_v < 0) {
+        khWriter_char(writer, U'-');
+    }
+
+    khWriter_uint(writer, int_v < 0 ? (uint64_t)0 - (uint64_t)int_v : (uint64_t)int_v, base);
+}
+
+static inline void khWriter_float(khWriter* writer, double floating, uint8_t precision, uint8_t base) {
+    if (floating < 0) {
+        khWriter_char(writer, U'-');
+        floating *= -1;
+    }
+
+    if (isinf(floating)) {
+        khWriter_cstring(writer, U"inf");
+        return;
+    }
+    else if (isnan(floating)) {
+        khWriter_cstring(writer, U"nan");
+        return;
+    }
+
+    // Enough for the integral digits of the largest double, even in binary
+    char32_t digits[1100];
+    size_t size = 0;
+
+    double value = floating;
+    while (value >= 1) {
+        uint8_t digit = (uint8_t)fmod(value, base);
+        digits[size++] = digit < 10 ? U'0' + digit : U'A' + digit - 10;
+        value /= base;
+    }
+
+    if (size == 0) {
+        khWriter_char(writer, U'0');
+    }
+    while (size > 0) {
+        khWriter_char(writer, digits[--size]);
+    }
+
+    if (precision > 0) {
+        khWriter_char(writer, U'.');
+
+        value = floating;
+        for (uint8_t i = 0; i < precision; i++) {
+            value *= base;
+            uint8_t digit = (uint8_t)fmod(value, base);
+            khWriter_char(writer, digit < 10 ? U'0' + digit : U'A' + digit - 10);
+        }
+    }
+}
+
+// Same as `kh_escapeChar`
+static inline void khWriter_escapeChar(khWriter* writer, char32_t chr) {
+    switch (chr) {
+        case U'\0':
+            khWriter_cstring(writer, U"\\0");
+            break;
+        case U'\n':
+            khWriter_cstring(writer, U"\\n");
+            break;
+        case U'\r':
+            khWriter_cstring(writer, U"\\r");
+            break;
+        case U'\t':
+            khWriter_cstring(writer, U"\\t");
+            break;
+        case U'\v':
+            khWriter_cstring(writer, U"\\v");
+            break;
+        case U'\b':
+            khWriter_cstring(writer, U"\\b");
+            break;
+        case U'\a':
+            khWriter_cstring(writer, U"\\a");
+            break;
+        case U'\f':
+            khWriter_cstring(writer, U"\\f");
+            break;
+        case U'\\':
+            khWriter_cstring(writer, U"\\\\");
+            break;
+        case U'\'':
+            khWriter_cstring(writer, U"\\\'");
+            break;
+        case U'\"':
+            khWriter_cstring(writer, U"\\\"");
+            break;
+
+        default:
+            if (kh_isPrintable(chr)) {
+                khWriter_char(writer, chr);
+            }
+            else {
+                khWriter_cstring(writer, chr < 0x100 ? U"\\x" : chr < 0x10000 ? U"\\u" : U"\\U");
+                khWriter_uint(writer, chr, 16);
+            }
+            break;
+    }
+}
+
+// Same as `khstring_quote` and `khbuffer_quote`
+static inline void khWriter_quoteSpan(khWriter* writer, const char32_t* begin, const char32_t* end) {
+    khWriter_char(writer, U'\"');
+    for (const char32_t* chr = begin; chr < end; chr++) {
+        if (*chr == U'\'') {
+            khWriter_char(writer, U'\'');
+        }
+        else {
+            khWriter_escapeChar(writer, *chr);
+        }
+    }
+    khWriter_char(writer, U'\"');
+}
+
+static inline void khWriter_quote(khWriter* writer, khstring* string) {
+    khWriter_quoteSpan(writer, *string, *string + khstring_size(string));
+}
+
+static inline void khWriter_quoteBuffer(khWriter* writer, khbuffer* buffer) {
+    khWriter_char(writer, U'\"');
+    for (uint8_t* byte = *buffer; byte < *buffer + khbuffer_size(buffer); byte++) {
+        if (*byte == '\'') {
+            khWriter_char(writer, U'\'');
+        }
+        else {
+            khWriter_escapeChar(writer, *byte);
+        }
+    }
+    khWriter_char(writer, U'\"');
+}
+
+
+#ifdef __cplusplus
+}
+#endif
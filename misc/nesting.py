@@ -0,0 +1,86 @@
+"""
+This file is a part of the Kithare programming language source code.
+The source code for Kithare programming language is distributed under the MIT license.
+Copyright (C) 2022 Kithare Organization
+
+misc/nesting.py
+Benchmark of the parser on deeply nested sources, the kind that machine-generated code has.
+
+Each case nests a construct a given amount of times, and repeats that enough times to be timed by
+`kcr parse`. Nesting within the parser's limit has to parse cleanly, and nesting far beyond it has to
+end up with a normal error rather than a crash.
+
+Usage: python3 misc/nesting.py <path/to/kcr> [depth] [repeats]
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+# Same as `kh_PARSE_MAX_DEPTH`
+MAX_DEPTH = 256
+
+CASES = {
+    "parentheses": lambda n: "(" * n + "x" + ")" * n,
+    "arrays": lambda n: "[" * n + "x" + "]" * n,
+    "dicts": lambda n: "{0: " * n + "x" + "}" * n,
+    "calls": lambda n: "f(" * n + "x" + ")" * n,
+    "unary": lambda n: "-" * n + "x",
+    "not": lambda n: "not " * n + "x",
+    "powers": lambda n: " ^ ".join(["x"] * (n + 1)),
+    "assignments": lambda n: " = ".join(["x"] * (n + 1)),
+    # Each one nests both an expression and a block
+    "lambdas": lambda n: "def() { return " * (n // 2) + "x" + " }" * (n // 2),
+}
+
+BLOCKS = lambda n: "def f() {\n" + "if x {\n" * n + "x = 1\n" + "}\n" * n + "}"
+
+
+def run(kcr, source):
+    with tempfile.NamedTemporaryFile("w", suffix=".kh", delete=False) as file:
+        file.write(source)
+
+    try:
+        start = time.perf_counter()
+        proc = subprocess.run(
+            [kcr, "parse", file.name], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL
+        )
+        return time.perf_counter() - start, proc.returncode
+    finally:
+        os.remove(file.name)
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+
+    kcr = sys.argv[1]
+    depth = int(sys.argv[2]) if len(sys.argv) > 2 else MAX_DEPTH // 2
+    repeats = int(sys.argv[3]) if len(sys.argv) > 3 else 1000
+
+    cases = {name: lambda n, case=case: "y = " + case(n) for name, case in CASES.items()}
+    cases["blocks"] = BLOCKS
+
+    print(f"{'case':<14}{'depth':>8}{'time':>10}{'MB/s':>10}  result")
+    for name, case in cases.items():
+        for n in (depth, MAX_DEPTH * 100):
+            # Beyond the limit, a single statement is enough
+            source = "\n".join([case(n)] * (repeats if n == depth else 1)) + "\n"
+            seconds, code = run(kcr, source)
+
+            if code < 0:
+                result = f"crashed ({-code})"
+            elif n <= MAX_DEPTH:
+                result = "ok" if code == 0 else f"{code} errors"
+            else:
+                result = "ok" if code > 0 else "expected an error"
+
+            throughput = len(source) / seconds / 1e6
+            print(f"{name:<14}{n:>8}{seconds:>9.3f}s{throughput:>10.2f}  {result}")
+
+
+if __name__ == "__main__":
+    main()
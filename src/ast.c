@@ -5,258 +5,631 @@
  * Copyright (C) 2022 Kithare Organization
  */
 
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <kithare/core/ast.h>
+#include <kithare/core/error.h>
+#include <kithare/core/token.h>
+#include <kithare/lib/hash.h>
 #include <kithare/lib/string.h>
+#include <kithare/lib/writer.h>
 
 
-khstring khAstStatementType_string(khAstStatementType type) {
+// Deletes an expression which its parent has a pointer to, or rather lets go of it in case it's shared;
+// it's NULL if the parent was moved out
+static inline void deleteChild(khAstExpression* child) {
+    if (child != NULL) {
+        khAstExpression_release(child);
+    }
+}
+
+// Copies are either deep, or only of the node itself with whatever it holds being shared
+#define copyOrShare(ARRAY, COPIER, SHARE) ((SHARE) ? kharray_share(ARRAY) : kharray_copy(ARRAY, COPIER))
+
+static inline khAstExpression* copyChild(khAstExpression* child, bool share) {
+    return share ? khAstExpression_retain(child)
+                 : khAstExpression_box(khAstExpression_copy(child), NULL);
+}
+
+// Payloads which are held out of line have the arena they're allocated from in front of them, and are
+// only freed by themselves when they're on the heap
+static void* allocateOutOfLine(size_t size, khArena* opt_arena) {
+    khArena** header = opt_arena != NULL
+                           ? (khArena**)khArena_allocate(opt_arena, sizeof(khArena*) + size)
+                           : (khArena**)malloc(sizeof(khArena*) + size);
+    *header = opt_arena;
+    return header + 1;
+}
+
+static inline khArena* outOfLineArena(void* payload) {
+    return *((khArena**)payload - 1);
+}
+
+static void freeOutOfLine(void* payload) {
+    khArena** header = (khArena**)payload - 1;
+    if (*header == NULL) {
+        free(header);
+    }
+}
+
+
+// What's left to be written of the nodes which have been started, kept on a stack of its own rather
+// than on the call stack, so that however deep the tree is, writing it can't overflow
+typedef enum {
+    khWriteTaskType_TEXT,
+    khWriteTaskType_QUOTE,
+    khWriteTaskType_EXPRESSION,
+    khWriteTaskType_STATEMENT,
+    khWriteTaskType_VARIABLE,
+    khWriteTaskType_PACKED
+} khWriteTaskType;
+
+typedef struct {
+    khWriteTaskType type;
+    union {
+        const char32_t* text;
+        khstring* string;
+        khAstExpression* expression;
+        khAstStatement* statement;
+        khAstVariable* variable;
+        struct {
+            khAstPackedValues* packed;
+            size_t index;
+        };
+    };
+} khWriteTask;
+
+static inline void deferText(kharray(khWriteTask) * tasks, const char32_t* text) {
+    kharray_append(tasks, ((khWriteTask){.type = khWriteTaskType_TEXT, .text = text}));
+}
+
+static inline void deferQuote(kharray(khWriteTask) * tasks, khstring* string) {
+    kharray_append(tasks, ((khWriteTask){.type = khWriteTaskType_QUOTE, .string = string}));
+}
+
+static inline void deferExpression(kharray(khWriteTask) * tasks, khAstExpression* expression) {
+    kharray_append(tasks,
+                   ((khWriteTask){.type = khWriteTaskType_EXPRESSION, .expression = expression}));
+}
+
+static inline void deferOptional(kharray(khWriteTask) * tasks, khAstExpression* opt_expression) {
+    if (opt_expression != NULL) {
+        deferExpression(tasks, opt_expression);
+    }
+    else {
+        deferText(tasks, U"null");
+    }
+}
+
+static inline void deferVariable(kharray(khWriteTask) * tasks, khAstVariable* variable) {
+    kharray_append(tasks, ((khWriteTask){.type = khWriteTaskType_VARIABLE, .variable = variable}));
+}
+
+static void deferExpressions(kharray(khWriteTask) * tasks, kharray(khAstExpression) * expressions) {
+    for (size_t i = 0; i < kharray_size(expressions); i++) {
+        deferExpression(tasks, &(*expressions)[i]);
+
+        if (i != kharray_size(expressions) - 1) {
+            deferText(tasks, U", ");
+        }
+    }
+}
+
+static void deferStatements(kharray(khWriteTask) * tasks, kharray(khAstStatement) * statements) {
+    for (size_t i = 0; i < kharray_size(statements); i++) {
+        kharray_append(tasks, ((khWriteTask){.type = khWriteTaskType_STATEMENT,
+                                             .statement = &(*statements)[i]}));
+
+        if (i != kharray_size(statements) - 1) {
+            deferText(tasks, U", ");
+        }
+    }
+}
+
+static void deferVariables(kharray(khWriteTask) * tasks, kharray(khAstVariable) * variables) {
+    for (size_t i = 0; i < kharray_size(variables); i++) {
+        deferVariable(tasks, &(*variables)[i]);
+
+        if (i != kharray_size(variables) - 1) {
+            deferText(tasks, U", ");
+        }
+    }
+}
+
+// Starting a node writes what comes before its first child right away, and defers the rest in order
+static void startExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                            khAstExpression* expression);
+static void startStatement(kharray(khWriteTask) * tasks, khWriter* writer, khAstStatement* statement);
+static void startVariable(kharray(khWriteTask) * tasks, khWriter* writer, khAstVariable* variable);
+
+// Reverses what got deferred from `first` onwards, so that it gets popped in the order it was deferred
+static inline void reverseTasks(kharray(khWriteTask) * tasks, size_t first) {
+    for (size_t i = first, j = kharray_size(tasks); i + 1 < j; i++, j--) {
+        khWriteTask task = (*tasks)[i];
+        (*tasks)[i] = (*tasks)[j - 1];
+        (*tasks)[j - 1] = task;
+    }
+}
+
+// Writes out everything deferred by the node which got started, then deletes the stack
+static void writeTasks(kharray(khWriteTask) * tasks, khWriter* writer) {
+    reverseTasks(tasks, 0);
+
+    while (kharray_size(tasks) > 0) {
+        khWriteTask task = (*tasks)[kharray_size(tasks) - 1];
+        kharray_pop(tasks, 1);
+        size_t first = kharray_size(tasks);
+
+        switch (task.type) {
+            case khWriteTaskType_TEXT:
+                khWriter_cstring(writer, task.text);
+                break;
+            case khWriteTaskType_QUOTE:
+                khWriter_quote(writer, task.string);
+                break;
+
+            case khWriteTaskType_EXPRESSION:
+                startExpression(tasks, writer, task.expression);
+                break;
+            case khWriteTaskType_STATEMENT:
+                startStatement(tasks, writer, task.statement);
+                break;
+            case khWriteTaskType_VARIABLE:
+                startVariable(tasks, writer, task.variable);
+                break;
+
+            // Packed elements are literals, which get written whole as they're started, so the
+            // transient expression isn't pointed to by anything that's left
+            case khWriteTaskType_PACKED: {
+                khAstExpression expression = khAstPackedValues_get(task.packed, task.index);
+                startExpression(tasks, writer, &expression);
+            } break;
+        }
+
+        reverseTasks(tasks, first);
+    }
+
+    kharray_delete(tasks);
+}
+
+
+khAstSource* khAstSource_new(char32_t* string, uint32_t file, khArena* opt_arena) {
+    khAstSource* source = opt_arena != NULL
+                              ? (khAstSource*)khArena_allocate(opt_arena, sizeof(khAstSource))
+                              : (khAstSource*)malloc(sizeof(khAstSource));
+    *source = (khAstSource){.string = string, .file = file, .references = 1, .opt_arena = opt_arena};
+    return source;
+}
+
+khAstSource* khAstSource_retain(khAstSource* source) {
+    __atomic_add_fetch(&source->references, 1, __ATOMIC_RELAXED);
+    return source;
+}
+
+void khAstSource_release(khAstSource* source) {
+    // Same as the boxes, a source on an arena is freed along with it
+    if (__atomic_sub_fetch(&source->references, 1, __ATOMIC_ACQ_REL) > 0 || source->opt_arena != NULL) {
+        return;
+    }
+
+    free(source);
+}
+
+// Deep copies live on the heap, so they can't hold onto a source on an arena which may go before them
+static inline khAstSource* copySource(khAstSource* source, bool share) {
+    return share || source->opt_arena == NULL ? khAstSource_retain(source)
+                                              : khAstSource_new(source->string, source->file, NULL);
+}
+
+
+static const char32_t* statementTypeName(khAstStatementType type) {
     switch (type) {
         case khAstStatementType_INVALID:
-            return khstring_new(U"invalid");
+            return U"invalid";
 
         case khAstStatementType_VARIABLE:
-            return khstring_new(U"variable");
+            return U"variable";
         case khAstStatementType_EXPRESSION:
-            return khstring_new(U"expression");
+            return U"expression";
 
         case khAstStatementType_IMPORT:
-            return khstring_new(U"import");
+            return U"import";
         case khAstStatementType_INCLUDE:
-            return khstring_new(U"include");
+            return U"include";
         case khAstStatementType_FUNCTION:
-            return khstring_new(U"function");
+            return U"function";
         case khAstStatementType_CLASS:
-            return khstring_new(U"class");
+            return U"class";
         case khAstStatementType_STRUCT:
-            return khstring_new(U"struct");
+            return U"struct";
         case khAstStatementType_ENUM:
-            return khstring_new(U"enum");
+            return U"enum";
         case khAstStatementType_ALIAS:
-            return khstring_new(U"alias");
+            return U"alias";
 
         case khAstStatementType_IF_BRANCH:
-            return khstring_new(U"if_branch");
+            return U"if_branch";
         case khAstStatementType_WHILE_LOOP:
-            return khstring_new(U"while_loop");
+            return U"while_loop";
         case khAstStatementType_DO_WHILE_LOOP:
-            return khstring_new(U"do_while_loop");
+            return U"do_while_loop";
         case khAstStatementType_FOR_LOOP:
-            return khstring_new(U"for_loop");
+            return U"for_loop";
         case khAstStatementType_BREAK:
-            return khstring_new(U"break");
+            return U"break";
         case khAstStatementType_CONTINUE:
-            return khstring_new(U"continue");
+            return U"continue";
         case khAstStatementType_RETURN:
-            return khstring_new(U"return");
+            return U"return";
 
         default:
-            return khstring_new(U"unknown");
+            return U"unknown";
     }
 }
 
+khstring khAstStatementType_string(khAstStatementType type) {
+    return khstring_new(statementTypeName(type));
+}
+
 
-khAstVariable khAstVariable_copy(khAstVariable* variable) {
+static khAstVariable copyVariable(khAstVariable* variable, bool share) {
     khAstExpression* opt_type = NULL;
     if (variable->opt_type != NULL) {
-        opt_type = (khAstExpression*)malloc(sizeof(khAstExpression));
-        *opt_type = khAstExpression_copy(variable->opt_type);
+        opt_type = copyChild(variable->opt_type, share);
     }
 
     khAstExpression* opt_initializer = NULL;
     if (variable->opt_initializer != NULL) {
-        opt_initializer = (khAstExpression*)malloc(sizeof(khAstExpression));
-        *opt_initializer = khAstExpression_copy(variable->opt_initializer);
+        opt_initializer = copyChild(variable->opt_initializer, share);
     }
 
     return (khAstVariable){.is_static = variable->is_static,
                            .is_wild = variable->is_wild,
                            .is_ref = variable->is_ref,
-                           .names = kharray_copy(&variable->names, khstring_copy),
+                           .names = copyOrShare(&variable->names, khstring_copy, share),
                            .opt_type = opt_type,
                            .opt_initializer = opt_initializer};
 }
 
+khAstVariable khAstVariable_copy(khAstVariable* variable) {
+    return copyVariable(variable, false);
+}
+
+khAstVariable khAstVariable_move(khAstVariable* variable) {
+    khAstVariable moved = *variable;
+    *variable = (khAstVariable){0};
+    return moved;
+}
+
 void khAstVariable_delete(khAstVariable* variable) {
     kharray_delete(&variable->names);
-    if (variable->opt_type != NULL) {
-        khAstExpression_delete(variable->opt_type);
-        free(variable->opt_type);
-    }
-    if (variable->opt_initializer != NULL) {
-        khAstExpression_delete(variable->opt_initializer);
-        free(variable->opt_initializer);
-    }
+    deleteChild(variable->opt_type);
+    deleteChild(variable->opt_initializer);
 }
 
-khstring khAstVariable_string(khAstVariable* variable, char32_t* origin) {
-    khstring string = khstring_new(U"{\"is_static\": ");
-    khstring_concatenateCstring(&string, variable->is_static ? U"true" : U"false");
+static void startVariable(kharray(khWriteTask) * tasks, khWriter* writer, khAstVariable* variable) {
+    khWriter_cstring(writer, U"{\"is_static\": ");
+    khWriter_cstring(writer, variable->is_static ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"is_wild\": ");
-    khstring_concatenateCstring(&string, variable->is_wild ? U"true" : U"false");
+    khWriter_cstring(writer, U", \"is_wild\": ");
+    khWriter_cstring(writer, variable->is_wild ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"is_ref\": ");
-    khstring_concatenateCstring(&string, variable->is_ref ? U"true" : U"false");
+    khWriter_cstring(writer, U", \"is_ref\": ");
+    khWriter_cstring(writer, variable->is_ref ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"names\": [");
+    khWriter_cstring(writer, U", \"names\": [");
     for (size_t i = 0; i < kharray_size(&variable->names); i++) {
-        khstring quoted_name = khstring_quote(&variable->names[i]);
-        khstring_concatenate(&string, &quoted_name);
-        khstring_delete(&quoted_name);
+        khWriter_quote(writer, &variable->names[i]);
 
         if (i != kharray_size(&variable->names) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"opt_type\": ");
-    if (variable->opt_type != NULL) {
-        khstring opt_type_str = khAstExpression_string(variable->opt_type, origin);
-        khstring_concatenate(&string, &opt_type_str);
-        khstring_delete(&opt_type_str);
-    }
-    else {
-        khstring_concatenateCstring(&string, U"null");
-    }
+    khWriter_cstring(writer, U"], \"opt_type\": ");
+    deferOptional(tasks, variable->opt_type);
 
-    khstring_concatenateCstring(&string, U", \"opt_initializer\": ");
-    if (variable->opt_initializer != NULL) {
-        khstring opt_initializer_str = khAstExpression_string(variable->opt_initializer, origin);
-        khstring_concatenate(&string, &opt_initializer_str);
-        khstring_delete(&opt_initializer_str);
-    }
-    else {
-        khstring_concatenateCstring(&string, U"null");
-    }
+    deferText(tasks, U", \"opt_initializer\": ");
+    deferOptional(tasks, variable->opt_initializer);
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+    deferText(tasks, U"}");
 }
 
+void khAstVariable_write(khAstVariable* variable, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startVariable(&tasks, writer, variable);
+    writeTasks(&tasks, writer);
+}
 
-khstring khAstExpressionType_string(khAstExpressionType type) {
+khstring khAstVariable_string(khAstVariable* variable) {
+    khWriter writer = khWriter_newString();
+    khAstVariable_write(variable, &writer);
+    return writer.string;
+}
+
+
+static const char32_t* expressionTypeName(khAstExpressionType type) {
     switch (type) {
         case khAstExpressionType_INVALID:
-            return khstring_new(U"invalid");
+            return U"invalid";
 
         case khAstExpressionType_IDENTIFIER:
-            return khstring_new(U"identifier");
+            return U"identifier";
         case khAstExpressionType_CHAR:
-            return khstring_new(U"char");
+            return U"char";
         case khAstExpressionType_STRING:
-            return khstring_new(U"string");
+            return U"string";
         case khAstExpressionType_BUFFER:
-            return khstring_new(U"buffer");
+            return U"buffer";
         case khAstExpressionType_BYTE:
-            return khstring_new(U"byte");
+            return U"byte";
         case khAstExpressionType_INTEGER:
-            return khstring_new(U"integer");
+            return U"integer";
         case khAstExpressionType_UINTEGER:
-            return khstring_new(U"uinteger");
+            return U"uinteger";
         case khAstExpressionType_FLOAT:
-            return khstring_new(U"float");
+            return U"float";
         case khAstExpressionType_DOUBLE:
-            return khstring_new(U"double");
+            return U"double";
         case khAstExpressionType_IFLOAT:
-            return khstring_new(U"ifloat");
+            return U"ifloat";
         case khAstExpressionType_IDOUBLE:
-            return khstring_new(U"idouble");
+            return U"idouble";
 
         case khAstExpressionType_TUPLE:
-            return khstring_new(U"tuple");
+            return U"tuple";
         case khAstExpressionType_ARRAY:
-            return khstring_new(U"array");
+            return U"array";
         case khAstExpressionType_DICT:
-            return khstring_new(U"dict");
+            return U"dict";
         case khAstExpressionType_ELLIPSIS:
-            return khstring_new(U"ellipsis");
+            return U"ellipsis";
 
         case khAstExpressionType_SIGNATURE:
-            return khstring_new(U"signature");
+            return U"signature";
         case khAstExpressionType_LAMBDA:
-            return khstring_new(U"lambda");
+            return U"lambda";
 
         case khAstExpressionType_UNARY:
-            return khstring_new(U"unary");
+            return U"unary";
         case khAstExpressionType_BINARY:
-            return khstring_new(U"binary");
+            return U"binary";
         case khAstExpressionType_TERNARY:
-            return khstring_new(U"ternary");
+            return U"ternary";
         case khAstExpressionType_COMPARISON:
-            return khstring_new(U"comparison");
+            return U"comparison";
         case khAstExpressionType_CALL:
-            return khstring_new(U"call");
+            return U"call";
         case khAstExpressionType_INDEX:
-            return khstring_new(U"index");
+            return U"index";
 
         case khAstExpressionType_SCOPE:
-            return khstring_new(U"scope");
+            return U"scope";
         case khAstExpressionType_TEMPLATIZE:
-            return khstring_new(U"templatize");
+            return U"templatize";
+
+        default:
+            return U"unknown";
+    }
+}
+
+khstring khAstExpressionType_string(khAstExpressionType type) {
+    return khstring_new(expressionTypeName(type));
+}
+
+
+size_t khAstPackedValues_width(khAstExpressionType type) {
+    switch (type) {
+        case khAstExpressionType_CHAR:
+            return sizeof(char32_t);
+        case khAstExpressionType_BYTE:
+            return sizeof(uint8_t);
+        case khAstExpressionType_INTEGER:
+            return sizeof(int64_t);
+        case khAstExpressionType_UINTEGER:
+            return sizeof(uint64_t);
+        case khAstExpressionType_FLOAT:
+            return sizeof(float);
+        case khAstExpressionType_DOUBLE:
+            return sizeof(double);
+
+        default:
+            return 0;
+    }
+}
+
+size_t khAstPackedValues_size(khAstPackedValues* packed) {
+    return packed->type != khAstExpressionType_INVALID
+               ? kharray_size(&packed->data) / khAstPackedValues_width(packed->type)
+               : 0;
+}
+
+khAstExpression khAstPackedValues_get(khAstPackedValues* packed, size_t index) {
+    khAstExpression expression = {
+        .begin = khAst_NO_SPAN, .end = khAst_NO_SPAN, .file = kh_getFile(), .type = packed->type};
+    uint8_t* value = packed->data + index * khAstPackedValues_width(packed->type);
+
+    switch (packed->type) {
+        case khAstExpressionType_CHAR:
+            memcpy(&expression.char_v, value, sizeof(char32_t));
+            break;
+        case khAstExpressionType_BYTE:
+            expression.byte = *value;
+            break;
+        case khAstExpressionType_INTEGER:
+            memcpy(&expression.integer, value, sizeof(int64_t));
+            break;
+        case khAstExpressionType_UINTEGER:
+            memcpy(&expression.uinteger, value, sizeof(uint64_t));
+            break;
+        case khAstExpressionType_FLOAT:
+            memcpy(&expression.float_v, value, sizeof(float));
+            break;
+        case khAstExpressionType_DOUBLE:
+            memcpy(&expression.double_v, value, sizeof(double));
+            break;
 
         default:
-            return khstring_new(U"unknown");
+            break;
+    }
+
+    return expression;
+}
+
+static inline khAstPackedValues copyPackedValues(khAstPackedValues* packed, bool share) {
+    return (khAstPackedValues){.type = packed->type,
+                               .data = packed->type != khAstExpressionType_INVALID
+                                           ? copyOrShare(&packed->data, NULL, share)
+                                           : NULL};
+}
+
+static inline void deletePackedValues(khAstPackedValues* packed) {
+    if (packed->type != khAstExpressionType_INVALID) {
+        kharray_delete(&packed->data);
+    }
+}
+
+// Literal expressions own nothing, so the expanded ones go wherever the packed values were allocated
+static void expandPackedValues(khAstPackedValues* packed, kharray(khAstExpression) * values) {
+    if (packed->type == khAstExpressionType_INVALID) {
+        return;
+    }
+
+    size_t size = khAstPackedValues_size(packed);
+    kharray_delete(values);
+    *values = kharray_newIn(khAstExpression, khAstExpression_delete, kharray_arena(&packed->data));
+    kharray_reserve(values, size);
+
+    for (size_t i = 0; i < size; i++) {
+        kharray_append(values, khAstPackedValues_get(packed, i));
+    }
+
+    deletePackedValues(packed);
+    *packed = (khAstPackedValues){.type = khAstExpressionType_INVALID, .data = NULL};
+}
+
+static void startValues(kharray(khWriteTask) * tasks, khWriter* writer,
+                        kharray(khAstExpression) * values, khAstPackedValues* packed) {
+    khWriter_cstring(writer, U"{\"values\": [");
+
+    if (packed->type != khAstExpressionType_INVALID) {
+        size_t size = khAstPackedValues_size(packed);
+        for (size_t i = 0; i < size; i++) {
+            kharray_append(tasks, ((khWriteTask){.type = khWriteTaskType_PACKED,
+                                                 .packed = packed,
+                                                 .index = i}));
+
+            if (i != size - 1) {
+                deferText(tasks, U", ");
+            }
+        }
+    }
+    else {
+        deferExpressions(tasks, values);
     }
+
+    deferText(tasks, U"]}");
 }
 
+static khAstTuple copyTuple(khAstTuple* tuple, bool share) {
+    return (khAstTuple){.values = copyOrShare(&tuple->values, khAstExpression_copy, share),
+                        .packed = copyPackedValues(&tuple->packed, share)};
+}
 
 khAstTuple khAstTuple_copy(khAstTuple* tuple) {
-    return (khAstTuple){.values = kharray_copy(&tuple->values, khAstExpression_copy)};
+    return copyTuple(tuple, false);
+}
+
+khAstTuple khAstTuple_move(khAstTuple* tuple) {
+    khAstTuple moved = *tuple;
+    *tuple = (khAstTuple){0};
+    return moved;
 }
 
 void khAstTuple_delete(khAstTuple* tuple) {
     kharray_delete(&tuple->values);
+    deletePackedValues(&tuple->packed);
 }
 
-khstring khAstTuple_string(khAstTuple* tuple, char32_t* origin) {
-    khstring string = khstring_new(U"{\"values\": [");
+static inline void startTuple(kharray(khWriteTask) * tasks, khWriter* writer, khAstTuple* tuple) {
+    startValues(tasks, writer, &tuple->values, &tuple->packed);
+}
 
-    for (size_t i = 0; i < kharray_size(&tuple->values); i++) {
-        khstring expression_str = khAstExpression_string(&tuple->values[i], origin);
-        khstring_concatenate(&string, &expression_str);
-        khstring_delete(&expression_str);
+void khAstTuple_write(khAstTuple* tuple, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startTuple(&tasks, writer, tuple);
+    writeTasks(&tasks, writer);
+}
 
-        if (i != kharray_size(&tuple->values) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+khstring khAstTuple_string(khAstTuple* tuple) {
+    khWriter writer = khWriter_newString();
+    khAstTuple_write(tuple, &writer);
+    return writer.string;
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+kharray(khAstExpression) * khAstTuple_values(khAstTuple* tuple) {
+    expandPackedValues(&tuple->packed, &tuple->values);
+    return &tuple->values;
 }
 
 
+static khAstArray copyArray(khAstArray* array, bool share) {
+    return (khAstArray){.values = copyOrShare(&array->values, khAstExpression_copy, share),
+                        .packed = copyPackedValues(&array->packed, share)};
+}
+
 khAstArray khAstArray_copy(khAstArray* array) {
-    return (khAstArray){.values = kharray_copy(&array->values, khAstExpression_copy)};
+    return copyArray(array, false);
+}
+
+khAstArray khAstArray_move(khAstArray* array) {
+    khAstArray moved = *array;
+    *array = (khAstArray){0};
+    return moved;
 }
 
 void khAstArray_delete(khAstArray* array) {
     kharray_delete(&array->values);
+    deletePackedValues(&array->packed);
 }
 
-khstring khAstArray_string(khAstArray* array, char32_t* origin) {
-    khstring string = khstring_new(U"{\"values\": [");
+static inline void startArray(kharray(khWriteTask) * tasks, khWriter* writer, khAstArray* array) {
+    startValues(tasks, writer, &array->values, &array->packed);
+}
 
-    for (size_t i = 0; i < kharray_size(&array->values); i++) {
-        khstring expression_str = khAstExpression_string(&array->values[i], origin);
-        khstring_concatenate(&string, &expression_str);
-        khstring_delete(&expression_str);
+void khAstArray_write(khAstArray* array, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startArray(&tasks, writer, array);
+    writeTasks(&tasks, writer);
+}
 
-        if (i != kharray_size(&array->values) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+khstring khAstArray_string(khAstArray* array) {
+    khWriter writer = khWriter_newString();
+    khAstArray_write(array, &writer);
+    return writer.string;
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+kharray(khAstExpression) * khAstArray_values(khAstArray* array) {
+    expandPackedValues(&array->packed, &array->values);
+    return &array->values;
 }
 
 
+static khAstDict copyDict(khAstDict* dict, bool share) {
+    return (khAstDict){.keys = copyOrShare(&dict->keys, khAstExpression_copy, share),
+                       .values = copyOrShare(&dict->values, khAstExpression_copy, share)};
+}
+
 khAstDict khAstDict_copy(khAstDict* dict) {
-    return (khAstDict){.keys = kharray_copy(&dict->keys, khAstExpression_copy),
-                       .values = kharray_copy(&dict->values, khAstExpression_copy)};
+    return copyDict(dict, false);
+}
+
+khAstDict khAstDict_move(khAstDict* dict) {
+    khAstDict moved = *dict;
+    *dict = (khAstDict){0};
+    return moved;
 }
 
 void khAstDict_delete(khAstDict* dict) {
@@ -264,406 +637,491 @@ void khAstDict_delete(khAstDict* dict) {
     kharray_delete(&dict->values);
 }
 
-khstring khAstDict_string(khAstDict* dict, char32_t* origin) {
-    khstring string = khstring_new(U"{\"keys\": [");
-
-    for (size_t i = 0; i < kharray_size(&dict->keys); i++) {
-        khstring expression_str = khAstExpression_string(&dict->keys[i], origin);
-        khstring_concatenate(&string, &expression_str);
-        khstring_delete(&expression_str);
-
-        if (i != kharray_size(&dict->keys) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+static void startDict(kharray(khWriteTask) * tasks, khWriter* writer, khAstDict* dict) {
+    khWriter_cstring(writer, U"{\"keys\": [");
+    deferExpressions(tasks, &dict->keys);
 
-    khstring_concatenateCstring(&string, U"], \"values\": [");
+    deferText(tasks, U"], \"values\": [");
+    deferExpressions(tasks, &dict->values);
 
-    for (size_t i = 0; i < kharray_size(&dict->values); i++) {
-        khstring expression_str = khAstExpression_string(&dict->values[i], origin);
-        khstring_concatenate(&string, &expression_str);
-        khstring_delete(&expression_str);
+    deferText(tasks, U"]}");
+}
 
-        if (i != kharray_size(&dict->values) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+void khAstDict_write(khAstDict* dict, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startDict(&tasks, writer, dict);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstDict_string(khAstDict* dict) {
+    khWriter writer = khWriter_newString();
+    khAstDict_write(dict, &writer);
+    return writer.string;
 }
 
 
-khAstSignature khAstSignature_copy(khAstSignature* signature) {
+static khAstSignature copySignature(khAstSignature* signature, bool share) {
     khAstExpression* opt_return_type = NULL;
     if (signature->opt_return_type != NULL) {
-        opt_return_type = (khAstExpression*)malloc(sizeof(khAstExpression));
-        *opt_return_type = khAstExpression_copy(signature->opt_return_type);
+        opt_return_type = copyChild(signature->opt_return_type, share);
     }
 
-    return (khAstSignature){.are_arguments_refs = kharray_copy(&signature->are_arguments_refs, NULL),
+    return (khAstSignature){.are_arguments_refs =
+                                copyOrShare(&signature->are_arguments_refs, NULL, share),
                             .argument_types =
-                                kharray_copy(&signature->argument_types, khAstExpression_copy),
+                                copyOrShare(&signature->argument_types, khAstExpression_copy, share),
                             .is_return_type_ref = signature->is_return_type_ref,
                             .opt_return_type = opt_return_type};
 }
 
+khAstSignature khAstSignature_copy(khAstSignature* signature) {
+    return copySignature(signature, false);
+}
+
+khAstSignature khAstSignature_move(khAstSignature* signature) {
+    khAstSignature moved = *signature;
+    *signature = (khAstSignature){0};
+    return moved;
+}
+
 void khAstSignature_delete(khAstSignature* signature) {
     kharray_delete(&signature->are_arguments_refs);
     kharray_delete(&signature->argument_types);
 
-    if (signature->opt_return_type != NULL) {
-        khAstExpression_delete(signature->opt_return_type);
-        free(signature->opt_return_type);
-    }
+    deleteChild(signature->opt_return_type);
 }
 
-khstring khAstSignature_string(khAstSignature* signature, char32_t* origin) {
-    khstring string = khstring_new(U"{\"are_arguments_refs\": [");
+static void startSignature(kharray(khWriteTask) * tasks, khWriter* writer,
+                           khAstSignature* signature) {
+    khWriter_cstring(writer, U"{\"are_arguments_refs\": [");
     for (size_t i = 0; i < kharray_size(&signature->are_arguments_refs); i++) {
-        khstring_concatenateCstring(&string, signature->are_arguments_refs[i] ? U"true" : U"false");
+        khWriter_cstring(writer, signature->are_arguments_refs[i] ? U"true" : U"false");
 
         if (i != kharray_size(&signature->are_arguments_refs) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"argument_types\": [");
-    for (size_t i = 0; i < kharray_size(&signature->argument_types); i++) {
-        khstring argument_type_str = khAstExpression_string(&signature->argument_types[i], origin);
-        khstring_concatenate(&string, &argument_type_str);
-        khstring_delete(&argument_type_str);
+    khWriter_cstring(writer, U"], \"argument_types\": [");
+    deferExpressions(tasks, &signature->argument_types);
 
-        if (i != kharray_size(&signature->argument_types) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+    deferText(tasks, U"], \"is_return_type_ref\": ");
+    deferText(tasks, signature->is_return_type_ref ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U"], \"is_return_type_ref\": ");
-    khstring_concatenateCstring(&string, signature->is_return_type_ref ? U"true" : U"false");
+    deferText(tasks, U", \"opt_return_type\": ");
+    deferOptional(tasks, signature->opt_return_type);
 
-    khstring_concatenateCstring(&string, U", \"opt_return_type\": ");
-    khstring return_type_str = khAstExpression_string(signature->opt_return_type, origin);
-    khstring_concatenate(&string, &return_type_str);
-    khstring_delete(&return_type_str);
+    deferText(tasks, U"}");
+}
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+void khAstSignature_write(khAstSignature* signature, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startSignature(&tasks, writer, signature);
+    writeTasks(&tasks, writer);
 }
 
+khstring khAstSignature_string(khAstSignature* signature) {
+    khWriter writer = khWriter_newString();
+    khAstSignature_write(signature, &writer);
+    return writer.string;
+}
 
-khAstLambda khAstLambda_copy(khAstLambda* lambda) {
+khAstSignature* khAstSignature_box(khAstSignature signature, khArena* opt_arena) {
+    khAstSignature* boxed = (khAstSignature*)allocateOutOfLine(sizeof(khAstSignature), opt_arena);
+    *boxed = signature;
+    return boxed;
+}
+
+
+// A copy gets allocated from the heap, and so does its block once it's parsed
+static inline khAstLazyBlock copyLazyBlock(khAstLazyBlock* lazy_block, bool share) {
+    return (khAstLazyBlock){.source = lazy_block->source != NULL
+                                          ? copySource(lazy_block->source, share)
+                                          : NULL,
+                            .begin = lazy_block->begin,
+                            .end = lazy_block->end,
+                            .opt_arena = NULL};
+}
+
+static inline void deleteLazyBlock(khAstLazyBlock* lazy_block) {
+    if (lazy_block->source != NULL) {
+        khAstSource_release(lazy_block->source);
+    }
+}
+
+static khAstLambda copyLambda(khAstLambda* lambda, bool share) {
     khAstVariable* opt_variadic_argument = NULL;
     if (lambda->opt_variadic_argument != NULL) {
-        opt_variadic_argument = (khAstVariable*)malloc(sizeof(khAstExpression));
-        *opt_variadic_argument = khAstVariable_copy(lambda->opt_variadic_argument);
+        opt_variadic_argument = copyOrShare(&lambda->opt_variadic_argument, khAstVariable_copy, share);
     }
 
     khAstExpression* opt_return_type = NULL;
     if (lambda->opt_return_type != NULL) {
-        opt_return_type = (khAstExpression*)malloc(sizeof(khAstExpression));
-        *opt_return_type = khAstExpression_copy(lambda->opt_return_type);
+        opt_return_type = copyChild(lambda->opt_return_type, share);
     }
 
-    return (khAstLambda){.arguments = kharray_copy(&lambda->arguments, khAstVariable_copy),
+    return (khAstLambda){.arguments = copyOrShare(&lambda->arguments, khAstVariable_copy, share),
                          .opt_variadic_argument = opt_variadic_argument,
                          .is_return_type_ref = lambda->is_return_type_ref,
                          .opt_return_type = opt_return_type,
-                         .block = kharray_copy(&lambda->block, khAstStatement_copy)};
+                         .block = copyOrShare(&lambda->block, khAstStatement_copy, share),
+                         .lazy_block = copyLazyBlock(&lambda->lazy_block, share)};
+}
+
+khAstLambda khAstLambda_copy(khAstLambda* lambda) {
+    return copyLambda(lambda, false);
+}
+
+khAstLambda khAstLambda_move(khAstLambda* lambda) {
+    khAstLambda moved = *lambda;
+    *lambda = (khAstLambda){0};
+    return moved;
 }
 
 void khAstLambda_delete(khAstLambda* lambda) {
     kharray_delete(&lambda->arguments);
-    if (lambda->opt_variadic_argument != NULL) {
-        khAstVariable_delete(lambda->opt_variadic_argument);
-        free(lambda->opt_variadic_argument);
-    }
-    if (lambda->opt_return_type != NULL) {
-        khAstExpression_delete(lambda->opt_return_type);
-        free(lambda->opt_return_type);
-    }
+    kharray_delete(&lambda->opt_variadic_argument);
+    deleteChild(lambda->opt_return_type);
     kharray_delete(&lambda->block);
+    deleteLazyBlock(&lambda->lazy_block);
 }
 
-khstring khAstLambda_string(khAstLambda* lambda, char32_t* origin) {
-    khstring string = khstring_new(U"{\"arguments\": [");
-    for (size_t i = 0; i < kharray_size(&lambda->arguments); i++) {
-        khstring argument_str = khAstVariable_string(&lambda->arguments[i], origin);
-        khstring_concatenate(&string, &argument_str);
-        khstring_delete(&argument_str);
+static void startLambda(kharray(khWriteTask) * tasks, khWriter* writer, khAstLambda* lambda) {
+    khWriter_cstring(writer, U"{\"arguments\": [");
+    deferVariables(tasks, &lambda->arguments);
 
-        if (i != kharray_size(&lambda->arguments) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
-
-    khstring_concatenateCstring(&string, U"], \"opt_variadic_argument\": ");
+    deferText(tasks, U"], \"opt_variadic_argument\": ");
     if (lambda->opt_variadic_argument != NULL) {
-        khstring opt_variadic_argument_str =
-            khAstVariable_string(lambda->opt_variadic_argument, origin);
-        khstring_concatenate(&string, &opt_variadic_argument_str);
-        khstring_delete(&opt_variadic_argument_str);
+        deferVariable(tasks, lambda->opt_variadic_argument);
     }
     else {
-        khstring_concatenateCstring(&string, U"null");
+        deferText(tasks, U"null");
     }
 
-    khstring_concatenateCstring(&string, U", \"is_return_type_ref\": ");
-    khstring_concatenateCstring(&string, lambda->is_return_type_ref ? U"true" : U"false");
+    deferText(tasks, U", \"is_return_type_ref\": ");
+    deferText(tasks, lambda->is_return_type_ref ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"opt_return_type\": ");
-    if (lambda->opt_return_type != NULL) {
-        khstring opt_return_type_str = khAstExpression_string(lambda->opt_return_type, origin);
-        khstring_concatenate(&string, &opt_return_type_str);
-        khstring_delete(&opt_return_type_str);
-    }
-    else {
-        khstring_concatenateCstring(&string, U"null");
+    deferText(tasks, U", \"opt_return_type\": ");
+    deferOptional(tasks, lambda->opt_return_type);
+
+    // Not parsed yet
+    if (lambda->lazy_block.source != NULL) {
+        deferText(tasks, U", \"block\": null}");
+        return;
     }
 
-    khstring_concatenateCstring(&string, U", \"block\": [");
-    for (size_t i = 0; i < kharray_size(&lambda->block); i++) {
-        khstring statement_str = khAstStatement_string(&lambda->block[i], origin);
-        khstring_concatenate(&string, &statement_str);
-        khstring_delete(&statement_str);
+    deferText(tasks, U", \"block\": [");
+    deferStatements(tasks, &lambda->block);
+    deferText(tasks, U"]}");
+}
+
+void khAstLambda_write(khAstLambda* lambda, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startLambda(&tasks, writer, lambda);
+    writeTasks(&tasks, writer);
+}
 
-        if (i != kharray_size(&lambda->block) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+khstring khAstLambda_string(khAstLambda* lambda) {
+    khWriter writer = khWriter_newString();
+    khAstLambda_write(lambda, &writer);
+    return writer.string;
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khAstLambda* khAstLambda_box(khAstLambda lambda, khArena* opt_arena) {
+    khAstLambda* boxed = (khAstLambda*)allocateOutOfLine(sizeof(khAstLambda), opt_arena);
+    *boxed = lambda;
+    return boxed;
 }
 
 
-khstring khAstUnaryExpressionType_string(khAstUnaryExpressionType type) {
+static const char32_t* unaryExpressionTypeName(khAstUnaryExpressionType type) {
     switch (type) {
         case khAstUnaryExpressionType_POSITIVE:
-            return khstring_new(U"positive");
+            return U"positive";
         case khAstUnaryExpressionType_NEGATIVE:
-            return khstring_new(U"negative");
+            return U"negative";
 
         case khAstUnaryExpressionType_NOT:
-            return khstring_new(U"not");
+            return U"not";
         case khAstUnaryExpressionType_BIT_NOT:
-            return khstring_new(U"bit_not");
+            return U"bit_not";
 
         default:
-            return khstring_new(U"unknown");
+            return U"unknown";
     }
 }
 
+khstring khAstUnaryExpressionType_string(khAstUnaryExpressionType type) {
+    return khstring_new(unaryExpressionTypeName(type));
+}
+
 
-khAstUnaryExpression khAstUnaryExpression_copy(khAstUnaryExpression* unary_exp) {
-    khAstExpression* operand = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *operand = khAstExpression_copy(unary_exp->operand);
+static khAstUnaryExpression copyUnaryExpression(khAstUnaryExpression* unary_exp, bool share) {
+    khAstExpression* operand = copyChild(unary_exp->operand, share);
 
     return (khAstUnaryExpression){.type = unary_exp->type, .operand = operand};
 }
 
+khAstUnaryExpression khAstUnaryExpression_copy(khAstUnaryExpression* unary_exp) {
+    return copyUnaryExpression(unary_exp, false);
+}
+
+khAstUnaryExpression khAstUnaryExpression_move(khAstUnaryExpression* unary_exp) {
+    khAstUnaryExpression moved = *unary_exp;
+    *unary_exp = (khAstUnaryExpression){0};
+    return moved;
+}
+
 void khAstUnaryExpression_delete(khAstUnaryExpression* unary_exp) {
-    khAstExpression_delete(unary_exp->operand);
-    free(unary_exp->operand);
+    deleteChild(unary_exp->operand);
 }
 
-khstring khAstUnaryExpression_string(khAstUnaryExpression* unary_exp, char32_t* origin) {
-    khstring string = khstring_new(U"{\"type\": ");
-    khstring type_str = khAstUnaryExpressionType_string(unary_exp->type);
-    khstring quoted_type = khstring_quote(&type_str);
-    khstring_concatenate(&string, &quoted_type);
-    khstring_delete(&type_str);
-    khstring_delete(&quoted_type);
+static void startUnaryExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                                 khAstUnaryExpression* unary_exp) {
+    khWriter_cstring(writer, U"{\"type\": ");
+    khWriter_char(writer, U'\"');
+    khWriter_cstring(writer, unaryExpressionTypeName(unary_exp->type));
+    khWriter_char(writer, U'\"');
+
+    khWriter_cstring(writer, U", \"operand\": ");
+    deferExpression(tasks, unary_exp->operand);
 
-    khstring_concatenateCstring(&string, U", \"operand\": ");
-    khstring operand_str = khAstExpression_string(unary_exp->operand, origin);
-    khstring_concatenate(&string, &operand_str);
-    khstring_delete(&operand_str);
+    deferText(tasks, U"}");
+}
+
+void khAstUnaryExpression_write(khAstUnaryExpression* unary_exp, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startUnaryExpression(&tasks, writer, unary_exp);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+khstring khAstUnaryExpression_string(khAstUnaryExpression* unary_exp) {
+    khWriter writer = khWriter_newString();
+    khAstUnaryExpression_write(unary_exp, &writer);
+    return writer.string;
 }
 
 
-khstring khAstBinaryExpressionType_string(khAstBinaryExpressionType type) {
+static const char32_t* binaryExpressionTypeName(khAstBinaryExpressionType type) {
     switch (type) {
         case khAstBinaryExpressionType_ASSIGN:
-            return khstring_new(U"assign");
+            return U"assign";
         case khAstBinaryExpressionType_RANGE:
-            return khstring_new(U"range");
+            return U"range";
 
         case khAstBinaryExpressionType_ADD:
-            return khstring_new(U"add");
+            return U"add";
         case khAstBinaryExpressionType_SUB:
-            return khstring_new(U"sub");
+            return U"sub";
         case khAstBinaryExpressionType_MUL:
-            return khstring_new(U"mul");
+            return U"mul";
         case khAstBinaryExpressionType_DIV:
-            return khstring_new(U"div");
+            return U"div";
         case khAstBinaryExpressionType_MOD:
-            return khstring_new(U"mod");
+            return U"mod";
         case khAstBinaryExpressionType_DOT:
-            return khstring_new(U"dot");
+            return U"dot";
         case khAstBinaryExpressionType_POW:
-            return khstring_new(U"pow");
+            return U"pow";
 
         case khAstBinaryExpressionType_IP_ADD:
-            return khstring_new(U"ip_add");
+            return U"ip_add";
         case khAstBinaryExpressionType_IP_SUB:
-            return khstring_new(U"ip_sub");
+            return U"ip_sub";
         case khAstBinaryExpressionType_IP_MUL:
-            return khstring_new(U"ip_mul");
+            return U"ip_mul";
         case khAstBinaryExpressionType_IP_DIV:
-            return khstring_new(U"ip_div");
+            return U"ip_div";
         case khAstBinaryExpressionType_IP_MOD:
-            return khstring_new(U"ip_mod");
+            return U"ip_mod";
         case khAstBinaryExpressionType_IP_DOT:
-            return khstring_new(U"ip_dot");
+            return U"ip_dot";
         case khAstBinaryExpressionType_IP_POW:
-            return khstring_new(U"ip_pow");
+            return U"ip_pow";
 
         case khAstBinaryExpressionType_AND:
-            return khstring_new(U"and");
+            return U"and";
         case khAstBinaryExpressionType_OR:
-            return khstring_new(U"or");
+            return U"or";
         case khAstBinaryExpressionType_XOR:
-            return khstring_new(U"xor");
+            return U"xor";
 
         case khAstBinaryExpressionType_BIT_AND:
-            return khstring_new(U"bit_and");
+            return U"bit_and";
         case khAstBinaryExpressionType_BIT_OR:
-            return khstring_new(U"bit_or");
+            return U"bit_or";
         case khAstBinaryExpressionType_BIT_XOR:
-            return khstring_new(U"bit_xor");
+            return U"bit_xor";
         case khAstBinaryExpressionType_BIT_LSHIFT:
-            return khstring_new(U"bit_lshift");
+            return U"bit_lshift";
         case khAstBinaryExpressionType_BIT_RSHIFT:
-            return khstring_new(U"bit_rshift");
+            return U"bit_rshift";
 
         case khAstBinaryExpressionType_IP_BIT_AND:
-            return khstring_new(U"ip_bit_and");
+            return U"ip_bit_and";
         case khAstBinaryExpressionType_IP_BIT_OR:
-            return khstring_new(U"ip_bit_or");
+            return U"ip_bit_or";
         case khAstBinaryExpressionType_IP_BIT_XOR:
-            return khstring_new(U"ip_bit_xor");
+            return U"ip_bit_xor";
         case khAstBinaryExpressionType_IP_BIT_LSHIFT:
-            return khstring_new(U"ip_bit_lshift");
+            return U"ip_bit_lshift";
         case khAstBinaryExpressionType_IP_BIT_RSHIFT:
-            return khstring_new(U"ip_bit_rshift");
+            return U"ip_bit_rshift";
 
         default:
-            return khstring_new(U"unknown");
+            return U"unknown";
     }
 }
 
+khstring khAstBinaryExpressionType_string(khAstBinaryExpressionType type) {
+    return khstring_new(binaryExpressionTypeName(type));
+}
 
-khAstBinaryExpression khAstBinaryExpression_copy(khAstBinaryExpression* binary_exp) {
-    khAstExpression* left = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *left = khAstExpression_copy(binary_exp->left);
 
-    khAstExpression* right = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *right = khAstExpression_copy(binary_exp->right);
+static khAstBinaryExpression copyBinaryExpression(khAstBinaryExpression* binary_exp, bool share) {
+    khAstExpression* left = copyChild(binary_exp->left, share);
+
+    khAstExpression* right = copyChild(binary_exp->right, share);
 
     return (khAstBinaryExpression){.type = binary_exp->type, .left = left, .right = right};
 }
 
+khAstBinaryExpression khAstBinaryExpression_copy(khAstBinaryExpression* binary_exp) {
+    return copyBinaryExpression(binary_exp, false);
+}
+
+khAstBinaryExpression khAstBinaryExpression_move(khAstBinaryExpression* binary_exp) {
+    khAstBinaryExpression moved = *binary_exp;
+    *binary_exp = (khAstBinaryExpression){0};
+    return moved;
+}
+
 void khAstBinaryExpression_delete(khAstBinaryExpression* binary_exp) {
-    khAstExpression_delete(binary_exp->left);
-    free(binary_exp->left);
-    khAstExpression_delete(binary_exp->right);
-    free(binary_exp->right);
+    deleteChild(binary_exp->left);
+    deleteChild(binary_exp->right);
 }
 
-khstring khAstBinaryExpression_string(khAstBinaryExpression* binary_exp, char32_t* origin) {
-    khstring string = khstring_new(U"{\"type\": ");
-    khstring type_str = khAstBinaryExpressionType_string(binary_exp->type);
-    khstring quoted_type = khstring_quote(&type_str);
-    khstring_concatenate(&string, &quoted_type);
-    khstring_delete(&type_str);
-    khstring_delete(&quoted_type);
+static void startBinaryExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                                  khAstBinaryExpression* binary_exp) {
+    khWriter_cstring(writer, U"{\"type\": ");
+    khWriter_char(writer, U'\"');
+    khWriter_cstring(writer, binaryExpressionTypeName(binary_exp->type));
+    khWriter_char(writer, U'\"');
 
-    khstring_concatenateCstring(&string, U", \"left\": ");
-    khstring left_str = khAstExpression_string(binary_exp->left, origin);
-    khstring_concatenate(&string, &left_str);
-    khstring_delete(&left_str);
+    khWriter_cstring(writer, U", \"left\": ");
+    deferExpression(tasks, binary_exp->left);
 
-    khstring_concatenateCstring(&string, U", \"right\": ");
-    khstring right_str = khAstExpression_string(binary_exp->right, origin);
-    khstring_concatenate(&string, &right_str);
-    khstring_delete(&right_str);
+    deferText(tasks, U", \"right\": ");
+    deferExpression(tasks, binary_exp->right);
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+    deferText(tasks, U"}");
 }
 
+void khAstBinaryExpression_write(khAstBinaryExpression* binary_exp, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startBinaryExpression(&tasks, writer, binary_exp);
+    writeTasks(&tasks, writer);
+}
 
-khAstTernaryExpression khAstTernaryExpression_copy(khAstTernaryExpression* ternary_exp) {
-    khAstExpression* condition = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *condition = khAstExpression_copy(ternary_exp->condition);
+khstring khAstBinaryExpression_string(khAstBinaryExpression* binary_exp) {
+    khWriter writer = khWriter_newString();
+    khAstBinaryExpression_write(binary_exp, &writer);
+    return writer.string;
+}
 
-    khAstExpression* value = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *value = khAstExpression_copy(ternary_exp->value);
 
-    khAstExpression* otherwise = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *otherwise = khAstExpression_copy(ternary_exp->otherwise);
+static khAstTernaryExpression copyTernaryExpression(khAstTernaryExpression* ternary_exp, bool share) {
+    khAstExpression* condition = copyChild(ternary_exp->condition, share);
+
+    khAstExpression* value = copyChild(ternary_exp->value, share);
+
+    khAstExpression* otherwise = copyChild(ternary_exp->otherwise, share);
 
     return (khAstTernaryExpression){.condition = condition, .value = value, .otherwise = otherwise};
 }
+
+khAstTernaryExpression khAstTernaryExpression_copy(khAstTernaryExpression* ternary_exp) {
+    return copyTernaryExpression(ternary_exp, false);
+}
+
+khAstTernaryExpression khAstTernaryExpression_move(khAstTernaryExpression* ternary_exp) {
+    khAstTernaryExpression moved = *ternary_exp;
+    *ternary_exp = (khAstTernaryExpression){0};
+    return moved;
+}
 void khAstTernaryExpression_delete(khAstTernaryExpression* ternary_exp) {
-    khAstExpression_delete(ternary_exp->condition);
-    free(ternary_exp->condition);
-    khAstExpression_delete(ternary_exp->value);
-    free(ternary_exp->value);
-    khAstExpression_delete(ternary_exp->otherwise);
-    free(ternary_exp->otherwise);
+    deleteChild(ternary_exp->condition);
+    deleteChild(ternary_exp->value);
+    deleteChild(ternary_exp->otherwise);
 }
 
-khstring khAstTernaryExpression_string(khAstTernaryExpression* ternary_exp, char32_t* origin) {
-    khstring string = khstring_new(U"{\"condition\": ");
-    khstring condition_str = khAstExpression_string(ternary_exp->condition, origin);
-    khstring_concatenate(&string, &condition_str);
-    khstring_delete(&condition_str);
+static void startTernaryExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                                   khAstTernaryExpression* ternary_exp) {
+    khWriter_cstring(writer, U"{\"condition\": ");
+    deferExpression(tasks, ternary_exp->condition);
 
-    khstring_concatenateCstring(&string, U", \"value\": ");
-    khstring value_str = khAstExpression_string(ternary_exp->value, origin);
-    khstring_concatenate(&string, &value_str);
-    khstring_delete(&value_str);
+    deferText(tasks, U", \"value\": ");
+    deferExpression(tasks, ternary_exp->value);
 
-    khstring_concatenateCstring(&string, U", \"otherwise\": ");
-    khstring otherwise_str = khAstExpression_string(ternary_exp->otherwise, origin);
-    khstring_concatenate(&string, &otherwise_str);
-    khstring_delete(&otherwise_str);
+    deferText(tasks, U", \"otherwise\": ");
+    deferExpression(tasks, ternary_exp->otherwise);
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+    deferText(tasks, U"}");
 }
 
+void khAstTernaryExpression_write(khAstTernaryExpression* ternary_exp, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startTernaryExpression(&tasks, writer, ternary_exp);
+    writeTasks(&tasks, writer);
+}
 
-khstring khAstComparisonExpressionType_string(khAstComparisonExpressionType type) {
+khstring khAstTernaryExpression_string(khAstTernaryExpression* ternary_exp) {
+    khWriter writer = khWriter_newString();
+    khAstTernaryExpression_write(ternary_exp, &writer);
+    return writer.string;
+}
+
+
+static const char32_t* comparisonExpressionTypeName(khAstComparisonExpressionType type) {
     switch (type) {
         case khAstComparisonExpressionType_EQUAL:
-            return khstring_new(U"equal");
+            return U"equal";
         case khAstComparisonExpressionType_UNEQUAL:
-            return khstring_new(U"unequal");
+            return U"unequal";
         case khAstComparisonExpressionType_LESS:
-            return khstring_new(U"less");
+            return U"less";
         case khAstComparisonExpressionType_GREATER:
-            return khstring_new(U"greater");
+            return U"greater";
         case khAstComparisonExpressionType_LESS_EQUAL:
-            return khstring_new(U"less_equal");
+            return U"less_equal";
         case khAstComparisonExpressionType_GREATER_EQUAL:
-            return khstring_new(U"greater_equal");
+            return U"greater_equal";
 
         default:
-            return khstring_new(U"unknown");
+            return U"unknown";
     }
 }
 
+khstring khAstComparisonExpressionType_string(khAstComparisonExpressionType type) {
+    return khstring_new(comparisonExpressionTypeName(type));
+}
 
-khAstComparisonExpression khAstComparisonExpression_copy(khAstComparisonExpression* comparison_exp) {
+
+static khAstComparisonExpression copyComparisonExpression(khAstComparisonExpression* comparison_exp,
+                                                          bool share) {
     return (khAstComparisonExpression){
-        .operations = kharray_copy(&comparison_exp->operations, NULL),
-        .operands = kharray_copy(&comparison_exp->operands, khAstExpression_copy)};
+        .operations = copyOrShare(&comparison_exp->operations, NULL, share),
+        .operands = copyOrShare(&comparison_exp->operands, khAstExpression_copy, share)};
+}
+
+khAstComparisonExpression khAstComparisonExpression_copy(khAstComparisonExpression* comparison_exp) {
+    return copyComparisonExpression(comparison_exp, false);
+}
+
+khAstComparisonExpression khAstComparisonExpression_move(khAstComparisonExpression* comparison_exp) {
+    khAstComparisonExpression moved = *comparison_exp;
+    *comparison_exp = (khAstComparisonExpression){0};
+    return moved;
 }
 
 void khAstComparisonExpression_delete(khAstComparisonExpression* comparison_exp) {
@@ -671,243 +1129,322 @@ void khAstComparisonExpression_delete(khAstComparisonExpression* comparison_exp)
     kharray_delete(&comparison_exp->operands);
 }
 
-khstring khAstComparisonExpression_string(khAstComparisonExpression* comparison_exp, char32_t* origin) {
-    khstring string = khstring_new(U"{\"operations\": [");
+static void startComparisonExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                                      khAstComparisonExpression* comparison_exp) {
+    khWriter_cstring(writer, U"{\"operations\": [");
     for (size_t i = 0; i < kharray_size(&comparison_exp->operations); i++) {
-        khstring operation_str = khAstComparisonExpressionType_string(comparison_exp->operations[i]);
-        khstring quoted_operation = khstring_quote(&operation_str);
-        khstring_concatenate(&string, &quoted_operation);
-        khstring_delete(&operation_str);
-        khstring_delete(&quoted_operation);
+        khWriter_char(writer, U'\"');
+        khWriter_cstring(writer, comparisonExpressionTypeName(comparison_exp->operations[i]));
+        khWriter_char(writer, U'\"');
 
         if (i != kharray_size(&comparison_exp->operations) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"operands\": [");
-    for (size_t i = 0; i < kharray_size(&comparison_exp->operands); i++) {
-        khstring operand_str = khAstExpression_string(&comparison_exp->operands[i], origin);
-        khstring_concatenate(&string, &operand_str);
-        khstring_delete(&operand_str);
+    khWriter_cstring(writer, U"], \"operands\": [");
+    deferExpressions(tasks, &comparison_exp->operands);
 
-        if (i != kharray_size(&comparison_exp->operands) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+    deferText(tasks, U"]}");
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+void khAstComparisonExpression_write(khAstComparisonExpression* comparison_exp, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startComparisonExpression(&tasks, writer, comparison_exp);
+    writeTasks(&tasks, writer);
 }
 
+khstring khAstComparisonExpression_string(khAstComparisonExpression* comparison_exp) {
+    khWriter writer = khWriter_newString();
+    khAstComparisonExpression_write(comparison_exp, &writer);
+    return writer.string;
+}
+
+
+static khAstCallExpression copyCallExpression(khAstCallExpression* call_exp, bool share) {
+    khAstExpression* callee = copyChild(call_exp->callee, share);
+
+    return (khAstCallExpression){
+        .callee = callee, .arguments = copyOrShare(&call_exp->arguments, khAstExpression_copy, share)};
+}
 
 khAstCallExpression khAstCallExpression_copy(khAstCallExpression* call_exp) {
-    khAstExpression* callee = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *callee = khAstExpression_copy(call_exp->callee);
+    return copyCallExpression(call_exp, false);
+}
 
-    return (khAstCallExpression){.callee = callee,
-                                 .arguments = kharray_copy(&call_exp->arguments, khAstExpression_copy)};
+khAstCallExpression khAstCallExpression_move(khAstCallExpression* call_exp) {
+    khAstCallExpression moved = *call_exp;
+    *call_exp = (khAstCallExpression){0};
+    return moved;
 }
 
 void khAstCallExpression_delete(khAstCallExpression* call_exp) {
-    khAstExpression_delete(call_exp->callee);
-    free(call_exp->callee);
+    deleteChild(call_exp->callee);
     kharray_delete(&call_exp->arguments);
 }
 
-khstring khAstCallExpression_string(khAstCallExpression* call_exp, char32_t* origin) {
-    khstring string = khstring_new(U"{\"callee\": ");
-    khstring callee_str = khAstExpression_string(call_exp->callee, origin);
-    khstring_concatenate(&string, &callee_str);
-    khstring_delete(&callee_str);
+static void startCallExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                                khAstCallExpression* call_exp) {
+    khWriter_cstring(writer, U"{\"callee\": ");
+    deferExpression(tasks, call_exp->callee);
 
-    khstring_concatenateCstring(&string, U", \"arguments\": [");
-    for (size_t i = 0; i < kharray_size(&call_exp->arguments); i++) {
-        khstring argument_str = khAstExpression_string(&call_exp->arguments[i], origin);
-        khstring_concatenate(&string, &argument_str);
-        khstring_delete(&argument_str);
+    deferText(tasks, U", \"arguments\": [");
+    deferExpressions(tasks, &call_exp->arguments);
 
-        if (i != kharray_size(&call_exp->arguments) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+    deferText(tasks, U"]}");
+}
+
+void khAstCallExpression_write(khAstCallExpression* call_exp, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startCallExpression(&tasks, writer, call_exp);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstCallExpression_string(khAstCallExpression* call_exp) {
+    khWriter writer = khWriter_newString();
+    khAstCallExpression_write(call_exp, &writer);
+    return writer.string;
 }
 
 
-khAstIndexExpression khAstIndexExpression_copy(khAstIndexExpression* index_exp) {
-    khAstExpression* indexee = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *indexee = khAstExpression_copy(index_exp->indexee);
+static khAstIndexExpression copyIndexExpression(khAstIndexExpression* index_exp, bool share) {
+    khAstExpression* indexee = copyChild(index_exp->indexee, share);
 
     return (khAstIndexExpression){
-        .indexee = indexee, .arguments = kharray_copy(&index_exp->arguments, khAstExpression_copy)};
+        .indexee = indexee,
+        .arguments = copyOrShare(&index_exp->arguments, khAstExpression_copy, share)};
+}
+
+khAstIndexExpression khAstIndexExpression_copy(khAstIndexExpression* index_exp) {
+    return copyIndexExpression(index_exp, false);
+}
+
+khAstIndexExpression khAstIndexExpression_move(khAstIndexExpression* index_exp) {
+    khAstIndexExpression moved = *index_exp;
+    *index_exp = (khAstIndexExpression){0};
+    return moved;
 }
 
 void khAstIndexExpression_delete(khAstIndexExpression* index_exp) {
-    khAstExpression_delete(index_exp->indexee);
-    free(index_exp->indexee);
+    deleteChild(index_exp->indexee);
     kharray_delete(&index_exp->arguments);
 }
 
-khstring khAstIndexExpression_string(khAstIndexExpression* index_exp, char32_t* origin) {
-    khstring string = khstring_new(U"{\"indexee\": ");
-    khstring indexee_str = khAstExpression_string(index_exp->indexee, origin);
-    khstring_concatenate(&string, &indexee_str);
-    khstring_delete(&indexee_str);
+static void startIndexExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                                 khAstIndexExpression* index_exp) {
+    khWriter_cstring(writer, U"{\"indexee\": ");
+    deferExpression(tasks, index_exp->indexee);
 
-    khstring_concatenateCstring(&string, U", \"arguments\": [");
-    for (size_t i = 0; i < kharray_size(&index_exp->arguments); i++) {
-        khstring argument_str = khAstExpression_string(&index_exp->arguments[i], origin);
-        khstring_concatenate(&string, &argument_str);
-        khstring_delete(&argument_str);
+    deferText(tasks, U", \"arguments\": [");
+    deferExpressions(tasks, &index_exp->arguments);
 
-        if (i != kharray_size(&index_exp->arguments) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+    deferText(tasks, U"]}");
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+void khAstIndexExpression_write(khAstIndexExpression* index_exp, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startIndexExpression(&tasks, writer, index_exp);
+    writeTasks(&tasks, writer);
 }
 
+khstring khAstIndexExpression_string(khAstIndexExpression* index_exp) {
+    khWriter writer = khWriter_newString();
+    khAstIndexExpression_write(index_exp, &writer);
+    return writer.string;
+}
 
-khAstScopeExpression khAstScopeExpression_copy(khAstScopeExpression* scope_exp) {
-    khAstExpression* value = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *value = khAstExpression_copy(scope_exp->value);
 
-    kharray(khstring) scope_names = kharray_new(khstring, khstring_delete);
-    for (size_t i = 0; i < kharray_size(&scope_exp->scope_names); i++) {
-        kharray_append(&scope_names, khstring_copy(&scope_exp->scope_names[i]));
-    }
+static khAstScopeExpression copyScopeExpression(khAstScopeExpression* scope_exp, bool share) {
+    khAstExpression* value = copyChild(scope_exp->value, share);
+
+    kharray(khstring) scope_names = copyOrShare(&scope_exp->scope_names, khstring_copy, share);
 
     return (khAstScopeExpression){.value = value, .scope_names = scope_names};
 }
 
+khAstScopeExpression khAstScopeExpression_copy(khAstScopeExpression* scope_exp) {
+    return copyScopeExpression(scope_exp, false);
+}
+
+khAstScopeExpression khAstScopeExpression_move(khAstScopeExpression* scope_exp) {
+    khAstScopeExpression moved = *scope_exp;
+    *scope_exp = (khAstScopeExpression){0};
+    return moved;
+}
+
 void khAstScopeExpression_delete(khAstScopeExpression* scope_exp) {
-    khAstExpression_delete(scope_exp->value);
-    free(scope_exp->value);
+    deleteChild(scope_exp->value);
     kharray_delete(&scope_exp->scope_names);
 }
 
-khstring khAstScopeExpression_string(khAstScopeExpression* scope_exp, char32_t* origin) {
-    khstring string = khstring_new(U"{\"value\": ");
-    khstring value_str = khAstExpression_string(scope_exp->value, origin);
-    khstring_concatenate(&string, &value_str);
-    khstring_delete(&value_str);
+static void startScopeExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                                 khAstScopeExpression* scope_exp) {
+    khWriter_cstring(writer, U"{\"value\": ");
+    deferExpression(tasks, scope_exp->value);
 
-    khstring_concatenateCstring(&string, U", \"scope_names\": [");
+    deferText(tasks, U", \"scope_names\": [");
     for (size_t i = 0; i < kharray_size(&scope_exp->scope_names); i++) {
-        khstring quoted_scope_name = khstring_quote(&scope_exp->scope_names[i]);
-        khstring_concatenate(&string, &quoted_scope_name);
-        khstring_delete(&quoted_scope_name);
+        deferQuote(tasks, &scope_exp->scope_names[i]);
 
         if (i != kharray_size(&scope_exp->scope_names) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            deferText(tasks, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+    deferText(tasks, U"]}");
 }
 
+void khAstScopeExpression_write(khAstScopeExpression* scope_exp, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startScopeExpression(&tasks, writer, scope_exp);
+    writeTasks(&tasks, writer);
+}
+
+khstring khAstScopeExpression_string(khAstScopeExpression* scope_exp) {
+    khWriter writer = khWriter_newString();
+    khAstScopeExpression_write(scope_exp, &writer);
+    return writer.string;
+}
 
-khAstTemplatizeExpression khAstTemplatizeExpression_copy(khAstTemplatizeExpression* templatize_exp) {
-    khAstExpression* value = (khAstExpression*)malloc(sizeof(khAstExpression));
-    *value = khAstExpression_copy(templatize_exp->value);
+
+static khAstTemplatizeExpression copyTemplatizeExpression(khAstTemplatizeExpression* templatize_exp,
+                                                          bool share) {
+    khAstExpression* value = copyChild(templatize_exp->value, share);
 
     return (khAstTemplatizeExpression){
         .value = value,
-        .template_arguments = kharray_copy(&templatize_exp->template_arguments, khAstExpression_copy)};
+        .template_arguments =
+            copyOrShare(&templatize_exp->template_arguments, khAstExpression_copy, share)};
+}
+
+khAstTemplatizeExpression khAstTemplatizeExpression_copy(khAstTemplatizeExpression* templatize_exp) {
+    return copyTemplatizeExpression(templatize_exp, false);
+}
+
+khAstTemplatizeExpression khAstTemplatizeExpression_move(khAstTemplatizeExpression* templatize_exp) {
+    khAstTemplatizeExpression moved = *templatize_exp;
+    *templatize_exp = (khAstTemplatizeExpression){0};
+    return moved;
 }
 
 void khAstTemplatizeExpression_delete(khAstTemplatizeExpression* templatize_exp) {
-    khAstExpression_delete(templatize_exp->value);
-    free(templatize_exp->value);
+    deleteChild(templatize_exp->value);
     kharray_delete(&templatize_exp->template_arguments);
 }
 
-khstring khAstTemplatizeExpression_string(khAstTemplatizeExpression* templatize_exp, char32_t* origin) {
-    khstring string = khstring_new(U"{\"value\": ");
-    khstring value_str = khAstExpression_string(templatize_exp->value, origin);
-    khstring_concatenate(&string, &value_str);
-    khstring_delete(&value_str);
+static void startTemplatizeExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                                      khAstTemplatizeExpression* templatize_exp) {
+    khWriter_cstring(writer, U"{\"value\": ");
+    deferExpression(tasks, templatize_exp->value);
 
-    khstring_concatenateCstring(&string, U", \"template_arguments\": [");
-    for (size_t i = 0; i < kharray_size(&templatize_exp->template_arguments); i++) {
-        khstring template_argument_str =
-            khAstExpression_string(&templatize_exp->template_arguments[i], origin);
-        khstring_concatenate(&string, &template_argument_str);
-        khstring_delete(&template_argument_str);
+    deferText(tasks, U", \"template_arguments\": [");
+    deferExpressions(tasks, &templatize_exp->template_arguments);
 
-        if (i != kharray_size(&templatize_exp->template_arguments) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+    deferText(tasks, U"]}");
+}
+
+void khAstTemplatizeExpression_write(khAstTemplatizeExpression* templatize_exp, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startTemplatizeExpression(&tasks, writer, templatize_exp);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstTemplatizeExpression_string(khAstTemplatizeExpression* templatize_exp) {
+    khWriter writer = khWriter_newString();
+    khAstTemplatizeExpression_write(templatize_exp, &writer);
+    return writer.string;
 }
 
 
-khAstExpression khAstExpression_copy(khAstExpression* expression) {
+// Whether a STRING or a BUFFER expression still has its payload in the source
+static inline bool isRaw(khAstExpression* expression) {
+    return expression->raw.source != NULL;
+}
+
+static inline char32_t* rawBegin(khAstExpression* expression) {
+    return expression->raw.source->string + expression->raw.begin;
+}
+
+static inline char32_t* rawEnd(khAstExpression* expression) {
+    return expression->raw.source->string + expression->raw.end;
+}
+
+static inline void copyRaw(khAstExpression* copy, khAstExpression* expression, bool share) {
+    copy->opt_raw_arena = NULL;
+    copy->raw.source = copySource(expression->raw.source, share);
+}
+
+static khAstExpression copyExpression(khAstExpression* expression, bool share) {
     khAstExpression copy = *expression;
 
     switch (expression->type) {
         case khAstExpressionType_IDENTIFIER:
-            copy.identifier = khstring_copy(&expression->identifier);
+            copy.identifier = copyOrShare(&expression->identifier, NULL, share);
             break;
+        // Copies live on the heap, and decode their own payload if it's still raw
         case khAstExpressionType_STRING:
-            copy.string = khstring_copy(&expression->string);
+            if (isRaw(expression)) {
+                copyRaw(&copy, expression, share);
+            }
+            else {
+                copy.string = copyOrShare(&expression->string, NULL, share);
+            }
             break;
         case khAstExpressionType_BUFFER:
-            copy.buffer = khbuffer_copy(&expression->buffer);
+            if (isRaw(expression)) {
+                copyRaw(&copy, expression, share);
+            }
+            else {
+                copy.buffer = copyOrShare(&expression->buffer, NULL, share);
+            }
             break;
 
         case khAstExpressionType_TUPLE:
-            copy.tuple = khAstTuple_copy(&expression->tuple);
+            copy.tuple = copyTuple(&expression->tuple, share);
             break;
         case khAstExpressionType_ARRAY:
-            copy.array = khAstArray_copy(&expression->array);
+            copy.array = copyArray(&expression->array, share);
             break;
         case khAstExpressionType_DICT:
-            copy.dict = khAstDict_copy(&expression->dict);
+            copy.dict = copyDict(&expression->dict, share);
             break;
         case khAstExpressionType_ELLIPSIS:
             break;
 
+        // Shared nodes hold their payload where the original does, as they're let go of the same way
         case khAstExpressionType_SIGNATURE:
-            copy.signature = khAstSignature_copy(&expression->signature);
+            copy.signature = khAstSignature_box(copySignature(expression->signature, share),
+                                                share ? outOfLineArena(expression->signature) : NULL);
             break;
         case khAstExpressionType_LAMBDA:
-            copy.lambda = khAstLambda_copy(&expression->lambda);
+            copy.lambda = khAstLambda_box(copyLambda(expression->lambda, share),
+                                          share ? outOfLineArena(expression->lambda) : NULL);
             break;
 
         case khAstExpressionType_UNARY:
-            copy.unary = khAstUnaryExpression_copy(&expression->unary);
+            copy.unary = copyUnaryExpression(&expression->unary, share);
             break;
         case khAstExpressionType_BINARY:
-            copy.binary = khAstBinaryExpression_copy(&expression->binary);
+            copy.binary = copyBinaryExpression(&expression->binary, share);
             break;
         case khAstExpressionType_TERNARY:
-            copy.ternary = khAstTernaryExpression_copy(&expression->ternary);
+            copy.ternary = copyTernaryExpression(&expression->ternary, share);
             break;
         case khAstExpressionType_COMPARISON:
-            copy.comparison = khAstComparisonExpression_copy(&expression->comparison);
+            copy.comparison = copyComparisonExpression(&expression->comparison, share);
             break;
         case khAstExpressionType_CALL:
-            copy.call = khAstCallExpression_copy(&expression->call);
+            copy.call = copyCallExpression(&expression->call, share);
             break;
         case khAstExpressionType_INDEX:
-            copy.index = khAstIndexExpression_copy(&expression->index);
+            copy.index = copyIndexExpression(&expression->index, share);
             break;
 
         case khAstExpressionType_SCOPE:
-            copy.scope = khAstScopeExpression_copy(&expression->scope);
+            copy.scope = copyScopeExpression(&expression->scope, share);
             break;
         case khAstExpressionType_TEMPLATIZE:
-            copy.templatize = khAstTemplatizeExpression_copy(&expression->templatize);
+            copy.templatize = copyTemplatizeExpression(&expression->templatize, share);
             break;
 
         default:
@@ -917,16 +1454,40 @@ khAstExpression khAstExpression_copy(khAstExpression* expression) {
     return copy;
 }
 
+khAstExpression khAstExpression_copy(khAstExpression* expression) {
+    return copyExpression(expression, false);
+}
+
+khAstExpression khAstExpression_share(khAstExpression* expression) {
+    return copyExpression(expression, true);
+}
+
+khAstExpression khAstExpression_move(khAstExpression* expression) {
+    khAstExpression moved = *expression;
+    *expression = (khAstExpression){0};
+    return moved;
+}
+
 void khAstExpression_delete(khAstExpression* expression) {
     switch (expression->type) {
         case khAstExpressionType_IDENTIFIER:
             khstring_delete(&expression->identifier);
             break;
         case khAstExpressionType_STRING:
-            khstring_delete(&expression->string);
+            if (isRaw(expression)) {
+                khAstSource_release(expression->raw.source);
+            }
+            else {
+                khstring_delete(&expression->string);
+            }
             break;
         case khAstExpressionType_BUFFER:
-            khbuffer_delete(&expression->buffer);
+            if (isRaw(expression)) {
+                khAstSource_release(expression->raw.source);
+            }
+            else {
+                khbuffer_delete(&expression->buffer);
+            }
             break;
 
         case khAstExpressionType_TUPLE:
@@ -942,10 +1503,12 @@ void khAstExpression_delete(khAstExpression* expression) {
             break;
 
         case khAstExpressionType_SIGNATURE:
-            khAstSignature_delete(&expression->signature);
+            khAstSignature_delete(expression->signature);
+            freeOutOfLine(expression->signature);
             break;
         case khAstExpressionType_LAMBDA:
-            khAstLambda_delete(&expression->lambda);
+            khAstLambda_delete(expression->lambda);
+            freeOutOfLine(expression->lambda);
             break;
 
         case khAstExpressionType_UNARY:
@@ -978,468 +1541,503 @@ void khAstExpression_delete(khAstExpression* expression) {
     }
 }
 
-khstring khAstExpression_string(khAstExpression* expression, char32_t* origin) {
-    khstring string = khstring_new(U"{\"type\": ");
-    khstring type_str = khAstExpressionType_string(expression->type);
-    khstring quoted_type = khstring_quote(&type_str);
-    khstring_concatenate(&string, &quoted_type);
-    khstring_delete(&type_str);
-    khstring_delete(&quoted_type);
+// The reference count goes in front of the boxed expression
+typedef struct {
+    uint32_t references;
+    khArena* opt_arena;
+    khAstExpression expression;
+} khAstBox;
+
+static inline khAstBox* boxOf(khAstExpression* boxed) {
+    return (khAstBox*)((char*)boxed - offsetof(khAstBox, expression));
+}
+
+khAstExpression* khAstExpression_box(khAstExpression expression, khArena* opt_arena) {
+    khAstBox* box = opt_arena != NULL ? (khAstBox*)khArena_allocate(opt_arena, sizeof(khAstBox))
+                                      : (khAstBox*)malloc(sizeof(khAstBox));
+    *box = (khAstBox){.references = 1, .opt_arena = opt_arena, .expression = expression};
+    return &box->expression;
+}
+
+khAstExpression khAstExpression_unbox(khAstExpression* boxed) {
+    khAstBox* box = boxOf(boxed);
+    khAstExpression expression = box->expression;
+
+    if (box->opt_arena == NULL) {
+        free(box);
+    }
+    return expression;
+}
+
+khAstExpression* khAstExpression_retain(khAstExpression* boxed) {
+    __atomic_add_fetch(&boxOf(boxed)->references, 1, __ATOMIC_RELAXED);
+    return boxed;
+}
+
+void khAstExpression_release(khAstExpression* boxed) {
+    khAstBox* box = boxOf(boxed);
+
+    // Same as arrays, a box on an arena is freed along with it
+    if (__atomic_sub_fetch(&box->references, 1, __ATOMIC_ACQ_REL) > 0 || box->opt_arena != NULL) {
+        return;
+    }
+
+    khAstExpression_delete(&box->expression);
+    free(box);
+}
+
+khAstExpression* khAstExpression_own(khAstExpression** boxed) {
+    khAstBox* box = boxOf(*boxed);
+
+    if (__atomic_load_n(&box->references, __ATOMIC_ACQUIRE) > 1) {
+        khAstExpression* owned = khAstExpression_box(khAstExpression_share(*boxed), box->opt_arena);
+        khAstExpression_release(*boxed);
+        *boxed = owned;
+    }
+
+    return *boxed;
+}
+
+static void startExpression(kharray(khWriteTask) * tasks, khWriter* writer,
+                            khAstExpression* expression) {
+    khWriter_cstring(writer, U"{\"type\": ");
+    khWriter_char(writer, U'\"');
+    khWriter_cstring(writer, expressionTypeName(expression->type));
+    khWriter_char(writer, U'\"');
 
-    khstring_concatenateCstring(&string, U", \"begin\": ");
-    if (expression->begin != NULL) {
-        khstring begin_str = kh_uintToString(expression->begin - origin, 10);
-        khstring_concatenate(&string, &begin_str);
-        khstring_delete(&begin_str);
+    khWriter_cstring(writer, U", \"begin\": ");
+    if (expression->begin != khAst_NO_SPAN) {
+        khWriter_uint(writer, expression->begin, 10);
     }
     else {
-        khstring_concatenateCstring(&string, U"null");
+        khWriter_cstring(writer, U"null");
     }
 
-    khstring_concatenateCstring(&string, U", \"end\": ");
-    if (expression->end != NULL) {
-        khstring end_str = kh_uintToString(expression->end - origin, 10);
-        khstring_concatenate(&string, &end_str);
-        khstring_delete(&end_str);
+    khWriter_cstring(writer, U", \"end\": ");
+    if (expression->end != khAst_NO_SPAN) {
+        khWriter_uint(writer, expression->end, 10);
     }
     else {
-        khstring_concatenateCstring(&string, U"null");
+        khWriter_cstring(writer, U"null");
     }
 
-    khstring_concatenateCstring(&string, U", \"value\": ");
+    khWriter_cstring(writer, U", \"value\": ");
     switch (expression->type) {
         case khAstExpressionType_IDENTIFIER: {
-            khstring quoted_identifier = khstring_quote(&expression->identifier);
-            khstring_concatenate(&string, &quoted_identifier);
-            khstring_delete(&quoted_identifier);
+            khWriter_quote(writer, &expression->identifier);
         } break;
         case khAstExpressionType_CHAR: {
-            khstring_append(&string, U'\"');
-            khstring escaped_char = kh_escapeChar(expression->char_v);
-            khstring_concatenate(&string, &escaped_char);
-            khstring_delete(&escaped_char);
-            khstring_append(&string, U'\"');
+            khWriter_char(writer, U'\"');
+            khWriter_escapeChar(writer, expression->char_v);
+            khWriter_char(writer, U'\"');
         } break;
+        // Raw payloads are quoted straight from the source, their bytes being no more than 0xFF
         case khAstExpressionType_STRING: {
-            khstring quoted_string = khstring_quote(&expression->string);
-            khstring_concatenate(&string, &quoted_string);
-            khstring_delete(&quoted_string);
+            if (isRaw(expression)) {
+                khWriter_quoteSpan(writer, rawBegin(expression), rawEnd(expression));
+            }
+            else {
+                khWriter_quote(writer, &expression->string);
+            }
         } break;
         case khAstExpressionType_BUFFER: {
-            khstring quoted_buffer = khbuffer_quote(&expression->buffer);
-            khstring_concatenate(&string, &quoted_buffer);
-            khstring_delete(&quoted_buffer);
+            if (isRaw(expression)) {
+                khWriter_quoteSpan(writer, rawBegin(expression), rawEnd(expression));
+            }
+            else {
+                khWriter_quoteBuffer(writer, &expression->buffer);
+            }
         } break;
         case khAstExpressionType_BYTE: {
-            khstring_append(&string, U'\"');
-            khstring escaped_byte = kh_escapeChar(expression->byte);
-            khstring_concatenate(&string, &escaped_byte);
-            khstring_delete(&escaped_byte);
-            khstring_append(&string, U'\"');
+            khWriter_char(writer, U'\"');
+            khWriter_escapeChar(writer, expression->byte);
+            khWriter_char(writer, U'\"');
         } break;
         case khAstExpressionType_INTEGER: {
-            khstring integer_str = kh_intToString(expression->integer, 10);
-            khstring_concatenate(&string, &integer_str);
-            khstring_delete(&integer_str);
+            khWriter_int(writer, expression->integer, 10);
         } break;
         case khAstExpressionType_UINTEGER: {
-            khstring uinteger_str = kh_uintToString(expression->uinteger, 10);
-            khstring_concatenate(&string, &uinteger_str);
-            khstring_delete(&uinteger_str);
+            khWriter_uint(writer, expression->uinteger, 10);
         } break;
         case khAstExpressionType_FLOAT: {
-            khstring float_str = kh_floatToString(expression->float_v, 8, 10);
-            khstring_concatenate(&string, &float_str);
-            khstring_delete(&float_str);
+            khWriter_float(writer, expression->float_v, 8, 10);
         } break;
         case khAstExpressionType_DOUBLE: {
-            khstring double_str = kh_floatToString(expression->double_v, 16, 10);
-            khstring_concatenate(&string, &double_str);
-            khstring_delete(&double_str);
+            khWriter_float(writer, expression->double_v, 16, 10);
         } break;
         case khAstExpressionType_IFLOAT: {
-            khstring ifloat_str = kh_floatToString(expression->ifloat, 8, 10);
-            khstring_concatenate(&string, &ifloat_str);
-            khstring_delete(&ifloat_str);
+            khWriter_float(writer, expression->ifloat, 8, 10);
         } break;
         case khAstExpressionType_IDOUBLE: {
-            khstring idouble_str = kh_floatToString(expression->idouble, 16, 10);
-            khstring_concatenate(&string, &idouble_str);
-            khstring_delete(&idouble_str);
+            khWriter_float(writer, expression->idouble, 16, 10);
         } break;
 
         case khAstExpressionType_TUPLE: {
-            khstring tuple_str = khAstTuple_string(&expression->tuple, origin);
-            khstring_concatenate(&string, &tuple_str);
-            khstring_delete(&tuple_str);
+            startTuple(tasks, writer, &expression->tuple);
         } break;
         case khAstExpressionType_ARRAY: {
-            khstring array_str = khAstArray_string(&expression->array, origin);
-            khstring_concatenate(&string, &array_str);
-            khstring_delete(&array_str);
+            startArray(tasks, writer, &expression->array);
         } break;
         case khAstExpressionType_DICT: {
-            khstring dict_str = khAstDict_string(&expression->dict, origin);
-            khstring_concatenate(&string, &dict_str);
-            khstring_delete(&dict_str);
+            startDict(tasks, writer, &expression->dict);
         } break;
         case khAstExpressionType_ELLIPSIS: {
-            khstring_concatenateCstring(&string, U"null");
+            khWriter_cstring(writer, U"null");
         } break;
 
         case khAstExpressionType_SIGNATURE: {
-            khstring signature_str = khAstSignature_string(&expression->signature, origin);
-            khstring_concatenate(&string, &signature_str);
-            khstring_delete(&signature_str);
+            startSignature(tasks, writer, expression->signature);
         } break;
         case khAstExpressionType_LAMBDA: {
-            khstring lambda_str = khAstLambda_string(&expression->lambda, origin);
-            khstring_concatenate(&string, &lambda_str);
-            khstring_delete(&lambda_str);
+            startLambda(tasks, writer, expression->lambda);
         } break;
 
         case khAstExpressionType_UNARY: {
-            khstring unary_str = khAstUnaryExpression_string(&expression->unary, origin);
-            khstring_concatenate(&string, &unary_str);
-            khstring_delete(&unary_str);
+            startUnaryExpression(tasks, writer, &expression->unary);
         } break;
         case khAstExpressionType_BINARY: {
-            khstring binary_str = khAstBinaryExpression_string(&expression->binary, origin);
-            khstring_concatenate(&string, &binary_str);
-            khstring_delete(&binary_str);
+            startBinaryExpression(tasks, writer, &expression->binary);
         } break;
         case khAstExpressionType_TERNARY: {
-            khstring ternary_str = khAstTernaryExpression_string(&expression->ternary, origin);
-            khstring_concatenate(&string, &ternary_str);
-            khstring_delete(&ternary_str);
+            startTernaryExpression(tasks, writer, &expression->ternary);
         } break;
         case khAstExpressionType_COMPARISON: {
-            khstring comparison_str = khAstComparisonExpression_string(&expression->comparison, origin);
-            khstring_concatenate(&string, &comparison_str);
-            khstring_delete(&comparison_str);
+            startComparisonExpression(tasks, writer, &expression->comparison);
         } break;
         case khAstExpressionType_CALL: {
-            khstring call_str = khAstCallExpression_string(&expression->call, origin);
-            khstring_concatenate(&string, &call_str);
-            khstring_delete(&call_str);
+            startCallExpression(tasks, writer, &expression->call);
         } break;
         case khAstExpressionType_INDEX: {
-            khstring index_str = khAstIndexExpression_string(&expression->index, origin);
-            khstring_concatenate(&string, &index_str);
-            khstring_delete(&index_str);
+            startIndexExpression(tasks, writer, &expression->index);
         } break;
 
         case khAstExpressionType_SCOPE: {
-            khstring scope_str = khAstScopeExpression_string(&expression->scope, origin);
-            khstring_concatenate(&string, &scope_str);
-            khstring_delete(&scope_str);
+            startScopeExpression(tasks, writer, &expression->scope);
         } break;
         case khAstExpressionType_TEMPLATIZE: {
-            khstring templatize_str = khAstTemplatizeExpression_string(&expression->templatize, origin);
-            khstring_concatenate(&string, &templatize_str);
-            khstring_delete(&templatize_str);
+            startTemplatizeExpression(tasks, writer, &expression->templatize);
         } break;
 
         default:
-            khstring_concatenateCstring(&string, U"null");
+            khWriter_cstring(writer, U"null");
             break;
     }
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+    deferText(tasks, U"}");
 }
 
+void khAstExpression_write(khAstExpression* expression, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startExpression(&tasks, writer, expression);
+    writeTasks(&tasks, writer);
+}
+
+khstring khAstExpression_string(khAstExpression* expression) {
+    khWriter writer = khWriter_newString();
+    khAstExpression_write(expression, &writer);
+    return writer.string;
+}
 
-khAstImport khAstImport_copy(khAstImport* import_v) {
-    kharray(khstring) path = kharray_new(khstring, khstring_delete);
-    for (size_t i = 0; i < kharray_size(&import_v->path); i++) {
-        kharray_append(&path, khstring_copy(&import_v->path[i]));
-    }
+
+static khAstImport copyImport(khAstImport* import_v, bool share) {
+    kharray(khstring) path = copyOrShare(&import_v->path, khstring_copy, share);
 
     khstring* opt_alias = NULL;
     if (import_v->opt_alias) {
-        opt_alias = (khstring*)malloc(sizeof(khstring));
-        *opt_alias = khstring_copy(import_v->opt_alias);
+        opt_alias = copyOrShare(&import_v->opt_alias, khstring_copy, share);
     }
 
     return (khAstImport){.path = path, .relative = import_v->relative, .opt_alias = opt_alias};
 }
 
+khAstImport khAstImport_copy(khAstImport* import_v) {
+    return copyImport(import_v, false);
+}
+
+khAstImport khAstImport_move(khAstImport* import_v) {
+    khAstImport moved = *import_v;
+    *import_v = (khAstImport){0};
+    return moved;
+}
+
 void khAstImport_delete(khAstImport* import_v) {
     kharray_delete(&import_v->path);
-    if (import_v->opt_alias != NULL) {
-        khstring_delete(import_v->opt_alias);
-        free(import_v->opt_alias);
-    }
+    kharray_delete(&import_v->opt_alias);
 }
 
-khstring khAstImport_string(khAstImport* import_v, char32_t* origin) {
-    khstring string = khstring_new(U"{\"path\": [");
+void khAstImport_write(khAstImport* import_v, khWriter* writer) {
+    khWriter_cstring(writer, U"{\"path\": [");
     for (size_t i = 0; i < kharray_size(&import_v->path); i++) {
-        khstring quoted_path = khstring_quote(&import_v->path[i]);
-        khstring_concatenate(&string, &quoted_path);
-        khstring_delete(&quoted_path);
+        khWriter_quote(writer, &import_v->path[i]);
 
         if (i != kharray_size(&import_v->path) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"relative\": ");
-    khstring_concatenateCstring(&string, import_v->relative ? U"true" : U"false");
+    khWriter_cstring(writer, U"], \"relative\": ");
+    khWriter_cstring(writer, import_v->relative ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"opt_alias\": ");
+    khWriter_cstring(writer, U", \"opt_alias\": ");
     if (import_v->opt_alias != NULL) {
-        khstring quoted_alias = khstring_quote(import_v->opt_alias);
-        khstring_concatenate(&string, &quoted_alias);
-        khstring_delete(&quoted_alias);
+        khWriter_quote(writer, import_v->opt_alias);
     }
     else {
-        khstring_concatenateCstring(&string, U"null");
+        khWriter_cstring(writer, U"null");
     }
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+    khWriter_cstring(writer, U"}");
 }
 
+khstring khAstImport_string(khAstImport* import_v) {
+    khWriter writer = khWriter_newString();
+    khAstImport_write(import_v, &writer);
+    return writer.string;
+}
 
-khAstInclude khAstInclude_copy(khAstInclude* include) {
-    kharray(khstring) path = kharray_new(khstring, khstring_delete);
-    for (size_t i = 0; i < kharray_size(&include->path); i++) {
-        kharray_append(&path, khstring_copy(&include->path[i]));
-    }
+
+static khAstInclude copyInclude(khAstInclude* include, bool share) {
+    kharray(khstring) path = copyOrShare(&include->path, khstring_copy, share);
 
     return (khAstInclude){.path = path, .relative = include->relative};
 }
 
+khAstInclude khAstInclude_copy(khAstInclude* include) {
+    return copyInclude(include, false);
+}
+
+khAstInclude khAstInclude_move(khAstInclude* include) {
+    khAstInclude moved = *include;
+    *include = (khAstInclude){0};
+    return moved;
+}
+
 void khAstInclude_delete(khAstInclude* include) {
     kharray_delete(&include->path);
 }
 
-khstring khAstInclude_string(khAstInclude* include, char32_t* origin) {
-    khstring string = khstring_new(U"{\"path\": [");
+void khAstInclude_write(khAstInclude* include, khWriter* writer) {
+    khWriter_cstring(writer, U"{\"path\": [");
     for (size_t i = 0; i < kharray_size(&include->path); i++) {
-        khstring quoted_path = khstring_quote(&include->path[i]);
-        khstring_concatenate(&string, &quoted_path);
-        khstring_delete(&quoted_path);
+        khWriter_quote(writer, &include->path[i]);
 
         if (i != kharray_size(&include->path) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"relative\": ");
-    khstring_concatenateCstring(&string, include->relative ? U"true" : U"false");
+    khWriter_cstring(writer, U"], \"relative\": ");
+    khWriter_cstring(writer, include->relative ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+    khWriter_cstring(writer, U"}");
 }
 
+khstring khAstInclude_string(khAstInclude* include) {
+    khWriter writer = khWriter_newString();
+    khAstInclude_write(include, &writer);
+    return writer.string;
+}
 
-khAstFunction khAstFunction_copy(khAstFunction* function) {
+
+static khAstFunction copyFunction(khAstFunction* function, bool share) {
     khAstVariable* opt_variadic_argument = NULL;
     if (function->opt_variadic_argument != NULL) {
-        opt_variadic_argument = (khAstVariable*)malloc(sizeof(khAstExpression));
-        *opt_variadic_argument = khAstVariable_copy(function->opt_variadic_argument);
+        opt_variadic_argument =
+            copyOrShare(&function->opt_variadic_argument, khAstVariable_copy, share);
     }
 
     khAstExpression* opt_return_type = NULL;
     if (function->opt_return_type != NULL) {
-        opt_return_type = (khAstExpression*)malloc(sizeof(khAstExpression));
-        *opt_return_type = khAstExpression_copy(function->opt_return_type);
+        opt_return_type = copyChild(function->opt_return_type, share);
     }
 
     return (khAstFunction){.is_incase = function->is_incase,
                            .is_static = function->is_static,
-                           .identifiers = kharray_copy(&function->identifiers, khstring_copy),
+                           .identifiers = copyOrShare(&function->identifiers, khstring_copy, share),
                            .template_arguments =
-                               kharray_copy(&function->template_arguments, khstring_copy),
-                           .arguments = kharray_copy(&function->arguments, khAstVariable_copy),
+                               copyOrShare(&function->template_arguments, khstring_copy, share),
+                           .arguments = copyOrShare(&function->arguments, khAstVariable_copy, share),
                            .opt_variadic_argument = opt_variadic_argument,
                            .is_return_type_ref = function->is_return_type_ref,
                            .opt_return_type = opt_return_type,
-                           .block = kharray_copy(&function->block, khAstStatement_copy)};
+                           .block = copyOrShare(&function->block, khAstStatement_copy, share),
+                           .lazy_block = copyLazyBlock(&function->lazy_block, share)};
+}
+
+khAstFunction khAstFunction_copy(khAstFunction* function) {
+    return copyFunction(function, false);
+}
+
+khAstFunction khAstFunction_move(khAstFunction* function) {
+    khAstFunction moved = *function;
+    *function = (khAstFunction){0};
+    return moved;
 }
 
 void khAstFunction_delete(khAstFunction* function) {
     kharray_delete(&function->identifiers);
     kharray_delete(&function->template_arguments);
     kharray_delete(&function->arguments);
-    if (function->opt_variadic_argument != NULL) {
-        khAstVariable_delete(function->opt_variadic_argument);
-        free(function->opt_variadic_argument);
-    }
-    if (function->opt_return_type != NULL) {
-        khAstExpression_delete(function->opt_return_type);
-        free(function->opt_return_type);
-    }
+    kharray_delete(&function->opt_variadic_argument);
+    deleteChild(function->opt_return_type);
     kharray_delete(&function->block);
+    deleteLazyBlock(&function->lazy_block);
 }
 
-khstring khAstFunction_string(khAstFunction* function, char32_t* origin) {
-    khstring string = khstring_new(U"{\"is_incase\": ");
-    khstring_concatenateCstring(&string, function->is_incase ? U"true" : U"false");
+static void startFunction(kharray(khWriteTask) * tasks, khWriter* writer, khAstFunction* function) {
+    khWriter_cstring(writer, U"{\"is_incase\": ");
+    khWriter_cstring(writer, function->is_incase ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"is_static\": ");
-    khstring_concatenateCstring(&string, function->is_static ? U"true" : U"false");
+    khWriter_cstring(writer, U", \"is_static\": ");
+    khWriter_cstring(writer, function->is_static ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"identifiers\": [");
+    khWriter_cstring(writer, U", \"identifiers\": [");
     for (size_t i = 0; i < kharray_size(&function->identifiers); i++) {
-        khstring quoted_identifier = khstring_quote(&function->identifiers[i]);
-        khstring_concatenate(&string, &quoted_identifier);
-        khstring_delete(&quoted_identifier);
+        khWriter_quote(writer, &function->identifiers[i]);
 
         if (i != kharray_size(&function->identifiers) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"template_arguments\": [");
+    khWriter_cstring(writer, U"], \"template_arguments\": [");
     for (size_t i = 0; i < kharray_size(&function->template_arguments); i++) {
-        khstring quoted_argument = khstring_quote(&function->template_arguments[i]);
-        khstring_concatenate(&string, &quoted_argument);
-        khstring_delete(&quoted_argument);
+        khWriter_quote(writer, &function->template_arguments[i]);
 
         if (i != kharray_size(&function->template_arguments) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"arguments\": [");
-    for (size_t i = 0; i < kharray_size(&function->arguments); i++) {
-        khstring argument_str = khAstVariable_string(&function->arguments[i], origin);
-        khstring_concatenate(&string, &argument_str);
-        khstring_delete(&argument_str);
-
-        if (i != kharray_size(&function->arguments) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+    khWriter_cstring(writer, U"], \"arguments\": [");
+    deferVariables(tasks, &function->arguments);
 
-    khstring_concatenateCstring(&string, U"], \"opt_variadic_argument\": ");
+    deferText(tasks, U"], \"opt_variadic_argument\": ");
     if (function->opt_variadic_argument != NULL) {
-        khstring argument_str = khAstVariable_string(function->opt_variadic_argument, origin);
-        khstring_concatenate(&string, &argument_str);
-        khstring_delete(&argument_str);
+        deferVariable(tasks, function->opt_variadic_argument);
     }
     else {
-        khstring_concatenateCstring(&string, U"null");
+        deferText(tasks, U"null");
     }
 
-    khstring_concatenateCstring(&string, U", \"is_return_type_ref\": ");
-    khstring_concatenateCstring(&string, function->is_return_type_ref ? U"true" : U"false");
+    deferText(tasks, U", \"is_return_type_ref\": ");
+    deferText(tasks, function->is_return_type_ref ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"opt_return_type\": ");
-    if (function->opt_return_type != NULL) {
-        khstring argument_str = khAstExpression_string(function->opt_return_type, origin);
-        khstring_concatenate(&string, &argument_str);
-        khstring_delete(&argument_str);
-    }
-    else {
-        khstring_concatenateCstring(&string, U"null");
+    deferText(tasks, U", \"opt_return_type\": ");
+    deferOptional(tasks, function->opt_return_type);
+
+    // Not parsed yet
+    if (function->lazy_block.source != NULL) {
+        deferText(tasks, U", \"block\": null}");
+        return;
     }
 
-    khstring_concatenateCstring(&string, U", \"block\": [");
-    for (size_t i = 0; i < kharray_size(&function->block); i++) {
-        khstring statement_str = khAstStatement_string(&function->block[i], origin);
-        khstring_concatenate(&string, &statement_str);
-        khstring_delete(&statement_str);
+    deferText(tasks, U", \"block\": [");
+    deferStatements(tasks, &function->block);
+    deferText(tasks, U"]}");
+}
 
-        if (i != kharray_size(&function->block) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+void khAstFunction_write(khAstFunction* function, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startFunction(&tasks, writer, function);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstFunction_string(khAstFunction* function) {
+    khWriter writer = khWriter_newString();
+    khAstFunction_write(function, &writer);
+    return writer.string;
 }
 
 
-khAstClass khAstClass_copy(khAstClass* class_v) {
-    kharray(khstring) template_arguments = kharray_new(khstring, khstring_delete);
-    for (size_t i = 0; i < kharray_size(&class_v->template_arguments); i++) {
-        kharray_append(&template_arguments, khstring_copy(&class_v->template_arguments[i]));
-    }
+static khAstClass copyClass(khAstClass* class_v, bool share) {
+    kharray(khstring) template_arguments =
+        copyOrShare(&class_v->template_arguments, khstring_copy, share);
 
     khAstExpression* opt_base_type = NULL;
     if (class_v->opt_base_type != NULL) {
-        opt_base_type = (khAstExpression*)malloc(sizeof(khAstExpression));
-        *opt_base_type = khAstExpression_copy(class_v->opt_base_type);
+        opt_base_type = copyChild(class_v->opt_base_type, share);
     }
 
     return (khAstClass){.is_incase = class_v->is_incase,
-                        .name = khstring_copy(&class_v->name),
+                        .name = copyOrShare(&class_v->name, NULL, share),
                         .template_arguments = template_arguments,
                         .opt_base_type = opt_base_type,
-                        .block = kharray_copy(&class_v->block, khAstStatement_copy)};
+                        .block = copyOrShare(&class_v->block, khAstStatement_copy, share)};
+}
+
+khAstClass khAstClass_copy(khAstClass* class_v) {
+    return copyClass(class_v, false);
+}
+
+khAstClass khAstClass_move(khAstClass* class_v) {
+    khAstClass moved = *class_v;
+    *class_v = (khAstClass){0};
+    return moved;
 }
 
 void khAstClass_delete(khAstClass* class_v) {
     khstring_delete(&class_v->name);
     kharray_delete(&class_v->template_arguments);
-    if (class_v->opt_base_type != NULL) {
-        khAstExpression_delete(class_v->opt_base_type);
-        free(class_v->opt_base_type);
-    }
+    deleteChild(class_v->opt_base_type);
     kharray_delete(&class_v->block);
 }
 
-khstring khAstClass_string(khAstClass* class_v, char32_t* origin) {
-    khstring string = khstring_new(U"{\"is_incase\": ");
-    khstring_concatenateCstring(&string, class_v->is_incase ? U"true" : U"false");
+static void startClass(kharray(khWriteTask) * tasks, khWriter* writer, khAstClass* class_v) {
+    khWriter_cstring(writer, U"{\"is_incase\": ");
+    khWriter_cstring(writer, class_v->is_incase ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"name\": ");
-    khstring quoted_name = khstring_quote(&class_v->name);
-    khstring_concatenate(&string, &quoted_name);
-    khstring_delete(&quoted_name);
+    khWriter_cstring(writer, U", \"name\": ");
+    khWriter_quote(writer, &class_v->name);
 
-    khstring_concatenateCstring(&string, U", \"template_arguments\": [");
+    khWriter_cstring(writer, U", \"template_arguments\": [");
     for (size_t i = 0; i < kharray_size(&class_v->template_arguments); i++) {
-        khstring quoted_argument = khstring_quote(&class_v->template_arguments[i]);
-        khstring_concatenate(&string, &quoted_argument);
-        khstring_delete(&quoted_argument);
+        khWriter_quote(writer, &class_v->template_arguments[i]);
 
         if (i != kharray_size(&class_v->template_arguments) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"opt_base_type\": ");
-    if (class_v->opt_base_type != NULL) {
-        khstring base_type_str = khAstExpression_string(class_v->opt_base_type, origin);
-        khstring_concatenate(&string, &base_type_str);
-        khstring_delete(&base_type_str);
-    }
-    else {
-        khstring_concatenateCstring(&string, U"null");
-    }
+    khWriter_cstring(writer, U"], \"opt_base_type\": ");
+    deferOptional(tasks, class_v->opt_base_type);
 
-    khstring_concatenateCstring(&string, U", \"block\": [");
-    for (size_t i = 0; i < kharray_size(&class_v->block); i++) {
-        khstring statement_str = khAstStatement_string(&class_v->block[i], origin);
-        khstring_concatenate(&string, &statement_str);
-        khstring_delete(&statement_str);
+    deferText(tasks, U", \"block\": [");
+    deferStatements(tasks, &class_v->block);
+    deferText(tasks, U"]}");
+}
 
-        if (i != kharray_size(&class_v->block) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+void khAstClass_write(khAstClass* class_v, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startClass(&tasks, writer, class_v);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstClass_string(khAstClass* class_v) {
+    khWriter writer = khWriter_newString();
+    khAstClass_write(class_v, &writer);
+    return writer.string;
 }
 
 
-khAstStruct khAstStruct_copy(khAstStruct* struct_v) {
-    kharray(khstring) template_arguments = kharray_new(khstring, khstring_delete);
-    for (size_t i = 0; i < kharray_size(&struct_v->template_arguments); i++) {
-        kharray_append(&template_arguments, khstring_copy(&struct_v->template_arguments[i]));
-    }
+static khAstStruct copyStruct(khAstStruct* struct_v, bool share) {
+    kharray(khstring) template_arguments =
+        copyOrShare(&struct_v->template_arguments, khstring_copy, share);
 
     return (khAstStruct){.is_incase = struct_v->is_incase,
-                         .name = khstring_copy(&struct_v->name),
+                         .name = copyOrShare(&struct_v->name, NULL, share),
                          .template_arguments = template_arguments,
-                         .block = kharray_copy(&struct_v->block, khAstStatement_copy)};
+                         .block = copyOrShare(&struct_v->block, khAstStatement_copy, share)};
+}
+
+khAstStruct khAstStruct_copy(khAstStruct* struct_v) {
+    return copyStruct(struct_v, false);
+}
+
+khAstStruct khAstStruct_move(khAstStruct* struct_v) {
+    khAstStruct moved = *struct_v;
+    *struct_v = (khAstStruct){0};
+    return moved;
 }
 
 void khAstStruct_delete(khAstStruct* struct_v) {
@@ -1448,49 +2046,54 @@ void khAstStruct_delete(khAstStruct* struct_v) {
     kharray_delete(&struct_v->block);
 }
 
-khstring khAstStruct_string(khAstStruct* struct_v, char32_t* origin) {
-    khstring string = khstring_new(U"{\"is_incase\": ");
-    khstring_concatenateCstring(&string, struct_v->is_incase ? U"true" : U"false");
+static void startStruct(kharray(khWriteTask) * tasks, khWriter* writer, khAstStruct* struct_v) {
+    khWriter_cstring(writer, U"{\"is_incase\": ");
+    khWriter_cstring(writer, struct_v->is_incase ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"name\": ");
-    khstring quoted_name = khstring_quote(&struct_v->name);
-    khstring_concatenate(&string, &quoted_name);
-    khstring_delete(&quoted_name);
+    khWriter_cstring(writer, U", \"name\": ");
+    khWriter_quote(writer, &struct_v->name);
 
-    khstring_concatenateCstring(&string, U", \"template_arguments\": [");
+    khWriter_cstring(writer, U", \"template_arguments\": [");
     for (size_t i = 0; i < kharray_size(&struct_v->template_arguments); i++) {
-        khstring quoted_argument = khstring_quote(&struct_v->template_arguments[i]);
-        khstring_concatenate(&string, &quoted_argument);
-        khstring_delete(&quoted_argument);
+        khWriter_quote(writer, &struct_v->template_arguments[i]);
 
         if (i != kharray_size(&struct_v->template_arguments) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"block\": [");
-    for (size_t i = 0; i < kharray_size(&struct_v->block); i++) {
-        khstring statement_str = khAstStatement_string(&struct_v->block[i], origin);
-        khstring_concatenate(&string, &statement_str);
-        khstring_delete(&statement_str);
+    khWriter_cstring(writer, U"], \"block\": [");
+    deferStatements(tasks, &struct_v->block);
+    deferText(tasks, U"]}");
+}
 
-        if (i != kharray_size(&struct_v->block) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+void khAstStruct_write(khAstStruct* struct_v, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startStruct(&tasks, writer, struct_v);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstStruct_string(khAstStruct* struct_v) {
+    khWriter writer = khWriter_newString();
+    khAstStruct_write(struct_v, &writer);
+    return writer.string;
 }
 
 
+static khAstEnum copyEnum(khAstEnum* enum_v, bool share) {
+    kharray(khstring) members = copyOrShare(&enum_v->members, khstring_copy, share);
+
+    return (khAstEnum){.name = copyOrShare(&enum_v->name, NULL, share), .members = members};
+}
+
 khAstEnum khAstEnum_copy(khAstEnum* enum_v) {
-    kharray(khstring) members = kharray_new(khstring, khstring_delete);
-    for (size_t i = 0; i < kharray_size(&enum_v->members); i++) {
-        kharray_append(&members, khstring_copy(&enum_v->members[i]));
-    }
+    return copyEnum(enum_v, false);
+}
 
-    return (khAstEnum){.name = khstring_copy(&enum_v->name), .members = members};
+khAstEnum khAstEnum_move(khAstEnum* enum_v) {
+    khAstEnum moved = *enum_v;
+    *enum_v = (khAstEnum){0};
+    return moved;
 }
 
 void khAstEnum_delete(khAstEnum* enum_v) {
@@ -1498,32 +2101,43 @@ void khAstEnum_delete(khAstEnum* enum_v) {
     kharray_delete(&enum_v->members);
 }
 
-khstring khAstEnum_string(khAstEnum* enum_v, char32_t* origin) {
-    khstring string = khstring_new(U"{\"name\": ");
-    khstring quoted_name = khstring_quote(&enum_v->name);
-    khstring_concatenate(&string, &quoted_name);
-    khstring_delete(&quoted_name);
+void khAstEnum_write(khAstEnum* enum_v, khWriter* writer) {
+    khWriter_cstring(writer, U"{\"name\": ");
+    khWriter_quote(writer, &enum_v->name);
 
-    khstring_concatenateCstring(&string, U", \"members\": [");
+    khWriter_cstring(writer, U", \"members\": [");
     for (size_t i = 0; i < kharray_size(&enum_v->members); i++) {
-        khstring quoted_member = khstring_quote(&enum_v->members[i]);
-        khstring_concatenate(&string, &quoted_member);
-        khstring_delete(&quoted_member);
+        khWriter_quote(writer, &enum_v->members[i]);
 
         if (i != kharray_size(&enum_v->members) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+    khWriter_cstring(writer, U"]}");
+}
+
+khstring khAstEnum_string(khAstEnum* enum_v) {
+    khWriter writer = khWriter_newString();
+    khAstEnum_write(enum_v, &writer);
+    return writer.string;
 }
 
 
-khAstAlias khAstAlias_copy(khAstAlias* alias) {
+static khAstAlias copyAlias(khAstAlias* alias, bool share) {
     return (khAstAlias){.is_incase = alias->is_incase,
-                        .name = khstring_copy(&alias->name),
-                        .expression = khAstExpression_copy(&alias->expression)};
+                        .name = copyOrShare(&alias->name, NULL, share),
+                        .expression = copyExpression(&alias->expression, share)};
+}
+
+khAstAlias khAstAlias_copy(khAstAlias* alias) {
+    return copyAlias(alias, false);
+}
+
+khAstAlias khAstAlias_move(khAstAlias* alias) {
+    khAstAlias moved = *alias;
+    *alias = (khAstAlias){0};
+    return moved;
 }
 
 void khAstAlias_delete(khAstAlias* alias) {
@@ -1531,36 +2145,59 @@ void khAstAlias_delete(khAstAlias* alias) {
     khAstExpression_delete(&alias->expression);
 }
 
-khstring khAstAlias_string(khAstAlias* alias, char32_t* origin) {
-    khstring string = khstring_new(U"{\"is_incase\": ");
-    khstring_concatenateCstring(&string, alias->is_incase ? U"true" : U"false");
+static void startAlias(kharray(khWriteTask) * tasks, khWriter* writer, khAstAlias* alias) {
+    khWriter_cstring(writer, U"{\"is_incase\": ");
+    khWriter_cstring(writer, alias->is_incase ? U"true" : U"false");
 
-    khstring_concatenateCstring(&string, U", \"name\": ");
-    khstring quoted_name = khstring_quote(&alias->name);
-    khstring_concatenate(&string, &quoted_name);
-    khstring_delete(&quoted_name);
+    khWriter_cstring(writer, U", \"name\": ");
+    khWriter_quote(writer, &alias->name);
 
-    khstring_concatenateCstring(&string, U", \"expression\": ");
-    khstring expression_str = khAstExpression_string(&alias->expression, origin);
-    khstring_concatenate(&string, &expression_str);
-    khstring_delete(&expression_str);
+    khWriter_cstring(writer, U", \"expression\": ");
+    deferExpression(tasks, &alias->expression);
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+    deferText(tasks, U"}");
 }
 
+void khAstAlias_write(khAstAlias* alias, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startAlias(&tasks, writer, alias);
+    writeTasks(&tasks, writer);
+}
 
-khAstIfBranch khAstIfBranch_copy(khAstIfBranch* if_branch) {
-    kharray(kharray(khAstStatement)) branch_blocks =
-        kharray_new(kharray(khAstStatement), kharray_arrayDeleter(khAstStatement));
-    for (size_t i = 0; i < kharray_size(&if_branch->branch_blocks); i++) {
-        kharray_append(&branch_blocks, kharray_copy(&if_branch->branch_blocks[i], khAstStatement_copy));
+khstring khAstAlias_string(khAstAlias* alias) {
+    khWriter writer = khWriter_newString();
+    khAstAlias_write(alias, &writer);
+    return writer.string;
+}
+
+
+static khAstIfBranch copyIfBranch(khAstIfBranch* if_branch, bool share) {
+    kharray(kharray(khAstStatement)) branch_blocks = NULL;
+    if (share) {
+        branch_blocks = kharray_share(&if_branch->branch_blocks);
+    }
+    else {
+        branch_blocks = kharray_new(kharray(khAstStatement), kharray_arrayDeleter(khAstStatement));
+        for (size_t i = 0; i < kharray_size(&if_branch->branch_blocks); i++) {
+            kharray_append(&branch_blocks,
+                           kharray_copy(&if_branch->branch_blocks[i], khAstStatement_copy));
+        }
     }
 
-    return (khAstIfBranch){.branch_conditions =
-                               kharray_copy(&if_branch->branch_conditions, khAstExpression_copy),
-                           .branch_blocks = branch_blocks,
-                           .else_block = kharray_copy(&if_branch->else_block, khAstStatement_copy)};
+    return (khAstIfBranch){
+        .branch_conditions = copyOrShare(&if_branch->branch_conditions, khAstExpression_copy, share),
+        .branch_blocks = branch_blocks,
+        .else_block = copyOrShare(&if_branch->else_block, khAstStatement_copy, share)};
+}
+
+khAstIfBranch khAstIfBranch_copy(khAstIfBranch* if_branch) {
+    return copyIfBranch(if_branch, false);
+}
+
+khAstIfBranch khAstIfBranch_move(khAstIfBranch* if_branch) {
+    khAstIfBranch moved = *if_branch;
+    *if_branch = (khAstIfBranch){0};
+    return moved;
 }
 
 void khAstIfBranch_delete(khAstIfBranch* if_branch) {
@@ -1569,57 +2206,52 @@ void khAstIfBranch_delete(khAstIfBranch* if_branch) {
     kharray_delete(&if_branch->else_block);
 }
 
-khstring khAstIfBranch_string(khAstIfBranch* if_branch, char32_t* origin) {
-    khstring string = khstring_new(U"{\"branch_conditions\": [");
-    for (size_t i = 0; i < kharray_size(&if_branch->branch_conditions); i++) {
-        khstring branch_condition_str =
-            khAstExpression_string(&if_branch->branch_conditions[i], origin);
-        khstring_concatenate(&string, &branch_condition_str);
-        khstring_delete(&branch_condition_str);
-
-        if (i != kharray_size(&if_branch->branch_conditions) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+static void startIfBranch(kharray(khWriteTask) * tasks, khWriter* writer, khAstIfBranch* if_branch) {
+    khWriter_cstring(writer, U"{\"branch_conditions\": [");
+    deferExpressions(tasks, &if_branch->branch_conditions);
 
-    khstring_concatenateCstring(&string, U"], \"branch_blocks\": [");
+    deferText(tasks, U"], \"branch_blocks\": [");
     for (size_t i = 0; i < kharray_size(&if_branch->branch_blocks); i++) {
-        khstring_append(&string, U'[');
-        for (size_t j = 0; j < kharray_size(&if_branch->branch_blocks[i]); j++) {
-            khstring statement_str = khAstStatement_string(&if_branch->branch_blocks[i][j], origin);
-            khstring_concatenate(&string, &statement_str);
-            khstring_delete(&statement_str);
-
-            if (j < kharray_size(&if_branch->branch_blocks[i]) - 1) {
-                khstring_concatenateCstring(&string, U", ");
-            }
-        }
-        khstring_append(&string, U']');
+        deferText(tasks, U"[");
+        deferStatements(tasks, &if_branch->branch_blocks[i]);
+        deferText(tasks, U"]");
 
         if (i != kharray_size(&if_branch->branch_blocks) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            deferText(tasks, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"else_block\": [");
-    for (size_t i = 0; i < kharray_size(&if_branch->else_block); i++) {
-        khstring statement_str = khAstStatement_string(&if_branch->else_block[i], origin);
-        khstring_concatenate(&string, &statement_str);
-        khstring_delete(&statement_str);
+    deferText(tasks, U"], \"else_block\": [");
+    deferStatements(tasks, &if_branch->else_block);
+    deferText(tasks, U"]}");
+}
 
-        if (i != kharray_size(&if_branch->else_block) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+void khAstIfBranch_write(khAstIfBranch* if_branch, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startIfBranch(&tasks, writer, if_branch);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstIfBranch_string(khAstIfBranch* if_branch) {
+    khWriter writer = khWriter_newString();
+    khAstIfBranch_write(if_branch, &writer);
+    return writer.string;
 }
 
 
+static khAstWhileLoop copyWhileLoop(khAstWhileLoop* while_loop, bool share) {
+    return (khAstWhileLoop){.condition = copyExpression(&while_loop->condition, share),
+                            .block = copyOrShare(&while_loop->block, khAstStatement_copy, share)};
+}
+
 khAstWhileLoop khAstWhileLoop_copy(khAstWhileLoop* while_loop) {
-    return (khAstWhileLoop){.condition = khAstExpression_copy(&while_loop->condition),
-                            .block = kharray_copy(&while_loop->block, khAstStatement_copy)};
+    return copyWhileLoop(while_loop, false);
+}
+
+khAstWhileLoop khAstWhileLoop_move(khAstWhileLoop* while_loop) {
+    khAstWhileLoop moved = *while_loop;
+    *while_loop = (khAstWhileLoop){0};
+    return moved;
 }
 
 void khAstWhileLoop_delete(khAstWhileLoop* while_loop) {
@@ -1627,31 +2259,42 @@ void khAstWhileLoop_delete(khAstWhileLoop* while_loop) {
     kharray_delete(&while_loop->block);
 }
 
-khstring khAstWhileLoop_string(khAstWhileLoop* while_loop, char32_t* origin) {
-    khstring string = khstring_new(U"{\"condition\": ");
-    khstring condition_str = khAstExpression_string(&while_loop->condition, origin);
-    khstring_concatenate(&string, &condition_str);
-    khstring_delete(&condition_str);
+static void startWhileLoop(kharray(khWriteTask) * tasks, khWriter* writer,
+                           khAstWhileLoop* while_loop) {
+    khWriter_cstring(writer, U"{\"condition\": ");
+    deferExpression(tasks, &while_loop->condition);
 
-    khstring_concatenateCstring(&string, U", \"block\": [");
-    for (size_t i = 0; i < kharray_size(&while_loop->block); i++) {
-        khstring statement_str = khAstStatement_string(&while_loop->block[i], origin);
-        khstring_concatenate(&string, &statement_str);
-        khstring_delete(&statement_str);
+    deferText(tasks, U", \"block\": [");
+    deferStatements(tasks, &while_loop->block);
+    deferText(tasks, U"]}");
+}
 
-        if (i != kharray_size(&while_loop->block) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+void khAstWhileLoop_write(khAstWhileLoop* while_loop, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startWhileLoop(&tasks, writer, while_loop);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstWhileLoop_string(khAstWhileLoop* while_loop) {
+    khWriter writer = khWriter_newString();
+    khAstWhileLoop_write(while_loop, &writer);
+    return writer.string;
 }
 
 
+static khAstDoWhileLoop copyDoWhileLoop(khAstDoWhileLoop* do_while_loop, bool share) {
+    return (khAstDoWhileLoop){.condition = copyExpression(&do_while_loop->condition, share),
+                              .block = copyOrShare(&do_while_loop->block, khAstStatement_copy, share)};
+}
+
 khAstDoWhileLoop khAstDoWhileLoop_copy(khAstDoWhileLoop* do_while_loop) {
-    return (khAstDoWhileLoop){.condition = khAstExpression_copy(&do_while_loop->condition),
-                              .block = kharray_copy(&do_while_loop->block, khAstStatement_copy)};
+    return copyDoWhileLoop(do_while_loop, false);
+}
+
+khAstDoWhileLoop khAstDoWhileLoop_move(khAstDoWhileLoop* do_while_loop) {
+    khAstDoWhileLoop moved = *do_while_loop;
+    *do_while_loop = (khAstDoWhileLoop){0};
+    return moved;
 }
 
 void khAstDoWhileLoop_delete(khAstDoWhileLoop* do_while_loop) {
@@ -1659,32 +2302,43 @@ void khAstDoWhileLoop_delete(khAstDoWhileLoop* do_while_loop) {
     kharray_delete(&do_while_loop->block);
 }
 
-khstring khAstDoWhileLoop_string(khAstDoWhileLoop* do_while_loop, char32_t* origin) {
-    khstring string = khstring_new(U"{\"condition\": ");
-    khstring condition_str = khAstExpression_string(&do_while_loop->condition, origin);
-    khstring_concatenate(&string, &condition_str);
-    khstring_delete(&condition_str);
+static void startDoWhileLoop(kharray(khWriteTask) * tasks, khWriter* writer,
+                             khAstDoWhileLoop* do_while_loop) {
+    khWriter_cstring(writer, U"{\"condition\": ");
+    deferExpression(tasks, &do_while_loop->condition);
 
-    khstring_concatenateCstring(&string, U", \"block\": [");
-    for (size_t i = 0; i < kharray_size(&do_while_loop->block); i++) {
-        khstring statement_str = khAstStatement_string(&do_while_loop->block[i], origin);
-        khstring_concatenate(&string, &statement_str);
-        khstring_delete(&statement_str);
+    deferText(tasks, U", \"block\": [");
+    deferStatements(tasks, &do_while_loop->block);
+    deferText(tasks, U"]}");
+}
 
-        if (i != kharray_size(&do_while_loop->block) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+void khAstDoWhileLoop_write(khAstDoWhileLoop* do_while_loop, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startDoWhileLoop(&tasks, writer, do_while_loop);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstDoWhileLoop_string(khAstDoWhileLoop* do_while_loop) {
+    khWriter writer = khWriter_newString();
+    khAstDoWhileLoop_write(do_while_loop, &writer);
+    return writer.string;
 }
 
 
+static khAstForLoop copyForLoop(khAstForLoop* for_loop, bool share) {
+    return (khAstForLoop){.iterators = copyOrShare(&for_loop->iterators, khstring_copy, share),
+                          .iteratee = copyExpression(&for_loop->iteratee, share),
+                          .block = copyOrShare(&for_loop->block, khAstStatement_copy, share)};
+}
+
 khAstForLoop khAstForLoop_copy(khAstForLoop* for_loop) {
-    return (khAstForLoop){.iterators = kharray_copy(&for_loop->iterators, khstring_copy),
-                          .iteratee = khAstExpression_copy(&for_loop->iteratee),
-                          .block = kharray_copy(&for_loop->block, khAstStatement_copy)};
+    return copyForLoop(for_loop, false);
+}
+
+khAstForLoop khAstForLoop_move(khAstForLoop* for_loop) {
+    khAstForLoop moved = *for_loop;
+    *for_loop = (khAstForLoop){0};
+    return moved;
 }
 
 void khAstForLoop_delete(khAstForLoop* for_loop) {
@@ -1693,111 +2347,121 @@ void khAstForLoop_delete(khAstForLoop* for_loop) {
     kharray_delete(&for_loop->block);
 }
 
-khstring khAstForLoop_string(khAstForLoop* for_loop, char32_t* origin) {
-    khstring string = khstring_new(U"{\"iterators\": [");
+static void startForLoop(kharray(khWriteTask) * tasks, khWriter* writer, khAstForLoop* for_loop) {
+    khWriter_cstring(writer, U"{\"iterators\": [");
     for (size_t i = 0; i < kharray_size(&for_loop->iterators); i++) {
-        khstring quoted_iterator = khstring_quote(&for_loop->iterators[i]);
-        khstring_concatenate(&string, &quoted_iterator);
-        khstring_delete(&quoted_iterator);
+        khWriter_quote(writer, &for_loop->iterators[i]);
 
         if (i != kharray_size(&for_loop->iterators) - 1) {
-            khstring_concatenateCstring(&string, U", ");
+            khWriter_cstring(writer, U", ");
         }
     }
 
-    khstring_concatenateCstring(&string, U"], \"iteratee\": ");
-    khstring iteratee_str = khAstExpression_string(&for_loop->iteratee, origin);
-    khstring_concatenate(&string, &iteratee_str);
-    khstring_delete(&iteratee_str);
+    khWriter_cstring(writer, U"], \"iteratee\": ");
+    deferExpression(tasks, &for_loop->iteratee);
 
-    khstring_concatenateCstring(&string, U", \"block\": [");
-    for (size_t i = 0; i < kharray_size(&for_loop->block); i++) {
-        khstring statement_str = khAstStatement_string(&for_loop->block[i], origin);
-        khstring_concatenate(&string, &statement_str);
-        khstring_delete(&statement_str);
+    deferText(tasks, U", \"block\": [");
+    deferStatements(tasks, &for_loop->block);
+    deferText(tasks, U"]}");
+}
 
-        if (i != kharray_size(&for_loop->block) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+void khAstForLoop_write(khAstForLoop* for_loop, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startForLoop(&tasks, writer, for_loop);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstForLoop_string(khAstForLoop* for_loop) {
+    khWriter writer = khWriter_newString();
+    khAstForLoop_write(for_loop, &writer);
+    return writer.string;
 }
 
 
+static khAstReturn copyReturn(khAstReturn* return_v, bool share) {
+    return (khAstReturn){.values = copyOrShare(&return_v->values, khAstExpression_copy, share)};
+}
+
 khAstReturn khAstReturn_copy(khAstReturn* return_v) {
-    return (khAstReturn){.values = kharray_copy(&return_v->values, khAstExpression_copy)};
+    return copyReturn(return_v, false);
+}
+
+khAstReturn khAstReturn_move(khAstReturn* return_v) {
+    khAstReturn moved = *return_v;
+    *return_v = (khAstReturn){0};
+    return moved;
 }
 
 void khAstReturn_delete(khAstReturn* return_v) {
     kharray_delete(&return_v->values);
 }
 
-khstring khAstReturn_string(khAstReturn* return_v, char32_t* origin) {
-    khstring string = khstring_new(U"{\"values\": [");
-    for (size_t i = 0; i < kharray_size(&return_v->values); i++) {
-        khstring value_str = khAstExpression_string(&return_v->values[i], origin);
-        khstring_concatenate(&string, &value_str);
-        khstring_delete(&value_str);
+static void startReturn(kharray(khWriteTask) * tasks, khWriter* writer, khAstReturn* return_v) {
+    khWriter_cstring(writer, U"{\"values\": [");
+    deferExpressions(tasks, &return_v->values);
+    deferText(tasks, U"]}");
+}
 
-        if (i != kharray_size(&return_v->values) - 1) {
-            khstring_concatenateCstring(&string, U", ");
-        }
-    }
+void khAstReturn_write(khAstReturn* return_v, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startReturn(&tasks, writer, return_v);
+    writeTasks(&tasks, writer);
+}
 
-    khstring_concatenateCstring(&string, U"]}");
-    return string;
+khstring khAstReturn_string(khAstReturn* return_v) {
+    khWriter writer = khWriter_newString();
+    khAstReturn_write(return_v, &writer);
+    return writer.string;
 }
 
 
-khAstStatement khAstStatement_copy(khAstStatement* statement) {
+static khAstStatement copyStatement(khAstStatement* statement, bool share) {
     khAstStatement copy = *statement;
 
     switch (statement->type) {
         case khAstStatementType_VARIABLE:
-            copy.variable = khAstVariable_copy(&statement->variable);
+            copy.variable = copyVariable(&statement->variable, share);
             break;
         case khAstStatementType_EXPRESSION:
-            copy.expression = khAstExpression_copy(&statement->expression);
+            copy.expression = copyExpression(&statement->expression, share);
             break;
 
         case khAstStatementType_IMPORT:
-            copy.import_v = khAstImport_copy(&statement->import_v);
+            copy.import_v = copyImport(&statement->import_v, share);
             break;
         case khAstStatementType_INCLUDE:
-            copy.include = khAstInclude_copy(&statement->include);
+            copy.include = copyInclude(&statement->include, share);
             break;
         case khAstStatementType_FUNCTION:
-            copy.function = khAstFunction_copy(&statement->function);
+            copy.function = copyFunction(&statement->function, share);
             break;
         case khAstStatementType_CLASS:
-            copy.class_v = khAstClass_copy(&statement->class_v);
+            copy.class_v = copyClass(&statement->class_v, share);
             break;
         case khAstStatementType_STRUCT:
-            copy.struct_v = khAstStruct_copy(&statement->struct_v);
+            copy.struct_v = copyStruct(&statement->struct_v, share);
             break;
         case khAstStatementType_ENUM:
-            copy.enum_v = khAstEnum_copy(&statement->enum_v);
+            copy.enum_v = copyEnum(&statement->enum_v, share);
             break;
         case khAstStatementType_ALIAS:
-            copy.alias = khAstAlias_copy(&statement->alias);
+            copy.alias = copyAlias(&statement->alias, share);
             break;
 
         case khAstStatementType_IF_BRANCH:
-            copy.if_branch = khAstIfBranch_copy(&statement->if_branch);
+            copy.if_branch = copyIfBranch(&statement->if_branch, share);
             break;
         case khAstStatementType_WHILE_LOOP:
-            copy.while_loop = khAstWhileLoop_copy(&statement->while_loop);
+            copy.while_loop = copyWhileLoop(&statement->while_loop, share);
             break;
         case khAstStatementType_DO_WHILE_LOOP:
-            copy.do_while_loop = khAstDoWhileLoop_copy(&statement->do_while_loop);
+            copy.do_while_loop = copyDoWhileLoop(&statement->do_while_loop, share);
             break;
         case khAstStatementType_FOR_LOOP:
-            copy.for_loop = khAstForLoop_copy(&statement->for_loop);
+            copy.for_loop = copyForLoop(&statement->for_loop, share);
             break;
         case khAstStatementType_RETURN:
-            copy.return_v = khAstReturn_copy(&statement->return_v);
+            copy.return_v = copyReturn(&statement->return_v, share);
             break;
 
         default:
@@ -1807,6 +2471,20 @@ khAstStatement khAstStatement_copy(khAstStatement* statement) {
     return copy;
 }
 
+khAstStatement khAstStatement_copy(khAstStatement* statement) {
+    return copyStatement(statement, false);
+}
+
+khAstStatement khAstStatement_share(khAstStatement* statement) {
+    return copyStatement(statement, true);
+}
+
+khAstStatement khAstStatement_move(khAstStatement* statement) {
+    khAstStatement moved = *statement;
+    *statement = (khAstStatement){0};
+    return moved;
+}
+
 void khAstStatement_delete(khAstStatement* statement) {
     switch (statement->type) {
         case khAstStatementType_VARIABLE:
@@ -1859,114 +2537,1058 @@ void khAstStatement_delete(khAstStatement* statement) {
     }
 }
 
-khstring khAstStatement_string(khAstStatement* statement, char32_t* origin) {
-    khstring string = khstring_new(U"{\"type\": ");
-    khstring type_str = khAstStatementType_string(statement->type);
-    khstring quoted_type = khstring_quote(&type_str);
-    khstring_concatenate(&string, &quoted_type);
-    khstring_delete(&type_str);
-    khstring_delete(&quoted_type);
+static void startStatement(kharray(khWriteTask) * tasks, khWriter* writer, khAstStatement* statement) {
+    khWriter_cstring(writer, U"{\"type\": ");
+    khWriter_char(writer, U'\"');
+    khWriter_cstring(writer, statementTypeName(statement->type));
+    khWriter_char(writer, U'\"');
 
-    khstring_concatenateCstring(&string, U", \"begin\": ");
-    if (statement->begin != NULL) {
-        khstring begin_str = kh_uintToString(statement->begin - origin, 10);
-        khstring_concatenate(&string, &begin_str);
-        khstring_delete(&begin_str);
+    khWriter_cstring(writer, U", \"begin\": ");
+    if (statement->begin != khAst_NO_SPAN) {
+        khWriter_uint(writer, statement->begin, 10);
     }
     else {
-        khstring_concatenateCstring(&string, U"null");
+        khWriter_cstring(writer, U"null");
     }
 
-    khstring_concatenateCstring(&string, U", \"end\": ");
-    if (statement->end != NULL) {
-        khstring end_str = kh_uintToString(statement->end - origin, 10);
-        khstring_concatenate(&string, &end_str);
-        khstring_delete(&end_str);
+    khWriter_cstring(writer, U", \"end\": ");
+    if (statement->end != khAst_NO_SPAN) {
+        khWriter_uint(writer, statement->end, 10);
     }
     else {
-        khstring_concatenateCstring(&string, U"null");
+        khWriter_cstring(writer, U"null");
     }
 
-    khstring_concatenateCstring(&string, U", \"value\": ");
+    khWriter_cstring(writer, U", \"value\": ");
     switch (statement->type) {
         case khAstStatementType_VARIABLE: {
-            khstring variable_str = khAstVariable_string(&statement->variable, origin);
-            khstring_concatenate(&string, &variable_str);
-            khstring_delete(&variable_str);
+            startVariable(tasks, writer, &statement->variable);
         } break;
 
         case khAstStatementType_EXPRESSION: {
-            khstring expression_str = khAstExpression_string(&statement->expression, origin);
-            khstring_concatenate(&string, &expression_str);
-            khstring_delete(&expression_str);
+            startExpression(tasks, writer, &statement->expression);
         } break;
 
         case khAstStatementType_IMPORT: {
-            khstring import_str = khAstImport_string(&statement->import_v, origin);
-            khstring_concatenate(&string, &import_str);
-            khstring_delete(&import_str);
+            khAstImport_write(&statement->import_v, writer);
         } break;
         case khAstStatementType_INCLUDE: {
-            khstring include_str = khAstInclude_string(&statement->include, origin);
-            khstring_concatenate(&string, &include_str);
-            khstring_delete(&include_str);
+            khAstInclude_write(&statement->include, writer);
         } break;
         case khAstStatementType_FUNCTION: {
-            khstring function_str = khAstFunction_string(&statement->function, origin);
-            khstring_concatenate(&string, &function_str);
-            khstring_delete(&function_str);
+            startFunction(tasks, writer, &statement->function);
         } break;
         case khAstStatementType_CLASS: {
-            khstring class_str = khAstClass_string(&statement->class_v, origin);
-            khstring_concatenate(&string, &class_str);
-            khstring_delete(&class_str);
+            startClass(tasks, writer, &statement->class_v);
         } break;
         case khAstStatementType_STRUCT: {
-            khstring struct_str = khAstStruct_string(&statement->struct_v, origin);
-            khstring_concatenate(&string, &struct_str);
-            khstring_delete(&struct_str);
+            startStruct(tasks, writer, &statement->struct_v);
         } break;
         case khAstStatementType_ENUM: {
-            khstring enum_str = khAstEnum_string(&statement->enum_v, origin);
-            khstring_concatenate(&string, &enum_str);
-            khstring_delete(&enum_str);
+            khAstEnum_write(&statement->enum_v, writer);
         } break;
         case khAstStatementType_ALIAS: {
-            khstring alias_str = khAstAlias_string(&statement->alias, origin);
-            khstring_concatenate(&string, &alias_str);
-            khstring_delete(&alias_str);
+            startAlias(tasks, writer, &statement->alias);
         } break;
 
         case khAstStatementType_IF_BRANCH: {
-            khstring if_branch_str = khAstIfBranch_string(&statement->if_branch, origin);
-            khstring_concatenate(&string, &if_branch_str);
-            khstring_delete(&if_branch_str);
+            startIfBranch(tasks, writer, &statement->if_branch);
         } break;
         case khAstStatementType_WHILE_LOOP: {
-            khstring while_loop_str = khAstWhileLoop_string(&statement->while_loop, origin);
-            khstring_concatenate(&string, &while_loop_str);
-            khstring_delete(&while_loop_str);
+            startWhileLoop(tasks, writer, &statement->while_loop);
         } break;
         case khAstStatementType_DO_WHILE_LOOP: {
-            khstring do_while_loop_str = khAstDoWhileLoop_string(&statement->do_while_loop, origin);
-            khstring_concatenate(&string, &do_while_loop_str);
-            khstring_delete(&do_while_loop_str);
+            startDoWhileLoop(tasks, writer, &statement->do_while_loop);
         } break;
         case khAstStatementType_FOR_LOOP: {
-            khstring for_loop_str = khAstForLoop_string(&statement->for_loop, origin);
-            khstring_concatenate(&string, &for_loop_str);
-            khstring_delete(&for_loop_str);
+            startForLoop(tasks, writer, &statement->for_loop);
         } break;
         case khAstStatementType_RETURN: {
-            khstring return_str = khAstReturn_string(&statement->return_v, origin);
-            khstring_concatenate(&string, &return_str);
-            khstring_delete(&return_str);
+            startReturn(tasks, writer, &statement->return_v);
+        } break;
+
+        default:
+            khWriter_cstring(writer, U"null");
+    }
+
+    deferText(tasks, U"}");
+}
+
+void khAstStatement_write(khAstStatement* statement, khWriter* writer) {
+    kharray(khWriteTask) tasks = kharray_new(khWriteTask, NULL);
+    startStatement(&tasks, writer, statement);
+    writeTasks(&tasks, writer);
+}
+
+khstring khAstStatement_string(khAstStatement* statement) {
+    khWriter writer = khWriter_newString();
+    khAstStatement_write(statement, &writer);
+    return writer.string;
+}
+
+
+// Relocation. Spans are shifted unless there's none, and the nodes take the file of the new source,
+// which also replaces whatever else there is held. Whatever's shared gets unshared on the way down,
+// leaving the other trees which share it as they are
+static inline uint32_t shiftOffset(uint32_t offset, int64_t shift) {
+    return offset != khAst_NO_SPAN ? (uint32_t)(offset + shift) : offset;
+}
+
+static inline void swapSource(khAstSource** held, khAstSource* source) {
+    khAstSource* previous = *held;
+    *held = khAstSource_retain(source);
+    khAstSource_release(previous);
+}
+
+static void relocateOptional(khAstExpression** opt_expression, khAstSource* source, int64_t shift) {
+    if (*opt_expression != NULL) {
+        khAstExpression_relocate(khAstExpression_own(opt_expression), source, shift);
+    }
+}
+
+static void relocateExpressions(kharray(khAstExpression) * expressions, khAstSource* source,
+                                int64_t shift) {
+    kharray_unshare(expressions, khAstExpression_share);
+    for (size_t i = 0; i < kharray_size(expressions); i++) {
+        khAstExpression_relocate(&(*expressions)[i], source, shift);
+    }
+}
+
+static void relocateStatements(kharray(khAstStatement) * statements, khAstSource* source,
+                               int64_t shift) {
+    kharray_unshare(statements, khAstStatement_share);
+    for (size_t i = 0; i < kharray_size(statements); i++) {
+        khAstStatement_relocate(&(*statements)[i], source, shift);
+    }
+}
+
+static khAstVariable shareVariable(khAstVariable* variable) {
+    return copyVariable(variable, true);
+}
+
+static kharray(khAstStatement) shareBlock(kharray(khAstStatement) * block) {
+    return kharray_share(block);
+}
+
+static void relocateVariable(khAstVariable* variable, khAstSource* source, int64_t shift) {
+    relocateOptional(&variable->opt_type, source, shift);
+    relocateOptional(&variable->opt_initializer, source, shift);
+}
+
+static void relocateArguments(kharray(khAstVariable) * arguments, khAstVariable** opt_variadic_argument,
+                              khAstSource* source, int64_t shift) {
+    kharray_unshare(arguments, shareVariable);
+    for (size_t i = 0; i < kharray_size(arguments); i++) {
+        relocateVariable(&(*arguments)[i], source, shift);
+    }
+
+    if (*opt_variadic_argument != NULL) {
+        kharray_unshare(opt_variadic_argument, shareVariable);
+        relocateVariable(*opt_variadic_argument, source, shift);
+    }
+}
+
+static void relocateLazyBlock(khAstLazyBlock* lazy_block, khAstSource* source, int64_t shift) {
+    if (lazy_block->source != NULL) {
+        swapSource(&lazy_block->source, source);
+        lazy_block->begin += shift;
+        lazy_block->end += shift;
+    }
+}
+
+void khAstExpression_relocate(khAstExpression* expression, khAstSource* source, int64_t shift) {
+    expression->begin = shiftOffset(expression->begin, shift);
+    expression->end = shiftOffset(expression->end, shift);
+    expression->file = source->file;
+
+    switch (expression->type) {
+        case khAstExpressionType_STRING:
+        case khAstExpressionType_BUFFER:
+            if (isRaw(expression)) {
+                swapSource(&expression->raw.source, source);
+                expression->raw.begin += shift;
+                expression->raw.end += shift;
+            }
+            break;
+
+        case khAstExpressionType_TUPLE:
+            relocateExpressions(&expression->tuple.values, source, shift);
+            break;
+        case khAstExpressionType_ARRAY:
+            relocateExpressions(&expression->array.values, source, shift);
+            break;
+        case khAstExpressionType_DICT:
+            relocateExpressions(&expression->dict.keys, source, shift);
+            relocateExpressions(&expression->dict.values, source, shift);
+            break;
+
+        case khAstExpressionType_SIGNATURE:
+            relocateExpressions(&expression->signature->argument_types, source, shift);
+            relocateOptional(&expression->signature->opt_return_type, source, shift);
+            break;
+        case khAstExpressionType_LAMBDA: {
+            khAstLambda* lambda = expression->lambda;
+            relocateArguments(&lambda->arguments, &lambda->opt_variadic_argument, source, shift);
+            relocateOptional(&lambda->opt_return_type, source, shift);
+            relocateStatements(&lambda->block, source, shift);
+            relocateLazyBlock(&lambda->lazy_block, source, shift);
+        } break;
+
+        case khAstExpressionType_UNARY:
+            khAstExpression_relocate(khAstExpression_own(&expression->unary.operand), source, shift);
+            break;
+        case khAstExpressionType_BINARY:
+            khAstExpression_relocate(khAstExpression_own(&expression->binary.left), source, shift);
+            khAstExpression_relocate(khAstExpression_own(&expression->binary.right), source, shift);
+            break;
+        case khAstExpressionType_TERNARY:
+            khAstExpression_relocate(khAstExpression_own(&expression->ternary.condition), source,
+                                     shift);
+            khAstExpression_relocate(khAstExpression_own(&expression->ternary.value), source, shift);
+            khAstExpression_relocate(khAstExpression_own(&expression->ternary.otherwise), source,
+                                     shift);
+            break;
+        case khAstExpressionType_COMPARISON:
+            relocateExpressions(&expression->comparison.operands, source, shift);
+            break;
+        case khAstExpressionType_CALL:
+            khAstExpression_relocate(khAstExpression_own(&expression->call.callee), source, shift);
+            relocateExpressions(&expression->call.arguments, source, shift);
+            break;
+        case khAstExpressionType_INDEX:
+            khAstExpression_relocate(khAstExpression_own(&expression->index.indexee), source, shift);
+            relocateExpressions(&expression->index.arguments, source, shift);
+            break;
+
+        case khAstExpressionType_SCOPE:
+            khAstExpression_relocate(khAstExpression_own(&expression->scope.value), source, shift);
+            break;
+        case khAstExpressionType_TEMPLATIZE:
+            khAstExpression_relocate(khAstExpression_own(&expression->templatize.value), source, shift);
+            relocateExpressions(&expression->templatize.template_arguments, source, shift);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void khAstStatement_relocate(khAstStatement* statement, khAstSource* source, int64_t shift) {
+    statement->begin = shiftOffset(statement->begin, shift);
+    statement->end = shiftOffset(statement->end, shift);
+    statement->file = source->file;
+
+    switch (statement->type) {
+        case khAstStatementType_VARIABLE:
+            relocateVariable(&statement->variable, source, shift);
+            break;
+        case khAstStatementType_EXPRESSION:
+            khAstExpression_relocate(&statement->expression, source, shift);
+            break;
+
+        case khAstStatementType_FUNCTION:
+            relocateArguments(&statement->function.arguments,
+                              &statement->function.opt_variadic_argument, source, shift);
+            relocateOptional(&statement->function.opt_return_type, source, shift);
+            relocateStatements(&statement->function.block, source, shift);
+            relocateLazyBlock(&statement->function.lazy_block, source, shift);
+            break;
+        case khAstStatementType_CLASS:
+            relocateOptional(&statement->class_v.opt_base_type, source, shift);
+            relocateStatements(&statement->class_v.block, source, shift);
+            break;
+        case khAstStatementType_STRUCT:
+            relocateStatements(&statement->struct_v.block, source, shift);
+            break;
+        case khAstStatementType_ALIAS:
+            khAstExpression_relocate(&statement->alias.expression, source, shift);
+            break;
+
+        case khAstStatementType_IF_BRANCH:
+            relocateExpressions(&statement->if_branch.branch_conditions, source, shift);
+            kharray_unshare(&statement->if_branch.branch_blocks, shareBlock);
+            for (size_t i = 0; i < kharray_size(&statement->if_branch.branch_blocks); i++) {
+                relocateStatements(&statement->if_branch.branch_blocks[i], source, shift);
+            }
+            relocateStatements(&statement->if_branch.else_block, source, shift);
+            break;
+        case khAstStatementType_WHILE_LOOP:
+            khAstExpression_relocate(&statement->while_loop.condition, source, shift);
+            relocateStatements(&statement->while_loop.block, source, shift);
+            break;
+        case khAstStatementType_DO_WHILE_LOOP:
+            khAstExpression_relocate(&statement->do_while_loop.condition, source, shift);
+            relocateStatements(&statement->do_while_loop.block, source, shift);
+            break;
+        case khAstStatementType_FOR_LOOP:
+            khAstExpression_relocate(&statement->for_loop.iteratee, source, shift);
+            relocateStatements(&statement->for_loop.block, source, shift);
+            break;
+        case khAstStatementType_RETURN:
+            relocateExpressions(&statement->return_v.values, source, shift);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void khAstExpression_decode(khAstExpression* expression) {
+    if ((expression->type != khAstExpressionType_STRING &&
+         expression->type != khAstExpressionType_BUFFER) ||
+        !isRaw(expression)) {
+        return;
+    }
+
+    // The payload takes the place of the arena
+    char32_t* begin = rawBegin(expression);
+    char32_t* end = rawEnd(expression);
+    if (expression->type == khAstExpressionType_STRING) {
+        expression->string = kh_decodeRawString(begin, end, expression->opt_raw_arena);
+    }
+    else {
+        expression->buffer = kh_decodeRawBuffer(begin, end, expression->opt_raw_arena);
+    }
+
+    khAstSource_release(expression->raw.source);
+    expression->raw = (khAstRawLiteral){.source = NULL, .begin = 0, .end = 0};
+}
+
+size_t khAstExpression_footprint(khAstExpression* expression) {
+    switch (expression->type) {
+        case khAstExpressionType_SIGNATURE:
+            return sizeof(khAstExpression) + sizeof(khArena*) + sizeof(khAstSignature);
+        case khAstExpressionType_LAMBDA:
+            return sizeof(khAstExpression) + sizeof(khArena*) + sizeof(khAstLambda);
+
+        default:
+            return sizeof(khAstExpression);
+    }
+}
+
+
+// Structural hashing and equality. Strings and buffers are compared by their payload wherever it is,
+// be it decoded or still raw in the source
+static inline void stringChars(khAstExpression* expression, char32_t** chars, size_t* size) {
+    if (isRaw(expression)) {
+        *chars = rawBegin(expression);
+        *size = expression->raw.end - expression->raw.begin;
+    }
+    else {
+        *chars = expression->string;
+        *size = khstring_size(&expression->string);
+    }
+}
+
+static inline size_t bufferSize(khAstExpression* expression) {
+    return isRaw(expression) ? (size_t)(expression->raw.end - expression->raw.begin)
+                             : khbuffer_size(&expression->buffer);
+}
+
+// Same as what `kh_decodeRawBuffer` gives
+static inline uint8_t bufferByte(khAstExpression* expression, size_t index) {
+    return isRaw(expression) ? (uint8_t)rawBegin(expression)[index] : expression->buffer[index];
+}
+
+static uint64_t hashChars(char32_t* chars, size_t size) {
+    return kh_hash(chars, size * sizeof(char32_t), 0);
+}
+
+static uint64_t hashBuffer(khAstExpression* expression) {
+    if (!isRaw(expression)) {
+        return kh_hash(expression->buffer, khbuffer_size(&expression->buffer), 0);
+    }
+    else if (expression->raw.begin == expression->raw.end) {
+        return kh_hash(NULL, 0, 0);
+    }
+
+    // The raw bytes have to be laid out the same as decoded ones to hash the same
+    size_t size = bufferSize(expression);
+    uint8_t small[256];
+    uint8_t* bytes = size <= sizeof(small) ? small : (uint8_t*)malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        bytes[i] = bufferByte(expression, i);
+    }
+
+    uint64_t hash = kh_hash(bytes, size, 0);
+    if (bytes != small) {
+        free(bytes);
+    }
+
+    return hash;
+}
+
+static uint64_t hashOptional(uint64_t hash, khAstExpression* opt_expression) {
+    return kh_combineHash(hash, opt_expression != NULL ? khAstExpression_hash(opt_expression) : 0);
+}
+
+static uint64_t hashExpressions(uint64_t hash, kharray(khAstExpression) * expressions) {
+    hash = kh_combineHash(hash, kharray_size(expressions));
+    for (size_t i = 0; i < kharray_size(expressions); i++) {
+        hash = kh_combineHash(hash, khAstExpression_hash(&(*expressions)[i]));
+    }
+
+    return hash;
+}
+
+static uint64_t hashNames(uint64_t hash, kharray(khstring) * names) {
+    hash = kh_combineHash(hash, kharray_size(names));
+    for (size_t i = 0; i < kharray_size(names); i++) {
+        hash = kh_combineHash(hash, hashChars((*names)[i], khstring_size(&(*names)[i])));
+    }
+
+    return hash;
+}
+
+// Packed values hash as the literal expressions they stand for
+static uint64_t hashValues(uint64_t hash, kharray(khAstExpression) * values,
+                           khAstPackedValues* packed) {
+    if (packed->type == khAstExpressionType_INVALID) {
+        return hashExpressions(hash, values);
+    }
+
+    size_t size = khAstPackedValues_size(packed);
+    hash = kh_combineHash(hash, size);
+    for (size_t i = 0; i < size; i++) {
+        khAstExpression value = khAstPackedValues_get(packed, i);
+        hash = kh_combineHash(hash, khAstExpression_hash(&value));
+    }
+
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, khstring* opt_string) {
+    return kh_combineHash(hash,
+                          opt_string != NULL ? hashChars(*opt_string, khstring_size(opt_string)) : 0);
+}
+
+static uint64_t hashVariable(uint64_t hash, khAstVariable* variable) {
+    hash = kh_combineHash(hash, variable->is_static);
+    hash = kh_combineHash(hash, variable->is_wild);
+    hash = kh_combineHash(hash, variable->is_ref);
+    hash = hashNames(hash, &variable->names);
+    hash = hashOptional(hash, variable->opt_type);
+    return hashOptional(hash, variable->opt_initializer);
+}
+
+static uint64_t hashVariables(uint64_t hash, kharray(khAstVariable) * variables,
+                              khAstVariable* opt_variadic_argument) {
+    hash = kh_combineHash(hash, kharray_size(variables));
+    for (size_t i = 0; i < kharray_size(variables); i++) {
+        hash = hashVariable(hash, &(*variables)[i]);
+    }
+
+    hash = kh_combineHash(hash, opt_variadic_argument != NULL);
+    return opt_variadic_argument != NULL ? hashVariable(hash, opt_variadic_argument) : hash;
+}
+
+static uint64_t hashStatement(uint64_t hash, khAstStatement* statement);
+
+static uint64_t hashStatements(uint64_t hash, kharray(khAstStatement) * statements) {
+    hash = kh_combineHash(hash, kharray_size(statements));
+    for (size_t i = 0; i < kharray_size(statements); i++) {
+        hash = hashStatement(hash, &(*statements)[i]);
+    }
+
+    return hash;
+}
+
+// A body which is yet to be parsed goes by where it is instead
+static uint64_t hashBody(uint64_t hash, kharray(khAstStatement) * block, khAstLazyBlock* lazy_block) {
+    if (lazy_block->source != NULL) {
+        hash = kh_combineHash(hash, lazy_block->begin);
+        return kh_combineHash(hash, lazy_block->end);
+    }
+
+    return hashStatements(hash, block);
+}
+
+static uint64_t hashStatement(uint64_t hash, khAstStatement* statement) {
+    hash = kh_combineHash(hash, statement->type);
+
+    switch (statement->type) {
+        case khAstStatementType_VARIABLE:
+            return hashVariable(hash, &statement->variable);
+        case khAstStatementType_EXPRESSION:
+            return kh_combineHash(hash, khAstExpression_hash(&statement->expression));
+
+        case khAstStatementType_IMPORT:
+            hash = hashNames(hash, &statement->import_v.path);
+            hash = kh_combineHash(hash, statement->import_v.relative);
+            return hashString(hash, statement->import_v.opt_alias);
+        case khAstStatementType_INCLUDE:
+            hash = hashNames(hash, &statement->include.path);
+            return kh_combineHash(hash, statement->include.relative);
+        case khAstStatementType_FUNCTION: {
+            khAstFunction* function = &statement->function;
+            hash = kh_combineHash(hash, function->is_incase);
+            hash = kh_combineHash(hash, function->is_static);
+            hash = hashNames(hash, &function->identifiers);
+            hash = hashNames(hash, &function->template_arguments);
+            hash = hashVariables(hash, &function->arguments, function->opt_variadic_argument);
+            hash = kh_combineHash(hash, function->is_return_type_ref);
+            hash = hashOptional(hash, function->opt_return_type);
+            return hashBody(hash, &function->block, &function->lazy_block);
+        }
+        case khAstStatementType_CLASS:
+            hash = kh_combineHash(hash, statement->class_v.is_incase);
+            hash = hashString(hash, &statement->class_v.name);
+            hash = hashNames(hash, &statement->class_v.template_arguments);
+            hash = hashOptional(hash, statement->class_v.opt_base_type);
+            return hashStatements(hash, &statement->class_v.block);
+        case khAstStatementType_STRUCT:
+            hash = kh_combineHash(hash, statement->struct_v.is_incase);
+            hash = hashString(hash, &statement->struct_v.name);
+            hash = hashNames(hash, &statement->struct_v.template_arguments);
+            return hashStatements(hash, &statement->struct_v.block);
+        case khAstStatementType_ENUM:
+            hash = hashString(hash, &statement->enum_v.name);
+            return hashNames(hash, &statement->enum_v.members);
+        case khAstStatementType_ALIAS:
+            hash = kh_combineHash(hash, statement->alias.is_incase);
+            hash = hashString(hash, &statement->alias.name);
+            return kh_combineHash(hash, khAstExpression_hash(&statement->alias.expression));
+
+        case khAstStatementType_IF_BRANCH: {
+            khAstIfBranch* if_branch = &statement->if_branch;
+            hash = hashExpressions(hash, &if_branch->branch_conditions);
+            for (size_t i = 0; i < kharray_size(&if_branch->branch_blocks); i++) {
+                hash = hashStatements(hash, &if_branch->branch_blocks[i]);
+            }
+            return hashStatements(hash, &if_branch->else_block);
+        }
+        case khAstStatementType_WHILE_LOOP:
+            hash = kh_combineHash(hash, khAstExpression_hash(&statement->while_loop.condition));
+            return hashStatements(hash, &statement->while_loop.block);
+        case khAstStatementType_DO_WHILE_LOOP:
+            hash = kh_combineHash(hash, khAstExpression_hash(&statement->do_while_loop.condition));
+            return hashStatements(hash, &statement->do_while_loop.block);
+        case khAstStatementType_FOR_LOOP:
+            hash = hashNames(hash, &statement->for_loop.iterators);
+            hash = kh_combineHash(hash, khAstExpression_hash(&statement->for_loop.iteratee));
+            return hashStatements(hash, &statement->for_loop.block);
+        case khAstStatementType_RETURN:
+            return hashExpressions(hash, &statement->return_v.values);
+
+        default:
+            return hash;
+    }
+}
+
+uint64_t khAstExpression_hash(khAstExpression* expression) {
+    if (expression->hash != 0) {
+        return expression->hash;
+    }
+
+    uint64_t hash = kh_combineHash(0, expression->type);
+
+    switch (expression->type) {
+        case khAstExpressionType_IDENTIFIER:
+            hash = kh_combineHash(
+                hash, hashChars(expression->identifier, khstring_size(&expression->identifier)));
+            break;
+        case khAstExpressionType_CHAR:
+            hash = kh_combineHash(hash, expression->char_v);
+            break;
+        case khAstExpressionType_STRING: {
+            char32_t* chars;
+            size_t size;
+            stringChars(expression, &chars, &size);
+            hash = kh_combineHash(hash, hashChars(chars, size));
+        } break;
+        case khAstExpressionType_BUFFER:
+            hash = kh_combineHash(hash, hashBuffer(expression));
+            break;
+        case khAstExpressionType_BYTE:
+            hash = kh_combineHash(hash, expression->byte);
+            break;
+        case khAstExpressionType_INTEGER:
+            hash = kh_combineHash(hash, (uint64_t)expression->integer);
+            break;
+        case khAstExpressionType_UINTEGER:
+            hash = kh_combineHash(hash, expression->uinteger);
+            break;
+
+        // Floating points go by their bits, the same as they're compared
+        case khAstExpressionType_FLOAT:
+        case khAstExpressionType_IFLOAT: {
+            uint32_t bits;
+            memcpy(&bits, &expression->float_v, sizeof(float));
+            hash = kh_combineHash(hash, bits);
+        } break;
+        case khAstExpressionType_DOUBLE:
+        case khAstExpressionType_IDOUBLE: {
+            uint64_t bits;
+            memcpy(&bits, &expression->double_v, sizeof(double));
+            hash = kh_combineHash(hash, bits);
+        } break;
+
+        case khAstExpressionType_TUPLE:
+            hash = hashValues(hash, &expression->tuple.values, &expression->tuple.packed);
+            break;
+        case khAstExpressionType_ARRAY:
+            hash = hashValues(hash, &expression->array.values, &expression->array.packed);
+            break;
+        case khAstExpressionType_DICT:
+            hash = hashExpressions(hash, &expression->dict.keys);
+            hash = hashExpressions(hash, &expression->dict.values);
+            break;
+
+        case khAstExpressionType_SIGNATURE: {
+            khAstSignature* signature = expression->signature;
+            hash = kh_combineHash(hash, kharray_size(&signature->argument_types));
+            for (size_t i = 0; i < kharray_size(&signature->argument_types); i++) {
+                hash = kh_combineHash(hash, signature->are_arguments_refs[i]);
+                hash = kh_combineHash(hash, khAstExpression_hash(&signature->argument_types[i]));
+            }
+            hash = kh_combineHash(hash, signature->is_return_type_ref);
+            hash = hashOptional(hash, signature->opt_return_type);
         } break;
+        case khAstExpressionType_LAMBDA: {
+            khAstLambda* lambda = expression->lambda;
+            hash = hashVariables(hash, &lambda->arguments, lambda->opt_variadic_argument);
+            hash = kh_combineHash(hash, lambda->is_return_type_ref);
+            hash = hashOptional(hash, lambda->opt_return_type);
+            hash = hashBody(hash, &lambda->block, &lambda->lazy_block);
+        } break;
+
+        case khAstExpressionType_UNARY:
+            hash = kh_combineHash(hash, expression->unary.type);
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->unary.operand));
+            break;
+        case khAstExpressionType_BINARY:
+            hash = kh_combineHash(hash, expression->binary.type);
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->binary.left));
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->binary.right));
+            break;
+        case khAstExpressionType_TERNARY:
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->ternary.condition));
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->ternary.value));
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->ternary.otherwise));
+            break;
+        case khAstExpressionType_COMPARISON: {
+            khAstComparisonExpression* comparison = &expression->comparison;
+            hash = kh_combineHash(hash, kharray_size(&comparison->operations));
+            for (size_t i = 0; i < kharray_size(&comparison->operations); i++) {
+                hash = kh_combineHash(hash, comparison->operations[i]);
+            }
+            hash = hashExpressions(hash, &comparison->operands);
+        } break;
+        case khAstExpressionType_CALL:
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->call.callee));
+            hash = hashExpressions(hash, &expression->call.arguments);
+            break;
+        case khAstExpressionType_INDEX:
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->index.indexee));
+            hash = hashExpressions(hash, &expression->index.arguments);
+            break;
+
+        case khAstExpressionType_SCOPE:
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->scope.value));
+            hash = hashNames(hash, &expression->scope.scope_names);
+            break;
+        case khAstExpressionType_TEMPLATIZE:
+            hash = kh_combineHash(hash, khAstExpression_hash(expression->templatize.value));
+            hash = hashExpressions(hash, &expression->templatize.template_arguments);
+            break;
+
+        default:
+            break;
+    }
+
+    // Zero is left to mean that it's not computed yet
+    expression->hash = hash != 0 ? hash : 1;
+    return expression->hash;
+}
+
+static inline bool charsEqual(char32_t* a, size_t a_size, char32_t* b, size_t b_size) {
+    return a_size == b_size && memcmp(a, b, a_size * sizeof(char32_t)) == 0;
+}
+
+static bool optionalEqual(khAstExpression* opt_a, khAstExpression* opt_b) {
+    return opt_a == NULL || opt_b == NULL ? opt_a == opt_b : khAstExpression_equal(opt_a, opt_b);
+}
+
+static bool expressionsEqual(kharray(khAstExpression) * a, kharray(khAstExpression) * b) {
+    if (kharray_size(a) != kharray_size(b)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < kharray_size(a); i++) {
+        if (!khAstExpression_equal(&(*a)[i], &(*b)[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool namesEqual(kharray(khstring) * a, kharray(khstring) * b) {
+    if (kharray_size(a) != kharray_size(b)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < kharray_size(a); i++) {
+        if (!khstring_equal(&(*a)[i], &(*b)[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool valuesEqual(kharray(khAstExpression) * a_values, khAstPackedValues* a_packed,
+                        kharray(khAstExpression) * b_values, khAstPackedValues* b_packed) {
+    bool a_is_packed = a_packed->type != khAstExpressionType_INVALID;
+    bool b_is_packed = b_packed->type != khAstExpressionType_INVALID;
+    size_t size = a_is_packed ? khAstPackedValues_size(a_packed) : kharray_size(a_values);
+    if (size != (b_is_packed ? khAstPackedValues_size(b_packed) : kharray_size(b_values))) {
+        return false;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        khAstExpression a_value, b_value;
+        if (a_is_packed) {
+            a_value = khAstPackedValues_get(a_packed, i);
+        }
+        if (b_is_packed) {
+            b_value = khAstPackedValues_get(b_packed, i);
+        }
+
+        if (!khAstExpression_equal(a_is_packed ? &a_value : &(*a_values)[i],
+                                   b_is_packed ? &b_value : &(*b_values)[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool stringsEqual(khstring* opt_a, khstring* opt_b) {
+    return opt_a == NULL || opt_b == NULL ? opt_a == opt_b : khstring_equal(opt_a, opt_b);
+}
+
+static bool variableEqual(khAstVariable* a, khAstVariable* b) {
+    return a->is_static == b->is_static && a->is_wild == b->is_wild && a->is_ref == b->is_ref &&
+           namesEqual(&a->names, &b->names) && optionalEqual(a->opt_type, b->opt_type) &&
+           optionalEqual(a->opt_initializer, b->opt_initializer);
+}
+
+static bool variablesEqual(kharray(khAstVariable) * a, khAstVariable* opt_a_variadic,
+                           kharray(khAstVariable) * b, khAstVariable* opt_b_variadic) {
+    if (kharray_size(a) != kharray_size(b)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < kharray_size(a); i++) {
+        if (!variableEqual(&(*a)[i], &(*b)[i])) {
+            return false;
+        }
+    }
+
+    if (opt_a_variadic == NULL || opt_b_variadic == NULL) {
+        return opt_a_variadic == opt_b_variadic;
+    }
+
+    return variableEqual(opt_a_variadic, opt_b_variadic);
+}
+
+static bool statementsEqual(kharray(khAstStatement) * a, kharray(khAstStatement) * b);
+
+// Bodies which are yet to be parsed are only the same as one over the same source
+static bool bodiesEqual(kharray(khAstStatement) * a_block, khAstLazyBlock* a_lazy_block,
+                        kharray(khAstStatement) * b_block, khAstLazyBlock* b_lazy_block) {
+    if (a_lazy_block->source != NULL || b_lazy_block->source != NULL) {
+        return a_lazy_block->source != NULL && b_lazy_block->source != NULL &&
+               a_lazy_block->source->string == b_lazy_block->source->string &&
+               a_lazy_block->begin == b_lazy_block->begin && a_lazy_block->end == b_lazy_block->end;
+    }
+
+    return statementsEqual(a_block, b_block);
+}
+
+static bool statementEqual(khAstStatement* a, khAstStatement* b) {
+    if (a->type != b->type) {
+        return false;
+    }
+
+    switch (a->type) {
+        case khAstStatementType_VARIABLE:
+            return variableEqual(&a->variable, &b->variable);
+        case khAstStatementType_EXPRESSION:
+            return khAstExpression_equal(&a->expression, &b->expression);
+
+        case khAstStatementType_IMPORT:
+            return namesEqual(&a->import_v.path, &b->import_v.path) &&
+                   a->import_v.relative == b->import_v.relative &&
+                   stringsEqual(a->import_v.opt_alias, b->import_v.opt_alias);
+        case khAstStatementType_INCLUDE:
+            return namesEqual(&a->include.path, &b->include.path) &&
+                   a->include.relative == b->include.relative;
+        case khAstStatementType_FUNCTION: {
+            khAstFunction* a_function = &a->function;
+            khAstFunction* b_function = &b->function;
+            return a_function->is_incase == b_function->is_incase &&
+                   a_function->is_static == b_function->is_static &&
+                   namesEqual(&a_function->identifiers, &b_function->identifiers) &&
+                   namesEqual(&a_function->template_arguments, &b_function->template_arguments) &&
+                   variablesEqual(&a_function->arguments, a_function->opt_variadic_argument,
+                                  &b_function->arguments, b_function->opt_variadic_argument) &&
+                   a_function->is_return_type_ref == b_function->is_return_type_ref &&
+                   optionalEqual(a_function->opt_return_type, b_function->opt_return_type) &&
+                   bodiesEqual(&a_function->block, &a_function->lazy_block, &b_function->block,
+                               &b_function->lazy_block);
+        }
+        case khAstStatementType_CLASS:
+            return a->class_v.is_incase == b->class_v.is_incase &&
+                   khstring_equal(&a->class_v.name, &b->class_v.name) &&
+                   namesEqual(&a->class_v.template_arguments, &b->class_v.template_arguments) &&
+                   optionalEqual(a->class_v.opt_base_type, b->class_v.opt_base_type) &&
+                   statementsEqual(&a->class_v.block, &b->class_v.block);
+        case khAstStatementType_STRUCT:
+            return a->struct_v.is_incase == b->struct_v.is_incase &&
+                   khstring_equal(&a->struct_v.name, &b->struct_v.name) &&
+                   namesEqual(&a->struct_v.template_arguments, &b->struct_v.template_arguments) &&
+                   statementsEqual(&a->struct_v.block, &b->struct_v.block);
+        case khAstStatementType_ENUM:
+            return khstring_equal(&a->enum_v.name, &b->enum_v.name) &&
+                   namesEqual(&a->enum_v.members, &b->enum_v.members);
+        case khAstStatementType_ALIAS:
+            return a->alias.is_incase == b->alias.is_incase &&
+                   khstring_equal(&a->alias.name, &b->alias.name) &&
+                   khAstExpression_equal(&a->alias.expression, &b->alias.expression);
+
+        case khAstStatementType_IF_BRANCH: {
+            khAstIfBranch* a_if_branch = &a->if_branch;
+            khAstIfBranch* b_if_branch = &b->if_branch;
+            if (!expressionsEqual(&a_if_branch->branch_conditions, &b_if_branch->branch_conditions)) {
+                return false;
+            }
+            for (size_t i = 0; i < kharray_size(&a_if_branch->branch_blocks); i++) {
+                if (!statementsEqual(&a_if_branch->branch_blocks[i], &b_if_branch->branch_blocks[i])) {
+                    return false;
+                }
+            }
+            return statementsEqual(&a_if_branch->else_block, &b_if_branch->else_block);
+        }
+        case khAstStatementType_WHILE_LOOP:
+            return khAstExpression_equal(&a->while_loop.condition, &b->while_loop.condition) &&
+                   statementsEqual(&a->while_loop.block, &b->while_loop.block);
+        case khAstStatementType_DO_WHILE_LOOP:
+            return khAstExpression_equal(&a->do_while_loop.condition, &b->do_while_loop.condition) &&
+                   statementsEqual(&a->do_while_loop.block, &b->do_while_loop.block);
+        case khAstStatementType_FOR_LOOP:
+            return namesEqual(&a->for_loop.iterators, &b->for_loop.iterators) &&
+                   khAstExpression_equal(&a->for_loop.iteratee, &b->for_loop.iteratee) &&
+                   statementsEqual(&a->for_loop.block, &b->for_loop.block);
+        case khAstStatementType_RETURN:
+            return expressionsEqual(&a->return_v.values, &b->return_v.values);
 
         default:
-            khstring_concatenateCstring(&string, U"null");
+            return true;
+    }
+}
+
+static bool statementsEqual(kharray(khAstStatement) * a, kharray(khAstStatement) * b) {
+    if (kharray_size(a) != kharray_size(b)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < kharray_size(a); i++) {
+        if (!statementEqual(&(*a)[i], &(*b)[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool khAstExpression_equal(khAstExpression* a, khAstExpression* b) {
+    if (a == b) {
+        return true;
+    }
+    if (a->type != b->type || khAstExpression_hash(a) != khAstExpression_hash(b)) {
+        return false;
+    }
+
+    switch (a->type) {
+        case khAstExpressionType_IDENTIFIER:
+            return khstring_equal(&a->identifier, &b->identifier);
+        case khAstExpressionType_CHAR:
+            return a->char_v == b->char_v;
+        case khAstExpressionType_STRING: {
+            char32_t *a_chars, *b_chars;
+            size_t a_size, b_size;
+            stringChars(a, &a_chars, &a_size);
+            stringChars(b, &b_chars, &b_size);
+            return charsEqual(a_chars, a_size, b_chars, b_size);
+        }
+        case khAstExpressionType_BUFFER: {
+            size_t size = bufferSize(a);
+            if (size != bufferSize(b)) {
+                return false;
+            }
+            for (size_t i = 0; i < size; i++) {
+                if (bufferByte(a, i) != bufferByte(b, i)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case khAstExpressionType_BYTE:
+            return a->byte == b->byte;
+        case khAstExpressionType_INTEGER:
+            return a->integer == b->integer;
+        case khAstExpressionType_UINTEGER:
+            return a->uinteger == b->uinteger;
+        case khAstExpressionType_FLOAT:
+        case khAstExpressionType_IFLOAT:
+            return memcmp(&a->float_v, &b->float_v, sizeof(float)) == 0;
+        case khAstExpressionType_DOUBLE:
+        case khAstExpressionType_IDOUBLE:
+            return memcmp(&a->double_v, &b->double_v, sizeof(double)) == 0;
+
+        case khAstExpressionType_TUPLE:
+            return valuesEqual(&a->tuple.values, &a->tuple.packed, &b->tuple.values, &b->tuple.packed);
+        case khAstExpressionType_ARRAY:
+            return valuesEqual(&a->array.values, &a->array.packed, &b->array.values, &b->array.packed);
+        case khAstExpressionType_DICT:
+            return expressionsEqual(&a->dict.keys, &b->dict.keys) &&
+                   expressionsEqual(&a->dict.values, &b->dict.values);
+
+        case khAstExpressionType_SIGNATURE: {
+            khAstSignature* a_signature = a->signature;
+            khAstSignature* b_signature = b->signature;
+            if (kharray_size(&a_signature->are_arguments_refs) !=
+                    kharray_size(&b_signature->are_arguments_refs) ||
+                a_signature->is_return_type_ref != b_signature->is_return_type_ref) {
+                return false;
+            }
+            for (size_t i = 0; i < kharray_size(&a_signature->are_arguments_refs); i++) {
+                if (a_signature->are_arguments_refs[i] != b_signature->are_arguments_refs[i]) {
+                    return false;
+                }
+            }
+            return expressionsEqual(&a_signature->argument_types, &b_signature->argument_types) &&
+                   optionalEqual(a_signature->opt_return_type, b_signature->opt_return_type);
+        }
+        case khAstExpressionType_LAMBDA: {
+            khAstLambda* a_lambda = a->lambda;
+            khAstLambda* b_lambda = b->lambda;
+            return variablesEqual(&a_lambda->arguments, a_lambda->opt_variadic_argument,
+                                  &b_lambda->arguments, b_lambda->opt_variadic_argument) &&
+                   a_lambda->is_return_type_ref == b_lambda->is_return_type_ref &&
+                   optionalEqual(a_lambda->opt_return_type, b_lambda->opt_return_type) &&
+                   bodiesEqual(&a_lambda->block, &a_lambda->lazy_block, &b_lambda->block,
+                               &b_lambda->lazy_block);
+        }
+
+        case khAstExpressionType_UNARY:
+            return a->unary.type == b->unary.type &&
+                   khAstExpression_equal(a->unary.operand, b->unary.operand);
+        case khAstExpressionType_BINARY:
+            return a->binary.type == b->binary.type &&
+                   khAstExpression_equal(a->binary.left, b->binary.left) &&
+                   khAstExpression_equal(a->binary.right, b->binary.right);
+        case khAstExpressionType_TERNARY:
+            return khAstExpression_equal(a->ternary.condition, b->ternary.condition) &&
+                   khAstExpression_equal(a->ternary.value, b->ternary.value) &&
+                   khAstExpression_equal(a->ternary.otherwise, b->ternary.otherwise);
+        case khAstExpressionType_COMPARISON: {
+            kharray(khAstComparisonExpressionType)* a_operations = &a->comparison.operations;
+            kharray(khAstComparisonExpressionType)* b_operations = &b->comparison.operations;
+            if (kharray_size(a_operations) != kharray_size(b_operations)) {
+                return false;
+            }
+            for (size_t i = 0; i < kharray_size(a_operations); i++) {
+                if ((*a_operations)[i] != (*b_operations)[i]) {
+                    return false;
+                }
+            }
+            return expressionsEqual(&a->comparison.operands, &b->comparison.operands);
+        }
+        case khAstExpressionType_CALL:
+            return khAstExpression_equal(a->call.callee, b->call.callee) &&
+                   expressionsEqual(&a->call.arguments, &b->call.arguments);
+        case khAstExpressionType_INDEX:
+            return khAstExpression_equal(a->index.indexee, b->index.indexee) &&
+                   expressionsEqual(&a->index.arguments, &b->index.arguments);
+
+        case khAstExpressionType_SCOPE:
+            return khAstExpression_equal(a->scope.value, b->scope.value) &&
+                   namesEqual(&a->scope.scope_names, &b->scope.scope_names);
+        case khAstExpressionType_TEMPLATIZE:
+            return khAstExpression_equal(a->templatize.value, b->templatize.value) &&
+                   expressionsEqual(&a->templatize.template_arguments,
+                                    &b->templatize.template_arguments);
+
+        default:
+            return true;
+    }
+}
+
+
+khAstInterner khAstInterner_new(void) {
+    khAstInterner interner = {.slots = kharray_new(khAstExpression*, NULL), .count = 0};
+    kharray_reserve(&interner.slots, 64);
+    for (size_t i = 0; i < 64; i++) {
+        kharray_append(&interner.slots, NULL);
+    }
+
+    return interner;
+}
+
+void khAstInterner_delete(khAstInterner* interner) {
+    kharray_delete(&interner->slots);
+}
+
+// Slot of the node equal to the expression, or of the empty one where it'd go. The table is kept at
+// most half full, so there's always an empty slot to stop at
+static inline size_t findSlot(khAstInterner* interner, khAstExpression* expression) {
+    size_t mask = kharray_size(&interner->slots) - 1;
+    size_t slot = khAstExpression_hash(expression) & mask;
+
+    while (interner->slots[slot] != NULL && !khAstExpression_equal(interner->slots[slot], expression)) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+khAstExpression* khAstInterner_intern(khAstInterner* interner, khAstExpression* expression) {
+    size_t slot = findSlot(interner, expression);
+    if (interner->slots[slot] != NULL) {
+        return interner->slots[slot];
+    }
+
+    interner->slots[slot] = expression;
+    interner->count++;
+
+    // Grows by doubling, going through the hashes which the nodes already have
+    if (interner->count * 2 > kharray_size(&interner->slots)) {
+        kharray(khAstExpression*) old_slots = interner->slots;
+        size_t size = kharray_size(&old_slots) * 2;
+
+        interner->slots = kharray_new(khAstExpression*, NULL);
+        kharray_reserve(&interner->slots, size);
+        for (size_t i = 0; i < size; i++) {
+            kharray_append(&interner->slots, NULL);
+        }
+
+        for (size_t i = 0; i < kharray_size(&old_slots); i++) {
+            if (old_slots[i] != NULL) {
+                size_t mask = size - 1;
+                size_t new_slot = old_slots[i]->hash & mask;
+                while (interner->slots[new_slot] != NULL) {
+                    new_slot = (new_slot + 1) & mask;
+                }
+                interner->slots[new_slot] = old_slots[i];
+            }
+        }
+
+        kharray_delete(&old_slots);
     }
 
-    khstring_concatenateCstring(&string, U"}");
-    return string;
+    return expression;
 }
@@ -0,0 +1,258 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#include <stdatomic.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include <kithare/core/cache.h>
+#include <kithare/core/error.h>
+#include <kithare/core/flat.h>
+#include <kithare/core/info.h>
+#include <kithare/core/lexer.h>
+#include <kithare/core/parser.h>
+#include <kithare/lib/hash.h>
+#include <kithare/lib/io.h>
+#include <kithare/lib/varint.h>
+
+
+typedef enum { khCacheKind_TOKENS, khCacheKind_AST } khCacheKind;
+
+// An entry is the magic, a hash of everything after it, then the size of the string and the errors as
+// varints, each being its type, its offset in the string plus one (or 0 without one) and its message.
+// The encoded result takes up the rest
+static const char magic[] = "khce";
+#define MAGIC_SIZE (sizeof(magic) - 1)
+
+// Tells apart the temporary files of the threads of a process
+static atomic_size_t temporary_count = 0;
+
+
+static khstring entryPath(khstring* string, khstring* cache_directory, khCacheKind kind) {
+    uint64_t seed = kh_hash(kh_VERSION_STR, strlen(kh_VERSION_STR), kind);
+    seed = kh_hash(&(uint32_t[]){kh_FLAT_FORMAT_VERSION, kh_TOKEN_FORMAT_VERSION}, 2 * sizeof(uint32_t),
+                   seed);
+    uint64_t key = kh_hash(*string, khstring_size(string) * sizeof(char32_t), seed);
+
+    khstring path = khstring_copy(cache_directory);
+    khstring_append(&path, U'/');
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        uint8_t digit = (key >> shift) & 0xF;
+        khstring_append(&path, digit < 10 ? U'0' + digit : U'a' + digit - 10);
+    }
+    khstring_concatenateCstring(&path, kind == khCacheKind_AST ? U".khast" : U".khtk");
+
+    return path;
+}
+
+// Gives the encoded result, or NULL if there's no valid entry. The errors of the entry are only raised
+// once the result has been decoded too
+static uint8_t* readEntry(khbuffer* entry, khstring* path, khstring* string,
+                          kharray(khError) * errors) {
+    bool exists;
+    *entry = kh_readFile(path, &exists);
+    if (!exists || khbuffer_size(entry) < MAGIC_SIZE + sizeof(uint64_t) ||
+        memcmp(*entry, magic, MAGIC_SIZE) != 0) {
+        return NULL;
+    }
+
+    // Anything torn or corrupted is caught here, so the rest can trust the contents
+    uint64_t checksum;
+    memcpy(&checksum, *entry + MAGIC_SIZE, sizeof(uint64_t));
+    uint8_t* contents = *entry + MAGIC_SIZE + sizeof(uint64_t);
+    size_t size = khbuffer_size(entry) - MAGIC_SIZE - sizeof(uint64_t);
+    if (kh_hash(contents, size, 0) != checksum) {
+        return NULL;
+    }
+
+    khVarintReader reader = khVarintReader_new(contents, size);
+    if (khVarintReader_get(&reader, UINT64_MAX) != khstring_size(string)) {
+        return NULL;
+    }
+
+    size_t count = khVarintReader_count(&reader);
+    for (size_t i = 0; i < count && reader.valid; i++) {
+        khErrorType type = khVarintReader_get(&reader, khErrorType_UNSPECIFIED);
+        size_t offset = khVarintReader_get(&reader, khstring_size(string) + 1);
+        size_t message_size = khVarintReader_count(&reader);
+
+        khstring message = khstring_new(U"");
+        kharray_reserve(&message, message_size);
+        for (size_t j = 0; j < message_size; j++) {
+            khstring_append(&message, khVarintReader_get(&reader, UINT32_MAX));
+        }
+
+        size_t offset_in = offset > 0 ? offset - 1 : 0;
+        kharray_append(errors, ((khError){.type = type, .message = message, .offset = offset_in}));
+    }
+
+    return reader.valid ? reader.cursor : NULL;
+}
+
+static void raiseErrors(kharray(khError) * errors) {
+    for (size_t i = 0; i < kharray_size(errors); i++) {
+        kh_raiseError(khError_move(&(*errors)[i]));
+    }
+    kharray_delete(errors);
+}
+
+// Makes the directory along with any of its parents which are missing
+static void makeDirectories(khstring* path) {
+    for (size_t i = 1; i < khstring_size(path); i++) {
+        if ((*path)[i] == U'/' || (*path)[i] == U'\\') {
+            khstring parent = khstring_new(U"");
+            kharray_memory(&parent, *path, i, NULL);
+            kh_makeDirectory(&parent);
+            khstring_delete(&parent);
+        }
+    }
+
+    kh_makeDirectory(path);
+}
+
+static void writeEntry(khstring* path, khstring* cache_directory, khstring* string, size_t first_error,
+                       khbuffer* result) {
+    // Once the errors have been capped, some of the ones for this string may have been left out
+    kharray(khError)* errors = kh_getErrors();
+    if (kharray_size(errors) >= kh_MAX_ERRORS) {
+        return;
+    }
+
+    // The checksum gets filled in once everything else is there
+    khbuffer entry = khbuffer_new(magic);
+    khbuffer_reserve(&entry, MAGIC_SIZE + sizeof(uint64_t) + khbuffer_size(result) + 64);
+    for (size_t i = 0; i < sizeof(uint64_t); i++) {
+        khbuffer_append(&entry, 0);
+    }
+
+    kh_putVarint(&entry, khstring_size(string));
+
+    // Only the errors raised while getting the result
+    kh_putVarint(&entry, kharray_size(errors) - first_error);
+    for (khError* error = *errors + first_error; error < *errors + kharray_size(errors); error++) {
+        kh_putVarint(&entry, error->type);
+        kh_putVarint(&entry, error->offset <= khstring_size(string) ? error->offset + 1 : 0);
+        kh_putVarint(&entry, khstring_size(&error->message));
+        for (size_t i = 0; i < khstring_size(&error->message); i++) {
+            kh_putVarint(&entry, error->message[i]);
+        }
+    }
+
+    khbuffer_concatenate(&entry, result);
+
+    uint8_t* contents = entry + MAGIC_SIZE + sizeof(uint64_t);
+    uint64_t checksum = kh_hash(contents, khbuffer_size(&entry) - MAGIC_SIZE - sizeof(uint64_t), 0);
+    memcpy(entry + MAGIC_SIZE, &checksum, sizeof(uint64_t));
+
+    // Named uniquely among processes and their threads, then moved in place all at once
+    khstring temporary_path = khstring_copy(path);
+    khstring_append(&temporary_path, U'.');
+    khstring pid_str = kh_uintToString(getpid(), 10);
+    khstring_concatenate(&temporary_path, &pid_str);
+    khstring_delete(&pid_str);
+    khstring_append(&temporary_path, U'-');
+    khstring count_str = kh_uintToString(atomic_fetch_add(&temporary_count, 1), 10);
+    khstring_concatenate(&temporary_path, &count_str);
+    khstring_delete(&count_str);
+    khstring_concatenateCstring(&temporary_path, U".tmp");
+
+    bool written = kh_writeFile(&temporary_path, &entry);
+    // Another process may have made the directory in the meantime, so it's retried either way
+    if (!written) {
+        makeDirectories(cache_directory);
+        written = kh_writeFile(&temporary_path, &entry);
+    }
+
+    // Another process may have just written the very same entry, in which case either one does
+    if (!written || !kh_moveFile(&temporary_path, path)) {
+        kh_removeFile(&temporary_path);
+    }
+
+    khstring_delete(&temporary_path);
+    khbuffer_delete(&entry);
+}
+
+
+kharray(khToken) kh_lexicateCached(khstring* string, khstring* cache_directory) {
+    khstring path = entryPath(string, cache_directory, khCacheKind_TOKENS);
+    kharray(khError) errors = kharray_new(khError, khError_delete);
+    khbuffer entry;
+    uint8_t* result = readEntry(&entry, &path, string, &errors);
+
+    if (result != NULL) {
+        bool success;
+        size_t size = entry + khbuffer_size(&entry) - result;
+        kharray(khToken) tokens = kh_decodeTokens(result, size, khstring_size(string), &success);
+        if (success) {
+            raiseErrors(&errors);
+            khbuffer_delete(&entry);
+            khstring_delete(&path);
+            return tokens;
+        }
+        kharray_delete(&tokens);
+    }
+    kharray_delete(&errors);
+    khbuffer_delete(&entry);
+
+    size_t first_error = kh_hasErrors();
+    kharray(khToken) tokens = kh_lexicate(string);
+    khbuffer encoded = kh_encodeTokens(&tokens);
+    writeEntry(&path, cache_directory, string, first_error, &encoded);
+
+    khbuffer_delete(&encoded);
+    khstring_delete(&path);
+    return tokens;
+}
+
+kharray(khAstStatement) kh_parseCached(khstring* string, khstring* cache_directory, size_t workers,
+                                       khLineIndex* opt_lines) {
+    khstring path = entryPath(string, cache_directory, khCacheKind_AST);
+    kharray(khError) errors = kharray_new(khError, khError_delete);
+    khbuffer entry;
+    uint8_t* result = readEntry(&entry, &path, string, &errors);
+
+    if (result != NULL) {
+        bool success;
+        khFlatAst flat = khFlatAst_decode(result, entry + khbuffer_size(&entry) - result,
+                                          khstring_size(string), &success);
+        if (success) {
+            kharray(khAstStatement) ast = khFlatAst_unflatten(&flat, *string);
+            if (opt_lines != NULL) {
+                khLineIndex_addRange(opt_lines, 0, khstring_size(string));
+            }
+            raiseErrors(&errors);
+            khFlatAst_delete(&flat);
+            khbuffer_delete(&entry);
+            khstring_delete(&path);
+            return ast;
+        }
+        khFlatAst_delete(&flat);
+    }
+    kharray_delete(&errors);
+    khbuffer_delete(&entry);
+
+    size_t first_error = kh_hasErrors();
+    kharray(khAstStatement) ast = kh_parseParallel(string, NULL, workers, opt_lines);
+    khFlatAst flat = khFlatAst_new(&ast);
+
+    // An entry which couldn't be read back would only make every hit parse again
+    if (khFlatAst_check(&flat, khstring_size(string))) {
+        khbuffer encoded = khFlatAst_encode(&flat);
+        writeEntry(&path, cache_directory, string, first_error, &encoded);
+        khbuffer_delete(&encoded);
+    }
+
+    khFlatAst_delete(&flat);
+    khstring_delete(&path);
+    return ast;
+}
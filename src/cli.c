@@ -5,7 +5,8 @@
  * Copyright (C) 2022 Kithare Organization
  */
 
-#include <locale.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -13,24 +14,80 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <unistd.h>
 #endif
 
 #include <kithare/core/ast.h>
+#include <kithare/core/cache.h>
 #include <kithare/core/info.h>
 #include <kithare/core/lexer.h>
+#include <kithare/core/lines.h>
 #include <kithare/core/parser.h>
+#include <kithare/core/pipe.h>
+#include <kithare/core/query.h>
+#include <kithare/core/walker.h>
 
 #include <kithare/lib/ansi.h>
 #include <kithare/lib/array.h>
 #include <kithare/lib/buffer.h>
 #include <kithare/lib/io.h>
 #include <kithare/lib/string.h>
+#include <kithare/lib/writer.h>
 
 
 static int argi = 1;
 static kharray(khstring) args = NULL;
 
 
+// Writes the raised errors as JSON objects, then flushes them. Returns the amount of errors
+static size_t writeErrors(khWriter* writer, khLineIndex* lines) {
+    size_t errors = kh_hasErrors();
+    for (size_t i = 0; i < errors; i++) {
+        khError* error = &(*kh_getErrors())[i];
+        khSourcePosition position = khLineIndex_position(lines, error->offset);
+
+        khWriter_cstring(writer, U"{\"index\": ");
+        khWriter_uint(writer, error->offset, 10);
+        khWriter_cstring(writer, U", \"line\": ");
+        khWriter_uint(writer, position.line, 10);
+        khWriter_cstring(writer, U", \"column\": ");
+        khWriter_uint(writer, position.column, 10);
+        khWriter_cstring(writer, U", \"message\": ");
+        khWriter_quote(writer, &error->message);
+        khWriter_char(writer, U'}');
+
+        khWriter_cstring(writer, i < errors - 1 ? U",\n" : U"\n");
+    }
+
+    kh_flushErrors();
+    return errors;
+}
+
+// Amount of processors online, which the work can be split between
+static size_t processorCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? count : 1;
+#endif
+}
+
+// Takes out the `--pipelined` flag if it's the last argument, returning whether it was there
+static bool takePipelinedFlag(void) {
+    size_t last = kharray_size(&args) - 1;
+    if (last < (size_t)argi || !khstring_equalCstring(&args[last], U"--pipelined")) {
+        return false;
+    }
+
+    kharray_pop(&args, 1);
+    return true;
+}
+
+
 static int help(void) {
     puts(kh_ANSI_BOLD "Kithare programming language Compiler and Runtime (kcr) " kh_VERSION_STR);
     puts(kh_ANSI_RESET "Copyright (C) 2022 Kithare Organization at " kh_ANSI_FG_CYAN kh_ANSI_UNDERLINE
@@ -45,13 +102,20 @@ static int help(void) {
          " : builds and runs source file on debug mode for debugging.");
     puts("    " kh_ANSI_BOLD "kcr build <file.kh> [executable.exe]" kh_ANSI_RESET
          " : builds source file.");
-    puts("    " kh_ANSI_BOLD "kcr lexicate <file.kh>" kh_ANSI_RESET
-         " : lexicates source file into tokens.");
-    puts("    " kh_ANSI_BOLD "kcr parse <file.kh>" kh_ANSI_RESET
-         " : parses source file into an AST tree.");
+    puts("    " kh_ANSI_BOLD "kcr lexicate <file.kh> [cache directory] [--pipelined]" kh_ANSI_RESET
+         " : lexicates source file into tokens, reusing them from the cache if given.");
+    puts("    " kh_ANSI_BOLD "kcr parse <file.kh> [cache directory] [--pipelined]" kh_ANSI_RESET
+         " : parses source file into an AST tree, reusing it from the cache if given.");
+    puts("    " kh_ANSI_BOLD "kcr measure <file.kh> [... files]" kh_ANSI_RESET
+         " : parses source files and reports the memory taken by each kind of AST node.");
+    puts("    " kh_ANSI_BOLD "kcr query <pattern> <file.kh> [... files]" kh_ANSI_RESET
+         " : finds the AST nodes matching the pattern, such as `call[name=print]`, in source files.");
     puts("    " kh_ANSI_BOLD "kcr semantic <file.kh>" kh_ANSI_RESET
          " : semantically analyze source file into a semantic graph.");
 
+    puts("\n`" kh_ANSI_BOLD "--pipelined" kh_ANSI_RESET
+         "` lexes on a separate thread, while the tokens are written or parsed, when not cached.");
+
     puts("\n`" kh_ANSI_BOLD "[...]" kh_ANSI_RESET "` arguments are optional. `" kh_ANSI_BOLD
          "<...>" kh_ANSI_RESET "` arguments are required input arguments.");
 
@@ -79,14 +143,14 @@ static int build(void) {
 }
 
 static int lexicate(void) {
+    bool is_pipelined = takePipelinedFlag();
     if (argi >= kharray_size(&args)) {
         fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "missing required argument: " kh_ANSI_RESET "file\n", stderr);
         return 1;
     }
-    else if (kharray_size(&args) > 3) {
+    else if (kharray_size(&args) > 4) {
         fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "too many arguments; " kh_ANSI_RESET kh_ANSI_BOLD
-                                          "lexicate" kh_ANSI_RESET
-                                          " only requires exactly 1 argument.\n",
+                                          "lexicate" kh_ANSI_RESET " only takes up to 2 arguments.\n",
               stderr);
         return 1;
     }
@@ -106,65 +170,67 @@ static int lexicate(void) {
         return 1;
     }
 
-    puts("{");
-    puts("\"tokens\": [");
-
-    // Print tokens
-    kharray(khToken) tokens = kh_lexicate(&content);
-    for (size_t i = 0; i < kharray_size(&tokens); i++) {
-        khstring token_str = khToken_string(&(tokens[i]), content);
-        kh_put(&token_str, stdout);
-        khstring_delete(&token_str);
-
-        if (i < kharray_size(&tokens) - 1) {
-            printf(",\n");
+    // Everything is streamed through a single writer, so the output never builds up in memory
+    khWriter writer = khWriter_newStream(stdout);
+    khWriter_cstring(&writer, U"{\n\"tokens\": [\n");
+
+    if (argi < kharray_size(&args)) {
+        khLineIndex lines = khLineIndex_newEmpty(&content);
+        kharray(khToken) tokens = kh_lexicateCached(&content, &args[argi]);
+        for (size_t i = 0; i < kharray_size(&tokens); i++) {
+            khToken_write(&tokens[i], &writer, content);
+            khWriter_cstring(&writer, i < kharray_size(&tokens) - 1 ? U",\n" : U"\n");
+            khLineIndex_addToken(&lines, &tokens[i]);
         }
-        else {
-            printf("\n");
-        }
-    }
+        kharray_delete(&tokens);
 
-    puts("],");
-    puts("\"errors\": [");
+        khWriter_cstring(&writer, U"],\n\"errors\": [\n");
 
-    // Print errors
-    size_t errors = kh_hasErrors();
-    for (size_t i = 0; i < errors; i++) {
-        khError* error = &(*kh_getErrors())[i];
-        khstring message = khstring_quote(&error->message);
+        size_t errors = writeErrors(&writer, &lines);
+        khLineIndex_delete(&lines);
+        khWriter_cstring(&writer, U"]\n}\n");
+        khWriter_delete(&writer);
 
-        printf("{\"index\": %lu, \"message\": ", (unsigned long)((char32_t*)error->data - content));
-        kh_put(&message, stdout);
-        printf("}");
+        khstring_delete(&content);
+        return errors;
+    }
 
-        khstring_delete(&message);
+    // Write tokens, while the next ones are being lexed on a separate thread if pipelined
+    khTokenPipe* pipe = khTokenPipe_new(&content, is_pipelined);
+    khLineIndex lines = khLineIndex_newEmpty(&content);
+    khToken token = khTokenPipe_next(pipe);
+    while (token.type != khTokenType_EOF) {
+        khToken_write(&token, &writer, content);
 
-        if (i < errors - 1) {
-            printf(",\n");
-        }
-        else {
-            printf("\n");
-        }
+        khLineIndex_addToken(&lines, &token);
+        khToken_delete(&token);
+
+        token = khTokenPipe_next(pipe);
+        khWriter_cstring(&writer, token.type != khTokenType_EOF ? U",\n" : U"\n");
     }
+    khTokenPipe_delete(pipe);
 
-    kh_flushErrors();
-    puts("]");
-    puts("}");
+    khWriter_cstring(&writer, U"],\n\"errors\": [\n");
+
+    size_t errors = writeErrors(&writer, &lines);
+    khLineIndex_delete(&lines);
+    khWriter_cstring(&writer, U"]\n}\n");
+    khWriter_delete(&writer);
 
     khstring_delete(&content);
-    kharray_delete(&tokens);
 
     return errors;
 }
 
 static int parse(void) {
+    bool is_pipelined = takePipelinedFlag();
     if (argi >= kharray_size(&args)) {
         fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "missing required argument: " kh_ANSI_RESET "file\n", stderr);
         return 1;
     }
-    else if (kharray_size(&args) > 3) {
+    else if (kharray_size(&args) > 4) {
         fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "too many arguments; " kh_ANSI_RESET kh_ANSI_BOLD
-                                          "parse" kh_ANSI_RESET " only requires exactly 1 argument.\n",
+                                          "parse" kh_ANSI_RESET " only takes up to 2 arguments.\n",
               stderr);
         return 1;
     }
@@ -184,55 +250,329 @@ static int parse(void) {
         return 1;
     }
 
-    puts("{");
-    puts("\"ast\": [");
-
-    // Print statements
-    kharray(khAstStatement) ast = kh_parse(&content);
+    khWriter writer = khWriter_newStream(stdout);
+    khWriter_cstring(&writer, U"{\n\"ast\": [\n");
+
+    // Write statements; the tree is only written once, so it's just torn down with its arena
+    // afterwards. A cached tree is decoded outside of it. The lines are recorded while parsing, for
+    // the positions of the errors
+    khArena arena = khArena_new();
+    khLineIndex lines = khLineIndex_newEmpty(&content);
+    kharray(khAstStatement) ast;
+    if (argi < kharray_size(&args)) {
+        ast = kh_parseCached(&content, &args[argi], processorCount(), &lines);
+    }
+    else if (is_pipelined) {
+        ast = kh_parsePipelined(&content, &arena, &lines);
+    }
+    else {
+        ast = kh_parseParallel(&content, &arena, processorCount(), &lines);
+    }
     for (size_t i = 0; i < kharray_size(&ast); i++) {
-        khstring statement_str = khAstStatement_string(&ast[i], content);
-        kh_put(&statement_str, stdout);
-        khstring_delete(&statement_str);
+        khAstStatement_write(&ast[i], &writer);
+        khWriter_cstring(&writer, i < kharray_size(&ast) - 1 ? U",\n" : U"\n");
+    }
 
-        if (i < kharray_size(&ast) - 1) {
-            printf(",\n");
-        }
-        else {
-            printf("\n");
+    khWriter_cstring(&writer, U"],\n\"errors\": [\n");
+
+    size_t errors = writeErrors(&writer, &lines);
+    khLineIndex_delete(&lines);
+    khWriter_cstring(&writer, U"]\n}\n");
+    khWriter_delete(&writer);
+
+    if (kharray_arena(&ast) == NULL) {
+        kharray_delete(&ast);
+    }
+    khstring_delete(&content);
+    khArena_delete(&arena);
+
+    return errors;
+}
+
+// Amount and bytes of the nodes of each kind, statements first and then expressions
+typedef struct {
+    size_t statements[khAstStatementType_RETURN + 1];
+    size_t expressions[khAstExpressionType_TEMPLATIZE + 1];
+    size_t expression_bytes[khAstExpressionType_TEMPLATIZE + 1];
+} khNodeMeasure;
+
+static khAstWalkAction measureNode(khAstNode node, size_t depth, void* data) {
+    khNodeMeasure* measure = (khNodeMeasure*)data;
+
+    if (node.kind == khAstNodeKind_STATEMENT) {
+        measure->statements[node.statement->type]++;
+    }
+    else {
+        // Packed elements only take their values' bytes
+        measure->expressions[node.expression->type]++;
+        measure->expression_bytes[node.expression->type] +=
+            node.is_transient ? khAstPackedValues_width(node.expression->type)
+                              : khAstExpression_footprint(node.expression);
+    }
+
+    return khAstWalkAction_CONTINUE;
+}
+
+static void writeMeasure(khWriter* writer, khstring kind, size_t nodes, size_t bytes, bool last) {
+    khWriter_cstring(writer, U"{\"kind\": ");
+    khWriter_quote(writer, &kind);
+    khWriter_cstring(writer, U", \"nodes\": ");
+    khWriter_uint(writer, nodes, 10);
+    khWriter_cstring(writer, U", \"bytes\": ");
+    khWriter_uint(writer, bytes, 10);
+    khWriter_cstring(writer, U", \"bytes_per_node\": ");
+    khWriter_float(writer, nodes > 0 ? (double)bytes / nodes : 0, 2, 10);
+    khWriter_cstring(writer, last ? U"}\n" : U"},\n");
+
+    khstring_delete(&kind);
+}
+
+static int measure(void) {
+    if (argi >= kharray_size(&args)) {
+        fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "missing required argument: " kh_ANSI_RESET "file\n", stderr);
+        return 1;
+    }
+
+    khNodeMeasure measure = {0};
+    khAstVisitor visitor = {.opt_pre = measureNode, .opt_post = NULL, .data = &measure};
+
+    for (; argi < kharray_size(&args); argi++) {
+        bool file_exists;
+        khbuffer content_buf = kh_readFile(&args[argi], &file_exists);
+        khstring content = kh_decodeUtf8(&content_buf);
+        khbuffer_delete(&content_buf);
+
+        if (!file_exists) {
+            fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "file not found: " kh_ANSI_RESET, stderr);
+            kh_putln(&args[argi], stderr);
+
+            khstring_delete(&content);
+            return 1;
         }
+
+        // Only the layout of the tree is measured, so whatever errors it has don't matter
+        khArena arena = khArena_new();
+        kharray(khAstStatement) ast = kh_parseParallel(&content, &arena, processorCount(), NULL);
+        khAst_walk(&ast, &visitor);
+        kh_flushErrors();
+
+        khstring_delete(&content);
+        khArena_delete(&arena);
     }
 
-    puts("],");
-    puts("\"errors\": [");
+    khWriter writer = khWriter_newStream(stdout);
+    khWriter_cstring(&writer, U"{\n\"statement_size\": ");
+    khWriter_uint(&writer, sizeof(khAstStatement), 10);
+    khWriter_cstring(&writer, U",\n\"expression_size\": ");
+    khWriter_uint(&writer, sizeof(khAstExpression), 10);
 
-    // Print errors
-    size_t errors = kh_hasErrors();
-    for (size_t i = 0; i < errors; i++) {
-        khError* error = &(*kh_getErrors())[i];
-        khstring message = khstring_quote(&error->message);
+    size_t nodes = 0;
+    size_t bytes = 0;
+
+    khWriter_cstring(&writer, U",\n\"statements\": [\n");
+    for (khAstStatementType type = 0; type <= khAstStatementType_RETURN; type++) {
+        size_t type_bytes = measure.statements[type] * sizeof(khAstStatement);
+        writeMeasure(&writer, khAstStatementType_string(type), measure.statements[type], type_bytes,
+                     type == khAstStatementType_RETURN);
+
+        nodes += measure.statements[type];
+        bytes += type_bytes;
+    }
+
+    khWriter_cstring(&writer, U"],\n\"expressions\": [\n");
+    for (khAstExpressionType type = 0; type <= khAstExpressionType_TEMPLATIZE; type++) {
+        writeMeasure(&writer, khAstExpressionType_string(type), measure.expressions[type],
+                     measure.expression_bytes[type], type == khAstExpressionType_TEMPLATIZE);
+
+        nodes += measure.expressions[type];
+        bytes += measure.expression_bytes[type];
+    }
+
+    khWriter_cstring(&writer, U"],\n\"total\": ");
+    writeMeasure(&writer, khstring_new(U"total"), nodes, bytes, true);
+    khWriter_cstring(&writer, U"}\n");
+    khWriter_delete(&writer);
+
+    return 0;
+}
+
+// Files are handed out to the workers one at a time, each of which parses, indexes and queries its
+// files by itself. What's found in each file is written out afterwards, in the order they were given
+typedef struct {
+    khAstQuery* query;
+    atomic_size_t* next; // Index of the next file to be taken, shared by the workers
+    khstring* outputs;
+    bool* found;
+    pthread_t thread;
+    bool is_started;
+} khQueryWorker;
+
+static void queryFile(khAstQuery* query, khstring* path, khstring* output, bool* found) {
+    bool file_exists;
+    khbuffer content_buf = kh_readFile(path, &file_exists);
+    khstring content = kh_decodeUtf8(&content_buf);
+    khbuffer_delete(&content_buf);
 
-        printf("{\"index\": %lu, \"message\": ", (unsigned long)((char32_t*)error->data - content));
-        kh_put(&message, stdout);
-        printf("}");
+    *found = file_exists;
+    if (!file_exists) {
+        khstring_delete(&content);
+        return;
+    }
 
-        khstring_delete(&message);
+    // Errors don't stop the query, which goes through whatever could be parsed. Files are already
+    // spread over the workers, so each one is parsed by a single thread, recording its lines meanwhile
+    khArena arena = khArena_new();
+    khLineIndex lines = khLineIndex_newEmpty(&content);
+    kharray(khAstStatement) ast = kh_parseParallel(&content, &arena, 1, &lines);
+    kh_flushErrors();
+
+    khAstIndex index = khAstIndex_new(&ast);
+    kharray(uint32_t) matches = khAstIndex_query(&index, query);
+
+    khWriter writer = khWriter_newString();
+    for (size_t i = 0; i < kharray_size(&matches); i++) {
+        khAstNode node = index.entries[matches[i]].node;
+        khstring* opt_name = khAstIndex_name(&index, matches[i]);
+        uint32_t begin = node.kind == khAstNodeKind_STATEMENT ? node.statement->begin
+                                                              : node.expression->begin;
+
+        khWriter_cstring(&writer, U"{\"file\": ");
+        khWriter_quote(&writer, path);
+        khWriter_cstring(&writer, U", \"kind\": ");
+        khstring kind = node.kind == khAstNodeKind_STATEMENT
+                            ? khAstStatementType_string(node.statement->type)
+                            : khAstExpressionType_string(node.expression->type);
+        khWriter_quote(&writer, &kind);
+        khstring_delete(&kind);
+
+        khWriter_cstring(&writer, U", \"name\": ");
+        if (opt_name != NULL) {
+            khWriter_quote(&writer, opt_name);
+        }
+        else {
+            khWriter_cstring(&writer, U"null");
+        }
 
-        if (i < errors - 1) {
-            printf(",\n");
+        if (begin != khAst_NO_SPAN) {
+            khSourcePosition position = khLineIndex_position(&lines, begin);
+            khWriter_cstring(&writer, U", \"index\": ");
+            khWriter_uint(&writer, begin, 10);
+            khWriter_cstring(&writer, U", \"line\": ");
+            khWriter_uint(&writer, position.line, 10);
+            khWriter_cstring(&writer, U", \"column\": ");
+            khWriter_uint(&writer, position.column, 10);
         }
         else {
-            printf("\n");
+            khWriter_cstring(&writer, U", \"index\": null, \"line\": null, \"column\": null");
         }
+
+        khWriter_cstring(&writer, i < kharray_size(&matches) - 1 ? U"},\n" : U"}");
     }
 
-    kh_flushErrors();
-    puts("]");
-    puts("}");
+    khstring_delete(output);
+    *output = writer.string;
 
+    khLineIndex_delete(&lines);
+    kharray_delete(&matches);
+    khAstIndex_delete(&index);
+    khArena_delete(&arena);
     khstring_delete(&content);
-    kharray_delete(&ast);
+}
 
-    return errors;
+static void* queryWorker(void* data) {
+    khQueryWorker* worker = (khQueryWorker*)data;
+    size_t files = kharray_size(&args) - argi;
+
+    size_t file;
+    while ((file = atomic_fetch_add(worker->next, 1)) < files) {
+        queryFile(worker->query, &args[argi + file], &worker->outputs[file], &worker->found[file]);
+    }
+
+    return NULL;
+}
+
+static int query(void) {
+    if (argi >= kharray_size(&args)) {
+        fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "missing required argument: " kh_ANSI_RESET "pattern\n",
+              stderr);
+        return 1;
+    }
+    else if (argi + 1 >= kharray_size(&args)) {
+        fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "missing required argument: " kh_ANSI_RESET "file\n", stderr);
+        return 1;
+    }
+
+    khAstQuery pattern = khAstQuery_new(&args[argi]);
+    if (kh_hasErrors()) {
+        khError* error = &(*kh_getErrors())[0];
+        fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "invalid pattern: " kh_ANSI_RESET, stderr);
+        kh_putln(&error->message, stderr);
+
+        kh_flushErrors();
+        khAstQuery_delete(&pattern);
+        return 1;
+    }
+    argi++;
+
+    size_t files = kharray_size(&args) - argi;
+    khstring* outputs = (khstring*)malloc(files * sizeof(khstring));
+    bool* found = (bool*)malloc(files * sizeof(bool));
+    for (size_t i = 0; i < files; i++) {
+        outputs[i] = khstring_new(U"");
+        found[i] = false;
+    }
+
+    // The calling thread is the first worker, which also takes the files of any thread that couldn't
+    // be started
+    size_t workers = processorCount() < files ? processorCount() : files;
+    khQueryWorker* query_workers = (khQueryWorker*)malloc(workers * sizeof(khQueryWorker));
+    atomic_size_t next = 0;
+    for (size_t i = 0; i < workers; i++) {
+        query_workers[i] =
+            (khQueryWorker){.query = &pattern, .next = &next, .outputs = outputs, .found = found};
+        if (i > 0) {
+            query_workers[i].is_started =
+                pthread_create(&query_workers[i].thread, NULL, queryWorker, &query_workers[i]) == 0;
+        }
+    }
+    queryWorker(&query_workers[0]);
+    for (size_t i = 1; i < workers; i++) {
+        if (query_workers[i].is_started) {
+            pthread_join(query_workers[i].thread, NULL);
+        }
+    }
+    free(query_workers);
+
+    khWriter writer = khWriter_newStream(stdout);
+    khWriter_cstring(&writer, U"{\n\"matches\": [\n");
+
+    int code = 0;
+    bool is_first = true;
+    for (size_t i = 0; i < files; i++) {
+        if (!found[i]) {
+            fputs(kh_ANSI_BOLD kh_ANSI_FG_RED "file not found: " kh_ANSI_RESET, stderr);
+            kh_putln(&args[argi + i], stderr);
+            code = 1;
+        }
+        else if (khstring_size(&outputs[i]) > 0) {
+            if (!is_first) {
+                khWriter_cstring(&writer, U",\n");
+            }
+            khWriter_string(&writer, &outputs[i]);
+            is_first = false;
+        }
+
+        khstring_delete(&outputs[i]);
+    }
+
+    khWriter_cstring(&writer, is_first ? U"]\n}\n" : U"\n]\n}\n");
+    khWriter_delete(&writer);
+
+    free(outputs);
+    free(found);
+    khAstQuery_delete(&pattern);
+
+    return code;
 }
 
 static int semantic(void) {
@@ -248,9 +588,6 @@ int wmain(int argc, wchar_t* argv[])
 int main(int argc, char* argv[])
 #endif
 {
-    setlocale(LC_ALL, "en_US.utf8");
-    setlocale(LC_TIME, "en_GB.utf8");
-
 #ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);
     setvbuf(stdout, NULL, _IONBF, 0);
@@ -307,6 +644,14 @@ int main(int argc, char* argv[])
         argi++;
         code = parse();
     }
+    else if (khstring_equalCstring(&args[1], U"measure")) {
+        argi++;
+        code = measure();
+    }
+    else if (khstring_equalCstring(&args[1], U"query")) {
+        argi++;
+        code = query();
+    }
     else if (khstring_equalCstring(&args[1], U"semantic")) {
         argi++;
         code = semantic();
@@ -6,25 +6,48 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <kithare/core/error.h>
 #include <kithare/lib/array.h>
 
 
 static _Thread_local kharray(khError) error_stack = NULL;
+static _Thread_local uint32_t error_file = 0;
 
+static const char32_t* too_many_errors = U"too many errors, the rest are left out";
+
+
+void kh_setFile(uint32_t file) {
+    error_file = file;
+}
+
+uint32_t kh_getFile(void) {
+    return error_file;
+}
 
 void kh_raiseError(khError error) {
+    error.file = error_file;
+
     if (error_stack == NULL) {
         error_stack = kharray_new(khError, khError_delete);
     }
 
+    // Once the note is there, nothing else gets looked at
+    size_t size = kharray_size(&error_stack);
+    khError* last = size > 0 ? &error_stack[size - 1] : NULL;
+    if (size >= kh_MAX_ERRORS && khstring_equalCstring(&last->message, too_many_errors)) {
+        khError_delete(&error);
+        return;
+    }
+
+    // Looks from the latest ones, as duplicates come from going over the same tokens again
     bool is_duplicate = false;
-    for (size_t i = 0; i < kharray_size(&error_stack); i++) {
-        khError* err = &error_stack[i];
+    for (size_t i = kharray_size(&error_stack); i > 0; i--) {
+        khError* err = &error_stack[i - 1];
 
         if (err->type == error.type && khstring_equal(&err->message, &error.message) &&
-            err->data == error.data) {
+            err->file == error.file && err->offset == error.offset) {
             is_duplicate = true;
             break;
         }
@@ -32,10 +55,18 @@ void kh_raiseError(khError error) {
 
     if (is_duplicate) {
         khError_delete(&error);
+        return;
     }
-    else {
-        kharray_append(&error_stack, error);
+
+    // Only an error past the limit means that some are left out, which the last one kept then notes
+    if (size >= kh_MAX_ERRORS) {
+        khstring_delete(&last->message);
+        last->message = khstring_new(too_many_errors);
+        khError_delete(&error);
+        return;
     }
+
+    kharray_append(&error_stack, error);
 }
 
 size_t kh_hasErrors(void) {
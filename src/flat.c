@@ -0,0 +1,1407 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <kithare/core/error.h>
+#include <kithare/core/flat.h>
+#include <kithare/lib/varint.h>
+
+
+// The extra pool may get reallocated whenever a child gets flattened, so slots are always written by
+// their offset, after the child's index has been obtained
+static inline void setExtra(khFlatAst* ast, uint32_t offset, uint32_t value) {
+    ast->extra[offset] = value;
+}
+
+static uint32_t reserveExtra(khFlatAst* ast, size_t count) {
+    // Grows by doubling, as an exact fit would move the whole pool on every node
+    uint32_t offset = kharray_size(&ast->extra);
+    if (offset + count > kharray_reserved(&ast->extra)) {
+        size_t doubled = kharray_reserved(&ast->extra) * 2;
+        kharray_reserve(&ast->extra, doubled > offset + count ? doubled : offset + count);
+    }
+    for (size_t i = 0; i < count; i++) {
+        kharray_append(&ast->extra, 0);
+    }
+
+    return offset;
+}
+
+static uint32_t reserveList(khFlatAst* ast, size_t size) {
+    uint32_t list = reserveExtra(ast, 1 + size);
+    setExtra(ast, list, size);
+    return list;
+}
+
+// Spans are offsets already, with `khAst_NO_SPAN` being the same as `khFlat_NONE`
+static uint32_t pushNode(khFlatAst* ast, khFlatNodeKind kind, uint8_t type, uint32_t begin,
+                         uint32_t end) {
+    uint32_t index = kharray_size(&ast->nodes);
+    kharray_append(&ast->nodes, ((khFlatNode){.kind = kind,
+                                               .type = type,
+                                               .flags = 0,
+                                               .begin = begin,
+                                               .end = end,
+                                               .extra = 0}));
+    return index;
+}
+
+static void putString(khFlatAst* ast, uint32_t offset, khstring* string) {
+    setExtra(ast, offset, khstring_size(&ast->strings));
+    setExtra(ast, offset + 1, khstring_size(string));
+    khstring_concatenate(&ast->strings, string);
+}
+
+static void putBuffer(khFlatAst* ast, uint32_t offset, khbuffer* buffer) {
+    setExtra(ast, offset, khbuffer_size(&ast->bytes));
+    setExtra(ast, offset + 1, khbuffer_size(buffer));
+    kharray_concatenate(&ast->bytes, buffer, NULL);
+}
+
+static void putUint64(khFlatAst* ast, uint32_t offset, uint64_t value) {
+    setExtra(ast, offset, (uint32_t)value);
+    setExtra(ast, offset + 1, (uint32_t)(value >> 32));
+}
+
+
+static uint32_t flattenExpression(khFlatAst* ast, khAstExpression* expression);
+static uint32_t flattenStatement(khFlatAst* ast, khAstStatement* statement);
+static uint32_t flattenArgument(khFlatAst* ast, khAstVariable* variable);
+
+static uint32_t flattenOptional(khFlatAst* ast, khAstExpression* opt_expression) {
+    return opt_expression != NULL ? flattenExpression(ast, opt_expression) : khFlat_NONE;
+}
+
+static uint32_t flattenExpressions(khFlatAst* ast, kharray(khAstExpression)* expressions) {
+    uint32_t list = reserveList(ast, kharray_size(expressions));
+    for (size_t i = 0; i < kharray_size(expressions); i++) {
+        setExtra(ast, list + 1 + i, flattenExpression(ast, &(*expressions)[i]));
+    }
+
+    return list;
+}
+
+static uint32_t flattenStatements(khFlatAst* ast, kharray(khAstStatement)* statements) {
+    uint32_t list = reserveList(ast, kharray_size(statements));
+    for (size_t i = 0; i < kharray_size(statements); i++) {
+        setExtra(ast, list + 1 + i, flattenStatement(ast, &(*statements)[i]));
+    }
+
+    return list;
+}
+
+static uint32_t flattenArguments(khFlatAst* ast, kharray(khAstVariable)* arguments) {
+    uint32_t list = reserveList(ast, kharray_size(arguments));
+    for (size_t i = 0; i < kharray_size(arguments); i++) {
+        setExtra(ast, list + 1 + i, flattenArgument(ast, &(*arguments)[i]));
+    }
+
+    return list;
+}
+
+static uint32_t flattenStrings(khFlatAst* ast, kharray(khstring)* strings) {
+    uint32_t list = reserveExtra(ast, 1 + 2 * kharray_size(strings));
+    setExtra(ast, list, kharray_size(strings));
+    for (size_t i = 0; i < kharray_size(strings); i++) {
+        putString(ast, list + 1 + 2 * i, &(*strings)[i]);
+    }
+
+    return list;
+}
+
+// Writes the record of a variable, shared by variable statements and arguments
+static uint32_t flattenVariable(khFlatAst* ast, khAstVariable* variable, uint16_t* flags) {
+    *flags = (variable->is_static ? khFlatFlag_STATIC : 0) | (variable->is_wild ? khFlatFlag_WILD : 0) |
+             (variable->is_ref ? khFlatFlag_REF : 0);
+
+    uint32_t record = reserveExtra(ast, 3);
+    setExtra(ast, record, flattenStrings(ast, &variable->names));
+    setExtra(ast, record + 1, flattenOptional(ast, variable->opt_type));
+    setExtra(ast, record + 2, flattenOptional(ast, variable->opt_initializer));
+    return record;
+}
+
+static uint32_t flattenArgument(khFlatAst* ast, khAstVariable* variable) {
+    uint32_t index = pushNode(ast, khFlatNodeKind_VARIABLE, khAstStatementType_VARIABLE, khAst_NO_SPAN,
+                              khAst_NO_SPAN);
+
+    uint16_t flags;
+    uint32_t record = flattenVariable(ast, variable, &flags);
+    ast->nodes[index].flags = flags;
+    ast->nodes[index].extra = record;
+    return index;
+}
+
+static uint32_t flattenOptionalArgument(khFlatAst* ast, khAstVariable* opt_variable) {
+    return opt_variable != NULL ? flattenArgument(ast, opt_variable) : khFlat_NONE;
+}
+
+// A block which wasn't parsed yet is kept as the range of its source instead
+static uint32_t flattenBlock(khFlatAst* ast, kharray(khAstStatement) * block,
+                             khAstLazyBlock* lazy_block, uint16_t* flags) {
+    if (lazy_block->source == NULL) {
+        return flattenStatements(ast, block);
+    }
+
+    *flags |= khFlatFlag_LAZY_BLOCK;
+    uint32_t range = reserveExtra(ast, 2);
+    setExtra(ast, range, lazy_block->begin);
+    setExtra(ast, range + 1, lazy_block->end);
+    return range;
+}
+
+static uint32_t flattenValues(khFlatAst* ast, kharray(khAstExpression) * values,
+                              khAstPackedValues* packed, uint16_t* flags) {
+    if (packed->type == khAstExpressionType_INVALID) {
+        return flattenExpressions(ast, values);
+    }
+
+    *flags |= khFlatFlag_PACKED;
+    uint32_t record = reserveExtra(ast, 3);
+    setExtra(ast, record, packed->type);
+    setExtra(ast, record + 1, khbuffer_size(&ast->bytes));
+    setExtra(ast, record + 2, kharray_size(&packed->data));
+    kharray_concatenate(&ast->bytes, &packed->data, NULL);
+    return record;
+}
+
+static uint32_t flattenExpression(khFlatAst* ast, khAstExpression* expression) {
+    uint32_t index = pushNode(ast, khFlatNodeKind_EXPRESSION, expression->type, expression->begin,
+                              expression->end);
+    uint16_t flags = 0;
+    uint32_t extra = 0;
+
+    switch (expression->type) {
+        case khAstExpressionType_IDENTIFIER:
+            extra = reserveExtra(ast, 2);
+            putString(ast, extra, &expression->identifier);
+            break;
+        case khAstExpressionType_CHAR:
+            extra = expression->char_v;
+            break;
+        case khAstExpressionType_STRING:
+            extra = reserveExtra(ast, 2);
+            if (expression->raw.source != NULL) {
+                flags = khFlatFlag_RAW;
+                setExtra(ast, extra, expression->raw.begin);
+                setExtra(ast, extra + 1, expression->raw.end);
+            }
+            else {
+                putString(ast, extra, &expression->string);
+            }
+            break;
+        case khAstExpressionType_BUFFER:
+            extra = reserveExtra(ast, 2);
+            if (expression->raw.source != NULL) {
+                flags = khFlatFlag_RAW;
+                setExtra(ast, extra, expression->raw.begin);
+                setExtra(ast, extra + 1, expression->raw.end);
+            }
+            else {
+                putBuffer(ast, extra, &expression->buffer);
+            }
+            break;
+        case khAstExpressionType_BYTE:
+            extra = expression->byte;
+            break;
+        case khAstExpressionType_INTEGER:
+            extra = reserveExtra(ast, 2);
+            putUint64(ast, extra, (uint64_t)expression->integer);
+            break;
+        case khAstExpressionType_UINTEGER:
+            extra = reserveExtra(ast, 2);
+            putUint64(ast, extra, expression->uinteger);
+            break;
+        case khAstExpressionType_FLOAT:
+            memcpy(&extra, &expression->float_v, sizeof(float));
+            break;
+        case khAstExpressionType_DOUBLE: {
+            uint64_t bits;
+            memcpy(&bits, &expression->double_v, sizeof(double));
+            extra = reserveExtra(ast, 2);
+            putUint64(ast, extra, bits);
+        } break;
+        case khAstExpressionType_IFLOAT:
+            memcpy(&extra, &expression->ifloat, sizeof(float));
+            break;
+        case khAstExpressionType_IDOUBLE: {
+            uint64_t bits;
+            memcpy(&bits, &expression->idouble, sizeof(double));
+            extra = reserveExtra(ast, 2);
+            putUint64(ast, extra, bits);
+        } break;
+
+        case khAstExpressionType_TUPLE: {
+            khAstTuple* tuple = &expression->tuple;
+            extra = reserveExtra(ast, 1);
+            setExtra(ast, extra, flattenValues(ast, &tuple->values, &tuple->packed, &flags));
+        } break;
+        case khAstExpressionType_ARRAY: {
+            khAstArray* array = &expression->array;
+            extra = reserveExtra(ast, 1);
+            setExtra(ast, extra, flattenValues(ast, &array->values, &array->packed, &flags));
+        } break;
+        case khAstExpressionType_DICT:
+            extra = reserveExtra(ast, 2);
+            setExtra(ast, extra, flattenExpressions(ast, &expression->dict.keys));
+            setExtra(ast, extra + 1, flattenExpressions(ast, &expression->dict.values));
+            break;
+
+        case khAstExpressionType_SIGNATURE: {
+            khAstSignature* signature = expression->signature;
+            flags = signature->is_return_type_ref ? khFlatFlag_RETURN_TYPE_REF : 0;
+
+            uint32_t refs = reserveList(ast, kharray_size(&signature->are_arguments_refs));
+            for (size_t i = 0; i < kharray_size(&signature->are_arguments_refs); i++) {
+                setExtra(ast, refs + 1 + i, signature->are_arguments_refs[i]);
+            }
+
+            extra = reserveExtra(ast, 3);
+            setExtra(ast, extra, refs);
+            setExtra(ast, extra + 1, flattenExpressions(ast, &signature->argument_types));
+            setExtra(ast, extra + 2, flattenOptional(ast, signature->opt_return_type));
+        } break;
+
+        case khAstExpressionType_LAMBDA: {
+            khAstLambda* lambda = expression->lambda;
+            flags = lambda->is_return_type_ref ? khFlatFlag_RETURN_TYPE_REF : 0;
+
+            extra = reserveExtra(ast, 4);
+            setExtra(ast, extra, flattenArguments(ast, &lambda->arguments));
+            setExtra(ast, extra + 1, flattenOptionalArgument(ast, lambda->opt_variadic_argument));
+            setExtra(ast, extra + 2, flattenOptional(ast, lambda->opt_return_type));
+            setExtra(ast, extra + 3, flattenBlock(ast, &lambda->block, &lambda->lazy_block, &flags));
+        } break;
+
+        case khAstExpressionType_UNARY:
+            flags = expression->unary.type;
+            extra = flattenExpression(ast, expression->unary.operand);
+            break;
+        case khAstExpressionType_BINARY:
+            flags = expression->binary.type;
+            extra = reserveExtra(ast, 2);
+            setExtra(ast, extra, flattenExpression(ast, expression->binary.left));
+            setExtra(ast, extra + 1, flattenExpression(ast, expression->binary.right));
+            break;
+        case khAstExpressionType_TERNARY:
+            extra = reserveExtra(ast, 3);
+            setExtra(ast, extra, flattenExpression(ast, expression->ternary.condition));
+            setExtra(ast, extra + 1, flattenExpression(ast, expression->ternary.value));
+            setExtra(ast, extra + 2, flattenExpression(ast, expression->ternary.otherwise));
+            break;
+
+        case khAstExpressionType_COMPARISON: {
+            khAstComparisonExpression* comparison = &expression->comparison;
+
+            uint32_t operations = reserveList(ast, kharray_size(&comparison->operations));
+            for (size_t i = 0; i < kharray_size(&comparison->operations); i++) {
+                setExtra(ast, operations + 1 + i, comparison->operations[i]);
+            }
+
+            extra = reserveExtra(ast, 2);
+            setExtra(ast, extra, operations);
+            setExtra(ast, extra + 1, flattenExpressions(ast, &comparison->operands));
+        } break;
+
+        case khAstExpressionType_CALL:
+            extra = reserveExtra(ast, 2);
+            setExtra(ast, extra, flattenExpression(ast, expression->call.callee));
+            setExtra(ast, extra + 1, flattenExpressions(ast, &expression->call.arguments));
+            break;
+        case khAstExpressionType_INDEX:
+            extra = reserveExtra(ast, 2);
+            setExtra(ast, extra, flattenExpression(ast, expression->index.indexee));
+            setExtra(ast, extra + 1, flattenExpressions(ast, &expression->index.arguments));
+            break;
+
+        case khAstExpressionType_SCOPE:
+            extra = reserveExtra(ast, 2);
+            setExtra(ast, extra, flattenExpression(ast, expression->scope.value));
+            setExtra(ast, extra + 1, flattenStrings(ast, &expression->scope.scope_names));
+            break;
+        case khAstExpressionType_TEMPLATIZE:
+            extra = reserveExtra(ast, 2);
+            setExtra(ast, extra, flattenExpression(ast, expression->templatize.value));
+            setExtra(ast, extra + 1,
+                     flattenExpressions(ast, &expression->templatize.template_arguments));
+            break;
+
+        default:
+            break;
+    }
+
+    ast->nodes[index].flags = flags;
+    ast->nodes[index].extra = extra;
+    return index;
+}
+
+static uint32_t flattenStatement(khFlatAst* ast, khAstStatement* statement) {
+    uint32_t index =
+        pushNode(ast, khFlatNodeKind_STATEMENT, statement->type, statement->begin, statement->end);
+    uint16_t flags = 0;
+    uint32_t extra = 0;
+
+    switch (statement->type) {
+        case khAstStatementType_VARIABLE:
+            extra = flattenVariable(ast, &statement->variable, &flags);
+            break;
+        case khAstStatementType_EXPRESSION:
+            extra = flattenExpression(ast, &statement->expression);
+            break;
+
+        case khAstStatementType_IMPORT: {
+            khAstImport* import_v = &statement->import_v;
+            flags = (import_v->relative ? khFlatFlag_RELATIVE : 0) |
+                    (import_v->opt_alias != NULL ? khFlatFlag_HAS_ALIAS : 0);
+
+            extra = reserveExtra(ast, 3);
+            setExtra(ast, extra, flattenStrings(ast, &import_v->path));
+            if (import_v->opt_alias != NULL) {
+                putString(ast, extra + 1, import_v->opt_alias);
+            }
+        } break;
+
+        case khAstStatementType_INCLUDE:
+            flags = statement->include.relative ? khFlatFlag_RELATIVE : 0;
+            extra = reserveExtra(ast, 1);
+            setExtra(ast, extra, flattenStrings(ast, &statement->include.path));
+            break;
+
+        case khAstStatementType_FUNCTION: {
+            khAstFunction* function = &statement->function;
+            flags = (function->is_incase ? khFlatFlag_INCASE : 0) |
+                    (function->is_static ? khFlatFlag_STATIC : 0) |
+                    (function->is_return_type_ref ? khFlatFlag_RETURN_TYPE_REF : 0);
+
+            extra = reserveExtra(ast, 6);
+            setExtra(ast, extra, flattenStrings(ast, &function->identifiers));
+            setExtra(ast, extra + 1, flattenStrings(ast, &function->template_arguments));
+            setExtra(ast, extra + 2, flattenArguments(ast, &function->arguments));
+            setExtra(ast, extra + 3, flattenOptionalArgument(ast, function->opt_variadic_argument));
+            setExtra(ast, extra + 4, flattenOptional(ast, function->opt_return_type));
+            setExtra(ast, extra + 5,
+                     flattenBlock(ast, &function->block, &function->lazy_block, &flags));
+        } break;
+
+        case khAstStatementType_CLASS: {
+            khAstClass* class_v = &statement->class_v;
+            flags = class_v->is_incase ? khFlatFlag_INCASE : 0;
+
+            extra = reserveExtra(ast, 5);
+            putString(ast, extra, &class_v->name);
+            setExtra(ast, extra + 2, flattenStrings(ast, &class_v->template_arguments));
+            setExtra(ast, extra + 3, flattenOptional(ast, class_v->opt_base_type));
+            setExtra(ast, extra + 4, flattenStatements(ast, &class_v->block));
+        } break;
+
+        case khAstStatementType_STRUCT: {
+            khAstStruct* struct_v = &statement->struct_v;
+            flags = struct_v->is_incase ? khFlatFlag_INCASE : 0;
+
+            extra = reserveExtra(ast, 4);
+            putString(ast, extra, &struct_v->name);
+            setExtra(ast, extra + 2, flattenStrings(ast, &struct_v->template_arguments));
+            setExtra(ast, extra + 3, flattenStatements(ast, &struct_v->block));
+        } break;
+
+        case khAstStatementType_ENUM:
+            extra = reserveExtra(ast, 3);
+            putString(ast, extra, &statement->enum_v.name);
+            setExtra(ast, extra + 2, flattenStrings(ast, &statement->enum_v.members));
+            break;
+
+        case khAstStatementType_ALIAS:
+            flags = statement->alias.is_incase ? khFlatFlag_INCASE : 0;
+            extra = reserveExtra(ast, 3);
+            putString(ast, extra, &statement->alias.name);
+            setExtra(ast, extra + 2, flattenExpression(ast, &statement->alias.expression));
+            break;
+
+        case khAstStatementType_IF_BRANCH: {
+            khAstIfBranch* if_branch = &statement->if_branch;
+
+            extra = reserveExtra(ast, 3);
+            setExtra(ast, extra, flattenExpressions(ast, &if_branch->branch_conditions));
+
+            uint32_t blocks = reserveList(ast, kharray_size(&if_branch->branch_blocks));
+            for (size_t i = 0; i < kharray_size(&if_branch->branch_blocks); i++) {
+                setExtra(ast, blocks + 1 + i, flattenStatements(ast, &if_branch->branch_blocks[i]));
+            }
+            setExtra(ast, extra + 1, blocks);
+
+            setExtra(ast, extra + 2, flattenStatements(ast, &if_branch->else_block));
+        } break;
+
+        case khAstStatementType_WHILE_LOOP:
+            extra = reserveExtra(ast, 2);
+            setExtra(ast, extra, flattenExpression(ast, &statement->while_loop.condition));
+            setExtra(ast, extra + 1, flattenStatements(ast, &statement->while_loop.block));
+            break;
+        case khAstStatementType_DO_WHILE_LOOP:
+            extra = reserveExtra(ast, 2);
+            setExtra(ast, extra, flattenExpression(ast, &statement->do_while_loop.condition));
+            setExtra(ast, extra + 1, flattenStatements(ast, &statement->do_while_loop.block));
+            break;
+        case khAstStatementType_FOR_LOOP:
+            extra = reserveExtra(ast, 3);
+            setExtra(ast, extra, flattenStrings(ast, &statement->for_loop.iterators));
+            setExtra(ast, extra + 1, flattenExpression(ast, &statement->for_loop.iteratee));
+            setExtra(ast, extra + 2, flattenStatements(ast, &statement->for_loop.block));
+            break;
+        case khAstStatementType_RETURN:
+            extra = reserveExtra(ast, 1);
+            setExtra(ast, extra, flattenExpressions(ast, &statement->return_v.values));
+            break;
+
+        default:
+            break;
+    }
+
+    ast->nodes[index].flags = flags;
+    ast->nodes[index].extra = extra;
+    return index;
+}
+
+
+khFlatAst khFlatAst_new(kharray(khAstStatement) * statements) {
+    khFlatAst ast = {.nodes = kharray_new(khFlatNode, NULL),
+                     .extra = kharray_new(uint32_t, NULL),
+                     .strings = khstring_new(U""),
+                     .bytes = khbuffer_new(""),
+                     .statements = 0};
+
+    ast.statements = flattenStatements(&ast, statements);
+    return ast;
+}
+
+void khFlatAst_delete(khFlatAst* ast) {
+    kharray_delete(&ast->nodes);
+    kharray_delete(&ast->extra);
+    khstring_delete(&ast->strings);
+    khbuffer_delete(&ast->bytes);
+}
+
+
+static khstring getString(khFlatAst* ast, uint32_t offset) {
+    khstring string = khstring_new(U"");
+    kharray_memory(&string, ast->strings + ast->extra[offset], ast->extra[offset + 1], NULL);
+    return string;
+}
+
+static khbuffer getBuffer(khFlatAst* ast, uint32_t offset) {
+    khbuffer buffer = khbuffer_new("");
+    kharray_memory(&buffer, ast->bytes + ast->extra[offset], ast->extra[offset + 1], NULL);
+    return buffer;
+}
+
+static uint64_t getUint64(khFlatAst* ast, uint32_t offset) {
+    return (uint64_t)ast->extra[offset] | (uint64_t)ast->extra[offset + 1] << 32;
+}
+
+
+static khAstExpression unflattenExpression(khFlatAst* ast, uint32_t index, khAstSource* source);
+static khAstStatement unflattenStatement(khFlatAst* ast, uint32_t index, khAstSource* source);
+static khAstVariable unflattenVariable(khFlatAst* ast, uint32_t index, khAstSource* source);
+
+static khAstExpression* unflattenPointer(khFlatAst* ast, uint32_t index, khAstSource* source) {
+    return khAstExpression_box(unflattenExpression(ast, index, source), NULL);
+}
+
+static khAstExpression* unflattenOptional(khFlatAst* ast, uint32_t index, khAstSource* source) {
+    return index != khFlat_NONE ? unflattenPointer(ast, index, source) : NULL;
+}
+
+static khAstVariable* unflattenOptionalArgument(khFlatAst* ast, uint32_t index, khAstSource* source) {
+    if (index == khFlat_NONE) {
+        return NULL;
+    }
+
+    kharray(khAstVariable) variable = kharray_new(khAstVariable, khAstVariable_delete);
+    kharray_append(&variable, unflattenVariable(ast, index, source));
+    return variable;
+}
+
+static kharray(khAstExpression) unflattenExpressions(khFlatAst* ast, uint32_t list,
+                                                     khAstSource* source) {
+    kharray(khAstExpression) expressions = kharray_new(khAstExpression, khAstExpression_delete);
+    kharray_reserve(&expressions, khFlatAst_listSize(ast, list));
+    for (size_t i = 0; i < khFlatAst_listSize(ast, list); i++) {
+        kharray_append(&expressions,
+                       unflattenExpression(ast, khFlatAst_listItems(ast, list)[i], source));
+    }
+
+    return expressions;
+}
+
+static kharray(khAstStatement) unflattenStatements(khFlatAst* ast, uint32_t list, khAstSource* source) {
+    kharray(khAstStatement) statements = kharray_new(khAstStatement, khAstStatement_delete);
+    kharray_reserve(&statements, khFlatAst_listSize(ast, list));
+    for (size_t i = 0; i < khFlatAst_listSize(ast, list); i++) {
+        kharray_append(&statements, unflattenStatement(ast, khFlatAst_listItems(ast, list)[i], source));
+    }
+
+    return statements;
+}
+
+static kharray(khAstVariable) unflattenArguments(khFlatAst* ast, uint32_t list, khAstSource* source) {
+    kharray(khAstVariable) arguments = kharray_new(khAstVariable, khAstVariable_delete);
+    kharray_reserve(&arguments, khFlatAst_listSize(ast, list));
+    for (size_t i = 0; i < khFlatAst_listSize(ast, list); i++) {
+        kharray_append(&arguments, unflattenVariable(ast, khFlatAst_listItems(ast, list)[i], source));
+    }
+
+    return arguments;
+}
+
+static kharray(khstring) unflattenStrings(khFlatAst* ast, uint32_t list) {
+    kharray(khstring) strings = kharray_new(khstring, khstring_delete);
+    kharray_reserve(&strings, khFlatAst_listSize(ast, list));
+    for (size_t i = 0; i < khFlatAst_listSize(ast, list); i++) {
+        kharray_append(&strings, getString(ast, list + 1 + 2 * i));
+    }
+
+    return strings;
+}
+
+// Works on both variable statements and arguments
+static khAstVariable unflattenVariable(khFlatAst* ast, uint32_t index, khAstSource* source) {
+    khFlatNode node = ast->nodes[index];
+    uint32_t* record = ast->extra + node.extra;
+
+    return (khAstVariable){.is_static = node.flags & khFlatFlag_STATIC,
+                           .is_wild = node.flags & khFlatFlag_WILD,
+                           .is_ref = node.flags & khFlatFlag_REF,
+                           .names = unflattenStrings(ast, record[0]),
+                           .opt_type = unflattenOptional(ast, record[1], source),
+                           .opt_initializer = unflattenOptional(ast, record[2], source)};
+}
+
+static kharray(khAstStatement) unflattenBlock(khFlatAst* ast, uint32_t slot, uint16_t flags,
+                                              khAstLazyBlock* lazy_block, khAstSource* source) {
+    if (!(flags & khFlatFlag_LAZY_BLOCK)) {
+        *lazy_block = (khAstLazyBlock){.source = NULL, .begin = 0, .end = 0, .opt_arena = NULL};
+        return unflattenStatements(ast, slot, source);
+    }
+
+    *lazy_block = (khAstLazyBlock){.source = khAstSource_retain(source),
+                                   .begin = ast->extra[slot],
+                                   .end = ast->extra[slot + 1],
+                                   .opt_arena = NULL};
+    return kharray_new(khAstStatement, khAstStatement_delete);
+}
+
+static kharray(khAstExpression) unflattenValues(khFlatAst* ast, uint32_t slot, uint16_t flags,
+                                                khAstPackedValues* packed, khAstSource* source) {
+    if (!(flags & khFlatFlag_PACKED)) {
+        *packed = (khAstPackedValues){.type = khAstExpressionType_INVALID, .data = NULL};
+        return unflattenExpressions(ast, slot, source);
+    }
+
+    uint32_t* record = ast->extra + slot;
+    *packed = (khAstPackedValues){.type = record[0], .data = kharray_new(uint8_t, NULL)};
+    kharray_memory(&packed->data, ast->bytes + record[1], record[2], NULL);
+    return kharray_new(khAstExpression, khAstExpression_delete);
+}
+
+static khAstExpression unflattenExpression(khFlatAst* ast, uint32_t index, khAstSource* source) {
+    khFlatNode node = ast->nodes[index];
+    uint32_t* record = ast->extra + node.extra;
+    khAstExpression expression = {
+        .begin = node.begin, .end = node.end, .file = source->file, .type = node.type};
+
+    switch (expression.type) {
+        case khAstExpressionType_IDENTIFIER:
+            expression.identifier = getString(ast, node.extra);
+            break;
+        case khAstExpressionType_CHAR:
+            expression.char_v = node.extra;
+            break;
+        case khAstExpressionType_STRING:
+        case khAstExpressionType_BUFFER:
+            if (node.flags & khFlatFlag_RAW) {
+                expression.raw = (khAstRawLiteral){
+                    .source = khAstSource_retain(source), .begin = record[0], .end = record[1]};
+                expression.opt_raw_arena = NULL;
+            }
+            else if (node.type == khAstExpressionType_STRING) {
+                expression.string = getString(ast, node.extra);
+            }
+            else {
+                expression.buffer = getBuffer(ast, node.extra);
+            }
+            break;
+        case khAstExpressionType_BYTE:
+            expression.byte = node.extra;
+            break;
+        case khAstExpressionType_INTEGER:
+            expression.integer = (int64_t)getUint64(ast, node.extra);
+            break;
+        case khAstExpressionType_UINTEGER:
+            expression.uinteger = getUint64(ast, node.extra);
+            break;
+        case khAstExpressionType_FLOAT:
+            memcpy(&expression.float_v, &node.extra, sizeof(float));
+            break;
+        case khAstExpressionType_DOUBLE: {
+            uint64_t bits = getUint64(ast, node.extra);
+            memcpy(&expression.double_v, &bits, sizeof(double));
+        } break;
+        case khAstExpressionType_IFLOAT:
+            memcpy(&expression.ifloat, &node.extra, sizeof(float));
+            break;
+        case khAstExpressionType_IDOUBLE: {
+            uint64_t bits = getUint64(ast, node.extra);
+            memcpy(&expression.idouble, &bits, sizeof(double));
+        } break;
+
+        case khAstExpressionType_TUPLE:
+            expression.tuple.values =
+                unflattenValues(ast, record[0], node.flags, &expression.tuple.packed, source);
+            break;
+        case khAstExpressionType_ARRAY:
+            expression.array.values =
+                unflattenValues(ast, record[0], node.flags, &expression.array.packed, source);
+            break;
+        case khAstExpressionType_DICT:
+            expression.dict = (khAstDict){.keys = unflattenExpressions(ast, record[0], source),
+                                          .values = unflattenExpressions(ast, record[1], source)};
+            break;
+
+        case khAstExpressionType_SIGNATURE: {
+            kharray(bool) are_arguments_refs = kharray_new(bool, NULL);
+            for (size_t i = 0; i < khFlatAst_listSize(ast, record[0]); i++) {
+                kharray_append(&are_arguments_refs, khFlatAst_listItems(ast, record[0])[i] != 0);
+            }
+
+            expression.signature = khAstSignature_box(
+                (khAstSignature){.are_arguments_refs = are_arguments_refs,
+                                 .argument_types = unflattenExpressions(ast, record[1], source),
+                                 .is_return_type_ref = node.flags & khFlatFlag_RETURN_TYPE_REF,
+                                 .opt_return_type = unflattenOptional(ast, record[2], source)},
+                NULL);
+        } break;
+
+        case khAstExpressionType_LAMBDA: {
+            khAstLazyBlock lazy_block;
+            kharray(khAstStatement) block =
+                unflattenBlock(ast, record[3], node.flags, &lazy_block, source);
+
+            expression.lambda = khAstLambda_box(
+                (khAstLambda){
+                    .arguments = unflattenArguments(ast, record[0], source),
+                    .opt_variadic_argument = unflattenOptionalArgument(ast, record[1], source),
+                    .is_return_type_ref = node.flags & khFlatFlag_RETURN_TYPE_REF,
+                    .opt_return_type = unflattenOptional(ast, record[2], source),
+                    .block = block,
+                    .lazy_block = lazy_block},
+                NULL);
+        } break;
+
+        case khAstExpressionType_UNARY:
+            expression.unary = (khAstUnaryExpression){
+                .type = node.flags, .operand = unflattenPointer(ast, node.extra, source)};
+            break;
+        case khAstExpressionType_BINARY:
+            expression.binary =
+                (khAstBinaryExpression){.type = node.flags,
+                                        .left = unflattenPointer(ast, record[0], source),
+                                        .right = unflattenPointer(ast, record[1], source)};
+            break;
+        case khAstExpressionType_TERNARY:
+            expression.ternary =
+                (khAstTernaryExpression){.condition = unflattenPointer(ast, record[0], source),
+                                         .value = unflattenPointer(ast, record[1], source),
+                                         .otherwise = unflattenPointer(ast, record[2], source)};
+            break;
+
+        case khAstExpressionType_COMPARISON: {
+            kharray(khAstComparisonExpressionType) operations =
+                kharray_new(khAstComparisonExpressionType, NULL);
+            for (size_t i = 0; i < khFlatAst_listSize(ast, record[0]); i++) {
+                kharray_append(&operations, khFlatAst_listItems(ast, record[0])[i]);
+            }
+
+            expression.comparison = (khAstComparisonExpression){
+                .operations = operations, .operands = unflattenExpressions(ast, record[1], source)};
+        } break;
+
+        case khAstExpressionType_CALL:
+            expression.call =
+                (khAstCallExpression){.callee = unflattenPointer(ast, record[0], source),
+                                      .arguments = unflattenExpressions(ast, record[1], source)};
+            break;
+        case khAstExpressionType_INDEX:
+            expression.index =
+                (khAstIndexExpression){.indexee = unflattenPointer(ast, record[0], source),
+                                       .arguments = unflattenExpressions(ast, record[1], source)};
+            break;
+
+        case khAstExpressionType_SCOPE:
+            expression.scope =
+                (khAstScopeExpression){.value = unflattenPointer(ast, record[0], source),
+                                       .scope_names = unflattenStrings(ast, record[1])};
+            break;
+        case khAstExpressionType_TEMPLATIZE:
+            expression.templatize = (khAstTemplatizeExpression){
+                .value = unflattenPointer(ast, record[0], source),
+                .template_arguments = unflattenExpressions(ast, record[1], source)};
+            break;
+
+        default:
+            break;
+    }
+
+    return expression;
+}
+
+static khAstStatement unflattenStatement(khFlatAst* ast, uint32_t index, khAstSource* source) {
+    khFlatNode node = ast->nodes[index];
+    uint32_t* record = ast->extra + node.extra;
+    khAstStatement statement = {
+        .begin = node.begin, .end = node.end, .file = source->file, .type = node.type};
+
+    switch (statement.type) {
+        case khAstStatementType_VARIABLE:
+            statement.variable = unflattenVariable(ast, index, source);
+            break;
+        case khAstStatementType_EXPRESSION:
+            statement.expression = unflattenExpression(ast, node.extra, source);
+            break;
+
+        case khAstStatementType_IMPORT: {
+            khstring* opt_alias = NULL;
+            if (node.flags & khFlatFlag_HAS_ALIAS) {
+                opt_alias = kharray_new(khstring, khstring_delete);
+                kharray_append(&opt_alias, getString(ast, node.extra + 1));
+            }
+
+            statement.import_v = (khAstImport){.path = unflattenStrings(ast, record[0]),
+                                               .relative = node.flags & khFlatFlag_RELATIVE,
+                                               .opt_alias = opt_alias};
+        } break;
+
+        case khAstStatementType_INCLUDE:
+            statement.include = (khAstInclude){.path = unflattenStrings(ast, record[0]),
+                                               .relative = node.flags & khFlatFlag_RELATIVE};
+            break;
+
+        case khAstStatementType_FUNCTION: {
+            khAstLazyBlock lazy_block;
+            kharray(khAstStatement) block =
+                unflattenBlock(ast, record[5], node.flags, &lazy_block, source);
+
+            statement.function = (khAstFunction){
+                .is_incase = node.flags & khFlatFlag_INCASE,
+                .is_static = node.flags & khFlatFlag_STATIC,
+                .identifiers = unflattenStrings(ast, record[0]),
+                .template_arguments = unflattenStrings(ast, record[1]),
+                .arguments = unflattenArguments(ast, record[2], source),
+                .opt_variadic_argument = unflattenOptionalArgument(ast, record[3], source),
+                .is_return_type_ref = node.flags & khFlatFlag_RETURN_TYPE_REF,
+                .opt_return_type = unflattenOptional(ast, record[4], source),
+                .block = block,
+                .lazy_block = lazy_block};
+        } break;
+
+        case khAstStatementType_CLASS:
+            statement.class_v = (khAstClass){.is_incase = node.flags & khFlatFlag_INCASE,
+                                             .name = getString(ast, node.extra),
+                                             .template_arguments = unflattenStrings(ast, record[2]),
+                                             .opt_base_type = unflattenOptional(ast, record[3], source),
+                                             .block = unflattenStatements(ast, record[4], source)};
+            break;
+
+        case khAstStatementType_STRUCT:
+            statement.struct_v = (khAstStruct){.is_incase = node.flags & khFlatFlag_INCASE,
+                                               .name = getString(ast, node.extra),
+                                               .template_arguments = unflattenStrings(ast, record[2]),
+                                               .block = unflattenStatements(ast, record[3], source)};
+            break;
+
+        case khAstStatementType_ENUM:
+            statement.enum_v = (khAstEnum){.name = getString(ast, node.extra),
+                                           .members = unflattenStrings(ast, record[2])};
+            break;
+
+        case khAstStatementType_ALIAS:
+            statement.alias = (khAstAlias){.is_incase = node.flags & khFlatFlag_INCASE,
+                                           .name = getString(ast, node.extra),
+                                           .expression = unflattenExpression(ast, record[2], source)};
+            break;
+
+        case khAstStatementType_IF_BRANCH: {
+            kharray(kharray(khAstStatement)) branch_blocks =
+                kharray_new(kharray(khAstStatement), kharray_arrayDeleter(khAstStatement));
+            uint32_t* blocks = khFlatAst_listItems(ast, record[1]);
+            for (size_t i = 0; i < khFlatAst_listSize(ast, record[1]); i++) {
+                kharray_append(&branch_blocks, unflattenStatements(ast, blocks[i], source));
+            }
+
+            statement.if_branch =
+                (khAstIfBranch){.branch_conditions = unflattenExpressions(ast, record[0], source),
+                                .branch_blocks = branch_blocks,
+                                .else_block = unflattenStatements(ast, record[2], source)};
+        } break;
+
+        case khAstStatementType_WHILE_LOOP:
+            statement.while_loop =
+                (khAstWhileLoop){.condition = unflattenExpression(ast, record[0], source),
+                                 .block = unflattenStatements(ast, record[1], source)};
+            break;
+        case khAstStatementType_DO_WHILE_LOOP:
+            statement.do_while_loop =
+                (khAstDoWhileLoop){.condition = unflattenExpression(ast, record[0], source),
+                                   .block = unflattenStatements(ast, record[1], source)};
+            break;
+        case khAstStatementType_FOR_LOOP:
+            statement.for_loop =
+                (khAstForLoop){.iterators = unflattenStrings(ast, record[0]),
+                               .iteratee = unflattenExpression(ast, record[1], source),
+                               .block = unflattenStatements(ast, record[2], source)};
+            break;
+        case khAstStatementType_RETURN:
+            statement.return_v = (khAstReturn){.values = unflattenExpressions(ast, record[0], source)};
+            break;
+
+        default:
+            break;
+    }
+
+    return statement;
+}
+
+
+kharray(khAstStatement) khFlatAst_unflatten(khFlatAst* ast, char32_t* origin) {
+    khAstSource* source = khAstSource_new(origin, kh_getFile(), NULL);
+    kharray(khAstStatement) statements = unflattenStatements(ast, ast->statements, source);
+
+    khAstSource_release(source);
+    return statements;
+}
+
+
+static const uint8_t magic[4] = {'k', 'h', 'f', 'a'};
+
+khbuffer khFlatAst_encode(khFlatAst* ast) {
+    khbuffer buffer = khbuffer_new("");
+    // Most varints of a typical tree fit in one or two bytes
+    kharray_reserve(&buffer, sizeof(magic) + 32 + kharray_size(&ast->nodes) * 8 +
+                                 kharray_size(&ast->extra) * 2 + khstring_size(&ast->strings) +
+                                 khbuffer_size(&ast->bytes));
+
+    kharray_memory(&buffer, (uint8_t*)magic, sizeof(magic), NULL);
+    kh_putVarint(&buffer, kh_FLAT_FORMAT_VERSION);
+    kh_putVarint(&buffer, kharray_size(&ast->nodes));
+    kh_putVarint(&buffer, kharray_size(&ast->extra));
+    kh_putVarint(&buffer, khstring_size(&ast->strings));
+    kh_putVarint(&buffer, khbuffer_size(&ast->bytes));
+    kh_putVarint(&buffer, ast->statements);
+
+    // Nodes come in pre-order, so their begin offsets are mostly small steps from the previous one's
+    uint32_t previous = 0;
+    for (khFlatNode* node = ast->nodes; node < ast->nodes + kharray_size(&ast->nodes); node++) {
+        bool has_begin = node->begin != khFlat_NONE;
+        bool has_end = node->end != khFlat_NONE;
+        kh_putVarint(&buffer, node->kind | has_begin << 2 | has_end << 3);
+        kh_putVarint(&buffer, node->type);
+        kh_putVarint(&buffer, node->flags);
+
+        if (has_begin) {
+            kh_putVarint(&buffer, kh_zigzag((int64_t)node->begin - previous));
+            previous = node->begin;
+        }
+        if (has_end) {
+            kh_putVarint(&buffer, kh_zigzag((int64_t)node->end - previous));
+        }
+
+        kh_putVarint(&buffer, node->extra);
+    }
+
+    for (uint32_t* slot = ast->extra; slot < ast->extra + kharray_size(&ast->extra); slot++) {
+        kh_putVarint(&buffer, *slot);
+    }
+    for (char32_t* chr = ast->strings; chr < ast->strings + khstring_size(&ast->strings); chr++) {
+        kh_putVarint(&buffer, *chr);
+    }
+    kharray_concatenate(&buffer, &ast->bytes, NULL);
+
+    return buffer;
+}
+
+// Nodes which are referred to by a decoded tree and still have to be checked. They're gone through
+// from a stack rather than recursively, as the tree being checked could be nested arbitrarily deep
+typedef struct {
+    uint32_t index;
+    khFlatNodeKind kind;
+    uint32_t depth;
+} khFlatReference;
+
+typedef struct {
+    khFlatAst* ast;
+    size_t origin_size;
+    kharray(khFlatReference) pending;
+    bool* reached; // Each node has to be referred to once, which also rules out any cycles
+    uint32_t depth; // Of the node being checked, which the nodes it refers to are one deeper than
+    bool valid;
+} khFlatChecker;
+
+static bool hasSlots(khFlatChecker* checker, uint64_t offset, uint64_t count) {
+    checker->valid &= offset + count <= kharray_size(&checker->ast->extra);
+    return checker->valid;
+}
+
+// The record of a node, or NULL if it doesn't fit in the extra pool
+static uint32_t* checkRecord(khFlatChecker* checker, uint32_t offset, size_t size) {
+    return hasSlots(checker, offset, size) ? checker->ast->extra + offset : NULL;
+}
+
+static void checkString(khFlatChecker* checker, uint32_t offset) {
+    uint32_t* slots = checkRecord(checker, offset, 2);
+    checker->valid &=
+        slots != NULL && (uint64_t)slots[0] + slots[1] <= khstring_size(&checker->ast->strings);
+}
+
+static void checkBuffer(khFlatChecker* checker, uint32_t offset) {
+    uint32_t* slots = checkRecord(checker, offset, 2);
+    checker->valid &=
+        slots != NULL && (uint64_t)slots[0] + slots[1] <= khbuffer_size(&checker->ast->bytes);
+}
+
+// Begin and end offsets of a raw literal or a skipped block, in the source
+static void checkRange(khFlatChecker* checker, uint32_t offset) {
+    uint32_t* slots = checkRecord(checker, offset, 2);
+    checker->valid &= slots != NULL && slots[0] <= slots[1] && slots[1] <= checker->origin_size;
+}
+
+// The size of the list, or 0 if it doesn't fit in the extra pool along with its `width` slots per item
+static size_t checkList(khFlatChecker* checker, uint32_t list, size_t width) {
+    if (!hasSlots(checker, list, 1)) {
+        return 0;
+    }
+
+    size_t size = khFlatAst_listSize(checker->ast, list);
+    return hasSlots(checker, (uint64_t)list + 1, (uint64_t)size * width) ? size : 0;
+}
+
+static void checkStrings(khFlatChecker* checker, uint32_t list) {
+    size_t size = checkList(checker, list, 2);
+    for (size_t i = 0; i < size; i++) {
+        checkString(checker, list + 1 + 2 * i);
+    }
+}
+
+// Each item of the list has to be below `bound`
+static size_t checkValues(khFlatChecker* checker, uint32_t list, uint32_t bound) {
+    size_t size = checkList(checker, list, 1);
+    for (size_t i = 0; i < size; i++) {
+        checker->valid &= khFlatAst_listItems(checker->ast, list)[i] < bound;
+    }
+
+    return size;
+}
+
+// Unflattening goes through the call stack, so it's also where the depth of the tree gets bounded
+static void refer(khFlatChecker* checker, uint32_t index, khFlatNodeKind kind) {
+    checker->valid &=
+        index < kharray_size(&checker->ast->nodes) && checker->depth < kh_FLAT_MAX_DEPTH;
+    if (checker->valid) {
+        kharray_append(&checker->pending,
+                       ((khFlatReference){.index = index, .kind = kind, .depth = checker->depth + 1}));
+    }
+}
+
+static void referOptional(khFlatChecker* checker, uint32_t index, khFlatNodeKind kind) {
+    if (index != khFlat_NONE) {
+        refer(checker, index, kind);
+    }
+}
+
+static size_t referList(khFlatChecker* checker, uint32_t list, khFlatNodeKind kind) {
+    size_t size = checkList(checker, list, 1);
+    for (size_t i = 0; i < size; i++) {
+        refer(checker, khFlatAst_listItems(checker->ast, list)[i], kind);
+    }
+
+    return size;
+}
+
+static void checkVariable(khFlatChecker* checker, khFlatNode* node) {
+    uint32_t* record = checkRecord(checker, node->extra, 3);
+    if (record != NULL) {
+        checkStrings(checker, record[0]);
+        referOptional(checker, record[1], khFlatNodeKind_EXPRESSION);
+        referOptional(checker, record[2], khFlatNodeKind_EXPRESSION);
+    }
+}
+
+static void checkBlock(khFlatChecker* checker, uint32_t slot, uint16_t flags) {
+    if (flags & khFlatFlag_LAZY_BLOCK) {
+        checkRange(checker, slot);
+    }
+    else {
+        referList(checker, slot, khFlatNodeKind_STATEMENT);
+    }
+}
+
+static void checkPackedValues(khFlatChecker* checker, uint32_t slot, uint16_t flags) {
+    if (!(flags & khFlatFlag_PACKED)) {
+        referList(checker, slot, khFlatNodeKind_EXPRESSION);
+        return;
+    }
+
+    uint32_t* record = checkRecord(checker, slot, 3);
+    if (record == NULL) {
+        return;
+    }
+
+    // Only the literals which `khAstPackedValues` has a width for
+    switch (record[0]) {
+        case khAstExpressionType_CHAR:
+        case khAstExpressionType_BYTE:
+        case khAstExpressionType_INTEGER:
+        case khAstExpressionType_UINTEGER:
+        case khAstExpressionType_FLOAT:
+        case khAstExpressionType_DOUBLE:
+            checkBuffer(checker, slot + 1);
+            break;
+
+        default:
+            checker->valid = false;
+            break;
+    }
+}
+
+static void checkExpression(khFlatChecker* checker, khFlatNode* node) {
+    uint32_t* record;
+
+    switch (node->type) {
+        case khAstExpressionType_INVALID:
+        case khAstExpressionType_CHAR:
+        case khAstExpressionType_BYTE:
+        case khAstExpressionType_FLOAT:
+        case khAstExpressionType_IFLOAT:
+        case khAstExpressionType_ELLIPSIS:
+            break;
+
+        case khAstExpressionType_IDENTIFIER:
+            checkString(checker, node->extra);
+            break;
+        case khAstExpressionType_STRING:
+            if (node->flags & khFlatFlag_RAW) {
+                checkRange(checker, node->extra);
+            }
+            else {
+                checkString(checker, node->extra);
+            }
+            break;
+        case khAstExpressionType_BUFFER:
+            if (node->flags & khFlatFlag_RAW) {
+                checkRange(checker, node->extra);
+            }
+            else {
+                checkBuffer(checker, node->extra);
+            }
+            break;
+        case khAstExpressionType_INTEGER:
+        case khAstExpressionType_UINTEGER:
+        case khAstExpressionType_DOUBLE:
+        case khAstExpressionType_IDOUBLE:
+            hasSlots(checker, node->extra, 2);
+            break;
+
+        case khAstExpressionType_TUPLE:
+        case khAstExpressionType_ARRAY:
+            if ((record = checkRecord(checker, node->extra, 1)) != NULL) {
+                checkPackedValues(checker, record[0], node->flags);
+            }
+            break;
+        case khAstExpressionType_DICT:
+            if ((record = checkRecord(checker, node->extra, 2)) != NULL) {
+                checker->valid &= referList(checker, record[0], khFlatNodeKind_EXPRESSION) ==
+                                  referList(checker, record[1], khFlatNodeKind_EXPRESSION);
+            }
+            break;
+
+        case khAstExpressionType_SIGNATURE:
+            if ((record = checkRecord(checker, node->extra, 3)) != NULL) {
+                checker->valid &= checkList(checker, record[0], 1) ==
+                                  referList(checker, record[1], khFlatNodeKind_EXPRESSION);
+                referOptional(checker, record[2], khFlatNodeKind_EXPRESSION);
+            }
+            break;
+        case khAstExpressionType_LAMBDA:
+            if ((record = checkRecord(checker, node->extra, 4)) != NULL) {
+                referList(checker, record[0], khFlatNodeKind_VARIABLE);
+                referOptional(checker, record[1], khFlatNodeKind_VARIABLE);
+                referOptional(checker, record[2], khFlatNodeKind_EXPRESSION);
+                checkBlock(checker, record[3], node->flags);
+            }
+            break;
+
+        case khAstExpressionType_UNARY:
+            checker->valid &= node->flags <= khAstUnaryExpressionType_BIT_NOT;
+            refer(checker, node->extra, khFlatNodeKind_EXPRESSION);
+            break;
+        case khAstExpressionType_BINARY:
+            checker->valid &= node->flags <= khAstBinaryExpressionType_IP_BIT_RSHIFT;
+            if ((record = checkRecord(checker, node->extra, 2)) != NULL) {
+                refer(checker, record[0], khFlatNodeKind_EXPRESSION);
+                refer(checker, record[1], khFlatNodeKind_EXPRESSION);
+            }
+            break;
+        case khAstExpressionType_TERNARY:
+            if ((record = checkRecord(checker, node->extra, 3)) != NULL) {
+                refer(checker, record[0], khFlatNodeKind_EXPRESSION);
+                refer(checker, record[1], khFlatNodeKind_EXPRESSION);
+                refer(checker, record[2], khFlatNodeKind_EXPRESSION);
+            }
+            break;
+
+        case khAstExpressionType_COMPARISON:
+            if ((record = checkRecord(checker, node->extra, 2)) != NULL) {
+                size_t operations =
+                    checkValues(checker, record[0], khAstComparisonExpressionType_GREATER_EQUAL + 1);
+                checker->valid &=
+                    referList(checker, record[1], khFlatNodeKind_EXPRESSION) == operations + 1;
+            }
+            break;
+
+        case khAstExpressionType_CALL:
+        case khAstExpressionType_INDEX:
+        case khAstExpressionType_TEMPLATIZE:
+            if ((record = checkRecord(checker, node->extra, 2)) != NULL) {
+                refer(checker, record[0], khFlatNodeKind_EXPRESSION);
+                referList(checker, record[1], khFlatNodeKind_EXPRESSION);
+            }
+            break;
+        case khAstExpressionType_SCOPE:
+            if ((record = checkRecord(checker, node->extra, 2)) != NULL) {
+                refer(checker, record[0], khFlatNodeKind_EXPRESSION);
+                checkStrings(checker, record[1]);
+            }
+            break;
+
+        default:
+            checker->valid = false;
+            break;
+    }
+}
+
+static void checkStatement(khFlatChecker* checker, khFlatNode* node) {
+    uint32_t* record;
+
+    switch (node->type) {
+        case khAstStatementType_INVALID:
+        case khAstStatementType_BREAK:
+        case khAstStatementType_CONTINUE:
+            break;
+
+        case khAstStatementType_VARIABLE:
+            checkVariable(checker, node);
+            break;
+        case khAstStatementType_EXPRESSION:
+            refer(checker, node->extra, khFlatNodeKind_EXPRESSION);
+            break;
+
+        case khAstStatementType_IMPORT:
+            if ((record = checkRecord(checker, node->extra, 3)) != NULL) {
+                checkStrings(checker, record[0]);
+                if (node->flags & khFlatFlag_HAS_ALIAS) {
+                    checkString(checker, node->extra + 1);
+                }
+            }
+            break;
+        case khAstStatementType_INCLUDE:
+            if ((record = checkRecord(checker, node->extra, 1)) != NULL) {
+                checkStrings(checker, record[0]);
+            }
+            break;
+
+        case khAstStatementType_FUNCTION:
+            if ((record = checkRecord(checker, node->extra, 6)) != NULL) {
+                checkStrings(checker, record[0]);
+                checkStrings(checker, record[1]);
+                referList(checker, record[2], khFlatNodeKind_VARIABLE);
+                referOptional(checker, record[3], khFlatNodeKind_VARIABLE);
+                referOptional(checker, record[4], khFlatNodeKind_EXPRESSION);
+                checkBlock(checker, record[5], node->flags);
+            }
+            break;
+        case khAstStatementType_CLASS:
+            if ((record = checkRecord(checker, node->extra, 5)) != NULL) {
+                checkString(checker, node->extra);
+                checkStrings(checker, record[2]);
+                referOptional(checker, record[3], khFlatNodeKind_EXPRESSION);
+                referList(checker, record[4], khFlatNodeKind_STATEMENT);
+            }
+            break;
+        case khAstStatementType_STRUCT:
+            if ((record = checkRecord(checker, node->extra, 4)) != NULL) {
+                checkString(checker, node->extra);
+                checkStrings(checker, record[2]);
+                referList(checker, record[3], khFlatNodeKind_STATEMENT);
+            }
+            break;
+        case khAstStatementType_ENUM:
+            if ((record = checkRecord(checker, node->extra, 3)) != NULL) {
+                checkString(checker, node->extra);
+                checkStrings(checker, record[2]);
+            }
+            break;
+        case khAstStatementType_ALIAS:
+            if ((record = checkRecord(checker, node->extra, 3)) != NULL) {
+                checkString(checker, node->extra);
+                refer(checker, record[2], khFlatNodeKind_EXPRESSION);
+            }
+            break;
+
+        case khAstStatementType_IF_BRANCH:
+            if ((record = checkRecord(checker, node->extra, 3)) != NULL) {
+                size_t blocks = checkList(checker, record[1], 1);
+                checker->valid &=
+                    referList(checker, record[0], khFlatNodeKind_EXPRESSION) == blocks;
+                for (size_t i = 0; i < blocks; i++) {
+                    referList(checker, khFlatAst_listItems(checker->ast, record[1])[i],
+                              khFlatNodeKind_STATEMENT);
+                }
+                referList(checker, record[2], khFlatNodeKind_STATEMENT);
+            }
+            break;
+        case khAstStatementType_WHILE_LOOP:
+        case khAstStatementType_DO_WHILE_LOOP:
+            if ((record = checkRecord(checker, node->extra, 2)) != NULL) {
+                refer(checker, record[0], khFlatNodeKind_EXPRESSION);
+                referList(checker, record[1], khFlatNodeKind_STATEMENT);
+            }
+            break;
+        case khAstStatementType_FOR_LOOP:
+            if ((record = checkRecord(checker, node->extra, 3)) != NULL) {
+                checkStrings(checker, record[0]);
+                refer(checker, record[1], khFlatNodeKind_EXPRESSION);
+                referList(checker, record[2], khFlatNodeKind_STATEMENT);
+            }
+            break;
+        case khAstStatementType_RETURN:
+            if ((record = checkRecord(checker, node->extra, 1)) != NULL) {
+                referList(checker, record[0], khFlatNodeKind_EXPRESSION);
+            }
+            break;
+
+        default:
+            checker->valid = false;
+            break;
+    }
+}
+
+// Whether everything reachable from the top-level statements is where `unflatten` would read it
+bool khFlatAst_check(khFlatAst* ast, size_t origin_size) {
+    khFlatChecker checker = {.ast = ast,
+                             .origin_size = origin_size,
+                             .pending = kharray_new(khFlatReference, NULL),
+                             .reached = (bool*)calloc(kharray_size(&ast->nodes) + 1, sizeof(bool)),
+                             .depth = 0,
+                             .valid = true};
+    referList(&checker, ast->statements, khFlatNodeKind_STATEMENT);
+
+    while (checker.valid && kharray_size(&checker.pending) > 0) {
+        khFlatReference reference = checker.pending[kharray_size(&checker.pending) - 1];
+        kharray_pop(&checker.pending, 1);
+        khFlatNode* node = &ast->nodes[reference.index];
+
+        checker.valid &= !checker.reached[reference.index] && node->kind == reference.kind &&
+                         (node->begin == khFlat_NONE || node->begin <= origin_size) &&
+                         (node->end == khFlat_NONE || node->end <= origin_size);
+        if (!checker.valid) {
+            break;
+        }
+        checker.reached[reference.index] = true;
+        checker.depth = reference.depth;
+
+        switch (node->kind) {
+            case khFlatNodeKind_STATEMENT:
+                checkStatement(&checker, node);
+                break;
+            case khFlatNodeKind_EXPRESSION:
+                checkExpression(&checker, node);
+                break;
+            case khFlatNodeKind_VARIABLE:
+                checker.valid &= node->type == khAstStatementType_VARIABLE;
+                checkVariable(&checker, node);
+                break;
+        }
+    }
+
+    kharray_delete(&checker.pending);
+    free(checker.reached);
+    return checker.valid;
+}
+
+khFlatAst khFlatAst_decode(uint8_t* data, size_t size, size_t origin_size, bool* success) {
+    khFlatAst ast = {.nodes = kharray_new(khFlatNode, NULL),
+                     .extra = kharray_new(uint32_t, NULL),
+                     .strings = khstring_new(U""),
+                     .bytes = khbuffer_new(""),
+                     .statements = 0};
+    khVarintReader reader = khVarintReader_new(data, size);
+
+    uint8_t* header = khVarintReader_bytes(&reader, sizeof(magic));
+    if (header == NULL || memcmp(header, magic, sizeof(magic)) != 0 ||
+        khVarintReader_get(&reader, UINT32_MAX) != kh_FLAT_FORMAT_VERSION) {
+        *success = false;
+        return ast;
+    }
+
+    size_t nodes = khVarintReader_count(&reader);
+    size_t extra = khVarintReader_count(&reader);
+    size_t strings = khVarintReader_count(&reader);
+    size_t bytes = khVarintReader_count(&reader);
+    ast.statements = khVarintReader_get(&reader, extra > 0 ? extra - 1 : 0);
+
+    // Written straight into the reserved memory, as the sizes are known upfront
+    kharray_reserve(&ast.nodes, nodes);
+    uint32_t previous = 0;
+    for (size_t i = 0; i < nodes && reader.valid; i++) {
+        khFlatNode* node = &ast.nodes[i];
+        uint8_t tag = khVarintReader_get(&reader, 0xF);
+        node->kind = tag & 0b11;
+        node->type = khVarintReader_get(&reader, UINT8_MAX);
+        node->flags = khVarintReader_get(&reader, UINT16_MAX);
+
+        node->begin = khFlat_NONE;
+        if (tag & 1 << 2) {
+            node->begin = previous + kh_unzigzag(khVarintReader_get(&reader, UINT64_MAX));
+            previous = node->begin;
+        }
+        node->end = tag & 1 << 3 ? previous + kh_unzigzag(khVarintReader_get(&reader, UINT64_MAX))
+                                 : khFlat_NONE;
+
+        node->extra = khVarintReader_get(&reader, UINT32_MAX);
+    }
+    kharray_size(&ast.nodes) = nodes;
+
+    kharray_reserve(&ast.extra, extra);
+    for (size_t i = 0; i < extra && reader.valid; i++) {
+        ast.extra[i] = khVarintReader_get(&reader, UINT32_MAX);
+    }
+    kharray_size(&ast.extra) = extra;
+
+    kharray_reserve(&ast.strings, strings);
+    for (size_t i = 0; i < strings && reader.valid; i++) {
+        ast.strings[i] = khVarintReader_get(&reader, UINT32_MAX);
+    }
+    kharray_size(&ast.strings) = strings;
+
+    uint8_t* payload = khVarintReader_bytes(&reader, bytes);
+    if (payload != NULL) {
+        kharray_memory(&ast.bytes, payload, bytes, NULL);
+    }
+
+    *success = reader.valid && reader.cursor == reader.end && khFlatAst_check(&ast, origin_size);
+    return ast;
+}
@@ -7,16 +7,17 @@
 
 #include <math.h>
 #include <string.h>
-#include <wctype.h>
 
 #include <kithare/core/error.h>
 #include <kithare/core/lexer.h>
+#include <kithare/core/unicode.h>
 #include <kithare/lib/buffer.h>
 #include <kithare/lib/string.h>
 
 
-static inline void raiseError(char32_t* ptr, const char32_t* message) {
-    kh_raiseError((khError){.type = khErrorType_LEXER, .message = khstring_new(message), .data = ptr});
+static inline void raiseError(uint32_t offset, const char32_t* message) {
+    kh_raiseError(
+        (khError){.type = khErrorType_LEXER, .message = khstring_new(message), .offset = offset});
 }
 
 static inline uint8_t digitOf(char32_t chr) {
@@ -37,36 +38,127 @@ static inline uint8_t digitOf(char32_t chr) {
     }
 }
 
+static inline bool wordEquals(char32_t* begin, size_t length, const char32_t* cstring) {
+    for (size_t i = 0; i < length; i++) {
+        if (cstring[i] != begin[i]) {
+            return false;
+        }
+    }
+
+    // Only equal if the C-string ends right there too
+    return cstring[length] == U'\0';
+}
+
+// Skips a string literal which has no escapes, as its payload is just the source between the quotes.
+// Returns false without moving the cursor if it has any, or anything `kh_lexString` would raise an
+// error for, so that it gets lexed normally instead
+static bool skipRawString(char32_t** cursor, bool is_buffer) {
+    char32_t* chr = *cursor + 1;
+    bool multiline = chr[0] == U'"' && chr[1] == U'"';
+    if (multiline) {
+        chr += 2;
+    }
+
+    while (true) {
+        switch (*chr) {
+            case U'"':
+                if (!multiline) {
+                    *cursor = chr + 1;
+                    return true;
+                }
+                else if (chr[1] == U'"' && chr[2] == U'"') {
+                    *cursor = chr + 3;
+                    return true;
+                }
+                break;
+
+            case U'\n':
+                if (!multiline) {
+                    return false;
+                }
+                break;
+
+            case U'\\':
+            case U'\0':
+                return false;
+
+            default:
+                if (is_buffer && *chr > 255) {
+                    return false;
+                }
+                break;
+        }
+
+        chr++;
+    }
+}
+
+
+bool kh_checkSourceSize(khstring* string) {
+    if (khstring_size(string) <= kh_MAX_SOURCE_SIZE) {
+        return true;
+    }
+
+    raiseError(0, U"source is too long, it has to be shorter than 4294967295 characters");
+    return false;
+}
 
 kharray(khToken) kh_lexicate(khstring* string) {
     kharray(khToken) tokens = kharray_new(khToken, khToken_delete);
+    if (!kh_checkSourceSize(string)) {
+        return tokens;
+    }
+
     char32_t* cursor = *string;
 
     do {
-        kharray_append(&tokens, kh_lexToken(&cursor));
+        kharray_append(&tokens, kh_lexToken(&cursor, *string));
     } while (tokens[kharray_size(&tokens) - 1].type != khTokenType_EOF);
     kharray_pop(&tokens, 1);
 
     return tokens;
 }
 
+void kh_lexicateEach(khstring* string, bool (*callback)(khToken* token, void* data), void* data) {
+    if (!kh_checkSourceSize(string)) {
+        return;
+    }
+
+    char32_t* cursor = *string;
 
-khToken kh_lexToken(char32_t** cursor) {
+    while (true) {
+        khToken token = kh_lexToken(&cursor, *string);
+        if (token.type == khTokenType_EOF) {
+            break;
+        }
+
+        // The token is only lent to the callback, then deleted right after
+        bool proceed = callback(&token, data);
+        khToken_delete(&token);
+
+        if (!proceed) {
+            break;
+        }
+    }
+}
+
+
+khToken kh_lexToken(char32_t** cursor, char32_t* origin) {
     // Skips any whitespace
-    while (iswspace(**cursor)) {
+    while (kh_isSpace(**cursor)) {
         // Special case for newline
         if (**cursor == U'\n') {
             (*cursor)++;
-            return khToken_fromNewline(*cursor - 1, *cursor);
+            return khToken_fromNewline(*cursor - 1 - origin, *cursor - origin);
         }
         else {
             (*cursor)++;
         }
     }
 
-    char32_t* begin = *cursor;
+    uint32_t begin = *cursor - origin;
 
-    if (iswalpha(**cursor) || **cursor == U'_') {
+    if (kh_isXidStart(**cursor) || **cursor == U'_') {
         if (**cursor == U'b' || **cursor == U'B') {
             (*cursor)++;
 
@@ -75,13 +167,17 @@ khToken kh_lexToken(char32_t** cursor) {
                 case U'\'': {
                     // Don't put kh_lexChar call in khToken_fromByte, as the evaluation of arguments
                     // aren't set by the C standard
-                    char32_t chr = kh_lexChar(cursor, true, true);
-                    return khToken_fromByte(chr, begin, *cursor);
+                    char32_t chr = kh_lexChar(cursor, origin, true, true);
+                    return khToken_fromByte(chr, begin, *cursor - origin);
                 }
 
                 // Buffers: b"1234"
                 case U'"': {
-                    khstring string = kh_lexString(cursor, true);
+                    if (skipRawString(cursor, true)) {
+                        return khToken_fromBuffer(NULL, begin, *cursor - origin);
+                    }
+
+                    khstring string = kh_lexString(cursor, origin, true);
                     khbuffer buffer = khbuffer_new("");
                     kharray_reserve(&buffer, khstring_size(&string));
 
@@ -90,31 +186,35 @@ khToken kh_lexToken(char32_t** cursor) {
                     }
 
                     khstring_delete(&string);
-                    return khToken_fromBuffer(buffer, begin, *cursor);
+                    return khToken_fromBuffer(buffer, begin, *cursor - origin);
                 }
 
                 default:
                     (*cursor)--;
-                    return kh_lexWord(cursor);
+                    return kh_lexWord(cursor, origin);
             }
         }
         else {
-            return kh_lexWord(cursor);
+            return kh_lexWord(cursor, origin);
         }
     }
     else if (digitOf(**cursor) < 10) {
-        return kh_lexNumber(cursor);
+        return kh_lexNumber(cursor, origin);
     }
     else {
         switch (**cursor) {
             case U'\'': {
-                char32_t chr = kh_lexChar(cursor, true, false);
-                return khToken_fromChar(chr, begin, *cursor);
+                char32_t chr = kh_lexChar(cursor, origin, true, false);
+                return khToken_fromChar(chr, begin, *cursor - origin);
             }
 
             case U'"': {
-                khstring string = kh_lexString(cursor, false);
-                return khToken_fromString(string, begin, *cursor);
+                if (skipRawString(cursor, false)) {
+                    return khToken_fromString(NULL, begin, *cursor - origin);
+                }
+
+                khstring string = kh_lexString(cursor, origin, false);
+                return khToken_fromString(string, begin, *cursor - origin);
             }
 
             case U'#':
@@ -123,29 +223,28 @@ khToken kh_lexToken(char32_t** cursor) {
                 if (**cursor == U'\n') {
                     (*cursor)++;
                 }
-                return khToken_fromComment(begin, *cursor);
+                return khToken_fromComment(begin, *cursor - origin);
 
             default:
-                return kh_lexSymbol(cursor);
+                return kh_lexSymbol(cursor, origin);
         }
     }
 }
 
-khToken kh_lexWord(char32_t** cursor) {
+khToken kh_lexWord(char32_t** cursor, char32_t* origin) {
     char32_t* begin = *cursor;
 
-    // Passes through alphanumeric or underscore characters in a row
-    while (iswalnum(**cursor) || **cursor == U'_') {
+    // Passes through XID_Continue characters in a row, which includes the underscore
+    while (kh_isXidContinue(**cursor)) {
         (*cursor)++;
     }
 
-    khstring identifier = khstring_new(U"");
-    kharray_memory(&identifier, begin, *cursor - begin, NULL);
+    // Keywords are matched against the source directly, only identifiers get their string allocated
+    size_t length = *cursor - begin;
 
 #define CASE_OPERATOR(STRING, OPERATOR)                        \
-    if (khstring_equalCstring(&identifier, STRING)) {          \
-        khstring_delete(&identifier);                          \
-        return khToken_fromOperator(OPERATOR, begin, *cursor); \
+    if (wordEquals(begin, length, STRING)) {                   \
+        return khToken_fromOperator(OPERATOR, begin - origin, *cursor - origin); \
     }
 
     CASE_OPERATOR(U"not", khOperatorToken_NOT);
@@ -154,9 +253,8 @@ khToken kh_lexWord(char32_t** cursor) {
     CASE_OPERATOR(U"xor", khOperatorToken_XOR);
 
 #define CASE_KEYWORD(STRING, KEYWORD)                        \
-    if (khstring_equalCstring(&identifier, STRING)) {        \
-        khstring_delete(&identifier);                        \
-        return khToken_fromKeyword(KEYWORD, begin, *cursor); \
+    if (wordEquals(begin, length, STRING)) {                 \
+        return khToken_fromKeyword(KEYWORD, begin - origin, *cursor - origin); \
     }
 
     CASE_KEYWORD(U"import", khKeywordToken_IMPORT);
@@ -188,16 +286,19 @@ khToken kh_lexWord(char32_t** cursor) {
 #undef CASE_OPERATOR
 #undef CASE_KEYWORD
 
-    return khToken_fromIdentifier(identifier, begin, *cursor);
+    khstring identifier = khstring_new(U"");
+    kharray_memory(&identifier, begin, length, NULL);
+
+    return khToken_fromIdentifier(identifier, begin - origin, *cursor - origin);
 }
 
-khToken kh_lexNumber(char32_t** cursor) {
-    char32_t* begin = *cursor;
+khToken kh_lexNumber(char32_t** cursor, char32_t* origin) {
+    uint32_t begin = *cursor - origin;
 
     if (digitOf(**cursor) > 9) {
         (*cursor)++;
-        raiseError(*cursor, U"expecting a decimal number, from 0 to 9");
-        return khToken_fromInvalid(*cursor, *cursor);
+        raiseError(*cursor - origin, U"expecting a decimal number, from 0 to 9");
+        return khToken_fromInvalid(*cursor - origin, *cursor - origin);
     }
 
     uint8_t base = 10;
@@ -229,86 +330,86 @@ khToken kh_lexNumber(char32_t** cursor) {
         }
     }
 
-    char32_t* origin = *cursor;
+    char32_t* digits = *cursor;
     bool had_overflowed;
-    uint64_t integer = kh_lexInt(cursor, base, -1, &had_overflowed);
+    uint64_t integer = kh_lexInt(cursor, origin, base, -1, &had_overflowed);
 
     // When it didn't lex any characters (presumably because it's out of base)
-    if (*cursor == origin) {
+    if (*cursor == digits) {
         switch (base) {
             case 2:
-                raiseError(*cursor, U"expecting a binary number, either 0 or 1");
+                raiseError(*cursor - origin, U"expecting a binary number, either 0 or 1");
                 break;
 
             case 8:
-                raiseError(*cursor, U"expecting an octal number, from 0 to 7");
+                raiseError(*cursor - origin, U"expecting an octal number, from 0 to 7");
                 break;
 
             case 10:
-                raiseError(*cursor, U"expecting a decimal number, from 0 to 9");
+                raiseError(*cursor - origin, U"expecting a decimal number, from 0 to 9");
                 break;
 
             case 16:
-                raiseError(*cursor, U"expecting a hexadecimal number, from 0 to 9 or A to F");
+                raiseError(*cursor - origin, U"expecting a hexadecimal number, from 0 to 9 or A to F");
                 break;
         }
 
-        return khToken_fromInvalid(begin, *cursor);
+        return khToken_fromInvalid(begin, *cursor - origin);
     }
     // If it was a floating point
     else if (**cursor == U'e' || **cursor == U'E' || **cursor == U'p' || **cursor == U'P' ||
              **cursor == U'f' || **cursor == U'F' || **cursor == 'j' || **cursor == 'J' ||
              **cursor == 'i' || **cursor == 'I' || ((*cursor)[0] == U'.' && (*cursor)[1] != U'.')) {
-        *cursor = origin;
-        double floating = kh_lexFloat(cursor, base);
+        *cursor = digits;
+        double floating = kh_lexFloat(cursor, origin, base);
 
         switch (*(*cursor)++) {
             // Explicit float
             case U'f':
             case U'F':
-                return khToken_fromFloat(floating, begin, *cursor);
+                return khToken_fromFloat(floating, begin, *cursor - origin);
 
             // Imaginary float
             case U'j':
             case U'J':
-                return khToken_fromIfloat(floating, begin, *cursor);
+                return khToken_fromIfloat(floating, begin, *cursor - origin);
 
             // Imaginary double
             case U'i':
             case U'I':
-                return khToken_fromIdouble(floating, begin, *cursor);
+                return khToken_fromIdouble(floating, begin, *cursor - origin);
 
             // Defaults to a double, without any suffixes
             default:
                 (*cursor)--;
-                return khToken_fromDouble(floating, begin, *cursor);
+                return khToken_fromDouble(floating, begin, *cursor - origin);
         }
     }
     else if (had_overflowed) {
-        raiseError(*cursor - 1, U"integer constant must not exceed 2^64");
-        return khToken_fromInvalid(begin, *cursor);
+        raiseError(*cursor - 1 - origin, U"integer constant must not exceed 2^64");
+        return khToken_fromInvalid(begin, *cursor - origin);
     }
     else if (**cursor == U'u' || **cursor == U'U') {
         (*cursor)++;
-        return khToken_fromUinteger(integer, begin, *cursor);
+        return khToken_fromUinteger(integer, begin, *cursor - origin);
     }
     else {
         if (integer > (1ull << 63ull) - 1ull) {
-            return khToken_fromUinteger(integer, begin, *cursor);
+            return khToken_fromUinteger(integer, begin, *cursor - origin);
         }
         else {
-            return khToken_fromInteger(integer, begin, *cursor);
+            return khToken_fromInteger(integer, begin, *cursor - origin);
         }
     }
 }
 
 
-khToken kh_lexSymbol(char32_t** cursor) {
-    char32_t* begin = *cursor;
+khToken kh_lexSymbol(char32_t** cursor, char32_t* origin) {
+    uint32_t begin = *cursor - origin;
 
 #define CASE_DELIMITER(CHR, DELIMITER) \
     case CHR:                          \
-        return khToken_fromDelimiter(DELIMITER, begin, *cursor)
+        return khToken_fromDelimiter(DELIMITER, begin, *cursor - origin)
 
     switch (*(*cursor)++) {
         // Pretty repetitive stuff here. Macros are utilized
@@ -326,181 +427,185 @@ khToken kh_lexSymbol(char32_t** cursor) {
         case U'.':
             if ((*cursor)[0] == U'.' && (*cursor)[1] == U'.') {
                 *cursor += 2;
-                return khToken_fromDelimiter(khDelimiterToken_ELLIPSIS, begin, *cursor);
+                return khToken_fromDelimiter(khDelimiterToken_ELLIPSIS, begin, *cursor - origin);
             }
             else if (**cursor == U'.') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_RANGE, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_RANGE, begin, *cursor - origin);
             }
             else {
-                return khToken_fromDelimiter(khDelimiterToken_DOT, begin, *cursor);
+                return khToken_fromDelimiter(khDelimiterToken_DOT, begin, *cursor - origin);
             }
 
         // Down here are where many multiple-character-operators are handled
         case U'+':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_IP_ADD, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_IP_ADD, begin, *cursor - origin);
             }
             else {
-                return khToken_fromOperator(khOperatorToken_ADD, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_ADD, begin, *cursor - origin);
             }
 
         case U'-':
             switch (*(*cursor)++) {
                 case U'=':
-                    return khToken_fromOperator(khOperatorToken_IP_SUB, begin, *cursor);
+                    return khToken_fromOperator(khOperatorToken_IP_SUB, begin, *cursor - origin);
 
                 case U'>':
-                    return khToken_fromDelimiter(khDelimiterToken_ARROW, begin, *cursor);
+                    return khToken_fromDelimiter(khDelimiterToken_ARROW, begin, *cursor - origin);
 
                 default:
                     (*cursor)--;
-                    return khToken_fromOperator(khOperatorToken_SUB, begin, *cursor);
+                    return khToken_fromOperator(khOperatorToken_SUB, begin, *cursor - origin);
             }
 
         case U'*':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_IP_MUL, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_IP_MUL, begin, *cursor - origin);
             }
             else {
-                return khToken_fromOperator(khOperatorToken_MUL, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_MUL, begin, *cursor - origin);
             }
 
         case U'/':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_IP_DIV, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_IP_DIV, begin, *cursor - origin);
             }
             else {
-                return khToken_fromOperator(khOperatorToken_DIV, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_DIV, begin, *cursor - origin);
             }
 
         case U'%':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_IP_MOD, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_IP_MOD, begin, *cursor - origin);
             }
             else {
-                return khToken_fromOperator(khOperatorToken_MOD, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_MOD, begin, *cursor - origin);
             }
 
         case U'@':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_IP_DOT, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_IP_DOT, begin, *cursor - origin);
             }
             else {
-                return khToken_fromOperator(khOperatorToken_DOT, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_DOT, begin, *cursor - origin);
             }
 
         case U'^':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_IP_POW, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_IP_POW, begin, *cursor - origin);
             }
             else {
-                return khToken_fromOperator(khOperatorToken_POW, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_POW, begin, *cursor - origin);
             }
 
         case U'=':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_EQUAL, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_EQUAL, begin, *cursor - origin);
             }
             else {
-                return khToken_fromOperator(khOperatorToken_ASSIGN, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_ASSIGN, begin, *cursor - origin);
             }
 
         case U'!':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_UNEQUAL, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_UNEQUAL, begin, *cursor - origin);
             }
             else {
-                return khToken_fromDelimiter(khDelimiterToken_EXCLAMATION, begin, *cursor);
+                return khToken_fromDelimiter(khDelimiterToken_EXCLAMATION, begin, *cursor - origin);
             }
 
         case U'<':
             switch (*(*cursor)++) {
                 case U'=':
-                    return khToken_fromOperator(khOperatorToken_LESS_EQUAL, begin, *cursor);
+                    return khToken_fromOperator(khOperatorToken_LESS_EQUAL, begin, *cursor - origin);
 
                 case U'<':
                     if (**cursor == U'=') {
                         (*cursor)++;
-                        return khToken_fromOperator(khOperatorToken_IP_BIT_LSHIFT, begin, *cursor);
+                        return khToken_fromOperator(khOperatorToken_IP_BIT_LSHIFT, begin,
+                                                    *cursor - origin);
                     }
                     else {
-                        return khToken_fromOperator(khOperatorToken_BIT_LSHIFT, begin, *cursor);
+                        return khToken_fromOperator(khOperatorToken_BIT_LSHIFT, begin,
+                                                    *cursor - origin);
                     }
 
                 default:
                     (*cursor)--;
-                    return khToken_fromOperator(khOperatorToken_LESS, begin, *cursor);
+                    return khToken_fromOperator(khOperatorToken_LESS, begin, *cursor - origin);
             }
 
         case U'>':
             switch (*(*cursor)++) {
                 case U'=':
-                    return khToken_fromOperator(khOperatorToken_GREATER_EQUAL, begin, *cursor);
+                    return khToken_fromOperator(khOperatorToken_GREATER_EQUAL, begin, *cursor - origin);
 
                 case U'<':
                     if (**cursor == U'=') {
                         (*cursor)++;
-                        return khToken_fromOperator(khOperatorToken_IP_BIT_RSHIFT, begin, *cursor);
+                        return khToken_fromOperator(khOperatorToken_IP_BIT_RSHIFT, begin,
+                                                    *cursor - origin);
                     }
                     else {
-                        return khToken_fromOperator(khOperatorToken_BIT_RSHIFT, begin, *cursor);
+                        return khToken_fromOperator(khOperatorToken_BIT_RSHIFT, begin,
+                                                    *cursor - origin);
                     }
 
                 default:
                     (*cursor)--;
-                    return khToken_fromOperator(khOperatorToken_GREATER, begin, *cursor);
+                    return khToken_fromOperator(khOperatorToken_GREATER, begin, *cursor - origin);
             }
 
         case U'~':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_IP_BIT_XOR, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_IP_BIT_XOR, begin, *cursor - origin);
             }
             else {
                 // It's also khOperatorToken_BIT_XOR
-                return khToken_fromOperator(khOperatorToken_BIT_OR, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_BIT_OR, begin, *cursor - origin);
             }
 
         case U'&':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_IP_BIT_AND, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_IP_BIT_AND, begin, *cursor - origin);
             }
             else {
-                return khToken_fromOperator(khOperatorToken_BIT_AND, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_BIT_AND, begin, *cursor - origin);
             }
 
         case U'|':
             if (**cursor == U'=') {
                 (*cursor)++;
-                return khToken_fromOperator(khOperatorToken_IP_BIT_OR, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_IP_BIT_OR, begin, *cursor - origin);
             }
             else {
-                return khToken_fromOperator(khOperatorToken_BIT_OR, begin, *cursor);
+                return khToken_fromOperator(khOperatorToken_BIT_OR, begin, *cursor - origin);
             }
 
         // Null-terminator, string end
         case U'\0':
             (*cursor)--;
-            return khToken_fromEof(begin, *cursor);
+            return khToken_fromEof(begin, *cursor - origin);
 
         default:
-            raiseError(*cursor - 1, U"unknown character");
-            return khToken_fromInvalid(begin, *cursor);
+            raiseError(*cursor - 1 - origin, U"unknown character");
+            return khToken_fromInvalid(begin, *cursor - origin);
     }
 #undef CASE_DELIMITER
 }
 
-char32_t kh_lexChar(char32_t** cursor, bool with_quotes, bool is_byte) {
+char32_t kh_lexChar(char32_t** cursor, char32_t* origin, bool with_quotes, bool is_byte) {
     char32_t chr = 0;
 
     if (with_quotes) {
@@ -508,7 +613,7 @@ char32_t kh_lexChar(char32_t** cursor, bool with_quotes, bool is_byte) {
             (*cursor)++;
         }
         else {
-            raiseError(*cursor, U"expecting a single quote opening for a character");
+            raiseError(*cursor - origin, U"expecting a single quote opening for a character");
         }
     }
 
@@ -556,9 +661,9 @@ char32_t kh_lexChar(char32_t** cursor, bool with_quotes, bool is_byte) {
             case U'x': {
                 char32_t* origin = *cursor;
 
-                chr = kh_lexInt(cursor, 16, 2, NULL);
+                chr = kh_lexInt(cursor, origin, 16, 2, NULL);
                 if (*cursor != origin + 2) {
-                    raiseError(*cursor,
+                    raiseError(*cursor - origin,
                                U"expecting 2 hexadecimal digits for 1 byte character, from 0 to 9 or "
                                U"A to F");
                 }
@@ -570,17 +675,17 @@ char32_t kh_lexChar(char32_t** cursor, bool with_quotes, bool is_byte) {
             case U'u': {
                 if (is_byte) {
                     raiseError(
-                        *cursor - 1,
+                        *cursor - 1 - origin,
                         U"only allowing one byte characters, 2 byte unicode escapes are not allowed");
                     break;
                 }
 
                 char32_t* origin = *cursor;
 
-                chr = kh_lexInt(cursor, 16, 4, NULL);
+                chr = kh_lexInt(cursor, origin, 16, 4, NULL);
                 if (*cursor != origin + 4) {
                     raiseError(
-                        *cursor,
+                        *cursor - origin,
                         U"expecting 4 hexadecimal digits for 2 byte unicode character, from 0 to 9 or "
                         U"A to F");
                 }
@@ -592,17 +697,17 @@ char32_t kh_lexChar(char32_t** cursor, bool with_quotes, bool is_byte) {
             case U'U': {
                 if (is_byte) {
                     raiseError(
-                        *cursor - 1,
+                        *cursor - 1 - origin,
                         U"only allowing one byte characters, 4 byte unicode escapes are not allowed");
                     break;
                 }
 
                 char32_t* origin = *cursor;
 
-                chr = kh_lexInt(cursor, 16, 8, NULL);
+                chr = kh_lexInt(cursor, origin, 16, 8, NULL);
                 if (*cursor != origin + 8) {
                     raiseError(
-                        *cursor,
+                        *cursor - origin,
                         U"expecting 8 hexadecimal digits for 4 byte unicode character, from 0 to 9 or "
                         U"A to F");
                 }
@@ -613,12 +718,13 @@ char32_t kh_lexChar(char32_t** cursor, bool with_quotes, bool is_byte) {
             // Unexpected null-terminator
             case U'\0':
                 (*cursor)--;
-                raiseError(*cursor, U"expecting a backslash escape character, met with a dead end");
+                raiseError(*cursor - origin,
+                           U"expecting a backslash escape character, met with a dead end");
                 return chr;
 
             // Unrecognized escape character
             default:
-                raiseError(*cursor - 1, U"unknown backslash escape character");
+                raiseError(*cursor - 1 - origin, U"unknown backslash escape character");
                 break;
         }
     }
@@ -629,23 +735,25 @@ char32_t kh_lexChar(char32_t** cursor, bool with_quotes, bool is_byte) {
             // Encourage users to use U'\'' instead
             case U'\'':
                 if (with_quotes) {
-                    raiseError(*cursor, U"a character cannot be closed empty, did you mean U'\\''");
+                    raiseError(*cursor - origin,
+                               U"a character cannot be closed empty, did you mean U'\\''");
                 }
                 break;
 
             // Encourage users to use U'\n' instead
             case U'\n':
-                raiseError(*cursor, U"a newline instead of an inline character, did you mean U'\\n'");
+                raiseError(*cursor - origin,
+                           U"a newline instead of an inline character, did you mean U'\\n'");
                 break;
 
             // Unexpected null-terminator
             case U'\0':
-                raiseError(*cursor, U"expecting a character, met with a dead end");
+                raiseError(*cursor - origin, U"expecting a character, met with a dead end");
                 return chr;
 
             default:
                 if (is_byte && chr > 255) {
-                    raiseError(*cursor,
+                    raiseError(*cursor - origin,
                                U"only allowing one byte characters, unicode character is forbidden");
                 }
                 break;
@@ -659,14 +767,14 @@ char32_t kh_lexChar(char32_t** cursor, bool with_quotes, bool is_byte) {
             (*cursor)++;
         }
         else {
-            raiseError(*cursor, U"expecting a single quote closing of the character");
+            raiseError(*cursor - origin, U"expecting a single quote closing of the character");
         }
     }
 
     return chr;
 }
 
-khstring kh_lexString(char32_t** cursor, bool is_buffer) {
+khstring kh_lexString(char32_t** cursor, char32_t* origin, bool is_buffer) {
     khstring string = khstring_new(U"");
     bool multiline = false;
 
@@ -680,7 +788,7 @@ khstring kh_lexString(char32_t** cursor, bool is_buffer) {
         }
     }
     else {
-        raiseError(*cursor, U"expecting a double quote for a string");
+        raiseError(*cursor - origin, U"expecting a double quote for a string");
     }
 
     while (true) {
@@ -710,7 +818,7 @@ khstring kh_lexString(char32_t** cursor, bool is_buffer) {
                     khstring_append(&string, U'\n');
                 }
                 else {
-                    raiseError(*cursor - 1,
+                    raiseError(*cursor - 1 - origin,
                                U"a newline instead of an inline character, use U'\\n' or a multiline "
                                U"string instead");
                 }
@@ -718,12 +826,12 @@ khstring kh_lexString(char32_t** cursor, bool is_buffer) {
 
             // Unexpected null-terminator
             case U'\0':
-                raiseError(*cursor, U"expecting a character, met with a dead end");
+                raiseError(*cursor - origin, U"expecting a character, met with a dead end");
                 return string;
 
             // Use kh_lexChar for other character encounters
             default:
-                khstring_append(&string, kh_lexChar(cursor, false, is_buffer));
+                khstring_append(&string, kh_lexChar(cursor, origin, false, is_buffer));
                 break;
         }
     }
@@ -731,7 +839,8 @@ khstring kh_lexString(char32_t** cursor, bool is_buffer) {
     return string;
 }
 
-uint64_t kh_lexInt(char32_t** cursor, uint8_t base, size_t max_length, bool* had_overflowed) {
+uint64_t kh_lexInt(char32_t** cursor, char32_t* origin, uint8_t base, size_t max_length,
+                   bool* had_overflowed) {
     uint64_t result = 0;
 
     if (had_overflowed != NULL) {
@@ -755,7 +864,7 @@ uint64_t kh_lexInt(char32_t** cursor, uint8_t base, size_t max_length, bool* had
     return result;
 }
 
-double kh_lexFloat(char32_t** cursor, uint8_t base) {
+double kh_lexFloat(char32_t** cursor, char32_t* origin, uint8_t base) {
     double result = 0;
 
     // The same implementation of kh_lexInt is used here. The reason of not using kh_lexInt directly
@@ -789,7 +898,7 @@ double kh_lexFloat(char32_t** cursor, uint8_t base) {
             if (**cursor == U'-') {
                 (*cursor)++;
 
-                result *= pow(10, -kh_lexInt(cursor, 10, -1, &had_overflowed));
+                result *= pow(10, -kh_lexInt(cursor, origin, 10, -1, &had_overflowed));
                 if (had_overflowed) {
                     result = 0.0;
                 }
@@ -799,7 +908,7 @@ double kh_lexFloat(char32_t** cursor, uint8_t base) {
                     (*cursor)++;
                 }
 
-                result *= pow(10, kh_lexInt(cursor, 10, -1, &had_overflowed));
+                result *= pow(10, kh_lexInt(cursor, origin, 10, -1, &had_overflowed));
                 if (had_overflowed) {
                     result = INFINITY;
                 }
@@ -816,7 +925,7 @@ double kh_lexFloat(char32_t** cursor, uint8_t base) {
             if (**cursor == U'-') {
                 (*cursor)++;
 
-                result *= pow(2, -kh_lexInt(cursor, 10, -1, &had_overflowed));
+                result *= pow(2, -kh_lexInt(cursor, origin, 10, -1, &had_overflowed));
                 if (had_overflowed) {
                     result = 0.0;
                 }
@@ -826,7 +935,7 @@ double kh_lexFloat(char32_t** cursor, uint8_t base) {
                     (*cursor)++;
                 }
 
-                result *= pow(2, kh_lexInt(cursor, 10, -1, &had_overflowed));
+                result *= pow(2, kh_lexInt(cursor, origin, 10, -1, &had_overflowed));
                 if (had_overflowed) {
                     result = INFINITY;
                 }
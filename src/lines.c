@@ -0,0 +1,168 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <kithare/core/lines.h>
+
+
+// Portable SIMD through GCC's vector extensions, lowered into SSE2/NEON/etc. by the compiler
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+typedef int32_t v4i32 __attribute__((vector_size(16)));
+
+
+static inline v4u32 load(char32_t* ptr) {
+    v4u32 vector;
+    memcpy(&vector, ptr, sizeof(vector));
+    return vector;
+}
+
+static inline bool anyLane(v4i32 mask) {
+    uint64_t halves[2];
+    memcpy(halves, &mask, sizeof(halves));
+    return (halves[0] | halves[1]) != 0;
+}
+
+static void scanNewlines(khLineIndex* index, char32_t* begin, char32_t* end) {
+    const v4u32 newlines = {U'\n', U'\n', U'\n', U'\n'};
+    char32_t* chr = begin;
+
+    // Checks 8 characters at a time, only going through them one by one when there's a newline
+    for (; chr + 8 <= end; chr += 8) {
+        if (!anyLane((load(chr) == newlines) | (load(chr + 4) == newlines))) {
+            continue;
+        }
+
+        for (size_t i = 0; i < 8; i++) {
+            if (chr[i] == U'\n') {
+                kharray_append(&index->line_offsets, chr + i + 1 - index->origin);
+            }
+        }
+    }
+
+    for (; chr < end; chr++) {
+        if (*chr == U'\n') {
+            kharray_append(&index->line_offsets, chr + 1 - index->origin);
+        }
+    }
+}
+
+static inline size_t utf8Size(char32_t chr) {
+    return 1 + (chr > 0x7F) + (chr > 0x7FF) + (chr > 0xFFFF);
+}
+
+// Size of the range once encoded by kh_encodeUtf8
+static size_t utf8Length(char32_t* begin, char32_t* end) {
+    const v4u32 limit1 = {0x7F, 0x7F, 0x7F, 0x7F};
+    const v4u32 limit2 = {0x7FF, 0x7FF, 0x7FF, 0x7FF};
+    const v4u32 limit3 = {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF};
+
+    size_t length = end - begin;
+    char32_t* chr = begin;
+
+    // Each comparison yields -1 on the lanes where the character needs an extra byte
+    v4i32 extra = {0, 0, 0, 0};
+    for (; chr + 4 <= end; chr += 4) {
+        v4u32 vector = load(chr);
+        extra -= (vector > limit1) + (vector > limit2) + (vector > limit3);
+    }
+    length += extra[0] + extra[1] + extra[2] + extra[3];
+
+    for (; chr < end; chr++) {
+        length += utf8Size(*chr) - 1;
+    }
+
+    return length;
+}
+
+
+khLineIndex khLineIndex_new(khstring* string) {
+    khLineIndex index = khLineIndex_newEmpty(string);
+    scanNewlines(&index, *string, *string + khstring_size(string));
+    return index;
+}
+
+khLineIndex khLineIndex_newEmpty(khstring* string) {
+    khLineIndex index = {.origin = *string,
+                         .line_offsets = kharray_new(size_t, NULL),
+                         .line_byte_offsets = kharray_new(size_t, NULL)};
+
+    kharray_append(&index.line_offsets, 0);
+    kharray_append(&index.line_byte_offsets, 0);
+    return index;
+}
+
+void khLineIndex_delete(khLineIndex* index) {
+    kharray_delete(&index->line_offsets);
+    kharray_delete(&index->line_byte_offsets);
+}
+
+void khLineIndex_addToken(khLineIndex* index, khToken* token) {
+    switch (token->type) {
+        case khTokenType_NEWLINE:
+            kharray_append(&index->line_offsets, token->end);
+            break;
+
+        // Tokens which may contain newlines; comments include their terminating newline
+        case khTokenType_INVALID:
+        case khTokenType_COMMENT:
+        case khTokenType_CHAR:
+        case khTokenType_STRING:
+        case khTokenType_BUFFER:
+        case khTokenType_BYTE:
+            scanNewlines(index, index->origin + token->begin, index->origin + token->end);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void khLineIndex_addRange(khLineIndex* index, uint32_t begin, uint32_t end) {
+    scanNewlines(index, index->origin + begin, index->origin + end);
+}
+
+void khLineIndex_merge(khLineIndex* index, khLineIndex* other) {
+    size_t last = index->line_offsets[kharray_size(&index->line_offsets) - 1];
+    for (size_t i = 0; i < kharray_size(&other->line_offsets); i++) {
+        if (other->line_offsets[i] > last) {
+            kharray_append(&index->line_offsets, other->line_offsets[i]);
+        }
+    }
+}
+
+khSourcePosition khLineIndex_position(khLineIndex* index, uint32_t offset) {
+    // Binary searches the last line which begins at or before the offset
+    size_t low = 0;
+    size_t high = kharray_size(&index->line_offsets);
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+
+        if (index->line_offsets[middle] <= offset) {
+            low = middle;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    // Fills in the UTF-8 offsets of the lines up to this one
+    for (size_t line = kharray_size(&index->line_byte_offsets); line <= low; line++) {
+        size_t previous = index->line_byte_offsets[line - 1];
+        kharray_append(&index->line_byte_offsets,
+                       previous + utf8Length(index->origin + index->line_offsets[line - 1],
+                                             index->origin + index->line_offsets[line]));
+    }
+
+    char32_t* line_begin = index->origin + index->line_offsets[low];
+    size_t byte_offset = index->line_byte_offsets[low] + utf8Length(line_begin, index->origin + offset);
+    return (khSourcePosition){.line = low + 1,
+                              .column = offset - index->line_offsets[low] + 1,
+                              .byte_offset = byte_offset};
+}
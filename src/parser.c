@@ -5,155 +5,812 @@
  * Copyright (C) 2022 Kithare Organization
  */
 
+#include <pthread.h>
+#include <stdlib.h>
+
 #include <kithare/core/error.h>
 #include <kithare/core/lexer.h>
 #include <kithare/core/parser.h>
+#include <kithare/core/pipe.h>
 #include <kithare/core/token.h>
+#include <kithare/core/unicode.h>
+
+
+// Tokens get lexed only once, lazily as the parser looks ahead, into a buffer which the parser walks
+// through. Peeking and skipping tokens are then just index moves, without any allocation
+typedef struct {
+    char32_t* string;            // Beginning of the string, which spans are offsets from
+    uint32_t file;               // What the nodes are made in, the file the thread was on
+    khAstSource* opt_source;     // Held by the raw literals and skipped blocks, made for the first one
+    uint32_t cursor;             // Offset in the string after the last skipped token
+    size_t index;                // Index of the token following the cursor
+    kharray(khToken) tokens;
+    char32_t* lexer_cursor;      // Where the lexer left off
+    khArena* opt_arena;          // Where the AST gets allocated from, instead of the heap
+    size_t depth;                // Nesting of the expressions and blocks being parsed
+    bool is_lazy;                // Whether function and lambda bodies get skipped instead
+    khAstInterner* opt_interner; // What child expressions get shared through, if given
+    khLineIndex* opt_lines;      // Where the newlines of the lexed tokens get recorded, if given
+    khTokenPipe* opt_pipe;       // What the tokens are taken from instead of lexing them, if given
+} khParser;
+
+
+static inline void raiseError(uint32_t offset, const char32_t* message) {
+    kh_raiseError(
+        (khError){.type = khErrorType_PARSER, .message = khstring_new(message), .offset = offset});
+}
+
+// Starts parsing at `begin`, somewhere in the string
+static khParser newParser(char32_t* string, char32_t* begin, khArena* opt_arena) {
+    return (khParser){.string = string,
+                      .file = kh_getFile(),
+                      .opt_source = NULL,
+                      .cursor = begin - string,
+                      .index = 0,
+                      .tokens = kharray_new(khToken, khToken_delete),
+                      .lexer_cursor = begin,
+                      .opt_arena = opt_arena,
+                      .depth = 0,
+                      .is_lazy = false,
+                      .opt_interner = NULL,
+                      .opt_lines = NULL,
+                      .opt_pipe = NULL};
+}
 
+static void deleteParser(khParser* parser) {
+    kharray_delete(&parser->tokens);
+    if (parser->opt_source != NULL) {
+        khAstSource_release(parser->opt_source);
+    }
+}
+
+static inline khAstSource* parserSource(khParser* parser) {
+    if (parser->opt_source == NULL) {
+        parser->opt_source = khAstSource_new(parser->string, parser->file, parser->opt_arena);
+    }
 
-static inline void raiseError(char32_t* ptr, const char32_t* message) {
-    kh_raiseError((khError){.type = khErrorType_PARSER, .message = khstring_new(message), .data = ptr});
+    return parser->opt_source;
 }
 
-// Token getter function
-static inline khToken currentToken(char32_t** cursor, bool ignore_newline) {
-    char32_t* cursor_copy = *cursor;
-    khToken token = kh_lexToken(&cursor_copy);
+// Boxes an expression which its parent has a pointer to, hashing it along with whatever in it isn't
+// hashed yet. When interning, an equal one which came before gets shared instead, this one just being
+// left unused in the arena. Nodes get their file here, or once they're parsed if they aren't boxed,
+// rather than everywhere they're made
+static inline khAstExpression* box(khParser* parser, khAstExpression expression) {
+    expression.file = parser->file;
+    khAstExpression* boxed = khAstExpression_box(expression, parser->opt_arena);
+    khAstExpression_hash(boxed);
 
-    // Ignoring newlines means that it would lex the next token if a newline token was encountered
-    while (token.type == khTokenType_COMMENT || (token.type == khTokenType_NEWLINE && ignore_newline)) {
-        khToken_delete(&token);
-        *cursor = cursor_copy;
-        token = kh_lexToken(&cursor_copy);
+    if (parser->opt_interner == NULL) {
+        return boxed;
     }
 
-    return token;
+    khAstExpression* interned = khAstInterner_intern(parser->opt_interner, boxed);
+    return interned != boxed ? khAstExpression_retain(interned) : boxed;
 }
 
-// Basically, a sort of `next` function
-static inline void skipToken(char32_t** cursor) {
-    char32_t* origin = *cursor;
-    khToken token = kh_lexToken(cursor);
+// Placeholder of an expression which isn't parsed yet, and stays if it fails to be
+static inline khAstExpression invalidExpression(void) {
+    return (khAstExpression){.begin = khAst_NO_SPAN,
+                             .end = khAst_NO_SPAN,
+                             .file = kh_getFile(),
+                             .type = khAstExpressionType_INVALID};
+}
+
+#define newArray(PARSER, TYPE, DELETER) kharray_newIn(TYPE, DELETER, (PARSER)->opt_arena)
+
+// These take the payload out of the current token, moving it into the AST instead of copying it. The
+// parser only ever backtracks over tokens it has peeked at, so a token never gets read again once its
+// payload is in the AST. It's copied when allocating from an arena, as that's where the AST has to live
+static inline khstring takeIdentifier(khParser* parser) {
+    khToken* token = &parser->tokens[parser->index];
+    return parser->opt_arena != NULL ? khstring_copyIn(&token->identifier, parser->opt_arena)
+                                     : khstring_move(&token->identifier);
+}
+
+static inline khstring takeString(khParser* parser) {
+    khToken* token = &parser->tokens[parser->index];
+    return parser->opt_arena != NULL ? khstring_copyIn(&token->string, parser->opt_arena)
+                                     : khstring_move(&token->string);
+}
 
-    // Ignoring comments, lex the next token
-    while (token.type == khTokenType_COMMENT) {
-        khToken_delete(&token);
-        token = kh_lexToken(cursor);
+static inline khbuffer takeBuffer(khParser* parser) {
+    khToken* token = &parser->tokens[parser->index];
+    return parser->opt_arena != NULL ? khbuffer_copyIn(&token->buffer, parser->opt_arena)
+                                     : khbuffer_move(&token->buffer);
+}
+
+// Literals left raw by the lexer stay that way, keeping only where their payload is in the source. A
+// NULL source means that the token has its payload decoded already
+static inline khAstRawLiteral takeRaw(khParser* parser) {
+    khToken* token = &parser->tokens[parser->index];
+    if (token->string != NULL) {
+        return (khAstRawLiteral){.source = NULL, .begin = 0, .end = 0};
     }
 
-    khToken_delete(&token);
+    khAstRawLiteral raw = {.source = khAstSource_retain(parserSource(parser))};
+    khToken_rawSpan(token, parser->string, &raw.begin, &raw.end);
+    return raw;
+}
 
-    // To avoid being stuck at the same token
-    if (origin == *cursor && **cursor != U'\0') {
-        (*cursor)++;
+// Lexes more tokens into the buffer if the index is not reached yet. The lexer errors are raised here,
+// the first time a token gets looked at, just like when the parser lexed the tokens itself. Tokens
+// taken from a pipe have theirs raised as they're taken, which is here as well
+static inline khToken* tokenAt(khParser* parser, size_t index) {
+    while (kharray_size(&parser->tokens) <= index) {
+        kharray_append(&parser->tokens, parser->opt_pipe != NULL
+                                            ? khTokenPipe_next(parser->opt_pipe)
+                                            : kh_lexToken(&parser->lexer_cursor, parser->string));
+        if (parser->opt_lines != NULL) {
+            khLineIndex_addToken(parser->opt_lines,
+                                 &parser->tokens[kharray_size(&parser->tokens) - 1]);
+        }
     }
+
+    return &parser->tokens[index];
 }
 
-static inline bool isEnd(char32_t** cursor) {
-    char32_t* cursor_copy = *cursor;
-    khToken token = kh_lexToken(&cursor_copy);
+// Token getter function; the token is owned by the parser's buffer, so it must not be deleted
+static inline khToken currentToken(khParser* parser, bool ignore_newline) {
+    khToken* token = tokenAt(parser, parser->index);
 
-    // Ignoring newlines and comments
-    while (token.type == khTokenType_COMMENT || token.type == khTokenType_NEWLINE) {
-        khToken_delete(&token);
-        token = kh_lexToken(&cursor_copy);
+    // Ignoring newlines means that it would get the next token if a newline token was encountered
+    while (token->type == khTokenType_COMMENT ||
+           (token->type == khTokenType_NEWLINE && ignore_newline)) {
+        parser->cursor = token->end;
+        parser->index++;
+        token = tokenAt(parser, parser->index);
     }
 
-    if (token.type == khTokenType_EOF) {
-        khToken_delete(&token);
-        return true;
+    return *token;
+}
+
+// Basically, a sort of `next` function
+static inline void skipToken(khParser* parser) {
+    khToken* token = tokenAt(parser, parser->index);
+
+    // Ignoring comments, skip the next token
+    while (token->type == khTokenType_COMMENT) {
+        parser->index++;
+        token = tokenAt(parser, parser->index);
     }
-    else {
-        khToken_delete(&token);
-        return false;
+
+    parser->cursor = token->end;
+
+    // Stays at the EOF token, as there's nothing beyond it
+    if (token->type != khTokenType_EOF) {
+        parser->index++;
     }
 }
 
+// Index of the next token which is neither a newline nor a comment, without moving the cursor
+static inline size_t nextIndex(khParser* parser) {
+    size_t index = parser->index;
+    khToken* token = tokenAt(parser, index);
 
-kharray(khAstStatement) kh_parse(khstring* string) {
-    kharray(khAstStatement) statements = kharray_new(khAstStatement, khAstStatement_delete);
-    char32_t* cursor = *string;
+    while (token->type == khTokenType_COMMENT || token->type == khTokenType_NEWLINE) {
+        index++;
+        token = tokenAt(parser, index);
+    }
+
+    return index;
+}
+
+static inline bool isEnd(khParser* parser) {
+    return tokenAt(parser, nextIndex(parser))->type == khTokenType_EOF;
+}
+
+// Panic mode, for a statement which doesn't end where it should. Skips up to a newline or a semicolon,
+// which it takes, or up to the closing curly bracket of the block it's in. The rest of the statement
+// then doesn't get parsed as more statements, each with errors of its own
+static void synchronize(khParser* parser) {
+    khToken token = currentToken(parser, false);
+
+    while (token.type != khTokenType_EOF) {
+        if (token.type == khTokenType_DELIMITER &&
+            token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
+            break;
+        }
+
+        skipToken(parser);
+
+        if (token.type == khTokenType_NEWLINE ||
+            (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
+            break;
+        }
 
-    while (!isEnd(&cursor)) {
-        kharray_append(&statements, kh_parseStatement(&cursor));
+        token = currentToken(parser, false);
     }
+}
 
-    return statements;
+// Skips everything up to the closing delimiter enclosing it, which is left for whatever opened it to
+// take. Also stops at a newline outside of any delimiters, unless newlines are ignored
+static void skipNested(khParser* parser, bool ignore_newline) {
+    size_t depth = 0;
+
+    while (true) {
+        khToken token = currentToken(parser, ignore_newline || depth > 0);
+        if (token.type == khTokenType_EOF || token.type == khTokenType_NEWLINE) {
+            return;
+        }
+
+        if (token.type == khTokenType_DELIMITER) {
+            switch (token.delimiter) {
+                case khDelimiterToken_PARENTHESIS_OPEN:
+                case khDelimiterToken_SQUARE_BRACKET_OPEN:
+                case khDelimiterToken_CURLY_BRACKET_OPEN:
+                    depth++;
+                    break;
+
+                case khDelimiterToken_PARENTHESIS_CLOSE:
+                case khDelimiterToken_SQUARE_BRACKET_CLOSE:
+                case khDelimiterToken_CURLY_BRACKET_CLOSE:
+                    if (depth == 0) {
+                        return;
+                    }
+                    depth--;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+
+        skipToken(parser);
+    }
 }
 
 
+static void parseUntil(khParser* parser, kharray(khAstStatement) * statements, char32_t* end);
+static khAstStatement parseStatement(khParser* parser);
+
 // Sub-level parsing levels
-static kharray(khAstStatement) sparseBlock(char32_t** cursor);
-static void sparseSpecifiers(char32_t** cursor, bool allow_incase, bool* is_incase, bool allow_static,
+static kharray(khAstStatement) sparseBlock(khParser* parser);
+static void sparseSpecifiers(khParser* parser, bool allow_incase, bool* is_incase, bool allow_static,
                              bool* is_static, bool ignore_newline);
-static khAstVariable sparseVariable(char32_t** cursor, bool no_static, bool no_unpacking,
+static khAstVariable sparseVariable(khParser* parser, bool no_static, bool no_unpacking,
                                     bool ignore_newline);
-static khAstImport sparseImport(char32_t** cursor);
-static khAstInclude sparseInclude(char32_t** cursor);
-static khAstFunction sparseFunction(char32_t** cursor);
-static khAstClass sparseClass(char32_t** cursor);
-static khAstStruct sparseStruct(char32_t** cursor);
-static khAstEnum sparseEnum(char32_t** cursor);
-static khAstAlias sparseAlias(char32_t** cursor);
-static khAstIfBranch sparseIfBranch(char32_t** cursor);
-static khAstWhileLoop sparseWhileLoop(char32_t** cursor);
-static khAstDoWhileLoop sparseDoWhileLoop(char32_t** cursor);
-static khAstForLoop sparseForLoop(char32_t** cursor);
-static void sparseBreak(char32_t** cursor);
-static void sparseContinue(char32_t** cursor);
-static khAstReturn sparseReturn(char32_t** cursor);
-
-// Sub-level expression parsing levels, by lowest to highest precedence
+static khAstImport sparseImport(khParser* parser);
+static khAstInclude sparseInclude(khParser* parser);
+static khAstFunction sparseFunction(khParser* parser);
+static khAstClass sparseClass(khParser* parser);
+static khAstStruct sparseStruct(khParser* parser);
+static khAstEnum sparseEnum(khParser* parser);
+static khAstAlias sparseAlias(khParser* parser);
+static khAstIfBranch sparseIfBranch(khParser* parser);
+static khAstWhileLoop sparseWhileLoop(khParser* parser);
+static khAstDoWhileLoop sparseDoWhileLoop(khParser* parser);
+static khAstForLoop sparseForLoop(khParser* parser);
+static void sparseBreak(khParser* parser);
+static void sparseContinue(khParser* parser);
+static khAstReturn sparseReturn(khParser* parser);
+
+// Operator precedences, by lowest to highest
+typedef enum {
+    khPrecedence_NONE,
+    khPrecedence_ASSIGN, // Right-associative
+    khPrecedence_TERNARY,
+    khPrecedence_OR,
+    khPrecedence_XOR,
+    khPrecedence_AND,
+    khPrecedence_NOT,
+    khPrecedence_COMPARISON,
+    khPrecedence_RANGE,
+    khPrecedence_BIT_OR,
+    khPrecedence_BIT_XOR,
+    khPrecedence_BIT_AND,
+    khPrecedence_BIT_SHIFTS,
+    khPrecedence_ADD_SUB,
+    khPrecedence_MUL_DIV_MOD_DOT,
+    khPrecedence_UNARY,
+    khPrecedence_POW // Right-associative
+} khPrecedence;
+
+// Sub-level expression parsing levels
 #define EXPARSE_ARGS bool ignore_newline, bool filter_type
-static khAstExpression exparseIpAssignmentOperators(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseTernary(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseLogicalOr(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseLogicalXor(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseLogicalAnd(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseLogicalNot(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseComparisonOperators(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseRange(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseBitwiseOr(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseBitwiseXor(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseBitwiseAnd(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseBitwiseShifts(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseAddSub(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseMulDivModDot(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseUnary(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparsePow(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseReverseUnary(char32_t** cursor, EXPARSE_ARGS);
-static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS);
-
-static khAstExpression exparseSignature(char32_t** cursor, bool ignore_newline);
-static khAstExpression exparseLambda(char32_t** cursor, bool ignore_newline);
-static khAstExpression exparseDict(char32_t** cursor, bool ignore_newline);
-static kharray(khAstExpression) exparseList(char32_t** cursor, khDelimiterToken opening_delimiter,
+static khAstExpression parseExpression(khParser* parser, EXPARSE_ARGS);
+static khAstExpression exparseOperators(khParser* parser, khPrecedence precedence, bool ignore_newline);
+static khAstExpression exparseReverseUnary(khParser* parser, EXPARSE_ARGS);
+static khAstExpression exparseOther(khParser* parser, EXPARSE_ARGS);
+
+static khAstExpression exparseSignature(khParser* parser, bool ignore_newline);
+static khAstExpression exparseLambda(khParser* parser, bool ignore_newline);
+static khAstExpression exparseDict(khParser* parser, bool ignore_newline);
+static kharray(khAstExpression) exparseList(khParser* parser, khDelimiterToken opening_delimiter,
                                             khDelimiterToken closing_delimiter, EXPARSE_ARGS);
+static kharray(khAstExpression) exparsePackableList(khParser* parser, khAstPackedValues* packed,
+                                                    khDelimiterToken opening_delimiter,
+                                                    khDelimiterToken closing_delimiter, EXPARSE_ARGS);
+
+
+kharray(khAstStatement) kh_parse(khstring* string) {
+    return kh_parseIn(string, NULL);
+}
+
+// All of the string with a single parser, which `kh_parseParallel` falls back to. Its tokens are lexed
+// on a thread of their own if it's pipelined
+static kharray(khAstStatement) parseWhole(khstring* string, khArena* opt_arena, khLineIndex* opt_lines,
+                                          bool is_pipelined) {
+    kharray(khAstStatement) statements =
+        kharray_newIn(khAstStatement, khAstStatement_delete, opt_arena);
+    if (!kh_checkSourceSize(string)) {
+        return statements;
+    }
+
+    khParser parser = newParser(*string, *string, opt_arena);
+    parser.opt_lines = opt_lines;
+    parser.opt_pipe = is_pipelined ? khTokenPipe_new(string, true) : NULL;
+
+    parseUntil(&parser, &statements, NULL);
+
+    deleteParser(&parser);
+    if (parser.opt_pipe != NULL) {
+        khTokenPipe_delete(parser.opt_pipe);
+    }
+    return statements;
+}
+
+kharray(khAstStatement) kh_parseIn(khstring* string, khArena* opt_arena) {
+    return parseWhole(string, opt_arena, NULL, false);
+}
+
+kharray(khAstStatement) kh_parsePipelined(khstring* string, khArena* opt_arena,
+                                          khLineIndex* opt_lines) {
+    return parseWhole(string, opt_arena, opt_lines, true);
+}
+
+kharray(khAstStatement) kh_parseInterned(khstring* string, khArena* arena, khAstInterner* interner) {
+    kharray(khAstStatement) statements = kharray_newIn(khAstStatement, khAstStatement_delete, arena);
+    if (!kh_checkSourceSize(string)) {
+        return statements;
+    }
+
+    khParser parser = newParser(*string, *string, arena);
+    parser.opt_interner = interner;
+
+    parseUntil(&parser, &statements, NULL);
+
+    deleteParser(&parser);
+    return statements;
+}
+
+kharray(khAstStatement) kh_parseDeclarations(khstring* string, khArena* opt_arena) {
+    kharray(khAstStatement) statements =
+        kharray_newIn(khAstStatement, khAstStatement_delete, opt_arena);
+    if (!kh_checkSourceSize(string)) {
+        return statements;
+    }
+
+    khParser parser = newParser(*string, *string, opt_arena);
+    parser.is_lazy = true;
 
+    parseUntil(&parser, &statements, NULL);
+
+    deleteParser(&parser);
+    return statements;
+}
+
+// Parses statements until the next one would begin at or after `end`, or until the end of the string if
+// it's NULL
+static void parseUntil(khParser* parser, kharray(khAstStatement) * statements, char32_t* end) {
+    while (!isEnd(parser)) {
+        if (end != NULL && parser->string + tokenAt(parser, nextIndex(parser))->begin >= end) {
+            break;
+        }
+
+        kharray_append(statements, parseStatement(parser));
+    }
+}
+
+// Whether the parser has stopped right where a fresh one starting from `begin` would be: its next
+// statement begins there, and the cursor is left there once the newlines before it are skipped
+static bool isStoppedAt(khParser* parser, uint32_t begin) {
+    size_t index = nextIndex(parser);
+    if (parser->tokens[index].begin != begin) {
+        return false;
+    }
+
+    return index > parser->index ? parser->tokens[index - 1].end == begin : parser->cursor == begin;
+}
+
+// Skips a comment, a string or a character without lexing it, returning where its last character is.
+// Newlines which end one are left to be looked at
+static char32_t* skipLiteral(char32_t* chr) {
+    if (*chr == U'#') {
+        while (chr[1] != U'\n' && chr[1] != U'\0') {
+            chr++;
+        }
+
+        return chr;
+    }
+
+    // Skips strings and characters, along with their escapes
+    char32_t quote = *chr;
+    bool multiline = quote == U'"' && chr[1] == U'"' && chr[2] == U'"';
+    chr += multiline ? 3 : 1;
+
+    while (*chr != U'\0') {
+        if (*chr == U'\\' && chr[1] != U'\0') {
+            chr++;
+        }
+        else if (*chr == quote && (!multiline || (chr[1] == U'"' && chr[2] == U'"'))) {
+            return chr + (multiline ? 2 : 0);
+        }
+        // Characters don't span lines
+        else if (quote == U'\'' && *chr == U'\n') {
+            return chr - 1;
+        }
+
+        chr++;
+    }
+
+    return chr - 1;
+}
+
+// Finds where a block ends by matching its curly brackets, without lexing nor parsing it. NULL if it
+// never gets closed
+static char32_t* matchBlock(char32_t* begin) {
+    size_t depth = 0;
+
+    for (char32_t* chr = begin; *chr != U'\0'; chr++) {
+        switch (*chr) {
+            case U'{':
+                depth++;
+                break;
 
-khAstStatement kh_parseStatement(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
-    char32_t* origin = token.begin;
+            case U'}':
+                depth--;
+                if (depth == 0) {
+                    return chr + 1;
+                }
+                break;
+
+            case U'#':
+            case U'"':
+            case U'\'':
+                chr = skipLiteral(chr);
+                break;
+        }
+    }
+
+    return NULL;
+}
+
+// Guesses where the string can be split into chunks of at least `chunk_size` characters: the beginnings
+// of lines outside of any brackets, strings and comments. Whether they're right is up to the parsing
+static kharray(char32_t*) findBoundaries(char32_t* string, size_t chunk_size) {
+    kharray(char32_t*) boundaries = kharray_new(char32_t*, NULL);
+    char32_t* target = string + chunk_size;
+    size_t depth = 0;
+
+    for (char32_t* chr = string; *chr != U'\0'; chr++) {
+        switch (*chr) {
+            case U'(':
+            case U'[':
+            case U'{':
+                depth++;
+                break;
+
+            case U')':
+            case U']':
+            case U'}':
+                if (depth > 0) {
+                    depth--;
+                }
+                break;
+
+            case U'#':
+            case U'"':
+            case U'\'':
+                chr = skipLiteral(chr);
+                break;
+
+            case U'\n':
+                if (depth == 0 && chr + 1 >= target && chr[1] != U'#' && chr[1] != U'\0' &&
+                    !kh_isSpace(chr[1])) {
+                    kharray_append(&boundaries, chr + 1);
+                    target = chr + 1 + chunk_size;
+                }
+                break;
+        }
+    }
+
+    return boundaries;
+}
+
+typedef struct {
+    khParser parser;
+    char32_t* begin;
+    char32_t* end; // Beginning of the next chunk, NULL for the last one
+    khArena arena;
+    khLineIndex lines; // Of what its parser lexed, if the lines are recorded
+    kharray(khAstStatement) statements;
+    kharray(khError) errors;
+    bool is_used; // Whether its results made it into the AST
+    bool is_threaded;
+    pthread_t thread;
+} khParseChunk;
+
+static void* parseChunk(void* data) {
+    khParseChunk* chunk = (khParseChunk*)data;
+    kh_setFile(chunk->parser.file);
+    parseUntil(&chunk->parser, &chunk->statements, chunk->end);
+
+    // Errors are raised on this thread's own stack, so they're moved out to be merged later
+    chunk->errors = kharray_copy(kh_getErrors(), khError_move);
+    kh_flushErrors();
+
+    return NULL;
+}
+
+// When its thread couldn't be started, the chunk is parsed on the calling one, with the errors raised
+// there so far set aside to leave only the chunk's own to be taken
+static void parseChunkHere(khParseChunk* chunk) {
+    kharray(khError)* stack = kh_getErrors();
+    kharray(khError) earlier = *stack;
+    *stack = NULL;
+
+    parseChunk(chunk);
+    *stack = earlier;
+}
+
+kharray(khAstStatement) kh_parseParallel(khstring* string, khArena* opt_arena, size_t workers,
+                                         khLineIndex* opt_lines) {
+    if (!kh_checkSourceSize(string)) {
+        return kharray_newIn(khAstStatement, khAstStatement_delete, opt_arena);
+    }
+
+    size_t chunk_size = khstring_size(string) / (workers > 0 ? workers : 1);
+    if (chunk_size < kh_PARSE_CHUNK_MIN_SIZE) {
+        chunk_size = kh_PARSE_CHUNK_MIN_SIZE;
+    }
+
+    kharray(char32_t*) boundaries = findBoundaries(*string, chunk_size);
+
+    if (kharray_size(&boundaries) == 0) {
+        kharray_delete(&boundaries);
+        return parseWhole(string, opt_arena, opt_lines, false);
+    }
+
+    size_t count = kharray_size(&boundaries) + 1;
+    khParseChunk* chunks = (khParseChunk*)malloc(sizeof(khParseChunk) * count);
+
+    for (size_t i = 0; i < count; i++) {
+        khParseChunk* chunk = &chunks[i];
+        chunk->begin = i == 0 ? *string : boundaries[i - 1];
+        chunk->end = i < count - 1 ? boundaries[i] : NULL;
+        chunk->arena = khArena_new();
+        chunk->parser = newParser(*string, chunk->begin, opt_arena != NULL ? &chunk->arena : NULL);
+        chunk->statements = newArray(&chunk->parser, khAstStatement, khAstStatement_delete);
+        chunk->errors = NULL;
+        if (opt_lines != NULL) {
+            chunk->lines = khLineIndex_newEmpty(string);
+            chunk->parser.opt_lines = &chunk->lines;
+        }
+        chunk->is_used = false;
+
+        chunk->is_threaded = pthread_create(&chunk->thread, NULL, parseChunk, chunk) == 0;
+        if (!chunk->is_threaded) {
+            parseChunkHere(chunk);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (chunks[i].is_threaded) {
+            pthread_join(chunks[i].thread, NULL);
+        }
+    }
+
+    kharray(khAstStatement) statements =
+        kharray_newIn(khAstStatement, khAstStatement_delete, opt_arena);
+
+    // Merges the chunks in source order, with their errors raised again as if it was all parsed here
+    size_t i = 0;
+    while (i < count) {
+        khParseChunk* chunk = &chunks[i];
+        chunk->is_used = true;
+
+        for (size_t j = 0; j < kharray_size(&chunk->errors); j++) {
+            kh_raiseError(khError_move(&chunk->errors[j]));
+        }
+        kharray_concatenate(&statements, &chunk->statements, khAstStatement_move);
+
+        // When a statement runs past the beginning of the next chunk, that chunk was parsed from the
+        // wrong place. Parsing carries on from here instead, until it lines up with a later chunk
+        i++;
+        while (i < count && !isStoppedAt(&chunk->parser, chunks[i].begin - *string)) {
+            parseUntil(&chunk->parser, &statements, chunks[i].end);
+            i++;
+        }
+
+        // Its parser lexed everything up to where the next chunk in use begins, and maybe a little past
+        if (opt_lines != NULL) {
+            khLineIndex_merge(opt_lines, &chunk->lines);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        khParseChunk* chunk = &chunks[i];
+        kharray_delete(&chunk->statements);
+        kharray_delete(&chunk->errors);
+        deleteParser(&chunk->parser);
+        if (opt_lines != NULL) {
+            khLineIndex_delete(&chunk->lines);
+        }
+
+        if (opt_arena != NULL && chunk->is_used) {
+            khArena_merge(opt_arena, &chunk->arena);
+        }
+        else {
+            khArena_delete(&chunk->arena);
+        }
+    }
+
+    free(chunks);
+    kharray_delete(&boundaries);
+    return statements;
+}
+
+// Whether a statement beginning there was parsed the same as if the parser started from it. Otherwise,
+// the parser's cursor was still behind it, which is where its first expression begins
+static inline bool isLineStart(char32_t* string, uint32_t begin) {
+    return begin == 0 || string[begin - 1] == U'\n' || string[begin - 1] == U';';
+}
+
+kharray(khAstStatement) kh_reparse(khstring* string, khArena* opt_arena,
+                                   kharray(khAstStatement) * statements, khstring* old_string,
+                                   khEdit edit) {
+    size_t count = kharray_size(statements);
+    // Parsing it anew raises the error when the string is too long
+    if (count == 0 || khstring_size(string) > kh_MAX_SOURCE_SIZE) {
+        return kh_parseIn(string, opt_arena);
+    }
+
+    // Its statements get moved out, which mustn't be seen by other trees sharing them
+    kharray_unshare(statements, khAstStatement_share);
+
+    char32_t* old_origin = *old_string;
+    char32_t* origin = *string;
+
+    // Starts from the statement before the one the edit is in, as an `if` looks at the first token of
+    // the next statement for an `elif` or `else`
+    size_t first = 0;
+    while (first < count && (*statements)[first].begin <= edit.index) {
+        first++;
+    }
+    first = first > 1 ? first - 2 : 0;
+    while (first > 0 && !isLineStart(old_origin, (*statements)[first].begin)) {
+        first--;
+    }
+
+    kharray(khAstStatement) new_statements =
+        kharray_newIn(khAstStatement, khAstStatement_delete, opt_arena);
+
+    // Statements which are moved over hold the new string through the parser's source
+    khParser parser =
+        newParser(origin, first > 0 ? origin + (*statements)[first].begin : origin, opt_arena);
+    khAstSource* source = parserSource(&parser);
+
+    for (size_t i = 0; i < first; i++) {
+        khAstStatement statement = khAstStatement_move(&(*statements)[i]);
+        khAstStatement_relocate(&statement, source, 0);
+        kharray_append(&new_statements, statement);
+    }
+
+    // Old statements which begin after the edit are left untouched by it, and get reused once the
+    // parser lines up with one, the same way as the chunks of `kh_parseParallel`
+    size_t old_after = edit.index + edit.size;
+    int64_t shift = (int64_t)edit.new_size - (int64_t)edit.size;
+
+    size_t next = first;
+    while (next < count && (*statements)[next].begin <= old_after) {
+        next++;
+    }
+
+    while (true) {
+        uint32_t position = tokenAt(&parser, nextIndex(&parser))->begin;
+        while (next < count && (*statements)[next].begin + shift < position) {
+            next++;
+        }
+
+        if (next < count && isLineStart(old_origin, (*statements)[next].begin) &&
+            isStoppedAt(&parser, (*statements)[next].begin + shift)) {
+            break;
+        }
+        if (isEnd(&parser)) {
+            next = count;
+            break;
+        }
+
+        kharray_append(&new_statements, parseStatement(&parser));
+    }
+
+    for (size_t i = next; i < count; i++) {
+        khAstStatement statement = khAstStatement_move(&(*statements)[i]);
+        khAstStatement_relocate(&statement, source, shift);
+        kharray_append(&new_statements, statement);
+    }
+
+    deleteParser(&parser);
+    return new_statements;
+}
+
+khAstStatement kh_parseStatement(char32_t** cursor, char32_t* origin) {
+    khParser parser = newParser(origin, *cursor, NULL);
+    khAstStatement statement = parseStatement(&parser);
+
+    *cursor = origin + parser.cursor;
+    deleteParser(&parser);
+    return statement;
+}
+
+khAstExpression kh_parseExpression(char32_t** cursor, char32_t* origin, bool ignore_newline,
+                                   bool filter_type) {
+    khParser parser = newParser(origin, *cursor, NULL);
+    khAstExpression expression = parseExpression(&parser, ignore_newline, filter_type);
+
+    *cursor = origin + parser.cursor;
+    deleteParser(&parser);
+    return expression;
+}
+
+static void parseLazyBlock(kharray(khAstStatement) * block, khAstLazyBlock* lazy_block) {
+    khAstSource* source = lazy_block->source;
+    if (source == NULL) {
+        return;
+    }
+
+    // It's parsed within the file it was skipped in, whichever one the thread is on now
+    uint32_t file = kh_getFile();
+    kh_setFile(source->file);
+
+    // Bodies within it get skipped as well, the same as they would've been. The parser takes over the
+    // block's reference to the source
+    khParser parser =
+        newParser(source->string, source->string + lazy_block->begin, lazy_block->opt_arena);
+    parser.opt_source = source;
+    parser.is_lazy = true;
+
+    kharray_delete(block);
+    *block = sparseBlock(&parser);
+    *lazy_block = (khAstLazyBlock){.source = NULL, .begin = 0, .end = 0, .opt_arena = NULL};
+
+    deleteParser(&parser);
+    kh_setFile(file);
+}
+
+kharray(khAstStatement) * khAstFunction_body(khAstFunction* function) {
+    parseLazyBlock(&function->block, &function->lazy_block);
+    return &function->block;
+}
+
+kharray(khAstStatement) * khAstLambda_body(khAstLambda* lambda) {
+    parseLazyBlock(&lambda->block, &lambda->lazy_block);
+    return &lambda->block;
+}
+
+static khAstStatement parseStatement(khParser* parser) {
+    khToken token = currentToken(parser, true);
+    uint32_t origin = token.begin;
+    size_t origin_index = parser->index;
     khAstStatement statement =
-        (khAstStatement){.begin = origin, .end = *cursor, .type = khAstStatementType_INVALID};
+        (khAstStatement){.begin = origin, .end = parser->cursor, .type = khAstStatementType_INVALID};
 
     if (token.type == khTokenType_KEYWORD) {
         switch (token.keyword) {
             case khKeywordToken_IMPORT: {
-                khAstImport import_v = sparseImport(cursor);
-                khToken_delete(&token);
+                khAstImport import_v = sparseImport(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_IMPORT,
                                              .import_v = import_v};
                 goto end;
             }
 
             case khKeywordToken_INCLUDE: {
-                khAstInclude include = sparseInclude(cursor);
-                khToken_delete(&token);
+                khAstInclude include = sparseInclude(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_INCLUDE,
                                              .include = include};
                 goto end;
@@ -161,53 +818,51 @@ khAstStatement kh_parseStatement(char32_t** cursor) {
 
             case khKeywordToken_AS:
                 raiseError(token.begin, U"unexpected keyword");
-                skipToken(cursor);
-                khToken_delete(&token);
+                skipToken(parser);
                 goto end;
 
             case khKeywordToken_DEF: {
-                khAstFunction function = sparseFunction(cursor);
-                khToken_delete(&token);
+                khAstFunction function = sparseFunction(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_FUNCTION,
                                              .function = function};
                 goto end;
             }
 
             case khKeywordToken_CLASS: {
-                khAstClass class_v = sparseClass(cursor);
-                khToken_delete(&token);
+                khAstClass class_v = sparseClass(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_CLASS,
                                              .class_v = class_v};
                 goto end;
             }
 
             case khKeywordToken_STRUCT: {
-                khAstStruct struct_v = sparseStruct(cursor);
-                khToken_delete(&token);
+                khAstStruct struct_v = sparseStruct(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_STRUCT,
                                              .struct_v = struct_v};
                 goto end;
             }
 
             case khKeywordToken_ENUM: {
-                khAstEnum enum_v = sparseEnum(cursor);
-                khToken_delete(&token);
-                statement = (khAstStatement){
-                    .begin = origin, .end = *cursor, .type = khAstStatementType_ENUM, .enum_v = enum_v};
+                khAstEnum enum_v = sparseEnum(parser);
+                statement = (khAstStatement){.begin = origin,
+                                             .end = parser->cursor,
+                                             .type = khAstStatementType_ENUM,
+                                             .enum_v = enum_v};
                 goto end;
             }
 
             case khKeywordToken_ALIAS: {
-                khAstAlias alias = sparseAlias(cursor);
-                khToken_delete(&token);
-                statement = (khAstStatement){
-                    .begin = origin, .end = *cursor, .type = khAstStatementType_ALIAS, .alias = alias};
+                khAstAlias alias = sparseAlias(parser);
+                statement = (khAstStatement){.begin = origin,
+                                             .end = parser->cursor,
+                                             .type = khAstStatementType_ALIAS,
+                                             .alias = alias};
                 goto end;
             }
 
@@ -220,49 +875,46 @@ khAstStatement kh_parseStatement(char32_t** cursor) {
             // Handling `incase` and `static` modifiers
             case khKeywordToken_INCASE:
             case khKeywordToken_STATIC: {
-                char32_t* previous = *cursor;
-                sparseSpecifiers(cursor, true, NULL, true, NULL, true);
-                khToken_delete(&token);
-                token = currentToken(cursor, true);
-                *cursor = previous;
+                uint32_t previous = parser->cursor;
+                size_t previous_index = parser->index;
+                sparseSpecifiers(parser, true, NULL, true, NULL, true);
+                token = currentToken(parser, true);
+                parser->cursor = previous;
+                parser->index = previous_index;
 
                 if (token.type == khTokenType_KEYWORD) {
                     switch (token.keyword) {
                         case khKeywordToken_DEF: {
-                            khAstFunction function = sparseFunction(cursor);
-                            khToken_delete(&token);
+                            khAstFunction function = sparseFunction(parser);
                             statement = (khAstStatement){.begin = origin,
-                                                         .end = *cursor,
+                                                         .end = parser->cursor,
                                                          .type = khAstStatementType_FUNCTION,
                                                          .function = function};
                             goto end;
                         }
 
                         case khKeywordToken_CLASS: {
-                            khAstClass class_v = sparseClass(cursor);
-                            khToken_delete(&token);
+                            khAstClass class_v = sparseClass(parser);
                             statement = (khAstStatement){.begin = origin,
-                                                         .end = *cursor,
+                                                         .end = parser->cursor,
                                                          .type = khAstStatementType_CLASS,
                                                          .class_v = class_v};
                             goto end;
                         }
 
                         case khKeywordToken_STRUCT: {
-                            khAstStruct struct_v = sparseStruct(cursor);
-                            khToken_delete(&token);
+                            khAstStruct struct_v = sparseStruct(parser);
                             statement = (khAstStatement){.begin = origin,
-                                                         .end = *cursor,
+                                                         .end = parser->cursor,
                                                          .type = khAstStatementType_STRUCT,
                                                          .struct_v = struct_v};
                             goto end;
                         }
 
                         case khKeywordToken_ALIAS: {
-                            khAstAlias alias = sparseAlias(cursor);
-                            khToken_delete(&token);
+                            khAstAlias alias = sparseAlias(parser);
                             statement = (khAstStatement){.begin = origin,
-                                                         .end = *cursor,
+                                                         .end = parser->cursor,
                                                          .type = khAstStatementType_ALIAS,
                                                          .alias = alias};
                             goto end;
@@ -272,25 +924,22 @@ khAstStatement kh_parseStatement(char32_t** cursor) {
                         case khKeywordToken_WILD:
                         case khKeywordToken_REF:
                         default: {
-                            khToken_delete(&token);
-                            token = currentToken(cursor, true);
+                            token = currentToken(parser, true);
                             goto out;
                         }
                     }
                 }
                 // Same goes with above
                 else {
-                    khToken_delete(&token);
-                    token = currentToken(cursor, true);
+                    token = currentToken(parser, true);
                     goto out;
                 }
             }
 
             case khKeywordToken_IF: {
-                khAstIfBranch if_branch = sparseIfBranch(cursor);
-                khToken_delete(&token);
+                khAstIfBranch if_branch = sparseIfBranch(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_IF_BRANCH,
                                              .if_branch = if_branch};
                 goto end;
@@ -298,67 +947,59 @@ khAstStatement kh_parseStatement(char32_t** cursor) {
 
             case khKeywordToken_ELIF:
                 raiseError(token.begin, U"no following if statement to have an elif statement");
-                skipToken(cursor);
-                khToken_delete(&token);
+                skipToken(parser);
                 goto end;
 
             case khKeywordToken_ELSE:
                 raiseError(token.begin, U"no following if statement to have an else statement");
-                skipToken(cursor);
-                khToken_delete(&token);
+                skipToken(parser);
                 goto end;
 
             case khKeywordToken_FOR: {
-                khAstForLoop for_loop = sparseForLoop(cursor);
-                khToken_delete(&token);
+                khAstForLoop for_loop = sparseForLoop(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_FOR_LOOP,
                                              .for_loop = for_loop};
                 goto end;
             }
 
             case khKeywordToken_WHILE: {
-                khAstWhileLoop while_loop = sparseWhileLoop(cursor);
-                khToken_delete(&token);
+                khAstWhileLoop while_loop = sparseWhileLoop(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_WHILE_LOOP,
                                              .while_loop = while_loop};
                 goto end;
             }
 
             case khKeywordToken_DO: {
-                khAstDoWhileLoop do_while_loop = sparseDoWhileLoop(cursor);
-                khToken_delete(&token);
+                khAstDoWhileLoop do_while_loop = sparseDoWhileLoop(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_DO_WHILE_LOOP,
                                              .do_while_loop = do_while_loop};
                 goto end;
             }
 
             case khKeywordToken_BREAK: {
-                sparseBreak(cursor);
-                khToken_delete(&token);
-                statement =
-                    (khAstStatement){.begin = origin, .end = *cursor, .type = khAstStatementType_BREAK};
+                sparseBreak(parser);
+                statement = (khAstStatement){
+                    .begin = origin, .end = parser->cursor, .type = khAstStatementType_BREAK};
                 goto end;
             }
 
             case khKeywordToken_CONTINUE: {
-                sparseContinue(cursor);
-                khToken_delete(&token);
+                sparseContinue(parser);
                 statement = (khAstStatement){
-                    .begin = origin, .end = *cursor, .type = khAstStatementType_CONTINUE};
+                    .begin = origin, .end = parser->cursor, .type = khAstStatementType_CONTINUE};
                 goto end;
             }
 
             case khKeywordToken_RETURN: {
-                khAstReturn return_v = sparseReturn(cursor);
-                khToken_delete(&token);
+                khAstReturn return_v = sparseReturn(parser);
                 statement = (khAstStatement){.begin = origin,
-                                             .end = *cursor,
+                                             .end = parser->cursor,
                                              .type = khAstStatementType_RETURN,
                                              .return_v = return_v};
                 goto end;
@@ -370,7 +1011,6 @@ khAstStatement kh_parseStatement(char32_t** cursor) {
     }
     else if (token.type == khTokenType_EOF) {
         raiseError(token.begin, U"expecting a statement, met with a dead end");
-        khToken_delete(&token);
         goto end;
     }
 out:
@@ -378,112 +1018,122 @@ out:
     if (token.type == khTokenType_KEYWORD &&
         (token.keyword == khKeywordToken_REF || token.keyword == khKeywordToken_WILD ||
          token.keyword == khKeywordToken_INCASE || token.keyword == khKeywordToken_STATIC)) {
-        khAstVariable variable = sparseVariable(cursor, false, false, false);
-        statement = (khAstStatement){
-            .begin = origin, .end = *cursor, .type = khAstStatementType_VARIABLE, .variable = variable};
+        khAstVariable variable = sparseVariable(parser, false, false, false);
+        statement = (khAstStatement){.begin = origin,
+                                     .end = parser->cursor,
+                                     .type = khAstStatementType_VARIABLE,
+                                     .variable = variable};
 
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        token = currentToken(parser, false);
     }
     // Tests out whether this might be a specifierless variable declaration
     else if (token.type == khTokenType_IDENTIFIER) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
 
         if (token.type == khTokenType_DELIMITER &&
             (token.delimiter == khDelimiterToken_COMMA || token.delimiter == khDelimiterToken_COLON)) {
-            *cursor = origin;
-            khAstVariable variable = sparseVariable(cursor, false, false, false);
+            parser->cursor = origin;
+            parser->index = origin_index;
+            khAstVariable variable = sparseVariable(parser, false, false, false);
             statement = (khAstStatement){.begin = origin,
-                                         .end = *cursor,
+                                         .end = parser->cursor,
                                          .type = khAstStatementType_VARIABLE,
                                          .variable = variable};
         }
         else {
-            *cursor = origin;
-            khAstExpression expression = kh_parseExpression(cursor, false, false);
+            parser->cursor = origin;
+            parser->index = origin_index;
+            khAstExpression expression = parseExpression(parser, false, false);
             statement = (khAstStatement){.begin = origin,
-                                         .end = *cursor,
+                                         .end = parser->cursor,
                                          .type = khAstStatementType_EXPRESSION,
                                          .expression = expression};
         }
 
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        token = currentToken(parser, false);
     }
     // Parses expression in the body if none of the keywords above are found
     else {
-        khAstExpression expression = kh_parseExpression(cursor, false, false);
+        khAstExpression expression = parseExpression(parser, false, false);
         statement = (khAstStatement){.begin = origin,
-                                     .end = *cursor,
+                                     .end = parser->cursor,
                                      .type = khAstStatementType_EXPRESSION,
                                      .expression = expression};
 
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        token = currentToken(parser, false);
     }
 
     // Ensures EOF, newline, or semicolon
     if (token.type == khTokenType_EOF || token.type == khTokenType_NEWLINE ||
         (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else if (token.type == khTokenType_DELIMITER &&
              token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
         // Do nothing
     }
     else {
-        // Still skips a token, to prevent other being stuck at the same token
-        skipToken(cursor);
         raiseError(token.begin, U"expecting a newline or a semicolon");
+        synchronize(parser);
     }
 
-    khToken_delete(&token);
 
 end:
+    statement.file = parser->file;
     return statement;
 }
 
-static kharray(khAstStatement) sparseBlock(char32_t** cursor) {
-    kharray(khAstStatement) block = kharray_new(khAstStatement, khAstStatement_delete);
-    khToken token = currentToken(cursor, true);
+static kharray(khAstStatement) sparseBlock(khParser* parser) {
+    kharray(khAstStatement) block = newArray(parser, khAstStatement, khAstStatement_delete);
+    khToken token = currentToken(parser, true);
+    // Leaves room for the expressions of its statements, so that it's the block which gets cut off
+    bool is_too_deep = parser->depth + 1 >= kh_PARSE_MAX_DEPTH;
+
+    if (is_too_deep) {
+        raiseError(token.begin, U"block is nested too deeply");
+    }
 
     // Ensures opening bracket
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_CURLY_BRACKET_OPEN) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        skipToken(parser);
+        token = currentToken(parser, true);
     }
     else {
         raiseError(token.begin, U"expecting an opening curly bracket");
     }
 
+    // Leaves the block empty, not going any deeper
+    if (is_too_deep) {
+        skipNested(parser, true);
+        token = currentToken(parser, true);
+    }
+
+    parser->depth++;
+
     // Gets the next statement until closing bracket
     while (!(token.type == khTokenType_DELIMITER &&
              token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE)) {
         // To make sure it won't get into an infinite loop
         if (token.type == khTokenType_EOF) {
             raiseError(token.begin, U"expecting a statement, met with a dead end");
-            khToken_delete(&token);
             goto end;
         }
 
-        kharray_append(&block, kh_parseStatement(cursor));
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        kharray_append(&block, parseStatement(parser));
+        token = currentToken(parser, true);
     }
 
-    skipToken(cursor);
-    khToken_delete(&token);
+    skipToken(parser);
 
 end:
+    parser->depth--;
     return block;
 }
 
-static void sparseSpecifiers(char32_t** cursor, bool allow_incase, bool* is_incase, bool allow_static,
+static void sparseSpecifiers(khParser* parser, bool allow_incase, bool* is_incase, bool allow_static,
                              bool* is_static, bool ignore_newline) {
-    khToken token = currentToken(cursor, ignore_newline);
+    khToken token = currentToken(parser, ignore_newline);
 
     if (is_incase) {
         *is_incase = false;
@@ -502,9 +1152,8 @@ static void sparseSpecifiers(char32_t** cursor, bool allow_incase, bool* is_inca
                     *is_incase = true;
                 }
 
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, ignore_newline);
+                skipToken(parser);
+                token = currentToken(parser, ignore_newline);
                 break;
 
             case khKeywordToken_STATIC:
@@ -515,9 +1164,8 @@ static void sparseSpecifiers(char32_t** cursor, bool allow_incase, bool* is_inca
                     *is_static = true;
                 }
 
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, ignore_newline);
+                skipToken(parser);
+                token = currentToken(parser, ignore_newline);
                 break;
 
             default:
@@ -525,50 +1173,43 @@ static void sparseSpecifiers(char32_t** cursor, bool allow_incase, bool* is_inca
         }
     }
 out:
-
-    khToken_delete(&token);
 }
 
-static khAstVariable sparseVariable(char32_t** cursor, bool no_static, bool no_unpacking,
+static khAstVariable sparseVariable(khParser* parser, bool no_static, bool no_unpacking,
                                     bool ignore_newline) {
-    khToken token = currentToken(cursor, ignore_newline);
+    khToken token = currentToken(parser, ignore_newline);
     khAstVariable variable = {.is_static = false,
                               .is_wild = false,
                               .is_ref = false,
-                              .names = kharray_new(khstring, khstring_delete),
+                              .names = newArray(parser, khstring, khstring_delete),
                               .opt_type = NULL,
                               .opt_initializer = NULL};
 
-
     if (!no_static) {
         // `static` specifier
-        sparseSpecifiers(cursor, false, NULL, true, &variable.is_static, ignore_newline);
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
+        sparseSpecifiers(parser, false, NULL, true, &variable.is_static, ignore_newline);
+        token = currentToken(parser, ignore_newline);
     }
 
     // `wild` specifier
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_WILD) {
         variable.is_wild = true;
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
+        skipToken(parser);
+        token = currentToken(parser, ignore_newline);
     }
 
     // `ref` specifier
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_REF) {
         variable.is_ref = true;
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
+        skipToken(parser);
+        token = currentToken(parser, ignore_newline);
     }
 
     // Its name
     if (token.type == khTokenType_IDENTIFIER) {
-        kharray_append(&variable.names, khstring_copy(&token.identifier));
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
+        kharray_append(&variable.names, takeIdentifier(parser));
+        skipToken(parser);
+        token = currentToken(parser, ignore_newline);
     }
     else {
         raiseError(token.begin, U"expecting a name for the variable in the declaration");
@@ -579,15 +1220,13 @@ static khAstVariable sparseVariable(char32_t** cursor, bool no_static, bool no_u
     if (!no_unpacking && token.type == khTokenType_DELIMITER &&
         token.delimiter == khDelimiterToken_COMMA) {
         do {
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, ignore_newline);
+            skipToken(parser);
+            token = currentToken(parser, ignore_newline);
 
             if (token.type == khTokenType_IDENTIFIER) {
-                kharray_append(&variable.names, khstring_copy(&token.identifier));
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, ignore_newline);
+                kharray_append(&variable.names, takeIdentifier(parser));
+                skipToken(parser);
+                token = currentToken(parser, ignore_newline);
             }
             else {
                 raiseError(token.begin,
@@ -597,31 +1236,28 @@ static khAstVariable sparseVariable(char32_t** cursor, bool no_static, bool no_u
 
         // Mandatory `:=`
         if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COLON) {
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, ignore_newline);
+            skipToken(parser);
+            token = currentToken(parser, ignore_newline);
         }
         else {
             raiseError(token.begin, U"expecting a `:=` in the unpacking declaration");
         }
 
         if (token.type == khTokenType_OPERATOR && token.operator_v == khOperatorToken_ASSIGN) {
-            skipToken(cursor);
+            skipToken(parser);
         }
         else {
             raiseError(token.begin, U"expecting a `:=` in the unpacking declaration");
         }
 
         // Mandatory initializer
-        variable.opt_initializer = malloc(sizeof(khAstExpression));
-        *variable.opt_initializer = kh_parseExpression(cursor, ignore_newline, false);
+        variable.opt_initializer = box(parser, parseExpression(parser, ignore_newline, false));
     }
     else {
         // Passes through the colon
         if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COLON) {
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, ignore_newline);
+            skipToken(parser);
+            token = currentToken(parser, ignore_newline);
         }
         else {
             raiseError(token.begin,
@@ -630,35 +1266,30 @@ static khAstVariable sparseVariable(char32_t** cursor, bool no_static, bool no_u
 
         // If there's no assign op at first, it's a type: `name: Type`
         if (!(token.type == khTokenType_OPERATOR && token.operator_v == khOperatorToken_ASSIGN)) {
-            variable.opt_type = malloc(sizeof(khAstExpression));
-            *variable.opt_type = kh_parseExpression(cursor, ignore_newline, true);
+            variable.opt_type = box(parser, parseExpression(parser, ignore_newline, true));
 
-            khToken_delete(&token);
-            token = currentToken(cursor, ignore_newline);
+            token = currentToken(parser, ignore_newline);
         }
 
         // Optional initializer
         if (token.type == khTokenType_OPERATOR && token.operator_v == khOperatorToken_ASSIGN) {
-            skipToken(cursor);
-            variable.opt_initializer = malloc(sizeof(khAstExpression));
-            *variable.opt_initializer = kh_parseExpression(cursor, ignore_newline, false);
+            skipToken(parser);
+            variable.opt_initializer = box(parser, parseExpression(parser, ignore_newline, false));
         }
     }
 
-    khToken_delete(&token);
     return variable;
 }
 
-static khAstImport sparseImport(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
+static khAstImport sparseImport(khParser* parser) {
+    khToken token = currentToken(parser, true);
     khAstImport import_v = {
-        .path = kharray_new(khstring, khstring_delete), .relative = false, .opt_alias = NULL};
+        .path = newArray(parser, khstring, khstring_delete), .relative = false, .opt_alias = NULL};
 
     // Ensures `import` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_IMPORT) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting an `import` keyword");
@@ -666,18 +1297,16 @@ static khAstImport sparseImport(char32_t** cursor) {
 
     // For relative imports, `import .a_script_file_in_the_same_folder`
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_DOT) {
-        skipToken(cursor);
+        skipToken(parser);
         import_v.relative = true;
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        token = currentToken(parser, false);
     }
 
     // Minimum one identifier
     if (token.type == khTokenType_IDENTIFIER) {
-        kharray_append(&import_v.path, khstring_copy(&token.identifier));
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        kharray_append(&import_v.path, takeIdentifier(parser));
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     // Directory import, `import .`
     else if (import_v.relative) {
@@ -689,15 +1318,13 @@ static khAstImport sparseImport(char32_t** cursor) {
 
     // Continues on
     while (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_DOT) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
 
         if (token.type == khTokenType_IDENTIFIER) {
-            kharray_append(&import_v.path, khstring_copy(&token.identifier));
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, false);
+            kharray_append(&import_v.path, takeIdentifier(parser));
+            skipToken(parser);
+            token = currentToken(parser, false);
         }
         else {
             raiseError(token.begin, U"expecting another identifier");
@@ -707,16 +1334,14 @@ static khAstImport sparseImport(char32_t** cursor) {
 finish:
     // `import something as another`
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_AS) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
 
         if (token.type == khTokenType_IDENTIFIER) {
-            import_v.opt_alias = malloc(sizeof(kharray(char)*));
-            *import_v.opt_alias = khstring_copy(&token.identifier);
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, false);
+            import_v.opt_alias = newArray(parser, khstring, khstring_delete);
+            kharray_append(&import_v.opt_alias, takeIdentifier(parser));
+            skipToken(parser);
+            token = currentToken(parser, false);
         }
         else {
             raiseError(token.begin, U"expecting an identifier to alias the imported module as");
@@ -725,7 +1350,7 @@ finish:
 
     if (token.type == khTokenType_NEWLINE || token.type == khTokenType_EOF ||
         (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else if (token.type == khTokenType_DELIMITER &&
              token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
@@ -733,21 +1358,20 @@ finish:
     }
     else {
         raiseError(token.begin, U"expecting a newline or a semicolon");
+        synchronize(parser);
     }
 
-    khToken_delete(&token);
     return import_v;
 }
 
-static khAstInclude sparseInclude(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
-    khAstInclude include = {.path = kharray_new(khstring, khstring_delete), .relative = false};
+static khAstInclude sparseInclude(khParser* parser) {
+    khToken token = currentToken(parser, true);
+    khAstInclude include = {.path = newArray(parser, khstring, khstring_delete), .relative = false};
 
     // Ensures `include` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_INCLUDE) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting an `include` keyword");
@@ -756,17 +1380,15 @@ static khAstInclude sparseInclude(char32_t** cursor) {
     // For relative includes, `include .a_script_file_in_the_same_folder`
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_DOT) {
         include.relative = true;
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
 
     // Minimum one identifier
     if (token.type == khTokenType_IDENTIFIER) {
-        kharray_append(&include.path, khstring_copy(&token.identifier));
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        kharray_append(&include.path, takeIdentifier(parser));
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     // Directory include, `include .`
     else if (include.relative) {
@@ -778,15 +1400,13 @@ static khAstInclude sparseInclude(char32_t** cursor) {
 
     // Continues on
     while (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_DOT) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
 
         if (token.type == khTokenType_IDENTIFIER) {
-            kharray_append(&include.path, khstring_copy(&token.identifier));
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, false);
+            kharray_append(&include.path, takeIdentifier(parser));
+            skipToken(parser);
+            token = currentToken(parser, false);
         }
         else {
             raiseError(token.begin, U"expecting another identifier");
@@ -796,7 +1416,7 @@ static khAstInclude sparseInclude(char32_t** cursor) {
 finish:
     if (token.type == khTokenType_NEWLINE || token.type == khTokenType_EOF ||
         (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else if (token.type == khTokenType_DELIMITER &&
              token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
@@ -804,23 +1424,50 @@ finish:
     }
     else {
         raiseError(token.begin, U"expecting a newline or a semicolon");
+        synchronize(parser);
     }
 
-    khToken_delete(&token);
     return include;
 }
 
-static inline void sparseFunctionOrLambda(char32_t** cursor, kharray(khAstVariable) * arguments,
+// Parses the body of a function or a lambda, unless bodies get skipped. Then it's left empty, with the
+// range of its source for `khAstFunction_body` or `khAstLambda_body` to parse
+static kharray(khAstStatement) sparseBody(khParser* parser, khAstLazyBlock* lazy_block) {
+    khToken token = currentToken(parser, true);
+
+    // Only when no token past the opening curly bracket was lexed yet, so there's none to throw away
+    if (parser->is_lazy && token.type == khTokenType_DELIMITER &&
+        token.delimiter == khDelimiterToken_CURLY_BRACKET_OPEN &&
+        parser->index + 1 == kharray_size(&parser->tokens)) {
+        char32_t* end = matchBlock(parser->string + token.begin);
+
+        if (end != NULL) {
+            *lazy_block = (khAstLazyBlock){.source = khAstSource_retain(parserSource(parser)),
+                                           .begin = token.begin,
+                                           .end = end - parser->string,
+                                           .opt_arena = parser->opt_arena};
+
+            // Carries on right after the block, as if all of its tokens were skipped
+            parser->index++;
+            parser->cursor = end - parser->string;
+            parser->lexer_cursor = end;
+            return newArray(parser, khAstStatement, khAstStatement_delete);
+        }
+    }
+
+    return sparseBlock(parser);
+}
+
+static inline void sparseFunctionOrLambda(khParser* parser, kharray(khAstVariable) * arguments,
                                           khAstVariable** opt_variadic_argument,
                                           bool* is_return_type_ref, khAstExpression** opt_return_type,
-                                          kharray(khAstStatement) * block) {
-    khToken token = currentToken(cursor, false);
+                                          kharray(khAstStatement) * block, khAstLazyBlock* lazy_block) {
+    khToken token = currentToken(parser, false);
 
     // Starts out by parsing the argument
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_PARENTHESIS_OPEN) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        skipToken(parser);
+        token = currentToken(parser, true);
     }
     else {
         raiseError(token.begin, U"expecting an opening parenthesis for the arguments");
@@ -830,13 +1477,12 @@ static inline void sparseFunctionOrLambda(char32_t** cursor, kharray(khAstVariab
              token.delimiter == khDelimiterToken_PARENTHESIS_CLOSE)) {
         // Variadic argument as the end
         if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_ELLIPSIS) {
-            skipToken(cursor);
+            skipToken(parser);
 
-            *opt_variadic_argument = malloc(sizeof(khAstVariable));
-            **opt_variadic_argument = sparseVariable(cursor, true, true, true);
+            *opt_variadic_argument = newArray(parser, khAstVariable, khAstVariable_delete);
+            kharray_append(opt_variadic_argument, sparseVariable(parser, true, true, true));
 
-            khToken_delete(&token);
-            token = currentToken(cursor, true);
+            token = currentToken(parser, true);
 
             if (!(token.type == khTokenType_DELIMITER &&
                   token.delimiter == khDelimiterToken_PARENTHESIS_CLOSE)) {
@@ -847,14 +1493,12 @@ static inline void sparseFunctionOrLambda(char32_t** cursor, kharray(khAstVariab
         }
 
         // Parse argument
-        kharray_append(arguments, sparseVariable(cursor, true, true, true));
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        kharray_append(arguments, sparseVariable(parser, true, true, true));
+        token = currentToken(parser, true);
 
         if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COMMA) {
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, true);
+            skipToken(parser);
+            token = currentToken(parser, true);
         }
         else if (token.type == khTokenType_DELIMITER &&
                  token.delimiter == khDelimiterToken_PARENTHESIS_CLOSE) {
@@ -869,64 +1513,56 @@ static inline void sparseFunctionOrLambda(char32_t** cursor, kharray(khAstVariab
         else {
             raiseError(token.begin,
                        U"expecting a comma with another argument or a closing parenthesis");
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, true);
+            skipToken(parser);
+            token = currentToken(parser, true);
         }
     }
 
-    skipToken(cursor);
-    khToken_delete(&token);
-    token = currentToken(cursor, true);
+    skipToken(parser);
+    token = currentToken(parser, true);
 
     // Optional return type
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_ARROW) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        skipToken(parser);
+        token = currentToken(parser, true);
 
         if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_REF) {
             *is_return_type_ref = true;
-            skipToken(cursor);
+            skipToken(parser);
         }
         else {
             *is_return_type_ref = false;
         }
 
-        *opt_return_type = malloc(sizeof(khAstExpression));
-        **opt_return_type = kh_parseExpression(cursor, true, true);
+        *opt_return_type = box(parser, parseExpression(parser, true, true));
 
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        token = currentToken(parser, true);
     }
 
     // Body
-    *block = sparseBlock(cursor);
-
-    khToken_delete(&token);
+    *block = sparseBody(parser, lazy_block);
 }
 
-static khAstFunction sparseFunction(char32_t** cursor) {
+static khAstFunction sparseFunction(khParser* parser) {
     khAstFunction function = {.is_incase = false,
                               .is_static = false,
-                              .identifiers = kharray_new(khstring, khstring_delete),
-                              .template_arguments = kharray_new(khstring, khstring_delete),
-                              .arguments = kharray_new(khAstVariable, khAstVariable_delete),
+                              .identifiers = newArray(parser, khstring, khstring_delete),
+                              .template_arguments = newArray(parser, khstring, khstring_delete),
+                              .arguments = newArray(parser, khAstVariable, khAstVariable_delete),
                               .opt_variadic_argument = NULL,
                               .is_return_type_ref = false,
                               .opt_return_type = NULL,
                               .block = NULL};
 
     // Any specifiers: `incase static def function() { ... }`
-    sparseSpecifiers(cursor, true, &function.is_incase, true, &function.is_static, true);
+    sparseSpecifiers(parser, true, &function.is_incase, true, &function.is_static, true);
 
-    khToken token = currentToken(cursor, true);
+    khToken token = currentToken(parser, true);
 
     // Ensures `def` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_DEF) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting a `def` keyword");
@@ -935,15 +1571,13 @@ static khAstFunction sparseFunction(char32_t** cursor) {
     // Identifiers
     goto in;
     while (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_DOT) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        skipToken(parser);
+        token = currentToken(parser, true);
     in:
         if (token.type == khTokenType_IDENTIFIER) {
-            kharray_append(&function.identifiers, khstring_copy(&token.identifier));
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, false);
+            kharray_append(&function.identifiers, takeIdentifier(parser));
+            skipToken(parser);
+            token = currentToken(parser, false);
         }
         else {
             raiseError(token.begin, U"expecting an identifier or name of the function");
@@ -952,42 +1586,37 @@ static khAstFunction sparseFunction(char32_t** cursor) {
 
     // Any template args
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_EXCLAMATION) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
 
         // Single template argument: `def name!T`
         if (token.type == khTokenType_IDENTIFIER) {
-            kharray_append(&function.template_arguments, khstring_copy(&token.identifier));
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, false);
+            kharray_append(&function.template_arguments, takeIdentifier(parser));
+            skipToken(parser);
+            token = currentToken(parser, false);
         }
         // Multiple template arguments in parentheses: `def name!(T, U)`
         else if (token.type == khTokenType_DELIMITER &&
                  token.delimiter == khDelimiterToken_PARENTHESIS_OPEN) {
             do {
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, true);
+                skipToken(parser);
+                token = currentToken(parser, true);
 
                 if (token.type == khTokenType_IDENTIFIER) {
-                    kharray_append(&function.template_arguments, khstring_copy(&token.identifier));
+                    kharray_append(&function.template_arguments, takeIdentifier(parser));
                 }
                 else {
                     raiseError(token.begin, U"expecting the name for a template argument");
                 }
 
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, true);
+                skipToken(parser);
+                token = currentToken(parser, true);
             } while (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COMMA);
 
             if (token.type == khTokenType_DELIMITER &&
                 token.delimiter == khDelimiterToken_PARENTHESIS_CLOSE) {
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, false);
+                skipToken(parser);
+                token = currentToken(parser, false);
             }
             else {
                 raiseError(token.begin, U"expecting a closing parenthesis");
@@ -999,69 +1628,63 @@ static khAstFunction sparseFunction(char32_t** cursor) {
     }
 
     // This will take care of the rest, including arguments and body
-    sparseFunctionOrLambda(cursor, &function.arguments, &function.opt_variadic_argument,
-                           &function.is_return_type_ref, &function.opt_return_type, &function.block);
+    sparseFunctionOrLambda(parser, &function.arguments, &function.opt_variadic_argument,
+                           &function.is_return_type_ref, &function.opt_return_type, &function.block,
+                           &function.lazy_block);
 
-    khToken_delete(&token);
     return function;
 }
 
-static inline void sparseClassOrStruct(char32_t** cursor, khstring* name,
+static inline void sparseClassOrStruct(khParser* parser, khstring* name,
                                        kharray(khstring) * template_arguments,
                                        khAstExpression** opt_base_type,
                                        kharray(khAstStatement) * block) {
-    khToken token = currentToken(cursor, false);
+    khToken token = currentToken(parser, false);
 
     // Ensures the name identifier of the class or struct
     if (token.type == khTokenType_IDENTIFIER) {
-        *name = khstring_copy(&token.identifier);
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        *name = takeIdentifier(parser);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
-        *name = khstring_new(U"");
+        *name = khstring_newIn(U"", parser->opt_arena);
         raiseError(token.begin, U"expecting a name for the type");
     }
 
     // Any template args
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_EXCLAMATION) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
 
         // Single template argument: `class Name!T`
         if (token.type == khTokenType_IDENTIFIER) {
-            kharray_append(template_arguments, khstring_copy(&token.identifier));
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, false);
+            kharray_append(template_arguments, takeIdentifier(parser));
+            skipToken(parser);
+            token = currentToken(parser, false);
         }
         // Multiple template arguments in parentheses: `class Name!(T, U)`
         else if (token.type == khTokenType_DELIMITER &&
                  token.delimiter == khDelimiterToken_PARENTHESIS_OPEN) {
             do {
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, true);
+                skipToken(parser);
+                token = currentToken(parser, true);
 
                 if (token.type == khTokenType_IDENTIFIER) {
-                    kharray_append(template_arguments, khstring_copy(&token.identifier));
+                    kharray_append(template_arguments, takeIdentifier(parser));
                 }
                 else {
                     raiseError(token.begin, U"expecting the name for a template argument");
                 }
 
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, true);
+                skipToken(parser);
+                token = currentToken(parser, true);
             } while (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COMMA);
 
             if (token.type == khTokenType_DELIMITER &&
                 token.delimiter == khDelimiterToken_PARENTHESIS_CLOSE) {
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, false);
+                skipToken(parser);
+                token = currentToken(parser, false);
             }
             else {
                 raiseError(token.begin, U"expecting a closing parenthesis");
@@ -1075,84 +1698,77 @@ static inline void sparseClassOrStruct(char32_t** cursor, khstring* name,
     // If a class is inheriting something: `class Name inherits Base`
     if (opt_base_type != NULL && token.type == khTokenType_KEYWORD &&
         token.keyword == khKeywordToken_INHERITS) {
-        skipToken(cursor);
-        *opt_base_type = malloc(sizeof(khAstExpression));
-        **opt_base_type = kh_parseExpression(cursor, true, true);
+        skipToken(parser);
+        *opt_base_type = box(parser, parseExpression(parser, true, true));
 
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        token = currentToken(parser, true);
     }
 
     // Parses its block
-    *block = sparseBlock(cursor);
-
-    khToken_delete(&token);
+    *block = sparseBlock(parser);
 }
 
-static khAstClass sparseClass(char32_t** cursor) {
+static khAstClass sparseClass(khParser* parser) {
     khAstClass class_v = {.is_incase = false,
                           .name = NULL,
-                          .template_arguments = kharray_new(khstring, khstring_delete),
+                          .template_arguments = newArray(parser, khstring, khstring_delete),
                           .opt_base_type = NULL,
                           .block = NULL};
 
     // Any specifiers: `incase class E { ... }`
-    sparseSpecifiers(cursor, true, &class_v.is_incase, false, NULL, true);
+    sparseSpecifiers(parser, true, &class_v.is_incase, false, NULL, true);
 
-    khToken token = currentToken(cursor, true);
+    khToken token = currentToken(parser, true);
 
     // Ensures `class` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_CLASS) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else {
         raiseError(token.begin, U"expecting a `class` keyword");
     }
 
-    sparseClassOrStruct(cursor, &class_v.name, &class_v.template_arguments, &class_v.opt_base_type,
+    sparseClassOrStruct(parser, &class_v.name, &class_v.template_arguments, &class_v.opt_base_type,
                         &class_v.block);
 
-    khToken_delete(&token);
     return class_v;
 }
 
-static khAstStruct sparseStruct(char32_t** cursor) {
+static khAstStruct sparseStruct(khParser* parser) {
     khAstStruct struct_v = {.is_incase = false,
                             .name = NULL,
-                            .template_arguments = kharray_new(khstring, khstring_delete),
+                            .template_arguments = newArray(parser, khstring, khstring_delete),
                             .block = NULL};
 
     // Any specifiers: `incase struct E { ... }`
-    sparseSpecifiers(cursor, true, &struct_v.is_incase, false, NULL, true);
+    sparseSpecifiers(parser, true, &struct_v.is_incase, false, NULL, true);
 
-    khToken token = currentToken(cursor, true);
+    khToken token = currentToken(parser, true);
 
     // Ensures `struct` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_STRUCT) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else {
         raiseError(token.begin, U"expecting a `struct` keyword");
     }
 
-    sparseClassOrStruct(cursor, &struct_v.name, &struct_v.template_arguments, NULL, &struct_v.block);
+    sparseClassOrStruct(parser, &struct_v.name, &struct_v.template_arguments, NULL, &struct_v.block);
 
-    khToken_delete(&token);
     return struct_v;
 }
 
-static khAstEnum sparseEnum(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
-    khAstEnum enum_v = {.name = NULL, .members = kharray_new(khstring, khstring_delete)};
+static khAstEnum sparseEnum(khParser* parser) {
+    khToken token = currentToken(parser, true);
+    khAstEnum enum_v = {.name = NULL, .members = newArray(parser, khstring, khstring_delete)};
 
     // No specifiers at all
-    sparseSpecifiers(cursor, false, NULL, false, NULL, true);
+    sparseSpecifiers(parser, false, NULL, false, NULL, true);
 
     // Ensures `enum` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_ENUM) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting an `enum` keyword");
@@ -1160,39 +1776,36 @@ static khAstEnum sparseEnum(char32_t** cursor) {
 
     // Its name
     if (token.type == khTokenType_IDENTIFIER) {
-        enum_v.name = khstring_copy(&token.identifier);
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        enum_v.name = takeIdentifier(parser);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
-        enum_v.name = khstring_new(U"");
+        enum_v.name = khstring_newIn(U"", parser->opt_arena);
         raiseError(token.begin, U"expecting a name for the enum type");
     }
 
     // Its members
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_CURLY_BRACKET_OPEN) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        skipToken(parser);
+        token = currentToken(parser, true);
 
         do {
             if (token.type == khTokenType_IDENTIFIER) {
-                kharray_append(&enum_v.members, khstring_copy(&token.identifier));
+                kharray_append(&enum_v.members, takeIdentifier(parser));
             }
             else {
                 raiseError(token.begin, U"expecting a member name");
             }
 
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, true);
+            skipToken(parser);
+            token = currentToken(parser, true);
         } while (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COMMA);
 
         // Ensures closing bracket at the end
         if (token.type == khTokenType_DELIMITER &&
             token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
-            skipToken(cursor);
+            skipToken(parser);
         }
         else {
             raiseError(token.begin,
@@ -1203,26 +1816,21 @@ static khAstEnum sparseEnum(char32_t** cursor) {
         raiseError(token.begin, U"expecting a `class` keyword");
     }
 
-    khToken_delete(&token);
     return enum_v;
 }
 
-static khAstAlias sparseAlias(char32_t** cursor) {
-    khAstAlias alias = {.is_incase = false,
-                        .name = NULL,
-                        .expression = (khAstExpression){
-                            .begin = NULL, .end = NULL, .type = khAstExpressionType_INVALID}};
+static khAstAlias sparseAlias(khParser* parser) {
+    khAstAlias alias = {.is_incase = false, .name = NULL, .expression = invalidExpression()};
 
     // Any specifiers
-    sparseSpecifiers(cursor, true, &alias.is_incase, false, NULL, true);
+    sparseSpecifiers(parser, true, &alias.is_incase, false, NULL, true);
 
-    khToken token = currentToken(cursor, true);
+    khToken token = currentToken(parser, true);
 
     // Ensures `alias` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_ALIAS) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting an `alias` keyword");
@@ -1230,24 +1838,23 @@ static khAstAlias sparseAlias(char32_t** cursor) {
 
     // Its name
     if (token.type == khTokenType_IDENTIFIER) {
-        alias.name = khstring_copy(&token.identifier);
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        alias.name = takeIdentifier(parser);
+        skipToken(parser);
+        token = currentToken(parser, true);
     }
     else {
-        alias.name = khstring_new(U"");
+        alias.name = khstring_newIn(U"", parser->opt_arena);
         raiseError(token.begin, U"expecting a name for the alias");
     }
 
     // Its alias expression
-    alias.expression = kh_parseExpression(cursor, false, false);
-    token = currentToken(cursor, false);
+    alias.expression = parseExpression(parser, false, false);
+    token = currentToken(parser, false);
 
     // Ensures a newline or a semicolon at the end
     if (token.type == khTokenType_NEWLINE || token.type == khTokenType_EOF ||
         (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else if (token.type == khTokenType_DELIMITER &&
              token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
@@ -1255,25 +1862,25 @@ static khAstAlias sparseAlias(char32_t** cursor) {
     }
     else {
         raiseError(token.begin, U"expecting a newline or a semicolon");
+        synchronize(parser);
     }
 
-    khToken_delete(&token);
     return alias;
 }
 
 
-static khAstIfBranch sparseIfBranch(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
+static khAstIfBranch sparseIfBranch(khParser* parser) {
+    khToken token = currentToken(parser, true);
     khAstIfBranch if_branch = (khAstIfBranch){
-        .branch_conditions = kharray_new(khAstExpression, khAstExpression_delete),
-        .branch_blocks = kharray_new(kharray(khAstStatement), kharray_arrayDeleter(khAstStatement)),
-        .else_block = kharray_new(khAstStatement, khAstStatement_delete)};
+        .branch_conditions = newArray(parser, khAstExpression, khAstExpression_delete),
+        .branch_blocks =
+            newArray(parser, kharray(khAstStatement), kharray_arrayDeleter(khAstStatement)),
+        .else_block = newArray(parser, khAstStatement, khAstStatement_delete)};
 
     // Ensures initial `if` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_IF) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting an `if` keyword");
@@ -1281,87 +1888,79 @@ static khAstIfBranch sparseIfBranch(char32_t** cursor) {
 
     goto in;
     while (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_ELIF) {
-        skipToken(cursor);
+        skipToken(parser);
     in:
-        kharray_append(&if_branch.branch_conditions, kh_parseExpression(cursor, false, false));
-        kharray_append(&if_branch.branch_blocks, sparseBlock(cursor));
+        kharray_append(&if_branch.branch_conditions, parseExpression(parser, false, false));
+        kharray_append(&if_branch.branch_blocks, sparseBlock(parser));
 
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        token = currentToken(parser, true);
 
         // Loop back again if there are any `elif` keywords
     }
 
     // End optional `else` block
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_ELSE) {
-        skipToken(cursor);
-        if_branch.else_block = sparseBlock(cursor);
+        skipToken(parser);
+        kharray_delete(&if_branch.else_block);
+        if_branch.else_block = sparseBlock(parser);
     }
 
-    khToken_delete(&token);
     return if_branch;
 }
 
-static khAstWhileLoop sparseWhileLoop(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
-    khAstWhileLoop while_loop = {
-        .condition = (khAstExpression){.begin = NULL, .end = NULL, .type = khAstExpressionType_INVALID},
-        .block = NULL};
+static khAstWhileLoop sparseWhileLoop(khParser* parser) {
+    khToken token = currentToken(parser, true);
+    khAstWhileLoop while_loop = {.condition = invalidExpression(), .block = NULL};
 
     // Ensures `while` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_WHILE) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else {
         raiseError(token.begin, U"expecting a `while` keyword");
     }
 
     // Its condition and block block
-    while_loop.condition = kh_parseExpression(cursor, false, false);
-    while_loop.block = sparseBlock(cursor);
+    while_loop.condition = parseExpression(parser, false, false);
+    while_loop.block = sparseBlock(parser);
 
-    khToken_delete(&token);
     return while_loop;
 }
 
-static khAstDoWhileLoop sparseDoWhileLoop(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
-    khAstDoWhileLoop do_while_loop = {
-        .condition = (khAstExpression){.begin = NULL, .end = NULL, .type = khAstExpressionType_INVALID},
-        .block = NULL};
+static khAstDoWhileLoop sparseDoWhileLoop(khParser* parser) {
+    khToken token = currentToken(parser, true);
+    khAstDoWhileLoop do_while_loop = {.condition = invalidExpression(), .block = NULL};
 
     // Ensures `do` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_DO) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else {
         raiseError(token.begin, U"expecting a `do` keyword");
     }
 
     // Its block
-    do_while_loop.block = sparseBlock(cursor);
+    do_while_loop.block = sparseBlock(parser);
 
-    khToken_delete(&token);
-    token = currentToken(cursor, true);
+    token = currentToken(parser, true);
 
     // Ensures `while` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_WHILE) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else {
         raiseError(token.begin, U"expecting a `while` keyword");
     }
 
     // And its condition
-    do_while_loop.condition = kh_parseExpression(cursor, false, false);
+    do_while_loop.condition = parseExpression(parser, false, false);
 
-    khToken_delete(&token);
-    token = currentToken(cursor, false);
+    token = currentToken(parser, false);
 
     // Ensures a newline or a semicolon at the end
     if (token.type == khTokenType_NEWLINE || token.type == khTokenType_EOF ||
         (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else if (token.type == khTokenType_DELIMITER &&
              token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
@@ -1369,24 +1968,23 @@ static khAstDoWhileLoop sparseDoWhileLoop(char32_t** cursor) {
     }
     else {
         raiseError(token.begin, U"expecting a newline or a semicolon");
+        synchronize(parser);
     }
 
-    khToken_delete(&token);
     return do_while_loop;
 }
 
-static khAstForLoop sparseForLoop(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
+static khAstForLoop sparseForLoop(khParser* parser) {
+    khToken token = currentToken(parser, true);
     khAstForLoop for_loop = {
-        .iterators = kharray_new(khstring, khstring_delete),
-        .iteratee = (khAstExpression){.begin = NULL, .end = NULL, .type = khAstExpressionType_INVALID},
+        .iterators = newArray(parser, khstring, khstring_delete),
+        .iteratee = invalidExpression(),
         .block = NULL};
 
     // Ensures `for` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_FOR) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting a `for` keyword");
@@ -1395,15 +1993,13 @@ static khAstForLoop sparseForLoop(char32_t** cursor) {
     // Iterator variables
     goto in;
     while (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COMMA) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        skipToken(parser);
+        token = currentToken(parser, true);
     in:
         if (token.type == khTokenType_IDENTIFIER) {
-            kharray_append(&for_loop.iterators, khstring_copy(&token.identifier));
-            skipToken(cursor);
-            khToken_delete(&token);
-            token = currentToken(cursor, false);
+            kharray_append(&for_loop.iterators, takeIdentifier(parser));
+            skipToken(parser);
+            token = currentToken(parser, false);
         }
         else {
             raiseError(token.begin, U"expecting an iterator variable name");
@@ -1412,28 +2008,26 @@ static khAstForLoop sparseForLoop(char32_t** cursor) {
 
     // Ensures `in` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_IN) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else {
         raiseError(token.begin, U"expecting an `in` keyword");
     }
 
     // Iteratee expression and block block
-    for_loop.iteratee = kh_parseExpression(cursor, false, false);
-    for_loop.block = sparseBlock(cursor);
+    for_loop.iteratee = parseExpression(parser, false, false);
+    for_loop.block = sparseBlock(parser);
 
-    khToken_delete(&token);
     return for_loop;
 }
 
-static void sparseBreak(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
+static void sparseBreak(khParser* parser) {
+    khToken token = currentToken(parser, true);
 
     // Ensures `break` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_BREAK) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting a `break` keyword");
@@ -1442,7 +2036,7 @@ static void sparseBreak(char32_t** cursor) {
     // Ensure it ends with a newline or a semicolon
     if (token.type == khTokenType_NEWLINE || token.type == khTokenType_EOF ||
         (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else if (token.type == khTokenType_DELIMITER &&
              token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
@@ -1450,19 +2044,17 @@ static void sparseBreak(char32_t** cursor) {
     }
     else {
         raiseError(token.begin, U"expecting a newline or a semicolon");
+        synchronize(parser);
     }
-
-    khToken_delete(&token);
 }
 
-static void sparseContinue(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
+static void sparseContinue(khParser* parser) {
+    khToken token = currentToken(parser, true);
 
     // Ensures `continue` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_CONTINUE) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting a `continue` keyword");
@@ -1471,7 +2063,7 @@ static void sparseContinue(char32_t** cursor) {
     // Ensure it ends with a newline or a semicolon
     if (token.type == khTokenType_NEWLINE || token.type == khTokenType_EOF ||
         (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else if (token.type == khTokenType_DELIMITER &&
              token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
@@ -1479,19 +2071,17 @@ static void sparseContinue(char32_t** cursor) {
     }
     else {
         raiseError(token.begin, U"expecting a newline or a semicolon");
+        synchronize(parser);
     }
-
-    khToken_delete(&token);
 }
 
-static khAstReturn sparseReturn(char32_t** cursor) {
-    khToken token = currentToken(cursor, true);
+static khAstReturn sparseReturn(khParser* parser) {
+    khToken token = currentToken(parser, true);
 
     // Ensures `return` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_RETURN) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, false);
+        skipToken(parser);
+        token = currentToken(parser, false);
     }
     else {
         raiseError(token.begin, U"expecting a `return` keyword");
@@ -1500,28 +2090,26 @@ static khAstReturn sparseReturn(char32_t** cursor) {
     // Instant return in a non-returning function
     if (token.type == khTokenType_NEWLINE || token.type == khTokenType_EOF ||
         (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
-        skipToken(cursor);
+        skipToken(parser);
 
-        khToken_delete(&token);
-        return (khAstReturn){.values = kharray_new(khAstExpression, khAstExpression_delete)};
+        return (khAstReturn){.values = newArray(parser, khAstExpression, khAstExpression_delete)};
     }
 
-    kharray(khAstExpression) values = kharray_new(khAstExpression, khAstExpression_delete);
+    kharray(khAstExpression) values = newArray(parser, khAstExpression, khAstExpression_delete);
 
     // Its return values
     goto skip;
     while (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COMMA) {
-        skipToken(cursor);
+        skipToken(parser);
     skip:
-        khToken_delete(&token);
-        kharray_append(&values, kh_parseExpression(cursor, false, false));
-        token = currentToken(cursor, false);
+        kharray_append(&values, parseExpression(parser, false, false));
+        token = currentToken(parser, false);
     };
 
     // Ensure it ends with a newline or a semicolon
     if (token.type == khTokenType_NEWLINE || token.type == khTokenType_EOF ||
         (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_SEMICOLON)) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else if (token.type == khTokenType_DELIMITER &&
              token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
@@ -1529,594 +2117,510 @@ static khAstReturn sparseReturn(char32_t** cursor) {
     }
     else {
         raiseError(token.begin, U"expecting a newline or a semicolon");
+        synchronize(parser);
     }
 
-    khToken_delete(&token);
     return (khAstReturn){.values = values};
 }
 
 
-// Macro to do recursive descent for a single binary operator as the whole function block
-#define RCD_BINARY(LOWER, TOKEN_OPERATOR, OPERATOR)                                                 \
-    khToken token = currentToken(cursor, ignore_newline);                                           \
-    char32_t* origin = token.begin;                                                                 \
-    khToken_delete(&token);                                                                         \
-                                                                                                    \
-    khAstExpression expression = LOWER(cursor, ignore_newline, filter_type);                        \
-                                                                                                    \
-    if (filter_type) {                                                                              \
-        return expression;                                                                          \
-    }                                                                                               \
-                                                                                                    \
-    token = currentToken(cursor, ignore_newline);                                                   \
-                                                                                                    \
-    while (token.type == khTokenType_OPERATOR && token.operator_v == TOKEN_OPERATOR) {              \
-        skipToken(cursor);                                                                          \
-                                                                                                    \
-        khAstExpression* left = malloc(sizeof(khAstExpression));                                    \
-        *left = expression;                                                                         \
-                                                                                                    \
-        khAstExpression* right = malloc(sizeof(khAstExpression));                                   \
-        *right = LOWER(cursor, ignore_newline, filter_type);                                        \
-                                                                                                    \
-        expression = (khAstExpression){.begin = origin,                                             \
-                                       .end = *cursor,                                              \
-                                       .type = khAstExpressionType_BINARY,                          \
-                                       .binary = {.type = OPERATOR, .left = left, .right = right}}; \
-                                                                                                    \
-        khToken_delete(&token);                                                                     \
-        token = currentToken(cursor, ignore_newline);                                               \
-    }                                                                                               \
-                                                                                                    \
-    khToken_delete(&token);                                                                         \
-    return expression;
-
-
-// Macro to do recursive descent for binary operators in a switch statement
-#define RCD_BINARY_CASE(LOWER, OPERATOR)                                                            \
-    {                                                                                               \
-        skipToken(cursor);                                                                          \
-                                                                                                    \
-        khAstExpression* left = malloc(sizeof(khAstExpression));                                    \
-        *left = expression;                                                                         \
-                                                                                                    \
-        khAstExpression* right = malloc(sizeof(khAstExpression));                                   \
-        *right = LOWER(cursor, ignore_newline, filter_type);                                        \
-                                                                                                    \
-        expression = (khAstExpression){.begin = origin,                                             \
-                                       .end = *cursor,                                              \
-                                       .type = khAstExpressionType_BINARY,                          \
-                                       .binary = {.type = OPERATOR, .left = left, .right = right}}; \
-                                                                                                    \
-        khToken_delete(&token);                                                                     \
-        token = currentToken(cursor, ignore_newline);                                               \
-    }                                                                                               \
-    break;
-
+// Every nested expression goes through here, so this is where the nesting is limited
+static khAstExpression parseExpression(khParser* parser, EXPARSE_ARGS) {
+    khAstExpression expression;
 
-khAstExpression kh_parseExpression(char32_t** cursor, EXPARSE_ARGS) {
-    return exparseIpAssignmentOperators(cursor, ignore_newline, filter_type);
-}
-
-static khAstExpression exparseIpAssignmentOperators(char32_t** cursor, EXPARSE_ARGS) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-    khToken_delete(&token);
+    if (parser->depth >= kh_PARSE_MAX_DEPTH) {
+        khToken token = currentToken(parser, ignore_newline);
+        raiseError(token.begin, U"expression is nested too deeply");
+        skipNested(parser, ignore_newline);
 
-    khAstExpression expression = exparseTernary(cursor, ignore_newline, filter_type);
-
-    if (filter_type) {
-        return expression;
-    }
-
-    token = currentToken(cursor, ignore_newline);
-
-    // All inplace operators
-    while (token.type == khTokenType_OPERATOR) {
-        switch (token.operator_v) {
-            // These LOWER macro arguments are set to this very function itself,
-            // in order to parse inplace/assignment operators from right to left.
-            case khOperatorToken_ASSIGN:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_ASSIGN);
-
-            case khOperatorToken_IP_ADD:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_ADD);
-            case khOperatorToken_IP_SUB:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_SUB);
-            case khOperatorToken_IP_MUL:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_MUL);
-            case khOperatorToken_IP_DIV:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_DIV);
-            case khOperatorToken_IP_MOD:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_MOD);
-            case khOperatorToken_IP_POW:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_POW);
-            case khOperatorToken_IP_DOT:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_DOT);
-
-            case khOperatorToken_IP_BIT_AND:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_BIT_AND);
-            case khOperatorToken_IP_BIT_OR:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_BIT_OR);
-            case khOperatorToken_IP_BIT_XOR:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_BIT_XOR);
-            case khOperatorToken_IP_BIT_LSHIFT:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_BIT_LSHIFT);
-            case khOperatorToken_IP_BIT_RSHIFT:
-                RCD_BINARY_CASE(exparseIpAssignmentOperators, khAstBinaryExpressionType_IP_BIT_RSHIFT);
-
-            default:
-                goto out;
-        }
+        return (khAstExpression){.begin = token.begin,
+                                 .end = parser->cursor,
+                                 .file = parser->file,
+                                 .type = khAstExpressionType_INVALID};
     }
-out:
-
-    khToken_delete(&token);
-    return expression;
-}
-
-static khAstExpression exparseTernary(char32_t** cursor, EXPARSE_ARGS) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-    khToken_delete(&token);
 
-    khAstExpression expression = exparseLogicalOr(cursor, ignore_newline, filter_type);
+    parser->depth++;
 
+    // Types don't have any operators in them, other than the reverse unary ones
     if (filter_type) {
-        return expression;
+        expression = exparseReverseUnary(parser, ignore_newline, filter_type);
     }
-
-    token = currentToken(cursor, ignore_newline);
-
-    // Hints that it's a ternary operation once `if` keyword is found after an expression
-    while (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_IF) {
-        skipToken(cursor);
-
-        // Its condition
-        khAstExpression* condition = malloc(sizeof(khAstExpression));
-        *condition = exparseLogicalOr(cursor, ignore_newline, filter_type);
-
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
-
-        // Ensures the `else` keyword before the otherwise value
-        if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_ELSE) {
-            skipToken(cursor);
-        }
-        else {
-            raiseError(token.begin, U"expecting an `else` keyword after the condition");
-        }
-
-        // Its otherwise value
-        khAstExpression* otherwise = malloc(sizeof(khAstExpression));
-        *otherwise = exparseLogicalOr(cursor, ignore_newline, filter_type);
-
-        khAstExpression* value = malloc(sizeof(khAstExpression));
-        *value = expression;
-
-        expression = (khAstExpression){
-            .begin = origin,
-            .end = *cursor,
-            .type = khAstExpressionType_TERNARY,
-            .ternary = {.value = value, .condition = condition, .otherwise = otherwise}};
-
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
+    else {
+        expression = exparseOperators(parser, khPrecedence_ASSIGN, ignore_newline);
     }
 
-    khToken_delete(&token);
-    return expression;
-}
-
-static khAstExpression exparseLogicalOr(char32_t** cursor, EXPARSE_ARGS) {
-    RCD_BINARY(exparseLogicalXor, khOperatorToken_OR, khAstBinaryExpressionType_OR);
-}
+    parser->depth--;
 
-static khAstExpression exparseLogicalXor(char32_t** cursor, EXPARSE_ARGS) {
-    RCD_BINARY(exparseLogicalAnd, khOperatorToken_XOR, khAstBinaryExpressionType_XOR);
-}
-
-static khAstExpression exparseLogicalAnd(char32_t** cursor, EXPARSE_ARGS) {
-    RCD_BINARY(exparseLogicalNot, khOperatorToken_AND, khAstBinaryExpressionType_AND);
+    // Everything within got hashed as it was boxed or parsed, which leaves only the top few nodes
+    expression.file = parser->file;
+    khAstExpression_hash(&expression);
+    return expression;
 }
 
-static khAstExpression exparseLogicalNot(char32_t** cursor, EXPARSE_ARGS) {
-    if (filter_type) {
-        return exparseComparisonOperators(cursor, ignore_newline, filter_type);
+// Binding power of each binary operator, along with the AST node type it makes
+static const struct {
+    khPrecedence precedence; // khPrecedence_NONE for non-binary operators
+    khAstBinaryExpressionType binary_type;
+    khAstComparisonExpressionType comparison_type; // Only for khPrecedence_COMPARISON
+} operator_infos[] = {
+    [khOperatorToken_ASSIGN] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_ASSIGN},
+    [khOperatorToken_RANGE] = {khPrecedence_RANGE, khAstBinaryExpressionType_RANGE},
+
+    [khOperatorToken_ADD] = {khPrecedence_ADD_SUB, khAstBinaryExpressionType_ADD},
+    [khOperatorToken_SUB] = {khPrecedence_ADD_SUB, khAstBinaryExpressionType_SUB},
+    [khOperatorToken_MUL] = {khPrecedence_MUL_DIV_MOD_DOT, khAstBinaryExpressionType_MUL},
+    [khOperatorToken_DIV] = {khPrecedence_MUL_DIV_MOD_DOT, khAstBinaryExpressionType_DIV},
+    [khOperatorToken_MOD] = {khPrecedence_MUL_DIV_MOD_DOT, khAstBinaryExpressionType_MOD},
+    [khOperatorToken_DOT] = {khPrecedence_MUL_DIV_MOD_DOT, khAstBinaryExpressionType_DOT},
+    [khOperatorToken_POW] = {khPrecedence_POW, khAstBinaryExpressionType_POW},
+
+    [khOperatorToken_IP_ADD] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_ADD},
+    [khOperatorToken_IP_SUB] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_SUB},
+    [khOperatorToken_IP_MUL] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_MUL},
+    [khOperatorToken_IP_DIV] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_DIV},
+    [khOperatorToken_IP_MOD] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_MOD},
+    [khOperatorToken_IP_DOT] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_DOT},
+    [khOperatorToken_IP_POW] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_POW},
+
+    [khOperatorToken_EQUAL] = {khPrecedence_COMPARISON, 0, khAstComparisonExpressionType_EQUAL},
+    [khOperatorToken_UNEQUAL] = {khPrecedence_COMPARISON, 0, khAstComparisonExpressionType_UNEQUAL},
+    [khOperatorToken_LESS] = {khPrecedence_COMPARISON, 0, khAstComparisonExpressionType_LESS},
+    [khOperatorToken_GREATER] = {khPrecedence_COMPARISON, 0, khAstComparisonExpressionType_GREATER},
+    [khOperatorToken_LESS_EQUAL] = {khPrecedence_COMPARISON, 0,
+                                    khAstComparisonExpressionType_LESS_EQUAL},
+    [khOperatorToken_GREATER_EQUAL] = {khPrecedence_COMPARISON, 0,
+                                       khAstComparisonExpressionType_GREATER_EQUAL},
+
+    [khOperatorToken_NOT] = {khPrecedence_NONE},
+    [khOperatorToken_AND] = {khPrecedence_AND, khAstBinaryExpressionType_AND},
+    [khOperatorToken_OR] = {khPrecedence_OR, khAstBinaryExpressionType_OR},
+    [khOperatorToken_XOR] = {khPrecedence_XOR, khAstBinaryExpressionType_XOR},
+
+    // Also `khOperatorToken_BIT_NOT`, as a prefix operator
+    [khOperatorToken_BIT_XOR] = {khPrecedence_BIT_XOR, khAstBinaryExpressionType_BIT_XOR},
+    [khOperatorToken_BIT_AND] = {khPrecedence_BIT_AND, khAstBinaryExpressionType_BIT_AND},
+    [khOperatorToken_BIT_OR] = {khPrecedence_BIT_OR, khAstBinaryExpressionType_BIT_OR},
+    [khOperatorToken_BIT_LSHIFT] = {khPrecedence_BIT_SHIFTS, khAstBinaryExpressionType_BIT_LSHIFT},
+    [khOperatorToken_BIT_RSHIFT] = {khPrecedence_BIT_SHIFTS, khAstBinaryExpressionType_BIT_RSHIFT},
+
+    [khOperatorToken_IP_BIT_AND] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_BIT_AND},
+    [khOperatorToken_IP_BIT_OR] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_BIT_OR},
+    [khOperatorToken_IP_BIT_XOR] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_BIT_XOR},
+    [khOperatorToken_IP_BIT_LSHIFT] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_BIT_LSHIFT},
+    [khOperatorToken_IP_BIT_RSHIFT] = {khPrecedence_ASSIGN, khAstBinaryExpressionType_IP_BIT_RSHIFT}};
+
+// What an operator level is waiting for its operand to be parsed for
+typedef enum {
+    khOperatorLevelState_LEFT, // Not waiting, it has its left-hand side and takes in the next operator
+    khOperatorLevelState_UNARY,
+    khOperatorLevelState_BINARY,
+    khOperatorLevelState_CONDITION,
+    khOperatorLevelState_OTHERWISE,
+    khOperatorLevelState_COMPARISON
+} khOperatorLevelState;
+
+// A level of operators which bind at least as tight as its precedence. Nested levels, of the operands
+// on the right, are kept in a heap-allocated stack rather than on the call stack, so that long chains
+// of prefix and right-associative operators can't overflow it
+typedef struct {
+    khPrecedence precedence;
+    uint32_t origin;
+    khOperatorLevelState state;
+    khAstExpression expression; // Left-hand side, parsed so far
+    size_t chain;               // Operations which the left-hand side went through, each a node deeper
+
+    khAstUnaryExpressionType unary_type;
+    khAstBinaryExpressionType binary_type;
+    khAstExpression* condition;
+    kharray(khAstComparisonExpressionType) operations;
+    kharray(khAstExpression) operands;
+} khOperatorLevel;
+
+// Whether the token is a prefix operator at the given precedence, with its operand to be parsed at
+// `operand_precedence`
+static inline bool isPrefix(khToken* token, khPrecedence precedence, khAstUnaryExpressionType* type,
+                            khPrecedence* operand_precedence) {
+    if (token->type != khTokenType_OPERATOR) {
+        return false;
     }
 
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-
-    // Self-explanatory
-    if (token.type == khTokenType_OPERATOR && token.operator_v == khOperatorToken_NOT) {
-        skipToken(cursor);
-
-        khAstExpression* expression = malloc(sizeof(khAstExpression));
-        *expression = exparseLogicalNot(cursor, ignore_newline, filter_type);
-
-        khToken_delete(&token);
-        return (khAstExpression){
-            .begin = origin,
-            .end = *cursor,
-            .type = khAstExpressionType_UNARY,
-            .unary = {.type = khAstUnaryExpressionType_NOT, .operand = expression}};
+    // `not` at the logical level takes everything up to the comparisons as its operand, while it only
+    // takes up to the power operator like the other unary operators when it's within an arithmetic one
+    if (token->operator_v == khOperatorToken_NOT && precedence <= khPrecedence_NOT) {
+        *type = khAstUnaryExpressionType_NOT;
+        *operand_precedence = khPrecedence_NOT;
+        return true;
     }
-    else {
-        khToken_delete(&token);
-        return exparseComparisonOperators(cursor, ignore_newline, filter_type);
+    else if (precedence > khPrecedence_UNARY) {
+        return false;
     }
-}
-
-static khAstExpression exparseComparisonOperators(char32_t** cursor, EXPARSE_ARGS) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-    khToken_delete(&token);
-
-    khAstExpression expression = exparseRange(cursor, ignore_newline, filter_type);
-
-    if (filter_type) {
-        return expression;
-    }
-
-    token = currentToken(cursor, ignore_newline);
-
-    // If any comparison operators found, start this mess
-    if (token.type == khTokenType_OPERATOR &&
-        (token.operator_v == khOperatorToken_EQUAL || token.operator_v == khOperatorToken_UNEQUAL ||
-         token.operator_v == khOperatorToken_LESS || token.operator_v == khOperatorToken_GREATER ||
-         token.operator_v == khOperatorToken_LESS_EQUAL ||
-         token.operator_v == khOperatorToken_GREATER_EQUAL)) {
-        kharray(khAstComparisonExpressionType) operations =
-            kharray_new(khAstComparisonExpressionType, NULL);
-        kharray(khAstExpression) operands = kharray_new(khAstExpression, khAstExpression_delete);
-        kharray_append(&operands, expression);
-
-        // Maps the khOperatorToken of the comparison operator to khAstComparisonExpressionType
-        while (token.type == khTokenType_OPERATOR) {
-            switch (token.operator_v) {
-                case khOperatorToken_EQUAL:
-                    kharray_append(&operations, khAstComparisonExpressionType_EQUAL);
-                    break;
-                case khOperatorToken_UNEQUAL:
-                    kharray_append(&operations, khAstComparisonExpressionType_UNEQUAL);
-                    break;
-                case khOperatorToken_LESS:
-                    kharray_append(&operations, khAstComparisonExpressionType_LESS);
-                    break;
-                case khOperatorToken_GREATER:
-                    kharray_append(&operations, khAstComparisonExpressionType_GREATER);
-                    break;
-                case khOperatorToken_LESS_EQUAL:
-                    kharray_append(&operations, khAstComparisonExpressionType_LESS_EQUAL);
-                    break;
-                case khOperatorToken_GREATER_EQUAL:
-                    kharray_append(&operations, khAstComparisonExpressionType_GREATER_EQUAL);
-                    break;
-
-                default:
-                    goto out;
-            }
 
-            skipToken(cursor);
-            kharray_append(&operands, exparseRange(cursor, ignore_newline, filter_type));
+    // All same-precedence unary operators
+    switch (token->operator_v) {
+        case khOperatorToken_ADD:
+            *type = khAstUnaryExpressionType_POSITIVE;
+            break;
+        case khOperatorToken_SUB:
+            *type = khAstUnaryExpressionType_NEGATIVE;
+            break;
 
-            khToken_delete(&token);
-            token = currentToken(cursor, ignore_newline);
-        }
-    out:
+        case khOperatorToken_NOT:
+            *type = khAstUnaryExpressionType_NOT;
+            break;
+        case khOperatorToken_BIT_NOT:
+            *type = khAstUnaryExpressionType_BIT_NOT;
+            break;
 
-        expression = (khAstExpression){.begin = origin,
-                                       .end = *cursor,
-                                       .type = khAstExpressionType_COMPARISON,
-                                       .comparison = {.operations = operations, .operands = operands}};
+        default:
+            return false;
     }
 
-
-    khToken_delete(&token);
-    return expression;
+    *operand_precedence = khPrecedence_UNARY;
+    return true;
 }
 
-static khAstExpression exparseRange(char32_t** cursor, EXPARSE_ARGS) {
-    RCD_BINARY(exparseBitwiseOr, khOperatorToken_RANGE, khAstBinaryExpressionType_RANGE);
-}
+static khAstExpression exparseOperators(khParser* parser, khPrecedence precedence,
+                                        bool ignore_newline) {
+    kharray(khOperatorLevel) levels = kharray_new(khOperatorLevel, NULL);
+    size_t depth = parser->depth;
+    size_t chains = 0; // Of all the levels, as left-associative chains make the tree as deep as nesting
+
+    while (true) {
+        // Starts a new level for an operand, going through its prefix operators first. The levels on
+        // top of the first one count as nested, as they would've been with recursion, and so do the
+        // chains of operations below it
+        khToken token = currentToken(parser, ignore_newline);
+        khAstUnaryExpressionType unary_type;
+        khPrecedence operand_precedence;
+
+        while (depth + chains + kharray_size(&levels) <= kh_PARSE_MAX_DEPTH &&
+               isPrefix(&token, precedence, &unary_type, &operand_precedence)) {
+            kharray_append(&levels, ((khOperatorLevel){.precedence = precedence,
+                                                       .origin = token.begin,
+                                                       .state = khOperatorLevelState_UNARY,
+                                                       .unary_type = unary_type}));
+
+            skipToken(parser);
+            precedence = operand_precedence;
+            token = currentToken(parser, ignore_newline);
+        }
 
-static khAstExpression exparseBitwiseOr(char32_t** cursor, EXPARSE_ARGS) {
-    RCD_BINARY(exparseBitwiseXor, khOperatorToken_BIT_OR, khAstBinaryExpressionType_BIT_OR);
-}
+        khAstExpression expression;
+        if (depth + chains + kharray_size(&levels) > kh_PARSE_MAX_DEPTH) {
+            raiseError(token.begin, U"expression is nested too deeply");
+            skipNested(parser, ignore_newline);
 
-static khAstExpression exparseBitwiseXor(char32_t** cursor, EXPARSE_ARGS) {
-    RCD_BINARY(exparseBitwiseAnd, khOperatorToken_BIT_XOR, khAstBinaryExpressionType_BIT_XOR);
-}
+            expression = (khAstExpression){
+                .begin = token.begin, .end = parser->cursor, .type = khAstExpressionType_INVALID};
+        }
+        else {
+            parser->depth = depth + chains + kharray_size(&levels);
+            expression = exparseReverseUnary(parser, ignore_newline, false);
+        }
 
-static khAstExpression exparseBitwiseAnd(char32_t** cursor, EXPARSE_ARGS) {
-    RCD_BINARY(exparseBitwiseShifts, khOperatorToken_BIT_AND, khAstBinaryExpressionType_BIT_AND);
-}
+        kharray_append(&levels, ((khOperatorLevel){.precedence = precedence,
+                                                   .origin = token.begin,
+                                                   .state = khOperatorLevelState_LEFT,
+                                                   .expression = expression}));
 
-static khAstExpression exparseBitwiseShifts(char32_t** cursor, EXPARSE_ARGS) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-    khToken_delete(&token);
+        // Takes in operators as long as they bind at least as tight as the level's precedence. The
+        // operands on the right only take in tighter binding operators, which makes same-precedence
+        // operators go from left to right, except the right-associative ones
+        while (true) {
+            khOperatorLevel* level = &levels[kharray_size(&levels) - 1];
+            token = currentToken(parser, ignore_newline);
 
-    khAstExpression expression = exparseAddSub(cursor, ignore_newline, filter_type);
+            // Hints that it's a ternary operation once `if` keyword is found after an expression
+            if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_IF &&
+                level->precedence <= khPrecedence_TERNARY) {
+                skipToken(parser);
 
-    if (filter_type) {
-        return expression;
-    }
+                // Its condition
+                level->state = khOperatorLevelState_CONDITION;
+                precedence = khPrecedence_OR;
+                break;
+            }
 
-    token = currentToken(cursor, ignore_newline);
+            if (token.type == khTokenType_OPERATOR &&
+                operator_infos[token.operator_v].precedence != khPrecedence_NONE &&
+                operator_infos[token.operator_v].precedence >= level->precedence) {
+                khPrecedence operator_precedence = operator_infos[token.operator_v].precedence;
+
+                // If any comparison operators found, start this mess
+                if (operator_precedence == khPrecedence_COMPARISON) {
+                    level->state = khOperatorLevelState_COMPARISON;
+                    level->operations = newArray(parser, khAstComparisonExpressionType, NULL);
+                    level->operands = newArray(parser, khAstExpression, khAstExpression_delete);
+                    level->expression.file = parser->file;
+                    kharray_append(&level->operands, level->expression);
+                    kharray_append(&level->operations,
+                                   operator_infos[token.operator_v].comparison_type);
+
+                    skipToken(parser);
+                    precedence = khPrecedence_RANGE;
+                    break;
+                }
 
-    // Self-explanatory
-    while (token.type == khTokenType_OPERATOR) {
-        switch (token.operator_v) {
-            case khOperatorToken_BIT_LSHIFT:
-                RCD_BINARY_CASE(exparseAddSub, khAstBinaryExpressionType_BIT_LSHIFT);
-            case khOperatorToken_BIT_RSHIFT:
-                RCD_BINARY_CASE(exparseAddSub, khAstBinaryExpressionType_BIT_RSHIFT);
+                level->state = khOperatorLevelState_BINARY;
+                level->binary_type = operator_infos[token.operator_v].binary_type;
+                skipToken(parser);
 
-            default:
-                goto out;
-        }
-    }
-out:
+                // Assignments and powers are parsed from right to left, by letting the right operand
+                // take in the same operator
+                precedence = operator_precedence == khPrecedence_ASSIGN ||
+                                     operator_precedence == khPrecedence_POW
+                                 ? operator_precedence
+                                 : operator_precedence + 1;
+                break;
+            }
 
-    khToken_delete(&token);
-    return expression;
-}
+            // Done with this level, which is then the operand of the one below it. Comparisons keep
+            // theirs in a list rather than boxed, so operands get their file here
+            khAstExpression operand = level->expression;
+            operand.file = parser->file;
+            chains -= level->chain;
+            kharray_pop(&levels, 1);
+
+            if (kharray_size(&levels) == 0) {
+                kharray_delete(&levels);
+                parser->depth = depth;
+                return operand;
+            }
 
-static khAstExpression exparseAddSub(char32_t** cursor, EXPARSE_ARGS) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-    khToken_delete(&token);
+            level = &levels[kharray_size(&levels) - 1];
+            switch (level->state) {
+                case khOperatorLevelState_UNARY: {
+                    khAstExpression* unary_operand = box(parser, operand);
 
-    khAstExpression expression = exparseMulDivModDot(cursor, ignore_newline, filter_type);
+                    level->expression = (khAstExpression){
+                        .begin = level->origin,
+                        .end = parser->cursor,
+                        .type = khAstExpressionType_UNARY,
+                        .unary = {.type = level->unary_type, .operand = unary_operand}};
+                } break;
 
-    if (filter_type) {
-        return expression;
-    }
+                case khOperatorLevelState_BINARY: {
+                    khAstExpression* left = box(parser, level->expression);
+                    khAstExpression* right = box(parser, operand);
 
-    token = currentToken(cursor, ignore_newline);
+                    level->expression = (khAstExpression){
+                        .begin = level->origin,
+                        .end = parser->cursor,
+                        .type = khAstExpressionType_BINARY,
+                        .binary = {.type = level->binary_type, .left = left, .right = right}};
+                } break;
 
-    // Self-explanatory
-    while (token.type == khTokenType_OPERATOR) {
-        switch (token.operator_v) {
-            case khOperatorToken_ADD:
-                RCD_BINARY_CASE(exparseMulDivModDot, khAstBinaryExpressionType_ADD);
-            case khOperatorToken_SUB:
-                RCD_BINARY_CASE(exparseMulDivModDot, khAstBinaryExpressionType_SUB);
+                case khOperatorLevelState_CONDITION:
+                    level->condition = box(parser, operand);
+                    token = currentToken(parser, ignore_newline);
 
-            default:
-                goto out;
-        }
-    }
-out:
+                    // Ensures the `else` keyword before the otherwise value
+                    if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_ELSE) {
+                        skipToken(parser);
+                    }
+                    else {
+                        raiseError(token.begin, U"expecting an `else` keyword after the condition");
+                    }
 
-    khToken_delete(&token);
-    return expression;
-}
+                    // Its otherwise value
+                    level->state = khOperatorLevelState_OTHERWISE;
+                    precedence = khPrecedence_OR;
+                    goto next;
+
+                case khOperatorLevelState_OTHERWISE: {
+                    khAstExpression* value = box(parser, level->expression);
+                    khAstExpression* otherwise = box(parser, operand);
+
+                    level->expression = (khAstExpression){.begin = level->origin,
+                                                          .end = parser->cursor,
+                                                          .type = khAstExpressionType_TERNARY,
+                                                          .ternary = {.value = value,
+                                                                      .condition = level->condition,
+                                                                      .otherwise = otherwise}};
+                } break;
 
-static khAstExpression exparseMulDivModDot(char32_t** cursor, EXPARSE_ARGS) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-    khToken_delete(&token);
+                // Chains up all the comparisons, like `a < b < c`
+                case khOperatorLevelState_COMPARISON:
+                    kharray_append(&level->operands, operand);
+                    token = currentToken(parser, ignore_newline);
 
-    khAstExpression expression = exparseUnary(cursor, ignore_newline, filter_type);
+                    if (token.type == khTokenType_OPERATOR &&
+                        operator_infos[token.operator_v].precedence == khPrecedence_COMPARISON) {
+                        kharray_append(&level->operations,
+                                       operator_infos[token.operator_v].comparison_type);
 
-    if (filter_type) {
-        return expression;
-    }
+                        skipToken(parser);
+                        precedence = khPrecedence_RANGE;
+                        goto next;
+                    }
 
-    token = currentToken(cursor, ignore_newline);
+                    level->expression = (khAstExpression){
+                        .begin = level->origin,
+                        .end = parser->cursor,
+                        .type = khAstExpressionType_COMPARISON,
+                        .comparison = {.operations = level->operations, .operands = level->operands}};
+                    break;
 
-    // Self-explanatory
-    while (token.type == khTokenType_OPERATOR) {
-        switch (token.operator_v) {
-            case khOperatorToken_MUL:
-                RCD_BINARY_CASE(exparseUnary, khAstBinaryExpressionType_MUL);
-            case khOperatorToken_DIV:
-                RCD_BINARY_CASE(exparseUnary, khAstBinaryExpressionType_DIV);
-            case khOperatorToken_MOD:
-                RCD_BINARY_CASE(exparseUnary, khAstBinaryExpressionType_MOD);
-            case khOperatorToken_DOT:
-                RCD_BINARY_CASE(exparseUnary, khAstBinaryExpressionType_DOT);
+                default:
+                    break;
+            }
 
-            default:
-                goto out;
+            level->state = khOperatorLevelState_LEFT;
+            level->chain++;
+            chains++;
         }
+    next:;
     }
-out:
-
-    khToken_delete(&token);
-    return expression;
 }
 
-
-// Like RCD_BINARY_CASE, but for unary operators
-#define RCD_UNARY_CASE(FUNCTION, OPERATOR)                                            \
-    {                                                                                 \
-        skipToken(cursor);                                                            \
-                                                                                      \
-        khAstExpression* expression = malloc(sizeof(khAstExpression));                \
-        *expression = exparseUnary(cursor, ignore_newline, filter_type);              \
-                                                                                      \
-        khToken_delete(&token);                                                       \
-        return (khAstExpression){.begin = origin,                                     \
-                                 .end = *cursor,                                      \
-                                 .type = khAstExpressionType_UNARY,                   \
-                                 .unary = {.type = OPERATOR, .operand = expression}}; \
-    }
-
-
-static khAstExpression exparseUnary(char32_t** cursor, EXPARSE_ARGS) {
-    if (filter_type) {
-        return exparsePow(cursor, ignore_newline, filter_type);
-    }
-
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-
-    // All same-precedence unary operators
-    if (token.type == khTokenType_OPERATOR) {
-        switch (token.operator_v) {
-            case khOperatorToken_ADD:
-                RCD_UNARY_CASE(exparsePow, khAstUnaryExpressionType_POSITIVE);
-            case khOperatorToken_SUB:
-                RCD_UNARY_CASE(exparsePow, khAstUnaryExpressionType_NEGATIVE);
-
-            case khOperatorToken_NOT:
-                RCD_UNARY_CASE(exparsePow, khAstUnaryExpressionType_NOT);
-            case khOperatorToken_BIT_NOT:
-                RCD_UNARY_CASE(exparsePow, khAstUnaryExpressionType_BIT_NOT);
-
-            default:
-                khToken_delete(&token);
-                return exparsePow(cursor, ignore_newline, filter_type);
-        }
-    }
-    else {
-        khToken_delete(&token);
-        return exparsePow(cursor, ignore_newline, filter_type);
+// Each link of a chain of calls, indexes, scopes and templatizations is a node deeper, the same as it
+// would've been with nesting. Past the limit, the rest of the chain is skipped with an error
+static bool skipDeepChain(khParser* parser, khToken* token, bool ignore_newline) {
+    if (parser->depth < kh_PARSE_MAX_DEPTH) {
+        return false;
     }
-}
 
-static khAstExpression exparsePow(char32_t** cursor, EXPARSE_ARGS) {
-    RCD_BINARY(exparseReverseUnary, khOperatorToken_POW, khAstBinaryExpressionType_POW);
+    raiseError(token->begin, U"expression is nested too deeply");
+    skipNested(parser, ignore_newline);
+    return true;
 }
 
-static khAstExpression exparseReverseUnary(char32_t** cursor, EXPARSE_ARGS) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-    khToken_delete(&token);
+static khAstExpression exparseReverseUnary(khParser* parser, EXPARSE_ARGS) {
+    khToken token = currentToken(parser, ignore_newline);
+    uint32_t origin = token.begin;
+    size_t depth = parser->depth;
 
-    khAstExpression expression = exparseOther(cursor, ignore_newline, filter_type);
-    token = currentToken(cursor, ignore_newline);
+    khAstExpression expression = exparseOther(parser, ignore_newline, filter_type);
+    token = currentToken(parser, ignore_newline);
 
     while (token.type == khTokenType_DELIMITER || token.type == khTokenType_OPERATOR) {
         switch (token.type) {
             case khTokenType_DELIMITER:
                 switch (token.delimiter) {
                     case khDelimiterToken_PARENTHESIS_OPEN: {
-                        if (filter_type) {
+                        if (filter_type || skipDeepChain(parser, &token, ignore_newline)) {
                             goto out;
                         }
 
                         kharray(khAstExpression) arguments = exparseList(
-                            cursor, khDelimiterToken_PARENTHESIS_OPEN,
+                            parser, khDelimiterToken_PARENTHESIS_OPEN,
                             khDelimiterToken_PARENTHESIS_CLOSE, ignore_newline, filter_type);
 
-                        khAstExpression* callee = malloc(sizeof(khAstExpression));
-                        *callee = expression;
+                        khAstExpression* callee = box(parser, expression);
 
                         expression =
                             (khAstExpression){.begin = origin,
-                                              .end = *cursor,
+                                              .end = parser->cursor,
                                               .type = khAstExpressionType_CALL,
                                               .call = {.callee = callee, .arguments = arguments}};
 
-                        khToken_delete(&token);
-                        token = currentToken(cursor, ignore_newline);
+                        token = currentToken(parser, ignore_newline);
                     } break;
 
                     case khDelimiterToken_SQUARE_BRACKET_OPEN: {
+                        if (skipDeepChain(parser, &token, ignore_newline)) {
+                            goto out;
+                        }
+
                         kharray(khAstExpression) arguments = exparseList(
-                            cursor, khDelimiterToken_SQUARE_BRACKET_OPEN,
+                            parser, khDelimiterToken_SQUARE_BRACKET_OPEN,
                             khDelimiterToken_SQUARE_BRACKET_CLOSE, ignore_newline, filter_type);
 
-                        khAstExpression* indexee = malloc(sizeof(khAstExpression));
-                        *indexee = expression;
+                        khAstExpression* indexee = box(parser, expression);
 
                         expression =
                             (khAstExpression){.begin = origin,
-                                              .end = *cursor,
+                                              .end = parser->cursor,
                                               .type = khAstExpressionType_INDEX,
                                               .index = {.indexee = indexee, .arguments = arguments}};
 
-                        khToken_delete(&token);
-                        token = currentToken(cursor, ignore_newline);
+                        token = currentToken(parser, ignore_newline);
                     } break;
 
                     case khDelimiterToken_DOT: {
-                        kharray(khstring) scope_names = kharray_new(khstring, khstring_delete);
+                        if (skipDeepChain(parser, &token, ignore_newline)) {
+                            goto out;
+                        }
+
+                        kharray(khstring) scope_names = newArray(parser, khstring, khstring_delete);
 
                         // `(expression).parses.these.scope.things`
                         while (token.type == khTokenType_DELIMITER &&
                                token.delimiter == khDelimiterToken_DOT) {
-                            skipToken(cursor);
-                            khToken_delete(&token);
-                            token = currentToken(cursor, ignore_newline);
+                            skipToken(parser);
+                            token = currentToken(parser, ignore_newline);
 
                             if (token.type == khTokenType_IDENTIFIER) {
-                                kharray_append(&scope_names, khstring_copy(&token.identifier));
+                                kharray_append(&scope_names, takeIdentifier(parser));
 
-                                skipToken(cursor);
-                                khToken_delete(&token);
-                                token = currentToken(cursor, ignore_newline);
+                                skipToken(parser);
+                                token = currentToken(parser, ignore_newline);
                             }
                             else {
                                 raiseError(token.begin, U"expecting an identifier to scope into");
                             }
                         }
 
-                        khAstExpression* value = malloc(sizeof(khAstExpression));
-                        *value = expression;
+                        khAstExpression* value = box(parser, expression);
 
                         expression =
                             (khAstExpression){.begin = origin,
-                                              .end = *cursor,
+                                              .end = parser->cursor,
                                               .type = khAstExpressionType_SCOPE,
                                               .scope = {.value = value, .scope_names = scope_names}};
                     } break;
 
                     case khDelimiterToken_EXCLAMATION: {
-                        skipToken(cursor);
-                        khToken_delete(&token);
-                        token = currentToken(cursor, ignore_newline);
+                        if (skipDeepChain(parser, &token, ignore_newline)) {
+                            goto out;
+                        }
+
+                        skipToken(parser);
+                        token = currentToken(parser, ignore_newline);
 
-                        khAstExpression* value = malloc(sizeof(khAstExpression));
-                        *value = expression;
+                        khAstExpression* value = box(parser, expression);
 
                         // Single identifier template argument: `Type!int`
                         if (token.type == khTokenType_IDENTIFIER) {
                             kharray(khAstExpression) template_arguments =
-                                kharray_new(khAstExpression, khAstExpression_delete);
+                                newArray(parser, khAstExpression, khAstExpression_delete);
 
-                            kharray_append(
-                                &template_arguments,
-                                ((khAstExpression){.begin = token.begin,
-                                                   .end = token.end,
-                                                   .type = khAstExpressionType_IDENTIFIER,
-                                                   .identifier = khstring_copy(&token.identifier)}));
+                            kharray_append(&template_arguments,
+                                           ((khAstExpression){
+                                               .begin = token.begin,
+                                               .end = token.end,
+                                               .file = parser->file,
+                                               .type = khAstExpressionType_IDENTIFIER,
+                                               .identifier = takeIdentifier(parser)}));
 
                             expression = (khAstExpression){
                                 .begin = origin,
-                                .end = *cursor,
+                                .end = parser->cursor,
                                 .type = khAstExpressionType_TEMPLATIZE,
                                 .templatize = {.value = value,
                                                .template_arguments = template_arguments}};
 
-                            skipToken(cursor);
-                            khToken_delete(&token);
-                            token = currentToken(cursor, ignore_newline);
+                            skipToken(parser);
+                            token = currentToken(parser, ignore_newline);
                         }
                         // Multiple template arguments: `Type!(int, float)`
                         else if (token.type == khTokenType_DELIMITER &&
                                  token.delimiter == khDelimiterToken_PARENTHESIS_OPEN) {
                             kharray(khAstExpression) template_arguments =
-                                exparseList(cursor, khDelimiterToken_PARENTHESIS_OPEN,
+                                exparseList(parser, khDelimiterToken_PARENTHESIS_OPEN,
                                             khDelimiterToken_PARENTHESIS_CLOSE, ignore_newline, true);
 
                             expression = (khAstExpression){
                                 .begin = origin,
-                                .end = *cursor,
+                                .end = parser->cursor,
                                 .type = khAstExpressionType_TEMPLATIZE,
                                 .templatize = {.value = value,
                                                .template_arguments = template_arguments}};
 
-                            khToken_delete(&token);
-                            token = currentToken(cursor, ignore_newline);
+                            token = currentToken(parser, ignore_newline);
                         }
                         else {
-                            free(value);
+                            khAstExpression_unbox(value);
                             raiseError(token.begin, U"expecting a type argument for templatizing");
                         }
                     } break;
@@ -2124,6 +2628,8 @@ static khAstExpression exparseReverseUnary(char32_t** cursor, EXPARSE_ARGS) {
                     default:
                         goto out;
                 }
+
+                parser->depth++;
                 break;
 
             default:
@@ -2132,37 +2638,39 @@ static khAstExpression exparseReverseUnary(char32_t** cursor, EXPARSE_ARGS) {
     }
 out:
 
-    khToken_delete(&token);
+    parser->depth = depth;
     return expression;
 }
 
-static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = token.begin;
-    khAstExpression expression =
-        (khAstExpression){.begin = NULL, .end = NULL, .type = khAstExpressionType_INVALID};
+static khAstExpression exparseOther(khParser* parser, EXPARSE_ARGS) {
+    khToken token = currentToken(parser, ignore_newline);
+    uint32_t origin = token.begin;
+    khAstExpression expression = invalidExpression();
 
     switch (token.type) {
         case khTokenType_IDENTIFIER: {
             expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
+                                           .end = parser->cursor,
                                            .type = khAstExpressionType_IDENTIFIER,
-                                           .identifier = khstring_copy(&token.identifier)};
+                                           .identifier = takeIdentifier(parser)};
 
-            skipToken(cursor);
+            skipToken(parser);
         } break;
 
         case khTokenType_KEYWORD: {
             // 2 cases
             if (token.keyword == khKeywordToken_DEF) {
-                char32_t* initial = *cursor;
-                skipToken(&initial);
-                khToken next_token = currentToken(&initial, ignore_newline);
+                uint32_t initial = parser->cursor;
+                size_t initial_index = parser->index;
+                skipToken(parser);
+                khToken next_token = currentToken(parser, ignore_newline);
+                parser->cursor = initial;
+                parser->index = initial_index;
 
                 // A function signature
                 if (next_token.type == khTokenType_DELIMITER &&
                     next_token.delimiter == khDelimiterToken_EXCLAMATION) {
-                    expression = exparseSignature(cursor, ignore_newline);
+                    expression = exparseSignature(parser, ignore_newline);
                 }
                 // A lambda
                 else {
@@ -2170,14 +2678,12 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
                         raiseError(token.begin, U"expecting a type, not a lambda");
                     }
 
-                    expression = exparseLambda(cursor, ignore_newline);
+                    expression = exparseLambda(parser, ignore_newline);
                 }
-
-                khToken_delete(&next_token);
             }
             else {
                 raiseError(token.begin, U"unexpected keyword in an expression");
-                skipToken(cursor);
+                skipToken(parser);
             }
         } break;
 
@@ -2185,36 +2691,39 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
             switch (token.keyword) {
                 // Parentheses enclosed expressions or tuples
                 case khDelimiterToken_PARENTHESIS_OPEN: {
-                    kharray(khAstExpression) values =
-                        exparseList(cursor, khDelimiterToken_PARENTHESIS_OPEN,
-                                    khDelimiterToken_PARENTHESIS_CLOSE, ignore_newline, filter_type);
+                    khAstPackedValues packed;
+                    kharray(khAstExpression) values = exparsePackableList(
+                        parser, &packed, khDelimiterToken_PARENTHESIS_OPEN,
+                        khDelimiterToken_PARENTHESIS_CLOSE, ignore_newline, filter_type);
 
                     if (kharray_size(&values) == 1) {
-                        expression = khAstExpression_copy(&values[0]);
+                        expression = khAstExpression_move(&values[0]);
                         kharray_delete(&values);
                     }
                     else {
                         expression = (khAstExpression){.begin = origin,
-                                                       .end = *cursor,
+                                                       .end = parser->cursor,
                                                        .type = khAstExpressionType_TUPLE,
-                                                       .tuple = {.values = values}};
+                                                       .tuple = {.values = values, .packed = packed}};
                     }
                 } break;
 
                 // Arrays
-                case khDelimiterToken_SQUARE_BRACKET_OPEN:
+                case khDelimiterToken_SQUARE_BRACKET_OPEN: {
                     if (filter_type) {
                         raiseError(token.begin, U"expecting a type, not an array");
                     }
 
-                    expression = (khAstExpression){
-                        .begin = origin,
-                        .end = *cursor,
-                        .type = khAstExpressionType_ARRAY,
-                        .array = {.values = exparseList(cursor, khDelimiterToken_SQUARE_BRACKET_OPEN,
-                                                        khDelimiterToken_SQUARE_BRACKET_CLOSE,
-                                                        ignore_newline, filter_type)}};
-                    break;
+                    khAstPackedValues packed;
+                    kharray(khAstExpression) values = exparsePackableList(
+                        parser, &packed, khDelimiterToken_SQUARE_BRACKET_OPEN,
+                        khDelimiterToken_SQUARE_BRACKET_CLOSE, ignore_newline, filter_type);
+
+                    expression = (khAstExpression){.begin = origin,
+                                                   .end = parser->cursor,
+                                                   .type = khAstExpressionType_ARRAY,
+                                                   .array = {.values = values, .packed = packed}};
+                } break;
 
                 // Dicts
                 case khDelimiterToken_CURLY_BRACKET_OPEN:
@@ -2222,21 +2731,21 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
                         raiseError(token.begin, U"expecting a type, not a dict");
                     }
 
-                    expression = exparseDict(cursor, ignore_newline);
+                    expression = exparseDict(parser, ignore_newline);
                     break;
 
                 // Ellipses
                 case khDelimiterToken_ELLIPSIS:
                     // No type-filtering here as it is used for making the slice compound-type
                     // slice: int[...] = expression
-                    skipToken(cursor);
+                    skipToken(parser);
                     expression = (khAstExpression){
-                        .begin = origin, .end = *cursor, .type = khAstExpressionType_ELLIPSIS};
+                        .begin = origin, .end = parser->cursor, .type = khAstExpressionType_ELLIPSIS};
                     break;
 
                 default:
                     raiseError(token.begin, U"unexpected token in an expression");
-                    skipToken(cursor);
+                    skipToken(parser);
                     break;
             }
             break;
@@ -2247,45 +2756,61 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
                 raiseError(token.begin, U"expecting a type, not a character");
             }
 
-            skipToken(cursor);
+            skipToken(parser);
             expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
+                                           .end = parser->cursor,
                                            .type = khAstExpressionType_CHAR,
                                            .char_v = token.char_v};
             break;
 
-        case khTokenType_STRING:
+        case khTokenType_STRING: {
             if (filter_type) {
                 raiseError(token.begin, U"expecting a type, not a string");
             }
 
-            skipToken(cursor);
-            expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
-                                           .type = khAstExpressionType_STRING,
-                                           .string = khstring_copy(&token.string)};
-            break;
+            khAstRawLiteral raw = takeRaw(parser);
+            expression =
+                (khAstExpression){.begin = origin, .type = khAstExpressionType_STRING, .raw = raw};
+            if (raw.source != NULL) {
+                expression.opt_raw_arena = parser->opt_arena;
+            }
+            else {
+                expression.string = takeString(parser);
+            }
+
+            skipToken(parser);
+            expression.end = parser->cursor;
+        } break;
 
-        case khTokenType_BUFFER:
+        case khTokenType_BUFFER: {
             if (filter_type) {
                 raiseError(token.begin, U"expecting a type, not a buffer");
             }
 
-            skipToken(cursor);
-            expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
-                                           .type = khAstExpressionType_BUFFER,
-                                           .buffer = khbuffer_copy(&token.buffer)};
-            break;
+            khAstRawLiteral raw = takeRaw(parser);
+            expression =
+                (khAstExpression){.begin = origin, .type = khAstExpressionType_BUFFER, .raw = raw};
+            if (raw.source != NULL) {
+                expression.opt_raw_arena = parser->opt_arena;
+            }
+            else {
+                expression.buffer = takeBuffer(parser);
+            }
+
+            skipToken(parser);
+            expression.end = parser->cursor;
+        } break;
 
         case khTokenType_BYTE:
             if (filter_type) {
                 raiseError(token.begin, U"expecting a type, not a byte");
             }
 
-            skipToken(cursor);
-            expression = (khAstExpression){
-                .begin = origin, .end = *cursor, .type = khAstExpressionType_BYTE, .byte = token.byte};
+            skipToken(parser);
+            expression = (khAstExpression){.begin = origin,
+                                           .end = parser->cursor,
+                                           .type = khAstExpressionType_BYTE,
+                                           .byte = token.byte};
             break;
 
         case khTokenType_INTEGER:
@@ -2297,9 +2822,9 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
              * }
              */
 
-            skipToken(cursor);
+            skipToken(parser);
             expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
+                                           .end = parser->cursor,
                                            .type = khAstExpressionType_INTEGER,
                                            .integer = token.integer};
             break;
@@ -2312,9 +2837,9 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
              * }
              */
 
-            skipToken(cursor);
+            skipToken(parser);
             expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
+                                           .end = parser->cursor,
                                            .type = khAstExpressionType_UINTEGER,
                                            .uinteger = token.uinteger};
             break;
@@ -2324,9 +2849,9 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
                 raiseError(token.begin, U"expecting a type, not a floating-point number");
             }
 
-            skipToken(cursor);
+            skipToken(parser);
             expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
+                                           .end = parser->cursor,
                                            .type = khAstExpressionType_FLOAT,
                                            .float_v = token.float_v};
             break;
@@ -2336,9 +2861,9 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
                 raiseError(token.begin, U"expecting a type, not a double floating-point number");
             }
 
-            skipToken(cursor);
+            skipToken(parser);
             expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
+                                           .end = parser->cursor,
                                            .type = khAstExpressionType_DOUBLE,
                                            .double_v = token.double_v};
             break;
@@ -2348,9 +2873,9 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
                 raiseError(token.begin, U"expecting a type, not an imaginary floating-point number");
             }
 
-            skipToken(cursor);
+            skipToken(parser);
             expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
+                                           .end = parser->cursor,
                                            .type = khAstExpressionType_IFLOAT,
                                            .ifloat = token.ifloat};
             break;
@@ -2361,16 +2886,16 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
                            U"expecting a type, not an imaginary double floating-point number");
             }
 
-            skipToken(cursor);
+            skipToken(parser);
             expression = (khAstExpression){.begin = origin,
-                                           .end = *cursor,
+                                           .end = parser->cursor,
                                            .type = khAstExpressionType_IDOUBLE,
                                            .idouble = token.idouble};
             break;
 
         case khTokenType_NEWLINE:
             raiseError(token.begin, U"unexpected newline in an expression");
-            skipToken(cursor);
+            skipToken(parser);
             break;
 
         case khTokenType_EOF:
@@ -2379,27 +2904,26 @@ static khAstExpression exparseOther(char32_t** cursor, EXPARSE_ARGS) {
 
         default:
             raiseError(token.begin, U"unexpected token in an expression");
-            skipToken(cursor);
+            skipToken(parser);
             break;
     }
 
-    khToken_delete(&token);
     return expression;
 }
 
-static khAstExpression exparseSignature(char32_t** cursor, bool ignore_newline) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = *cursor;
-    khAstSignature signature = {.are_arguments_refs = kharray_new(bool, NULL),
-                                .argument_types = kharray_new(khAstExpression, khAstExpression_delete),
-                                .is_return_type_ref = false,
-                                .opt_return_type = NULL};
+static khAstExpression exparseSignature(khParser* parser, bool ignore_newline) {
+    khToken token = currentToken(parser, ignore_newline);
+    uint32_t origin = parser->cursor;
+    khAstSignature signature = {
+        .are_arguments_refs = newArray(parser, bool, NULL),
+        .argument_types = newArray(parser, khAstExpression, khAstExpression_delete),
+        .is_return_type_ref = false,
+        .opt_return_type = NULL};
 
     // Ensures `def` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_DEF) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
+        skipToken(parser);
+        token = currentToken(parser, ignore_newline);
     }
     else {
         raiseError(token.begin, U"expecting a `def` keyword");
@@ -2407,9 +2931,8 @@ static khAstExpression exparseSignature(char32_t** cursor, bool ignore_newline)
 
     // Ensures an exclamation mark
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_EXCLAMATION) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
+        skipToken(parser);
+        token = currentToken(parser, ignore_newline);
     }
     else {
         raiseError(token.begin, U"expecting an exclamation mark");
@@ -2417,9 +2940,8 @@ static khAstExpression exparseSignature(char32_t** cursor, bool ignore_newline)
 
     // Ensures an opening parenthesis
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_PARENTHESIS_OPEN) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        skipToken(parser);
+        token = currentToken(parser, true);
     }
     else {
         raiseError(token.begin, U"expecting an opening parenthesis");
@@ -2427,34 +2949,32 @@ static khAstExpression exparseSignature(char32_t** cursor, bool ignore_newline)
 
     // Instant close
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_PARENTHESIS_CLOSE) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else {
         while (true) {
             // Handles `ref` arguments
             if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_REF) {
                 kharray_append(&signature.are_arguments_refs, true);
-                skipToken(cursor);
+                skipToken(parser);
             }
             else {
                 kharray_append(&signature.are_arguments_refs, false);
             }
 
             // Argument type
-            kharray_append(&signature.argument_types, kh_parseExpression(cursor, true, true));
-            khToken_delete(&token);
-            token = currentToken(cursor, true);
+            kharray_append(&signature.argument_types, parseExpression(parser, true, true));
+            token = currentToken(parser, true);
 
             // Do nothing after a comma
             if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COMMA) {
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, true);
+                skipToken(parser);
+                token = currentToken(parser, true);
             }
             // Breaks out of the loop after closing the arglist
             else if (token.type == khTokenType_DELIMITER &&
                      token.delimiter == khDelimiterToken_PARENTHESIS_CLOSE) {
-                skipToken(cursor);
+                skipToken(parser);
                 break;
             }
             else {
@@ -2466,33 +2986,31 @@ static khAstExpression exparseSignature(char32_t** cursor, bool ignore_newline)
     }
 
     // Optional return type
-    khToken_delete(&token);
-    token = currentToken(cursor, ignore_newline);
+    token = currentToken(parser, ignore_newline);
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_ARROW) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
+        skipToken(parser);
+        token = currentToken(parser, ignore_newline);
 
         // Handles `ref` return type
         if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_REF) {
             signature.is_return_type_ref = true;
-            skipToken(cursor);
+            skipToken(parser);
         }
 
         // Return type itself
-        signature.opt_return_type = malloc(sizeof(khAstExpression));
-        *signature.opt_return_type = kh_parseExpression(cursor, ignore_newline, true);
+        signature.opt_return_type = box(parser, parseExpression(parser, ignore_newline, true));
     }
 
-    khToken_delete(&token);
-    return (khAstExpression){
-        .begin = origin, .end = *cursor, .type = khAstExpressionType_SIGNATURE, .signature = signature};
+    return (khAstExpression){.begin = origin,
+                             .end = parser->cursor,
+                             .type = khAstExpressionType_SIGNATURE,
+                             .signature = khAstSignature_box(signature, parser->opt_arena)};
 }
 
-static khAstExpression exparseLambda(char32_t** cursor, bool ignore_newline) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = *cursor;
-    khAstLambda lambda = {.arguments = kharray_new(khAstVariable, khAstVariable_delete),
+static khAstExpression exparseLambda(khParser* parser, bool ignore_newline) {
+    khToken token = currentToken(parser, ignore_newline);
+    uint32_t origin = parser->cursor;
+    khAstLambda lambda = {.arguments = newArray(parser, khAstVariable, khAstVariable_delete),
                           .opt_variadic_argument = NULL,
                           .is_return_type_ref = false,
                           .opt_return_type = NULL,
@@ -2500,33 +3018,33 @@ static khAstExpression exparseLambda(char32_t** cursor, bool ignore_newline) {
 
     // Ensures `def` keyword
     if (token.type == khTokenType_KEYWORD && token.keyword == khKeywordToken_DEF) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, ignore_newline);
+        skipToken(parser);
+        token = currentToken(parser, ignore_newline);
     }
     else {
         raiseError(token.begin, U"expecting a `def` keyword");
     }
 
-    sparseFunctionOrLambda(cursor, &lambda.arguments, &lambda.opt_variadic_argument,
-                           &lambda.is_return_type_ref, &lambda.opt_return_type, &lambda.block);
+    sparseFunctionOrLambda(parser, &lambda.arguments, &lambda.opt_variadic_argument,
+                           &lambda.is_return_type_ref, &lambda.opt_return_type, &lambda.block,
+                           &lambda.lazy_block);
 
-    khToken_delete(&token);
-    return (khAstExpression){
-        .begin = origin, .end = *cursor, .type = khAstExpressionType_LAMBDA, .lambda = lambda};
+    return (khAstExpression){.begin = origin,
+                             .end = parser->cursor,
+                             .type = khAstExpressionType_LAMBDA,
+                             .lambda = khAstLambda_box(lambda, parser->opt_arena)};
 }
 
-static khAstExpression exparseDict(char32_t** cursor, bool ignore_newline) {
-    khToken token = currentToken(cursor, ignore_newline);
-    char32_t* origin = *cursor;
-    khAstDict dict = {.keys = kharray_new(khAstExpression, khAstExpression_delete),
-                      .values = kharray_new(khAstExpression, khAstExpression_delete)};
+static khAstExpression exparseDict(khParser* parser, bool ignore_newline) {
+    khToken token = currentToken(parser, ignore_newline);
+    uint32_t origin = parser->cursor;
+    khAstDict dict = {.keys = newArray(parser, khAstExpression, khAstExpression_delete),
+                      .values = newArray(parser, khAstExpression, khAstExpression_delete)};
 
     // Ensures an opening curly bracket
     if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_CURLY_BRACKET_OPEN) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        skipToken(parser);
+        token = currentToken(parser, true);
     }
     else {
         raiseError(token.begin, U"expecting an opening curly bracket");
@@ -2535,40 +3053,36 @@ static khAstExpression exparseDict(char32_t** cursor, bool ignore_newline) {
     // Instant close
     if (token.type == khTokenType_DELIMITER &&
         token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else {
         while (true) {
             // Key
-            kharray_append(&dict.keys, kh_parseExpression(cursor, true, false));
-            khToken_delete(&token);
-            token = currentToken(cursor, true);
+            kharray_append(&dict.keys, parseExpression(parser, true, false));
+            token = currentToken(parser, true);
 
             // Ensures a colon
             if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COLON) {
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, true);
+                skipToken(parser);
+                token = currentToken(parser, true);
             }
             else {
                 raiseError(token.begin, U"expecting a colon after the key for its value pair");
             }
 
             // Value
-            kharray_append(&dict.values, kh_parseExpression(cursor, true, false));
-            khToken_delete(&token);
-            token = currentToken(cursor, true);
+            kharray_append(&dict.values, parseExpression(parser, true, false));
+            token = currentToken(parser, true);
 
             // Do nothing after a comma
             if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COMMA) {
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, true);
+                skipToken(parser);
+                token = currentToken(parser, true);
             }
             // Breaks out of the loop after dict close
             else if (token.type == khTokenType_DELIMITER &&
                      token.delimiter == khDelimiterToken_CURLY_BRACKET_CLOSE) {
-                skipToken(cursor);
+                skipToken(parser);
                 break;
             }
             else {
@@ -2580,21 +3094,19 @@ static khAstExpression exparseDict(char32_t** cursor, bool ignore_newline) {
         }
     }
 
-    khToken_delete(&token);
     return (khAstExpression){
-        .begin = origin, .end = *cursor, .type = khAstExpressionType_DICT, .dict = dict};
+        .begin = origin, .end = parser->cursor, .type = khAstExpressionType_DICT, .dict = dict};
 }
 
-static kharray(khAstExpression) exparseList(char32_t** cursor, khDelimiterToken opening_delimiter,
+static kharray(khAstExpression) exparseList(khParser* parser, khDelimiterToken opening_delimiter,
                                             khDelimiterToken closing_delimiter, EXPARSE_ARGS) {
-    kharray(khAstExpression) expressions = kharray_new(khAstExpression, khAstExpression_delete);
-    khToken token = currentToken(cursor, ignore_newline);
+    kharray(khAstExpression) expressions = newArray(parser, khAstExpression, khAstExpression_delete);
+    khToken token = currentToken(parser, ignore_newline);
 
     // Ensures the opening delimiter
     if (token.type == khTokenType_DELIMITER && token.delimiter == opening_delimiter) {
-        skipToken(cursor);
-        khToken_delete(&token);
-        token = currentToken(cursor, true);
+        skipToken(parser);
+        token = currentToken(parser, true);
     }
     else {
         raiseError(token.begin, U"expecting an opening delimiter");
@@ -2602,24 +3114,22 @@ static kharray(khAstExpression) exparseList(char32_t** cursor, khDelimiterToken
 
     // Instant close
     if (token.type == khTokenType_DELIMITER && token.delimiter == closing_delimiter) {
-        skipToken(cursor);
+        skipToken(parser);
     }
     else {
         while (true) {
             // Expression
-            kharray_append(&expressions, kh_parseExpression(cursor, true, filter_type));
-            khToken_delete(&token);
-            token = currentToken(cursor, true);
+            kharray_append(&expressions, parseExpression(parser, true, filter_type));
+            token = currentToken(parser, true);
 
             // Do nothing after a comma
             if (token.type == khTokenType_DELIMITER && token.delimiter == khDelimiterToken_COMMA) {
-                skipToken(cursor);
-                khToken_delete(&token);
-                token = currentToken(cursor, true);
+                skipToken(parser);
+                token = currentToken(parser, true);
             }
             // Breaks out of the loop after list close
             else if (token.type == khTokenType_DELIMITER && token.delimiter == closing_delimiter) {
-                skipToken(cursor);
+                skipToken(parser);
                 break;
             }
             else {
@@ -2630,7 +3140,142 @@ static kharray(khAstExpression) exparseList(char32_t** cursor, khDelimiterToken
         }
     }
 
-    khToken_delete(&token);
-
     return expressions;
 }
+
+static khAstExpressionType packedType(khTokenType type) {
+    switch (type) {
+        case khTokenType_CHAR:
+            return khAstExpressionType_CHAR;
+        case khTokenType_BYTE:
+            return khAstExpressionType_BYTE;
+        case khTokenType_INTEGER:
+            return khAstExpressionType_INTEGER;
+        case khTokenType_UINTEGER:
+            return khAstExpressionType_UINTEGER;
+        case khTokenType_FLOAT:
+            return khAstExpressionType_FLOAT;
+        case khTokenType_DOUBLE:
+            return khAstExpressionType_DOUBLE;
+
+        default:
+            return khAstExpressionType_INVALID;
+    }
+}
+
+// Looks ahead from the first element for literals of the same type, each followed by a comma or the
+// closing delimiter. Returns how many there are, or 0 if anything else is in the list
+static size_t countPackable(khParser* parser, khDelimiterToken closing_delimiter) {
+    size_t index = nextIndex(parser);
+    khTokenType type = tokenAt(parser, index)->type;
+    size_t count = 0;
+
+    if (packedType(type) == khAstExpressionType_INVALID) {
+        return 0;
+    }
+
+    while (true) {
+        if (tokenAt(parser, index)->type != type) {
+            return 0;
+        }
+
+        count++;
+        index++;
+        while (tokenAt(parser, index)->type == khTokenType_COMMENT ||
+               tokenAt(parser, index)->type == khTokenType_NEWLINE) {
+            index++;
+        }
+
+        khToken* token = tokenAt(parser, index);
+        if (token->type != khTokenType_DELIMITER) {
+            return 0;
+        }
+        else if (token->delimiter == closing_delimiter) {
+            return count;
+        }
+        else if (token->delimiter != khDelimiterToken_COMMA) {
+            return 0;
+        }
+
+        index++;
+        while (tokenAt(parser, index)->type == khTokenType_COMMENT ||
+               tokenAt(parser, index)->type == khTokenType_NEWLINE) {
+            index++;
+        }
+    }
+}
+
+// Same as `exparseList`, except that a big enough list of literals of one type gets packed without
+// making an expression for each. The returned array is empty then
+static kharray(khAstExpression) exparsePackableList(khParser* parser, khAstPackedValues* packed,
+                                                    khDelimiterToken opening_delimiter,
+                                                    khDelimiterToken closing_delimiter, EXPARSE_ARGS) {
+    *packed = (khAstPackedValues){.type = khAstExpressionType_INVALID, .data = NULL};
+    khToken token = currentToken(parser, ignore_newline);
+
+    // Literals as types are errors, and too deep elements as well, which the usual path raises
+    if (filter_type || parser->depth >= kh_PARSE_MAX_DEPTH || token.type != khTokenType_DELIMITER ||
+        token.delimiter != opening_delimiter) {
+        return exparseList(parser, opening_delimiter, closing_delimiter, ignore_newline, filter_type);
+    }
+
+    size_t index = parser->index;
+    uint32_t cursor = parser->cursor;
+    skipToken(parser);
+
+    size_t count = countPackable(parser, closing_delimiter);
+    if (count < kh_PARSE_PACK_MIN_SIZE) {
+        parser->index = index;
+        parser->cursor = cursor;
+        return exparseList(parser, opening_delimiter, closing_delimiter, ignore_newline, filter_type);
+    }
+
+    *packed = (khAstPackedValues){.type = packedType(currentToken(parser, true).type),
+                                  .data = newArray(parser, uint8_t, NULL)};
+
+    for (size_t i = 0; i < count; i++) {
+        token = currentToken(parser, true);
+        uint8_t* value;
+        size_t width;
+
+        switch (token.type) {
+            case khTokenType_CHAR:
+                value = (uint8_t*)&token.char_v;
+                width = sizeof(char32_t);
+                break;
+            case khTokenType_BYTE:
+                value = &token.byte;
+                width = sizeof(uint8_t);
+                break;
+            case khTokenType_INTEGER:
+                value = (uint8_t*)&token.integer;
+                width = sizeof(int64_t);
+                break;
+            case khTokenType_UINTEGER:
+                value = (uint8_t*)&token.uinteger;
+                width = sizeof(uint64_t);
+                break;
+            case khTokenType_FLOAT:
+                value = (uint8_t*)&token.float_v;
+                width = sizeof(float);
+                break;
+            default:
+                value = (uint8_t*)&token.double_v;
+                width = sizeof(double);
+                break;
+        }
+
+        if (i == 0) {
+            kharray_reserve(&packed->data, count * width);
+        }
+
+        kharray_memory(&packed->data, value, width, NULL);
+
+        // The literal, then its comma or the closing delimiter
+        skipToken(parser);
+        currentToken(parser, true);
+        skipToken(parser);
+    }
+
+    return newArray(parser, khAstExpression, khAstExpression_delete);
+}
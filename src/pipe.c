@@ -0,0 +1,138 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#include <sched.h>
+#include <stdlib.h>
+
+#include <kithare/core/error.h>
+#include <kithare/core/lexer.h>
+#include <kithare/core/pipe.h>
+
+
+static void* lexerThread(void* data) {
+    khTokenPipe* pipe = data;
+    kh_setFile(pipe->file);
+    char32_t* cursor = pipe->origin;
+    size_t head = 0;
+
+    while (true) {
+        khToken token = kh_lexToken(&cursor, pipe->origin);
+        bool is_eof = token.type == khTokenType_EOF;
+
+        // Moves the errors raised on this thread along with the token
+        kharray(khError) errors = NULL;
+        if (kh_hasErrors()) {
+            errors = kharray_copy(kh_getErrors(), khError_move);
+            kh_flushErrors();
+        }
+
+        // Waits for a free slot in the ring
+        while (head - atomic_load_explicit(&pipe->tail, memory_order_acquire) >=
+               kh_TOKEN_PIPE_CAPACITY) {
+            if (atomic_load_explicit(&pipe->is_stopped, memory_order_relaxed)) {
+                khToken_delete(&token);
+                if (errors != NULL) {
+                    kharray_delete(&errors);
+                }
+                return NULL;
+            }
+
+            sched_yield();
+        }
+
+        pipe->slots[head & (kh_TOKEN_PIPE_CAPACITY - 1)] =
+            (_khTokenPipeSlot){.token = token, .errors = errors};
+        atomic_store_explicit(&pipe->head, ++head, memory_order_release);
+
+        if (is_eof) {
+            return NULL;
+        }
+    }
+}
+
+
+// What's lexed instead of a string which is too long
+static char32_t empty_string[1] = {U'\0'};
+
+khTokenPipe* khTokenPipe_new(khstring* string, bool is_threaded) {
+    khTokenPipe* pipe = (khTokenPipe*)malloc(sizeof(khTokenPipe));
+    pipe->slots = NULL;
+    if (is_threaded) {
+        pipe->slots = (_khTokenPipeSlot*)malloc(sizeof(_khTokenPipeSlot) * kh_TOKEN_PIPE_CAPACITY);
+    }
+    pipe->origin = kh_checkSourceSize(string) ? *string : empty_string;
+    pipe->cursor = pipe->origin;
+    pipe->file = kh_getFile();
+    pipe->is_finished = false;
+
+    atomic_init(&pipe->head, 0);
+    atomic_init(&pipe->tail, 0);
+    atomic_init(&pipe->is_stopped, false);
+
+    pipe->is_threaded = is_threaded && pthread_create(&pipe->thread, NULL, lexerThread, pipe) == 0;
+    return pipe;
+}
+
+void khTokenPipe_delete(khTokenPipe* pipe) {
+    if (pipe->is_threaded) {
+        atomic_store_explicit(&pipe->is_stopped, true, memory_order_relaxed);
+        pthread_join(pipe->thread, NULL);
+    }
+
+    // Deletes the tokens which weren't taken
+    size_t head = atomic_load_explicit(&pipe->head, memory_order_acquire);
+    for (size_t i = atomic_load_explicit(&pipe->tail, memory_order_relaxed); i < head; i++) {
+        _khTokenPipeSlot* slot = &pipe->slots[i & (kh_TOKEN_PIPE_CAPACITY - 1)];
+
+        khToken_delete(&slot->token);
+        if (slot->errors != NULL) {
+            kharray_delete(&slot->errors);
+        }
+    }
+
+    free(pipe->slots);
+    free(pipe);
+}
+
+khToken khTokenPipe_next(khTokenPipe* pipe) {
+    if (pipe->is_finished) {
+        return pipe->eof;
+    }
+
+    if (!pipe->is_threaded) {
+        khToken token = kh_lexToken(&pipe->cursor, pipe->origin);
+        if (token.type == khTokenType_EOF) {
+            pipe->eof = token;
+            pipe->is_finished = true;
+        }
+
+        return token;
+    }
+
+    size_t tail = atomic_load_explicit(&pipe->tail, memory_order_relaxed);
+    while (atomic_load_explicit(&pipe->head, memory_order_acquire) == tail) {
+        sched_yield();
+    }
+
+    _khTokenPipeSlot slot = pipe->slots[tail & (kh_TOKEN_PIPE_CAPACITY - 1)];
+    atomic_store_explicit(&pipe->tail, tail + 1, memory_order_release);
+
+    // Raise the lexer errors on this thread, as if the token was lexed here
+    if (slot.errors != NULL) {
+        for (size_t i = 0; i < kharray_size(&slot.errors); i++) {
+            kh_raiseError(khError_move(&slot.errors[i]));
+        }
+        kharray_delete(&slot.errors);
+    }
+
+    if (slot.token.type == khTokenType_EOF) {
+        pipe->eof = slot.token;
+        pipe->is_finished = true;
+    }
+
+    return slot.token;
+}
@@ -0,0 +1,750 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#include <kithare/core/error.h>
+#include <kithare/core/query.h>
+#include <kithare/core/unicode.h>
+#include <kithare/lib/hash.h>
+
+
+static void deleteName(khAstIndexName* name) {
+    khstring_delete(&name->name);
+    kharray_delete(&name->entries);
+}
+
+static inline uint64_t hashName(char32_t* chars, size_t size) {
+    return kh_hash(chars, size * sizeof(char32_t), 0);
+}
+
+// Slot of the name, or of the empty one where it'd go. Same as the interner's, the table is kept at
+// most half full
+static inline size_t findSlot(khAstIndex* index, khstring* name, uint64_t hash) {
+    size_t mask = kharray_size(&index->slots) - 1;
+    size_t slot = hash & mask;
+
+    while (index->slots[slot] != UINT32_MAX) {
+        khAstIndexName* other = &index->names[index->slots[slot]];
+        if (other->hash == hash && khstring_equal(&other->name, name)) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+static void growSlots(khAstIndex* index) {
+    size_t size = kharray_size(&index->slots) * 2;
+    kharray_delete(&index->slots);
+
+    index->slots = kharray_new(uint32_t, NULL);
+    kharray_reserve(&index->slots, size);
+    for (size_t i = 0; i < size; i++) {
+        kharray_append(&index->slots, UINT32_MAX);
+    }
+
+    for (uint32_t i = 0; i < kharray_size(&index->names); i++) {
+        size_t slot = index->names[i].hash & (size - 1);
+        while (index->slots[slot] != UINT32_MAX) {
+            slot = (slot + 1) & (size - 1);
+        }
+        index->slots[slot] = i;
+    }
+}
+
+// Gives the node one more name, which is copied into the table if it's new there
+static void addName(khAstIndex* index, uint32_t entry, khstring* name) {
+    uint64_t hash = hashName(*name, khstring_size(name));
+    size_t slot = findSlot(index, name, hash);
+
+    if (index->slots[slot] == UINT32_MAX) {
+        index->slots[slot] = kharray_size(&index->names);
+        kharray_append(&index->names, ((khAstIndexName){.name = khstring_copy(name),
+                                                        .hash = hash,
+                                                        .entries = kharray_new(uint32_t, NULL)}));
+
+        if (kharray_size(&index->names) * 2 > kharray_size(&index->slots)) {
+            growSlots(index);
+            slot = findSlot(index, name, hash);
+        }
+    }
+
+    // A variable declaring the same name twice is still listed once
+    uint32_t id = index->slots[slot];
+    kharray(uint32_t)* entries = &index->names[id].entries;
+    if (kharray_size(entries) == 0 || (*entries)[kharray_size(entries) - 1] != entry) {
+        kharray_append(entries, entry);
+        kharray_append(&index->name_ids, id);
+    }
+}
+
+static void joinNames(khstring* joined, kharray(khstring) * names) {
+    for (size_t i = 0; i < kharray_size(names); i++) {
+        if (i > 0) {
+            khstring_append(joined, U'.');
+        }
+        khstring_concatenate(joined, &(*names)[i]);
+    }
+}
+
+// Appends the name of the expression, if it has one
+static bool writeExpressionName(khAstExpression* expression, khstring* name) {
+    switch (expression->type) {
+        case khAstExpressionType_IDENTIFIER:
+            khstring_concatenate(name, &expression->identifier);
+            return true;
+
+        case khAstExpressionType_SCOPE:
+            if (writeExpressionName(expression->scope.value, name)) {
+                khstring_append(name, U'.');
+            }
+            joinNames(name, &expression->scope.scope_names);
+            return true;
+
+        case khAstExpressionType_CALL:
+            return writeExpressionName(expression->call.callee, name);
+        case khAstExpressionType_INDEX:
+            return writeExpressionName(expression->index.indexee, name);
+        case khAstExpressionType_TEMPLATIZE:
+            return writeExpressionName(expression->templatize.value, name);
+
+        default:
+            return false;
+    }
+}
+
+static void nameStatement(khAstIndex* index, uint32_t entry, khAstStatement* statement,
+                          khstring* scratch) {
+    switch (statement->type) {
+        case khAstStatementType_VARIABLE:
+            for (size_t i = 0; i < kharray_size(&statement->variable.names); i++) {
+                addName(index, entry, &statement->variable.names[i]);
+            }
+            break;
+
+        case khAstStatementType_IMPORT:
+            joinNames(scratch, &statement->import_v.path);
+            addName(index, entry, scratch);
+            break;
+        case khAstStatementType_INCLUDE:
+            joinNames(scratch, &statement->include.path);
+            addName(index, entry, scratch);
+            break;
+        case khAstStatementType_FUNCTION:
+            joinNames(scratch, &statement->function.identifiers);
+            addName(index, entry, scratch);
+            break;
+
+        case khAstStatementType_CLASS:
+            addName(index, entry, &statement->class_v.name);
+            break;
+        case khAstStatementType_STRUCT:
+            addName(index, entry, &statement->struct_v.name);
+            break;
+        case khAstStatementType_ENUM:
+            addName(index, entry, &statement->enum_v.name);
+            break;
+        case khAstStatementType_ALIAS:
+            addName(index, entry, &statement->alias.name);
+            break;
+
+        default:
+            break;
+    }
+}
+
+typedef struct {
+    khAstIndex* index;
+    khstring scratch; // Where the names which have to be put together are
+} khIndexer;
+
+static khAstWalkAction indexNode(khAstNode node, size_t depth, void* data) {
+    khIndexer* indexer = (khIndexer*)data;
+    khAstIndex* index = indexer->index;
+
+    uint32_t entry = kharray_size(&index->entries);
+    uint32_t names_begin = kharray_size(&index->name_ids);
+    khstring_pop(&indexer->scratch, khstring_size(&indexer->scratch));
+
+    // Pointed to once the walk is done, as the copies may still move until then
+    if (node.is_transient) {
+        kharray_append(&index->elements, *node.expression);
+        node.expression = NULL;
+    }
+
+    if (node.kind == khAstNodeKind_STATEMENT) {
+        kharray_append(&index->statement_kinds[node.statement->type], entry);
+        nameStatement(index, entry, node.statement, &indexer->scratch);
+    }
+    else {
+        khAstExpression* expression =
+            node.is_transient ? &index->elements[kharray_size(&index->elements) - 1] : node.expression;
+        kharray_append(&index->expression_kinds[expression->type], entry);
+        if (writeExpressionName(expression, &indexer->scratch)) {
+            addName(index, entry, &indexer->scratch);
+        }
+    }
+
+    kharray_append(&index->entries, ((khAstIndexEntry){.node = node,
+                                                       .depth = depth,
+                                                       .names_begin = names_begin,
+                                                       .names_end = kharray_size(&index->name_ids)}));
+    return khAstWalkAction_CONTINUE;
+}
+
+khAstIndex khAstIndex_new(kharray(khAstStatement) * statements) {
+    khAstIndex index = {.entries = kharray_new(khAstIndexEntry, NULL),
+                        .elements = kharray_new(khAstExpression, NULL),
+                        .name_ids = kharray_new(uint32_t, NULL),
+                        .names = kharray_new(khAstIndexName, deleteName),
+                        .slots = kharray_new(uint32_t, NULL)};
+
+    for (size_t i = 0; i <= khAstStatementType_RETURN; i++) {
+        index.statement_kinds[i] = kharray_new(uint32_t, NULL);
+    }
+    for (size_t i = 0; i <= khAstExpressionType_TEMPLATIZE; i++) {
+        index.expression_kinds[i] = kharray_new(uint32_t, NULL);
+    }
+
+    kharray_reserve(&index.slots, 64);
+    for (size_t i = 0; i < 64; i++) {
+        kharray_append(&index.slots, UINT32_MAX);
+    }
+
+    khIndexer indexer = {.index = &index, .scratch = khstring_new(U"")};
+    khAstVisitor visitor = {.opt_pre = indexNode, .opt_post = NULL, .data = &indexer};
+    khAst_walk(statements, &visitor);
+    khstring_delete(&indexer.scratch);
+
+    // The copies don't move anymore, so the entries of the transient nodes can point to them. Those are
+    // literals, which have nothing of their own to be deleted
+    khAstExpression* element = index.elements;
+    for (size_t i = 0; i < kharray_size(&index.entries); i++) {
+        if (index.entries[i].node.is_transient) {
+            index.entries[i].node.expression = element++;
+        }
+    }
+
+    return index;
+}
+
+void khAstIndex_delete(khAstIndex* index) {
+    kharray_delete(&index->entries);
+    kharray_delete(&index->elements);
+    for (size_t i = 0; i <= khAstStatementType_RETURN; i++) {
+        kharray_delete(&index->statement_kinds[i]);
+    }
+    for (size_t i = 0; i <= khAstExpressionType_TEMPLATIZE; i++) {
+        kharray_delete(&index->expression_kinds[i]);
+    }
+
+    kharray_delete(&index->name_ids);
+    kharray_delete(&index->names);
+    kharray_delete(&index->slots);
+}
+
+khstring* khAstIndex_name(khAstIndex* index, uint32_t entry) {
+    khAstIndexEntry* index_entry = &index->entries[entry];
+    return index_entry->names_begin < index_entry->names_end
+               ? &index->names[index->name_ids[index_entry->names_begin]].name
+               : NULL;
+}
+
+kharray(uint32_t) * khAstIndex_named(khAstIndex* index, khstring* name) {
+    size_t slot = findSlot(index, name, hashName(*name, khstring_size(name)));
+    return index->slots[slot] != UINT32_MAX ? &index->names[index->slots[slot]].entries : NULL;
+}
+
+
+static inline void raiseError(uint32_t offset, const char32_t* message) {
+    kh_raiseError((khError){
+        .type = khErrorType_UNSPECIFIED, .message = khstring_new(message), .offset = offset});
+}
+
+static void deleteCondition(khAstQueryCondition* condition) {
+    khstring_delete(&condition->name);
+}
+
+static inline void skipSpaces(char32_t** cursor) {
+    while (kh_isSpace(**cursor)) {
+        (*cursor)++;
+    }
+}
+
+static inline bool isWordChar(char32_t chr) {
+    return kh_isXidContinue(chr) || chr == U'.' || chr == U'*';
+}
+
+static khstring takeWord(char32_t** cursor) {
+    khstring word = khstring_new(U"");
+    while (isWordChar(**cursor)) {
+        khstring_append(&word, *(*cursor)++);
+    }
+
+    return word;
+}
+
+// Quoted values may have anything in them, where a backslash escapes the character after it
+static khstring takeValue(char32_t** cursor, char32_t* origin) {
+    if (**cursor != U'\"') {
+        return takeWord(cursor);
+    }
+
+    khstring value = khstring_new(U"");
+    for ((*cursor)++; **cursor != U'\"'; (*cursor)++) {
+        if (**cursor == U'\\' && (*cursor)[1] != U'\0') {
+            (*cursor)++;
+        }
+        else if (**cursor == U'\0') {
+            raiseError(*cursor - origin, U"unclosed quote");
+            return value;
+        }
+        khstring_append(&value, **cursor);
+    }
+    (*cursor)++;
+
+    return value;
+}
+
+static bool parseKind(khAstQuery* query, khstring* word) {
+    for (uint32_t type = 0; type <= khAstStatementType_RETURN; type++) {
+        khstring name = khAstStatementType_string(type);
+        bool is_equal = khstring_equal(&name, word);
+        khstring_delete(&name);
+
+        if (is_equal) {
+            query->has_kind = true;
+            query->kind = khAstNodeKind_STATEMENT;
+            query->type = type;
+            return true;
+        }
+    }
+
+    for (uint32_t type = 0; type <= khAstExpressionType_TEMPLATIZE; type++) {
+        khstring name = khAstExpressionType_string(type);
+        bool is_equal = khstring_equal(&name, word);
+        khstring_delete(&name);
+
+        if (is_equal) {
+            query->has_kind = true;
+            query->kind = khAstNodeKind_EXPRESSION;
+            query->type = type;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool parseOperation(char32_t** cursor, khAstComparisonExpressionType* operation) {
+    switch (**cursor) {
+        case U'=':
+            *operation = khAstComparisonExpressionType_EQUAL;
+            break;
+        case U'!':
+            if ((*cursor)[1] != U'=') {
+                return false;
+            }
+            *operation = khAstComparisonExpressionType_UNEQUAL;
+            (*cursor)++;
+            break;
+        case U'<':
+            *operation = (*cursor)[1] == U'=' ? khAstComparisonExpressionType_LESS_EQUAL
+                                              : khAstComparisonExpressionType_LESS;
+            break;
+        case U'>':
+            *operation = (*cursor)[1] == U'=' ? khAstComparisonExpressionType_GREATER_EQUAL
+                                              : khAstComparisonExpressionType_GREATER;
+            break;
+
+        default:
+            return false;
+    }
+
+    (*cursor)++;
+    if (*operation == khAstComparisonExpressionType_LESS_EQUAL ||
+        *operation == khAstComparisonExpressionType_GREATER_EQUAL) {
+        (*cursor)++;
+    }
+
+    return true;
+}
+
+// Resolves the operator named by the value, as either a unary or a binary one
+static void parseOperator(khAstQueryCondition* condition, khstring* value) {
+    condition->unary = -1;
+    condition->binary = -1;
+
+    for (int32_t type = 0; type <= khAstUnaryExpressionType_BIT_NOT; type++) {
+        khstring name = khAstUnaryExpressionType_string(type);
+        if (khstring_equal(&name, value)) {
+            condition->unary = type;
+        }
+        khstring_delete(&name);
+    }
+
+    for (int32_t type = 0; type <= khAstBinaryExpressionType_IP_BIT_RSHIFT; type++) {
+        khstring name = khAstBinaryExpressionType_string(type);
+        if (khstring_equal(&name, value)) {
+            condition->binary = type;
+        }
+        khstring_delete(&name);
+    }
+}
+
+static bool parseCondition(khAstQuery* query, char32_t** cursor, char32_t* origin) {
+    khAstQueryCondition condition = {.name = NULL, .number = 0, .unary = -1, .binary = -1};
+
+    char32_t* attribute_begin = *cursor;
+    khstring attribute = takeWord(cursor);
+    bool is_known = true;
+    if (khstring_equalCstring(&attribute, U"name")) {
+        condition.attribute = khAstQueryAttribute_NAME;
+    }
+    else if (khstring_equalCstring(&attribute, U"arguments")) {
+        condition.attribute = khAstQueryAttribute_ARGUMENTS;
+    }
+    else if (khstring_equalCstring(&attribute, U"operator")) {
+        condition.attribute = khAstQueryAttribute_OPERATOR;
+    }
+    else if (khstring_equalCstring(&attribute, U"depth")) {
+        condition.attribute = khAstQueryAttribute_DEPTH;
+    }
+    else {
+        is_known = false;
+    }
+    khstring_delete(&attribute);
+
+    if (!is_known) {
+        raiseError(attribute_begin - origin, U"unknown attribute, expecting `name`, `arguments`, "
+                                             U"`operator` or `depth`");
+        return false;
+    }
+
+    skipSpaces(cursor);
+    char32_t* operation_begin = *cursor;
+    if (!parseOperation(cursor, &condition.operation)) {
+        raiseError(operation_begin - origin, U"expecting a comparison");
+        return false;
+    }
+
+    bool is_textual = condition.attribute == khAstQueryAttribute_NAME ||
+                      condition.attribute == khAstQueryAttribute_OPERATOR;
+    if (is_textual && condition.operation != khAstComparisonExpressionType_EQUAL &&
+        condition.operation != khAstComparisonExpressionType_UNEQUAL) {
+        raiseError(operation_begin - origin,
+                   U"names and operators can only be compared with `=` or `!=`");
+        return false;
+    }
+
+    skipSpaces(cursor);
+    char32_t* value_begin = *cursor;
+    khstring value = takeValue(cursor, origin);
+
+    switch (condition.attribute) {
+        case khAstQueryAttribute_NAME:
+            condition.name = khstring_move(&value);
+            break;
+
+        case khAstQueryAttribute_OPERATOR:
+            parseOperator(&condition, &value);
+            if (condition.unary == -1 && condition.binary == -1) {
+                raiseError(value_begin - origin, U"unknown operator");
+            }
+            break;
+
+        default:
+            for (char32_t* chr = value; chr < value + khstring_size(&value); chr++) {
+                if (*chr < U'0' || *chr > U'9') {
+                    raiseError(value_begin - origin, U"expecting a number");
+                    break;
+                }
+                condition.number = condition.number * 10 + (*chr - U'0');
+            }
+            if (khstring_size(&value) == 0) {
+                raiseError(value_begin - origin, U"expecting a number");
+            }
+            break;
+    }
+    khstring_delete(&value);
+
+    kharray_append(&query->conditions, condition);
+    return true;
+}
+
+khAstQuery khAstQuery_new(khstring* pattern) {
+    khAstQuery query = {.has_kind = false,
+                        .kind = khAstNodeKind_STATEMENT,
+                        .type = 0,
+                        .conditions = kharray_new(khAstQueryCondition, deleteCondition)};
+
+    char32_t* origin = *pattern;
+    char32_t* cursor = origin;
+    skipSpaces(&cursor);
+
+    if (*cursor == U'*') {
+        cursor++;
+    }
+    else {
+        char32_t* kind_begin = cursor;
+        khstring kind = takeWord(&cursor);
+        bool is_known = parseKind(&query, &kind);
+        khstring_delete(&kind);
+
+        if (!is_known) {
+            raiseError(kind_begin - origin, U"unknown node kind");
+            return query;
+        }
+    }
+
+    skipSpaces(&cursor);
+    if (*cursor == U'[') {
+        do {
+            cursor++;
+            skipSpaces(&cursor);
+            if (!parseCondition(&query, &cursor, origin)) {
+                return query;
+            }
+            skipSpaces(&cursor);
+        } while (*cursor == U',');
+
+        if (*cursor != U']') {
+            raiseError(cursor - origin, U"expecting a closing square bracket");
+            return query;
+        }
+        cursor++;
+        skipSpaces(&cursor);
+    }
+
+    if (*cursor != U'\0') {
+        raiseError(cursor - origin, U"unexpected character");
+    }
+
+    return query;
+}
+
+void khAstQuery_delete(khAstQuery* query) {
+    kharray_delete(&query->conditions);
+}
+
+
+// Where a star matches any characters, going back to the last star whenever the rest doesn't match
+static bool globMatches(khstring* glob, khstring* string) {
+    char32_t* pattern = *glob;
+    char32_t* pattern_end = pattern + khstring_size(glob);
+    char32_t* chr = *string;
+    char32_t* end = chr + khstring_size(string);
+
+    char32_t* star = NULL;
+    char32_t* star_chr = NULL;
+    while (chr < end) {
+        if (pattern < pattern_end && *pattern == U'*') {
+            star = pattern++;
+            star_chr = chr;
+        }
+        else if (pattern < pattern_end && *pattern == *chr) {
+            pattern++;
+            chr++;
+        }
+        else if (star != NULL) {
+            pattern = star + 1;
+            chr = ++star_chr;
+        }
+        else {
+            return false;
+        }
+    }
+
+    while (pattern < pattern_end && *pattern == U'*') {
+        pattern++;
+    }
+    return pattern == pattern_end;
+}
+
+static inline bool compareNumbers(khAstComparisonExpressionType operation, uint64_t a, uint64_t b) {
+    switch (operation) {
+        case khAstComparisonExpressionType_EQUAL:
+            return a == b;
+        case khAstComparisonExpressionType_UNEQUAL:
+            return a != b;
+        case khAstComparisonExpressionType_LESS:
+            return a < b;
+        case khAstComparisonExpressionType_GREATER:
+            return a > b;
+        case khAstComparisonExpressionType_LESS_EQUAL:
+            return a <= b;
+        case khAstComparisonExpressionType_GREATER_EQUAL:
+            return a >= b;
+
+        default:
+            return false;
+    }
+}
+
+static bool argumentCount(khAstNode node, uint64_t* count) {
+    if (node.kind == khAstNodeKind_STATEMENT) {
+        if (node.statement->type != khAstStatementType_FUNCTION) {
+            return false;
+        }
+        *count = kharray_size(&node.statement->function.arguments);
+        return true;
+    }
+
+    khAstExpression* expression = node.expression;
+    switch (expression->type) {
+        case khAstExpressionType_CALL:
+            *count = kharray_size(&expression->call.arguments);
+            return true;
+        case khAstExpressionType_INDEX:
+            *count = kharray_size(&expression->index.arguments);
+            return true;
+        case khAstExpressionType_TEMPLATIZE:
+            *count = kharray_size(&expression->templatize.template_arguments);
+            return true;
+        case khAstExpressionType_LAMBDA:
+            *count = kharray_size(&expression->lambda->arguments);
+            return true;
+        case khAstExpressionType_SIGNATURE:
+            *count = kharray_size(&expression->signature->argument_types);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool matchesName(khAstIndex* index, khAstIndexEntry* entry, khAstQueryCondition* condition) {
+    if (entry->names_begin == entry->names_end) {
+        return false;
+    }
+
+    bool found = false;
+    for (uint32_t i = entry->names_begin; i < entry->names_end && !found; i++) {
+        found = globMatches(&condition->name, &index->names[index->name_ids[i]].name);
+    }
+
+    return condition->operation == khAstComparisonExpressionType_EQUAL ? found : !found;
+}
+
+static bool matchesOperator(khAstNode node, khAstQueryCondition* condition) {
+    if (node.kind != khAstNodeKind_EXPRESSION) {
+        return false;
+    }
+
+    bool found;
+    if (node.expression->type == khAstExpressionType_UNARY) {
+        found = (int32_t)node.expression->unary.type == condition->unary;
+    }
+    else if (node.expression->type == khAstExpressionType_BINARY) {
+        found = (int32_t)node.expression->binary.type == condition->binary;
+    }
+    else {
+        return false;
+    }
+
+    return condition->operation == khAstComparisonExpressionType_EQUAL ? found : !found;
+}
+
+bool khAstQuery_matches(khAstQuery* query, khAstIndex* index, uint32_t entry) {
+    khAstIndexEntry* index_entry = &index->entries[entry];
+    khAstNode node = index_entry->node;
+
+    if (query->has_kind) {
+        uint32_t type = node.kind == khAstNodeKind_STATEMENT ? (uint32_t)node.statement->type
+                                                             : (uint32_t)node.expression->type;
+        if (node.kind != query->kind || type != query->type) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < kharray_size(&query->conditions); i++) {
+        khAstQueryCondition* condition = &query->conditions[i];
+        uint64_t count;
+
+        switch (condition->attribute) {
+            case khAstQueryAttribute_NAME:
+                if (!matchesName(index, index_entry, condition)) {
+                    return false;
+                }
+                break;
+
+            case khAstQueryAttribute_ARGUMENTS:
+                if (!argumentCount(node, &count) ||
+                    !compareNumbers(condition->operation, count, condition->number)) {
+                    return false;
+                }
+                break;
+
+            case khAstQueryAttribute_OPERATOR:
+                if (!matchesOperator(node, condition)) {
+                    return false;
+                }
+                break;
+
+            case khAstQueryAttribute_DEPTH:
+                if (!compareNumbers(condition->operation, index_entry->depth, condition->number)) {
+                    return false;
+                }
+                break;
+        }
+    }
+
+    return true;
+}
+
+static bool isExactName(khAstQueryCondition* condition) {
+    if (condition->attribute != khAstQueryAttribute_NAME ||
+        condition->operation != khAstComparisonExpressionType_EQUAL) {
+        return false;
+    }
+
+    for (char32_t* chr = condition->name; chr < condition->name + khstring_size(&condition->name);
+         chr++) {
+        if (*chr == U'*') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+kharray(uint32_t) khAstIndex_query(khAstIndex* index, khAstQuery* query) {
+    kharray(uint32_t) matches = kharray_new(uint32_t, NULL);
+
+    // Only the nodes which can match at all are gone through
+    kharray(uint32_t)* candidates = NULL;
+    bool is_narrowed = false;
+    for (size_t i = 0; i < kharray_size(&query->conditions) && !is_narrowed; i++) {
+        if (isExactName(&query->conditions[i])) {
+            candidates = khAstIndex_named(index, &query->conditions[i].name);
+            is_narrowed = true;
+        }
+    }
+
+    if (!is_narrowed && query->has_kind) {
+        candidates = query->kind == khAstNodeKind_STATEMENT ? &index->statement_kinds[query->type]
+                                                            : &index->expression_kinds[query->type];
+        is_narrowed = true;
+    }
+
+    if (!is_narrowed) {
+        for (uint32_t entry = 0; entry < kharray_size(&index->entries); entry++) {
+            if (khAstQuery_matches(query, index, entry)) {
+                kharray_append(&matches, entry);
+            }
+        }
+    }
+    else if (candidates != NULL) {
+        for (size_t i = 0; i < kharray_size(candidates); i++) {
+            if (khAstQuery_matches(query, index, (*candidates)[i])) {
+                kharray_append(&matches, (*candidates)[i]);
+            }
+        }
+    }
+
+    return matches;
+}
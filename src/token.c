@@ -5,238 +5,258 @@
  * Copyright (C) 2022 Kithare Organization
  */
 
+#include <string.h>
+
 #include <kithare/core/token.h>
 #include <kithare/lib/string.h>
+#include <kithare/lib/varint.h>
+#include <kithare/lib/writer.h>
 
 
-khstring khTokenType_string(khTokenType type) {
+static const char32_t* tokenTypeName(khTokenType type) {
     switch (type) {
         case khTokenType_INVALID:
-            return khstring_new(U"invalid");
+            return U"invalid";
         case khTokenType_EOF:
-            return khstring_new(U"eof");
+            return U"eof";
         case khTokenType_NEWLINE:
-            return khstring_new(U"newline");
+            return U"newline";
         case khTokenType_COMMENT:
-            return khstring_new(U"comment");
+            return U"comment";
 
         case khTokenType_IDENTIFIER:
-            return khstring_new(U"identifier");
+            return U"identifier";
         case khTokenType_KEYWORD:
-            return khstring_new(U"keyword");
+            return U"keyword";
         case khTokenType_DELIMITER:
-            return khstring_new(U"delimiter");
+            return U"delimiter";
         case khTokenType_OPERATOR:
-            return khstring_new(U"operator");
+            return U"operator";
 
         case khTokenType_CHAR:
-            return khstring_new(U"char");
+            return U"char";
         case khTokenType_STRING:
-            return khstring_new(U"string");
+            return U"string";
         case khTokenType_BUFFER:
-            return khstring_new(U"buffer");
+            return U"buffer";
 
         case khTokenType_BYTE:
-            return khstring_new(U"byte");
+            return U"byte";
         case khTokenType_INTEGER:
-            return khstring_new(U"integer");
+            return U"integer";
         case khTokenType_UINTEGER:
-            return khstring_new(U"uinteger");
+            return U"uinteger";
         case khTokenType_FLOAT:
-            return khstring_new(U"float");
+            return U"float";
         case khTokenType_DOUBLE:
-            return khstring_new(U"double");
+            return U"double";
         case khTokenType_IDOUBLE:
-            return khstring_new(U"idouble");
+            return U"idouble";
         case khTokenType_IFLOAT:
-            return khstring_new(U"ifloat");
+            return U"ifloat";
 
         default:
-            return khstring_new(U"unknown");
+            return U"unknown";
     }
 }
 
+khstring khTokenType_string(khTokenType type) {
+    return khstring_new(tokenTypeName(type));
+}
 
-khstring khKeywordToken_string(khKeywordToken keyword) {
+
+static const char32_t* keywordTokenName(khKeywordToken keyword) {
     switch (keyword) {
         case khKeywordToken_IMPORT:
-            return khstring_new(U"import");
+            return U"import";
         case khKeywordToken_INCLUDE:
-            return khstring_new(U"include");
+            return U"include";
         case khKeywordToken_AS:
-            return khstring_new(U"as");
+            return U"as";
         case khKeywordToken_DEF:
-            return khstring_new(U"def");
+            return U"def";
         case khKeywordToken_CLASS:
-            return khstring_new(U"class");
+            return U"class";
         case khKeywordToken_INHERITS:
-            return khstring_new(U"inherits");
+            return U"inherits";
         case khKeywordToken_STRUCT:
-            return khstring_new(U"struct");
+            return U"struct";
         case khKeywordToken_ENUM:
-            return khstring_new(U"enum");
+            return U"enum";
         case khKeywordToken_ALIAS:
-            return khstring_new(U"alias");
+            return U"alias";
 
         case khKeywordToken_REF:
-            return khstring_new(U"ref");
+            return U"ref";
         case khKeywordToken_WILD:
-            return khstring_new(U"wild");
+            return U"wild";
         case khKeywordToken_INCASE:
-            return khstring_new(U"incase");
+            return U"incase";
         case khKeywordToken_STATIC:
-            return khstring_new(U"static");
+            return U"static";
 
         case khKeywordToken_IF:
-            return khstring_new(U"if");
+            return U"if";
         case khKeywordToken_ELIF:
-            return khstring_new(U"elif");
+            return U"elif";
         case khKeywordToken_ELSE:
-            return khstring_new(U"else");
+            return U"else";
         case khKeywordToken_FOR:
-            return khstring_new(U"for");
+            return U"for";
         case khKeywordToken_IN:
-            return khstring_new(U"in");
+            return U"in";
         case khKeywordToken_WHILE:
-            return khstring_new(U"while");
+            return U"while";
         case khKeywordToken_DO:
-            return khstring_new(U"do");
+            return U"do";
         case khKeywordToken_BREAK:
-            return khstring_new(U"break");
+            return U"break";
         case khKeywordToken_CONTINUE:
-            return khstring_new(U"continue");
+            return U"continue";
         case khKeywordToken_RETURN:
-            return khstring_new(U"return");
+            return U"return";
 
         default:
-            return khstring_new(U"unknown");
+            return U"unknown";
     }
 }
 
+khstring khKeywordToken_string(khKeywordToken keyword) {
+    return khstring_new(keywordTokenName(keyword));
+}
 
-khstring khDelimiterToken_string(khDelimiterToken delimiter) {
+
+static const char32_t* delimiterTokenName(khDelimiterToken delimiter) {
     switch (delimiter) {
         case khDelimiterToken_DOT:
-            return khstring_new(U".");
+            return U".";
         case khDelimiterToken_COMMA:
-            return khstring_new(U",");
+            return U",";
         case khDelimiterToken_COLON:
-            return khstring_new(U":");
+            return U":";
         case khDelimiterToken_SEMICOLON:
-            return khstring_new(U";");
+            return U";";
         case khDelimiterToken_EXCLAMATION:
-            return khstring_new(U"!");
+            return U"!";
 
         case khDelimiterToken_PARENTHESIS_OPEN:
-            return khstring_new(U"(");
+            return U"(";
         case khDelimiterToken_PARENTHESIS_CLOSE:
-            return khstring_new(U")");
+            return U")";
         case khDelimiterToken_CURLY_BRACKET_OPEN:
-            return khstring_new(U"{");
+            return U"{";
         case khDelimiterToken_CURLY_BRACKET_CLOSE:
-            return khstring_new(U"}");
+            return U"}";
         case khDelimiterToken_SQUARE_BRACKET_OPEN:
-            return khstring_new(U"[");
+            return U"[";
         case khDelimiterToken_SQUARE_BRACKET_CLOSE:
-            return khstring_new(U"]");
+            return U"]";
 
         case khDelimiterToken_ARROW:
-            return khstring_new(U"->");
+            return U"->";
         case khDelimiterToken_ELLIPSIS:
-            return khstring_new(U"...");
+            return U"...";
 
         default:
-            return khstring_new(U"unknown");
+            return U"unknown";
     }
 }
 
+khstring khDelimiterToken_string(khDelimiterToken delimiter) {
+    return khstring_new(delimiterTokenName(delimiter));
+}
 
-khstring khOperatorToken_string(khOperatorToken operator_v) {
+
+static const char32_t* operatorTokenName(khOperatorToken operator_v) {
     switch (operator_v) {
         case khOperatorToken_ASSIGN:
-            return khstring_new(U"=");
+            return U"=";
         case khOperatorToken_RANGE:
-            return khstring_new(U"..");
+            return U"..";
 
         case khOperatorToken_ADD:
-            return khstring_new(U"+");
+            return U"+";
         case khOperatorToken_SUB:
-            return khstring_new(U"-");
+            return U"-";
         case khOperatorToken_MUL:
-            return khstring_new(U"*");
+            return U"*";
         case khOperatorToken_DIV:
-            return khstring_new(U"/");
+            return U"/";
         case khOperatorToken_MOD:
-            return khstring_new(U"%");
+            return U"%";
         case khOperatorToken_DOT:
-            return khstring_new(U"@");
+            return U"@";
         case khOperatorToken_POW:
-            return khstring_new(U"^");
+            return U"^";
 
         case khOperatorToken_IP_ADD:
-            return khstring_new(U"+=");
+            return U"+=";
         case khOperatorToken_IP_SUB:
-            return khstring_new(U"-=");
+            return U"-=";
         case khOperatorToken_IP_MUL:
-            return khstring_new(U"*=");
+            return U"*=";
         case khOperatorToken_IP_DIV:
-            return khstring_new(U"/=");
+            return U"/=";
         case khOperatorToken_IP_MOD:
-            return khstring_new(U"%=");
+            return U"%=";
         case khOperatorToken_IP_DOT:
-            return khstring_new(U"@=");
+            return U"@=";
         case khOperatorToken_IP_POW:
-            return khstring_new(U"^=");
+            return U"^=";
 
         case khOperatorToken_EQUAL:
-            return khstring_new(U"==");
+            return U"==";
         case khOperatorToken_UNEQUAL:
-            return khstring_new(U"!=");
+            return U"!=";
         case khOperatorToken_LESS:
-            return khstring_new(U"<");
+            return U"<";
         case khOperatorToken_GREATER:
-            return khstring_new(U">");
+            return U">";
         case khOperatorToken_LESS_EQUAL:
-            return khstring_new(U"<=");
+            return U"<=";
         case khOperatorToken_GREATER_EQUAL:
-            return khstring_new(U">=");
+            return U">=";
 
         case khOperatorToken_NOT:
-            return khstring_new(U"not");
+            return U"not";
         case khOperatorToken_AND:
-            return khstring_new(U"and");
+            return U"and";
         case khOperatorToken_OR:
-            return khstring_new(U"or");
+            return U"or";
         case khOperatorToken_XOR:
-            return khstring_new(U"xor");
+            return U"xor";
 
         case khOperatorToken_BIT_NOT:
-            return khstring_new(U"~");
+            return U"~";
         case khOperatorToken_BIT_AND:
-            return khstring_new(U"&");
+            return U"&";
         case khOperatorToken_BIT_OR:
-            return khstring_new(U"|");
+            return U"|";
         case khOperatorToken_BIT_LSHIFT:
-            return khstring_new(U"<<");
+            return U"<<";
         case khOperatorToken_BIT_RSHIFT:
-            return khstring_new(U">>");
+            return U">>";
 
         case khOperatorToken_IP_BIT_AND:
-            return khstring_new(U"&=");
+            return U"&=";
         case khOperatorToken_IP_BIT_OR:
-            return khstring_new(U"|=");
+            return U"|=";
         case khOperatorToken_IP_BIT_XOR:
-            return khstring_new(U"~=");
+            return U"~=";
         case khOperatorToken_IP_BIT_LSHIFT:
-            return khstring_new(U"<<=");
+            return U"<<=";
         case khOperatorToken_IP_BIT_RSHIFT:
-            return khstring_new(U">>=");
+            return U">>=";
 
         default:
-            return khstring_new(U"unknown");
+            return U"unknown";
     }
 }
 
+khstring khOperatorToken_string(khOperatorToken operator_v) {
+    return khstring_new(operatorTokenName(operator_v));
+}
+
 
 khToken khToken_copy(khToken* token) {
     khToken copy = *token;
@@ -247,11 +267,15 @@ khToken khToken_copy(khToken* token) {
             break;
 
         case khTokenType_STRING:
-            copy.string = khstring_copy(&token->string);
+            if (token->string != NULL) {
+                copy.string = khstring_copy(&token->string);
+            }
             break;
 
         case khTokenType_BUFFER:
-            copy.buffer = khbuffer_copy(&token->buffer);
+            if (token->buffer != NULL) {
+                copy.buffer = khbuffer_copy(&token->buffer);
+            }
             break;
 
         default:
@@ -261,6 +285,12 @@ khToken khToken_copy(khToken* token) {
     return copy;
 }
 
+khToken khToken_move(khToken* token) {
+    khToken moved = *token;
+    *token = khToken_fromInvalid(token->begin, token->end);
+    return moved;
+}
+
 void khToken_delete(khToken* token) {
     switch (token->type) {
         case khTokenType_IDENTIFIER:
@@ -268,11 +298,15 @@ void khToken_delete(khToken* token) {
             break;
 
         case khTokenType_STRING:
-            khstring_delete(&token->string);
+            if (token->string != NULL) {
+                khstring_delete(&token->string);
+            }
             break;
 
         case khTokenType_BUFFER:
-            khbuffer_delete(&token->buffer);
+            if (token->buffer != NULL) {
+                khbuffer_delete(&token->buffer);
+            }
             break;
 
         default:
@@ -280,99 +314,327 @@ void khToken_delete(khToken* token) {
     }
 }
 
-khstring khToken_string(khToken* token, char32_t* origin) {
-    khstring string = khstring_new(U"{\"type\": ");
+void khToken_write(khToken* token, khWriter* writer, char32_t* origin) {
+    khWriter_cstring(writer, U"{\"type\": ");
+    khWriter_char(writer, U'\"');
+    khWriter_cstring(writer, tokenTypeName(token->type));
+    khWriter_char(writer, U'\"');
 
-    khstring type_str = khTokenType_string(token->type);
-    khstring quoted_type_str = khstring_quote(&type_str);
-    khstring_concatenate(&string, &quoted_type_str);
-
-    khstring_concatenateCstring(&string, U", \"begin\": ");
-    if (token->begin != NULL) {
-        khstring begin_str = kh_uintToString(token->begin - origin, 10);
-        khstring_concatenate(&string, &begin_str);
-        khstring_delete(&begin_str);
-    }
-    else {
-        khstring_concatenateCstring(&string, U"null");
-    }
-
-    khstring_concatenateCstring(&string, U", \"end\": ");
-    if (token->end != NULL) {
-        khstring end_str = kh_uintToString(token->end - origin, 10);
-        khstring_concatenate(&string, &end_str);
-        khstring_delete(&end_str);
-    }
-    else {
-        khstring_concatenateCstring(&string, U"null");
-    }
+    khWriter_cstring(writer, U", \"begin\": ");
+    khWriter_uint(writer, token->begin, 10);
+    khWriter_cstring(writer, U", \"end\": ");
+    khWriter_uint(writer, token->end, 10);
 
-    khstring_concatenateCstring(&string, U", \"value\": ");
-    khstring value;
+    khWriter_cstring(writer, U", \"value\": ");
     switch (token->type) {
         case khTokenType_IDENTIFIER:
-            value = khstring_quote(&token->identifier);
+            khWriter_quote(writer, &token->identifier);
+            break;
+        case khTokenType_KEYWORD:
+            khWriter_char(writer, U'\"');
+            khWriter_cstring(writer, keywordTokenName(token->keyword));
+            khWriter_char(writer, U'\"');
+            break;
+        case khTokenType_DELIMITER:
+            khWriter_char(writer, U'\"');
+            khWriter_cstring(writer, delimiterTokenName(token->delimiter));
+            khWriter_char(writer, U'\"');
+            break;
+        case khTokenType_OPERATOR:
+            khWriter_char(writer, U'\"');
+            khWriter_cstring(writer, operatorTokenName(token->operator_v));
+            khWriter_char(writer, U'\"');
             break;
-        case khTokenType_KEYWORD: {
-            khstring keyword_str = khKeywordToken_string(token->keyword);
-            value = khstring_quote(&keyword_str);
-            khstring_delete(&keyword_str);
-        } break;
-        case khTokenType_DELIMITER: {
-            khstring delimiter_str = khDelimiterToken_string(token->delimiter);
-            value = khstring_quote(&delimiter_str);
-            khstring_delete(&delimiter_str);
-        } break;
-        case khTokenType_OPERATOR: {
-            khstring operator_str = khOperatorToken_string(token->operator_v);
-            value = khstring_quote(&operator_str);
-            khstring_delete(&operator_str);
-        } break;
 
         case khTokenType_CHAR:
-            khstring_append(&string, U'\"');
-            value = kh_escapeChar(token->char_v);
-            khstring_append(&value, U'\"');
+            khWriter_char(writer, U'\"');
+            khWriter_escapeChar(writer, token->char_v);
+            khWriter_char(writer, U'\"');
             break;
+        // Raw payloads are quoted straight from the source, their bytes being no more than 0xFF
         case khTokenType_STRING:
-            value = khstring_quote(&token->string);
+            if (token->string != NULL) {
+                khWriter_quote(writer, &token->string);
+            }
+            else {
+                uint32_t begin;
+                uint32_t end;
+                khToken_rawSpan(token, origin, &begin, &end);
+                khWriter_quoteSpan(writer, origin + begin, origin + end);
+            }
             break;
         case khTokenType_BUFFER:
-            value = khbuffer_quote(&token->buffer);
+            if (token->buffer != NULL) {
+                khWriter_quoteBuffer(writer, &token->buffer);
+            }
+            else {
+                uint32_t begin;
+                uint32_t end;
+                khToken_rawSpan(token, origin, &begin, &end);
+                khWriter_quoteSpan(writer, origin + begin, origin + end);
+            }
             break;
 
         case khTokenType_BYTE:
-            khstring_append(&string, U'\"');
-            value = kh_escapeChar(token->byte);
-            khstring_append(&value, U'\"');
+            khWriter_char(writer, U'\"');
+            khWriter_escapeChar(writer, token->byte);
+            khWriter_char(writer, U'\"');
             break;
         case khTokenType_INTEGER:
-            value = kh_intToString(token->integer, 10);
+            khWriter_int(writer, token->integer, 10);
             break;
         case khTokenType_UINTEGER:
-            value = kh_uintToString(token->uinteger, 10);
+            khWriter_uint(writer, token->uinteger, 10);
             break;
         case khTokenType_FLOAT:
-            value = kh_floatToString(token->float_v, 8, 10);
+            khWriter_float(writer, token->float_v, 8, 10);
             break;
         case khTokenType_DOUBLE:
-            value = kh_floatToString(token->double_v, 16, 10);
+            khWriter_float(writer, token->double_v, 16, 10);
             break;
         case khTokenType_IFLOAT:
-            value = kh_floatToString(token->ifloat, 8, 10);
+            khWriter_float(writer, token->ifloat, 8, 10);
             break;
         case khTokenType_IDOUBLE:
-            value = kh_floatToString(token->idouble, 16, 10);
+            khWriter_float(writer, token->idouble, 16, 10);
             break;
 
         default:
-            value = khstring_new(U"null");
+            khWriter_cstring(writer, U"null");
             break;
     }
 
-    khstring_concatenate(&string, &value);
-    khstring_delete(&value);
-    khstring_append(&string, U'}');
+    khWriter_char(writer, U'}');
+}
+
+khstring khToken_string(khToken* token, char32_t* origin) {
+    khWriter writer = khWriter_newString();
+    khToken_write(token, &writer, origin);
+    return writer.string;
+}
+
+void khToken_rawSpan(khToken* token, char32_t* origin, uint32_t* begin, uint32_t* end) {
+    *begin = token->begin;
+    if (token->type == khTokenType_BUFFER) {
+        (*begin)++;
+    }
+
+    // Triple double quotes can only ever open a multiline string, as `""` is closed right away
+    uint32_t quotes = origin[*begin + 1] == U'"' && origin[*begin + 2] == U'"' ? 3 : 1;
+    *begin += quotes;
+    *end = token->end - quotes;
+}
+
+khstring kh_decodeRawString(char32_t* begin, char32_t* end, khArena* opt_arena) {
+    khstring string = kharray_newIn(char32_t, NULL, opt_arena);
+    kharray_memory(&string, begin, end - begin, NULL);
+    return string;
+}
+
+khbuffer kh_decodeRawBuffer(char32_t* begin, char32_t* end, khArena* opt_arena) {
+    khbuffer buffer = kharray_newIn(uint8_t, NULL, opt_arena);
+    kharray_reserve(&buffer, end - begin);
+
+    for (char32_t* chr = begin; chr < end; chr++) {
+        kharray_append(&buffer, *chr);
+    }
+
+    return buffer;
+}
+
+
+static const uint8_t magic[4] = {'k', 'h', 't', 'k'};
+
+static void putChars(khbuffer* buffer, char32_t* chars, size_t size) {
+    for (char32_t* chr = chars; chr < chars + size; chr++) {
+        kh_putVarint(buffer, *chr);
+    }
+}
+
+khbuffer kh_encodeTokens(kharray(khToken) * tokens) {
+    khbuffer buffer = khbuffer_new("");
+    kharray_reserve(&buffer, sizeof(magic) + 16 + kharray_size(tokens) * 4);
+
+    kharray_memory(&buffer, (uint8_t*)magic, sizeof(magic), NULL);
+    kh_putVarint(&buffer, kh_TOKEN_FORMAT_VERSION);
+    kh_putVarint(&buffer, kharray_size(tokens));
+
+    // Tokens follow each other, so each one's begin is a small step from the previous one's end
+    uint32_t previous = 0;
+    for (khToken* token = *tokens; token < *tokens + kharray_size(tokens); token++) {
+        kh_putVarint(&buffer, token->type);
+        kh_putVarint(&buffer, kh_zigzag((int64_t)token->begin - previous));
+        kh_putVarint(&buffer, kh_zigzag(token->end - token->begin));
+        previous = token->end;
+
+        switch (token->type) {
+            case khTokenType_IDENTIFIER:
+                kh_putVarint(&buffer, khstring_size(&token->identifier));
+                putChars(&buffer, token->identifier, khstring_size(&token->identifier));
+                break;
+            case khTokenType_KEYWORD:
+                kh_putVarint(&buffer, token->keyword);
+                break;
+            case khTokenType_DELIMITER:
+                kh_putVarint(&buffer, token->delimiter);
+                break;
+            case khTokenType_OPERATOR:
+                kh_putVarint(&buffer, token->operator_v);
+                break;
+
+            case khTokenType_CHAR:
+                kh_putVarint(&buffer, token->char_v);
+                break;
+            // Raw ones are zero, the rest their size plus one
+            case khTokenType_STRING:
+                if (token->string != NULL) {
+                    kh_putVarint(&buffer, khstring_size(&token->string) + 1);
+                    putChars(&buffer, token->string, khstring_size(&token->string));
+                }
+                else {
+                    kh_putVarint(&buffer, 0);
+                }
+                break;
+            case khTokenType_BUFFER:
+                if (token->buffer != NULL) {
+                    kh_putVarint(&buffer, khbuffer_size(&token->buffer) + 1);
+                    kharray_concatenate(&buffer, &token->buffer, NULL);
+                }
+                else {
+                    kh_putVarint(&buffer, 0);
+                }
+                break;
+
+            case khTokenType_BYTE:
+                kh_putVarint(&buffer, token->byte);
+                break;
+            case khTokenType_INTEGER:
+                kh_putVarint(&buffer, kh_zigzag(token->integer));
+                break;
+            case khTokenType_UINTEGER:
+                kh_putVarint(&buffer, token->uinteger);
+                break;
+            case khTokenType_FLOAT:
+            case khTokenType_IFLOAT: {
+                uint32_t bits;
+                memcpy(&bits, &token->float_v, sizeof(float));
+                kh_putVarint(&buffer, bits);
+            } break;
+            case khTokenType_DOUBLE:
+            case khTokenType_IDOUBLE: {
+                uint64_t bits;
+                memcpy(&bits, &token->double_v, sizeof(double));
+                kh_putVarint(&buffer, bits);
+            } break;
+
+            default:
+                break;
+        }
+    }
+
+    return buffer;
+}
+
+static khstring getChars(khVarintReader* reader, size_t size) {
+    khstring string = khstring_new(U"");
+    kharray_reserve(&string, size);
+
+    for (size_t i = 0; i < size && reader->valid; i++) {
+        string[i] = khVarintReader_get(reader, UINT32_MAX);
+    }
+    kharray_size(&string) = size;
 
     return string;
 }
+
+kharray(khToken) kh_decodeTokens(uint8_t* data, size_t size, size_t origin_size, bool* success) {
+    kharray(khToken) tokens = kharray_new(khToken, khToken_delete);
+    khVarintReader reader = khVarintReader_new(data, size);
+
+    uint8_t* header = khVarintReader_bytes(&reader, sizeof(magic));
+    if (header == NULL || memcmp(header, magic, sizeof(magic)) != 0 ||
+        khVarintReader_get(&reader, UINT32_MAX) != kh_TOKEN_FORMAT_VERSION) {
+        *success = false;
+        return tokens;
+    }
+
+    size_t count = khVarintReader_count(&reader);
+    kharray_reserve(&tokens, count);
+
+    // Spans are kept within the string, which is all that isn't trusted about the tokens
+    size_t previous = 0;
+    for (size_t i = 0; i < count && reader.valid; i++) {
+        khTokenType type = khVarintReader_get(&reader, khTokenType_IDOUBLE);
+        size_t begin = previous + kh_unzigzag(khVarintReader_get(&reader, UINT64_MAX));
+        size_t end = begin + kh_unzigzag(khVarintReader_get(&reader, UINT64_MAX));
+        reader.valid &= begin <= end && end <= origin_size;
+        if (!reader.valid) {
+            break;
+        }
+        previous = end;
+
+        khToken token = {.begin = begin, .end = end, .file = kh_getFile(), .type = type};
+        switch (type) {
+            case khTokenType_IDENTIFIER:
+                token.identifier = getChars(&reader, khVarintReader_count(&reader));
+                break;
+            case khTokenType_KEYWORD:
+                token.keyword = khVarintReader_get(&reader, khKeywordToken_RETURN);
+                break;
+            case khTokenType_DELIMITER:
+                token.delimiter = khVarintReader_get(&reader, khDelimiterToken_ELLIPSIS);
+                break;
+            case khTokenType_OPERATOR:
+                token.operator_v = khVarintReader_get(&reader, khOperatorToken_IP_BIT_RSHIFT);
+                break;
+
+            case khTokenType_CHAR:
+                token.char_v = khVarintReader_get(&reader, UINT32_MAX);
+                break;
+            case khTokenType_STRING: {
+                size_t size = khVarintReader_get(&reader, UINT32_MAX);
+                reader.valid &= size <= (size_t)(reader.end - reader.cursor) + 1;
+                token.string = size > 0 && reader.valid ? getChars(&reader, size - 1) : NULL;
+            } break;
+            case khTokenType_BUFFER: {
+                size_t size = khVarintReader_get(&reader, UINT32_MAX);
+                uint8_t* bytes = size > 0 ? khVarintReader_bytes(&reader, size - 1) : NULL;
+                if (bytes != NULL) {
+                    token.buffer = khbuffer_new("");
+                    kharray_memory(&token.buffer, bytes, size - 1, NULL);
+                }
+                else {
+                    token.buffer = NULL;
+                }
+            } break;
+
+            case khTokenType_BYTE:
+                token.byte = khVarintReader_get(&reader, UINT8_MAX);
+                break;
+            case khTokenType_INTEGER:
+                token.integer = kh_unzigzag(khVarintReader_get(&reader, UINT64_MAX));
+                break;
+            case khTokenType_UINTEGER:
+                token.uinteger = khVarintReader_get(&reader, UINT64_MAX);
+                break;
+            case khTokenType_FLOAT:
+            case khTokenType_IFLOAT: {
+                uint32_t bits = khVarintReader_get(&reader, UINT32_MAX);
+                memcpy(&token.float_v, &bits, sizeof(float));
+            } break;
+            case khTokenType_DOUBLE:
+            case khTokenType_IDOUBLE: {
+                uint64_t bits = khVarintReader_get(&reader, UINT64_MAX);
+                memcpy(&token.double_v, &bits, sizeof(double));
+            } break;
+
+            default:
+                break;
+        }
+
+        kharray_append(&tokens, token);
+    }
+
+    *success = reader.valid && reader.cursor == reader.end;
+    return tokens;
+}
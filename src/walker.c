@@ -0,0 +1,358 @@
+/*
+ * This file is a part of the Kithare programming language source code.
+ * The source code for Kithare programming language is distributed under the MIT license,
+ *     and it is available as a repository at https://github.com/avaxar/Kithare
+ * Copyright (C) 2022 Kithare Organization
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include <kithare/core/walker.h>
+
+
+typedef struct {
+    khAstNode node;
+    khAstPackedValues* opt_packed; // Where the element is if it's a transient one, built once popped
+    size_t index;
+    size_t depth;
+    bool is_post; // Whether its children are done, and only its post callback is left
+} khWalkEntry;
+
+
+static inline void pushStatement(kharray(khWalkEntry) * stack, khAstStatement* statement,
+                                 size_t depth) {
+    khAstNode node = {.kind = khAstNodeKind_STATEMENT, .statement = statement};
+    kharray_append(stack,
+                   ((khWalkEntry){.node = node, .opt_packed = NULL, .depth = depth, .is_post = false}));
+}
+
+static inline void pushExpression(kharray(khWalkEntry) * stack, khAstExpression* opt_expression,
+                                  size_t depth) {
+    if (opt_expression != NULL) {
+        khAstNode node = {.kind = khAstNodeKind_EXPRESSION, .expression = opt_expression};
+        kharray_append(
+            stack, ((khWalkEntry){.node = node, .opt_packed = NULL, .depth = depth, .is_post = false}));
+    }
+}
+
+static void pushStatements(kharray(khWalkEntry) * stack, kharray(khAstStatement) * statements,
+                           size_t depth) {
+    for (size_t i = 0; i < kharray_size(statements); i++) {
+        pushStatement(stack, &(*statements)[i], depth);
+    }
+}
+
+static void pushExpressions(kharray(khWalkEntry) * stack, kharray(khAstExpression) * expressions,
+                            size_t depth) {
+    for (size_t i = 0; i < kharray_size(expressions); i++) {
+        pushExpression(stack, &(*expressions)[i], depth);
+    }
+}
+
+static void pushArguments(kharray(khWalkEntry) * stack, kharray(khAstVariable) * arguments,
+                          khAstVariable* opt_variadic_argument, size_t depth) {
+    for (size_t i = 0; i < kharray_size(arguments); i++) {
+        pushExpression(stack, (*arguments)[i].opt_type, depth);
+        pushExpression(stack, (*arguments)[i].opt_initializer, depth);
+    }
+
+    if (opt_variadic_argument != NULL) {
+        pushExpression(stack, opt_variadic_argument->opt_type, depth);
+        pushExpression(stack, opt_variadic_argument->opt_initializer, depth);
+    }
+}
+
+// Packed values have no nodes of their own, so only where each element is gets pushed
+static void pushValues(kharray(khWalkEntry) * stack, kharray(khAstExpression) * values,
+                       khAstPackedValues* packed, size_t depth) {
+    if (packed->type == khAstExpressionType_INVALID) {
+        pushExpressions(stack, values, depth);
+        return;
+    }
+
+    khAstNode node = {.kind = khAstNodeKind_EXPRESSION, .is_transient = true, .expression = NULL};
+    for (size_t i = 0; i < khAstPackedValues_size(packed); i++) {
+        kharray_append(stack, ((khWalkEntry){.node = node,
+                                             .opt_packed = packed,
+                                             .index = i,
+                                             .depth = depth,
+                                             .is_post = false}));
+    }
+}
+
+static void pushStatementChildren(kharray(khWalkEntry) * stack, khAstStatement* statement,
+                                  size_t depth) {
+    switch (statement->type) {
+        case khAstStatementType_VARIABLE:
+            pushExpression(stack, statement->variable.opt_type, depth);
+            pushExpression(stack, statement->variable.opt_initializer, depth);
+            break;
+        case khAstStatementType_EXPRESSION:
+            pushExpression(stack, &statement->expression, depth);
+            break;
+
+        case khAstStatementType_FUNCTION: {
+            khAstFunction* function = &statement->function;
+            pushArguments(stack, &function->arguments, function->opt_variadic_argument, depth);
+            pushExpression(stack, function->opt_return_type, depth);
+            pushStatements(stack, &function->block, depth);
+        } break;
+        case khAstStatementType_CLASS:
+            pushExpression(stack, statement->class_v.opt_base_type, depth);
+            pushStatements(stack, &statement->class_v.block, depth);
+            break;
+        case khAstStatementType_STRUCT:
+            pushStatements(stack, &statement->struct_v.block, depth);
+            break;
+        case khAstStatementType_ALIAS:
+            pushExpression(stack, &statement->alias.expression, depth);
+            break;
+
+        case khAstStatementType_IF_BRANCH: {
+            khAstIfBranch* if_branch = &statement->if_branch;
+            for (size_t i = 0; i < kharray_size(&if_branch->branch_conditions); i++) {
+                pushExpression(stack, &if_branch->branch_conditions[i], depth);
+                pushStatements(stack, &if_branch->branch_blocks[i], depth);
+            }
+            pushStatements(stack, &if_branch->else_block, depth);
+        } break;
+        case khAstStatementType_WHILE_LOOP:
+            pushExpression(stack, &statement->while_loop.condition, depth);
+            pushStatements(stack, &statement->while_loop.block, depth);
+            break;
+        case khAstStatementType_DO_WHILE_LOOP:
+            pushStatements(stack, &statement->do_while_loop.block, depth);
+            pushExpression(stack, &statement->do_while_loop.condition, depth);
+            break;
+        case khAstStatementType_FOR_LOOP:
+            pushExpression(stack, &statement->for_loop.iteratee, depth);
+            pushStatements(stack, &statement->for_loop.block, depth);
+            break;
+        case khAstStatementType_RETURN:
+            pushExpressions(stack, &statement->return_v.values, depth);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void pushExpressionChildren(kharray(khWalkEntry) * stack, khAstExpression* expression,
+                                   size_t depth) {
+    switch (expression->type) {
+        case khAstExpressionType_TUPLE:
+            pushValues(stack, &expression->tuple.values, &expression->tuple.packed, depth);
+            break;
+        case khAstExpressionType_ARRAY:
+            pushValues(stack, &expression->array.values, &expression->array.packed, depth);
+            break;
+        case khAstExpressionType_DICT:
+            for (size_t i = 0; i < kharray_size(&expression->dict.keys); i++) {
+                pushExpression(stack, &expression->dict.keys[i], depth);
+                pushExpression(stack, &expression->dict.values[i], depth);
+            }
+            break;
+
+        case khAstExpressionType_SIGNATURE:
+            pushExpressions(stack, &expression->signature->argument_types, depth);
+            pushExpression(stack, expression->signature->opt_return_type, depth);
+            break;
+        case khAstExpressionType_LAMBDA: {
+            khAstLambda* lambda = expression->lambda;
+            pushArguments(stack, &lambda->arguments, lambda->opt_variadic_argument, depth);
+            pushExpression(stack, lambda->opt_return_type, depth);
+            pushStatements(stack, &lambda->block, depth);
+        } break;
+
+        case khAstExpressionType_UNARY:
+            pushExpression(stack, expression->unary.operand, depth);
+            break;
+        case khAstExpressionType_BINARY:
+            pushExpression(stack, expression->binary.left, depth);
+            pushExpression(stack, expression->binary.right, depth);
+            break;
+        // In the order they're written: `value if condition else otherwise`
+        case khAstExpressionType_TERNARY:
+            pushExpression(stack, expression->ternary.value, depth);
+            pushExpression(stack, expression->ternary.condition, depth);
+            pushExpression(stack, expression->ternary.otherwise, depth);
+            break;
+        case khAstExpressionType_COMPARISON:
+            pushExpressions(stack, &expression->comparison.operands, depth);
+            break;
+        case khAstExpressionType_CALL:
+            pushExpression(stack, expression->call.callee, depth);
+            pushExpressions(stack, &expression->call.arguments, depth);
+            break;
+        case khAstExpressionType_INDEX:
+            pushExpression(stack, expression->index.indexee, depth);
+            pushExpressions(stack, &expression->index.arguments, depth);
+            break;
+
+        case khAstExpressionType_SCOPE:
+            pushExpression(stack, expression->scope.value, depth);
+            break;
+        case khAstExpressionType_TEMPLATIZE:
+            pushExpression(stack, expression->templatize.value, depth);
+            pushExpressions(stack, &expression->templatize.template_arguments, depth);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Reverses what got pushed from `first` onwards, so that it gets popped in the order it was pushed
+static inline void reverseFrom(kharray(khWalkEntry) * stack, size_t first) {
+    for (size_t i = first, j = kharray_size(stack); i + 1 < j; i++, j--) {
+        khWalkEntry entry = (*stack)[i];
+        (*stack)[i] = (*stack)[j - 1];
+        (*stack)[j - 1] = entry;
+    }
+}
+
+// Goes until the stack is empty, or until the walk gets stopped by this visitor or another thread's
+static bool walk(kharray(khWalkEntry) * stack, khAstVisitor* visitor, atomic_bool* opt_is_stopped) {
+    while (kharray_size(stack) > 0) {
+        if (opt_is_stopped != NULL && atomic_load_explicit(opt_is_stopped, memory_order_relaxed)) {
+            return false;
+        }
+
+        khWalkEntry entry = (*stack)[kharray_size(stack) - 1];
+        kharray_pop(stack, 1);
+
+        // Built again for the post callback, as it only lives until the callback returns
+        khAstExpression element;
+        if (entry.opt_packed != NULL) {
+            element = khAstPackedValues_get(entry.opt_packed, entry.index);
+            entry.node.expression = &element;
+        }
+
+        if (entry.is_post) {
+            visitor->opt_post(entry.node, entry.depth, visitor->data);
+            continue;
+        }
+
+        khAstWalkAction action = visitor->opt_pre != NULL
+                                     ? visitor->opt_pre(entry.node, entry.depth, visitor->data)
+                                     : khAstWalkAction_CONTINUE;
+        if (action == khAstWalkAction_STOP) {
+            if (opt_is_stopped != NULL) {
+                atomic_store(opt_is_stopped, true);
+            }
+            return false;
+        }
+
+        // Comes back around for the post callback once the children are done
+        if (visitor->opt_post != NULL) {
+            entry.is_post = true;
+            kharray_append(stack, entry);
+        }
+
+        if (action == khAstWalkAction_CONTINUE) {
+            size_t first = kharray_size(stack);
+            if (entry.node.kind == khAstNodeKind_STATEMENT) {
+                pushStatementChildren(stack, entry.node.statement, entry.depth + 1);
+            }
+            else {
+                pushExpressionChildren(stack, entry.node.expression, entry.depth + 1);
+            }
+            reverseFrom(stack, first);
+        }
+    }
+
+    return true;
+}
+
+bool khAst_walk(kharray(khAstStatement) * statements, khAstVisitor* visitor) {
+    kharray(khWalkEntry) stack = kharray_new(khWalkEntry, NULL);
+    pushStatements(&stack, statements, 0);
+    reverseFrom(&stack, 0);
+
+    bool is_done = walk(&stack, visitor, NULL);
+    kharray_delete(&stack);
+    return is_done;
+}
+
+bool khAstStatement_walk(khAstStatement* statement, khAstVisitor* visitor) {
+    kharray(khWalkEntry) stack = kharray_new(khWalkEntry, NULL);
+    pushStatement(&stack, statement, 0);
+
+    bool is_done = walk(&stack, visitor, NULL);
+    kharray_delete(&stack);
+    return is_done;
+}
+
+bool khAstExpression_walk(khAstExpression* expression, khAstVisitor* visitor) {
+    kharray(khWalkEntry) stack = kharray_new(khWalkEntry, NULL);
+    pushExpression(&stack, expression, 0);
+
+    bool is_done = walk(&stack, visitor, NULL);
+    kharray_delete(&stack);
+    return is_done;
+}
+
+
+typedef struct {
+    kharray(khAstStatement) * statements;
+    khAstVisitor* visitor;
+    atomic_size_t* next; // Index of the next statement to be taken, shared by the workers
+    atomic_bool* is_stopped;
+    pthread_t thread;
+    bool is_started;
+} khWalkWorker;
+
+static void* walkWorker(void* data) {
+    khWalkWorker* worker = (khWalkWorker*)data;
+    kharray(khWalkEntry) stack = kharray_new(khWalkEntry, NULL);
+
+    // Statements are taken one at a time, so that a few big ones don't hold up a single worker
+    size_t index;
+    while ((index = atomic_fetch_add(worker->next, 1)) < kharray_size(worker->statements)) {
+        pushStatement(&stack, &(*worker->statements)[index], 0);
+        if (!walk(&stack, worker->visitor, worker->is_stopped)) {
+            break;
+        }
+    }
+
+    kharray_delete(&stack);
+    return NULL;
+}
+
+bool khAst_walkParallel(kharray(khAstStatement) * statements, khAstVisitor* visitors, size_t workers) {
+    if (workers > kharray_size(statements)) {
+        workers = kharray_size(statements);
+    }
+    if (workers <= 1) {
+        return khAst_walk(statements, visitors);
+    }
+
+    atomic_size_t next = 0;
+    atomic_bool is_stopped = false;
+    khWalkWorker* walk_workers = (khWalkWorker*)malloc(sizeof(khWalkWorker) * workers);
+
+    // The calling thread is the first worker, which also takes the statements of any thread that
+    // couldn't be started
+    for (size_t i = 0; i < workers; i++) {
+        walk_workers[i] = (khWalkWorker){.statements = statements,
+                                         .visitor = &visitors[i],
+                                         .next = &next,
+                                         .is_stopped = &is_stopped};
+        if (i > 0) {
+            walk_workers[i].is_started =
+                pthread_create(&walk_workers[i].thread, NULL, walkWorker, &walk_workers[i]) == 0;
+        }
+    }
+
+    walkWorker(&walk_workers[0]);
+    for (size_t i = 1; i < workers; i++) {
+        if (walk_workers[i].is_started) {
+            pthread_join(walk_workers[i].thread, NULL);
+        }
+    }
+
+    free(walk_workers);
+    return !atomic_load(&is_stopped);
+}